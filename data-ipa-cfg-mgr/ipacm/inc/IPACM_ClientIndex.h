@@ -0,0 +1,314 @@
+/* 
+Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_ClientIndex.h
+
+	@brief
+	Hash index from client MAC or IPv4 address to the slot of the client
+	in the per-interface client arrays.
+*/
+#ifndef IPACM_CLIENTINDEX_H
+#define IPACM_CLIENTINDEX_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IPACM_Defs.h"
+
+#define IPACM_CLIENT_INDEX_MIN_SIZE 16
+#define IPACM_CLIENT_INDEX_EMPTY (-1)
+
+/* Open addressing table with linear probing, keys are compared as
+   bytes. Removal shifts the following entries back, so there are no
+   tombstones and a lookup stops at the first empty entry, or after
+   probing the whole table */
+class IPACM_ClientHash
+{
+public:
+
+	IPACM_ClientHash(int len)
+	{
+		key_len = len;
+		size = 0;
+		tbl = NULL;
+	}
+
+	~IPACM_ClientHash()
+	{
+		free(tbl);
+	}
+
+	int init(int max_clients)
+	{
+		free(tbl);
+		size = IPACM_CLIENT_INDEX_MIN_SIZE;
+		while(size < 2 * max_clients)
+		{
+			size <<= 1;
+		}
+		tbl = (entry *)calloc(size, sizeof(entry));
+		if(tbl == NULL)
+		{
+			size = 0;
+			return IPACM_FAILURE;
+		}
+		clear();
+		return IPACM_SUCCESS;
+	}
+
+	void clear()
+	{
+		for(int i = 0; i < size; i++)
+		{
+			tbl[i].slot = IPACM_CLIENT_INDEX_EMPTY;
+		}
+	}
+
+	/* returns IPACM_CLIENT_INDEX_EMPTY on a miss, for slots beyond IPACM_INVALID_INDEX */
+	int lookup(const void *key)
+	{
+		int i, n;
+
+		if(size == 0)
+		{
+			return IPACM_CLIENT_INDEX_EMPTY;
+		}
+		for(i = hash(key), n = 0; n < size && tbl[i].slot != IPACM_CLIENT_INDEX_EMPTY; i = (i + 1) & (size - 1), n++)
+		{
+			if(memcmp(tbl[i].key, key, key_len) == 0)
+			{
+				return tbl[i].slot;
+			}
+		}
+		return IPACM_CLIENT_INDEX_EMPTY;
+	}
+
+	int find(const void *key)
+	{
+		int slot = lookup(key);
+
+		return (slot == IPACM_CLIENT_INDEX_EMPTY) ? IPACM_INVALID_INDEX : slot;
+	}
+
+	/* the first slot added for a key wins, as with the old array scan */
+	void add(const void *key, int slot)
+	{
+		int i, n;
+
+		if(size == 0)
+		{
+			return;
+		}
+		for(i = hash(key), n = 0; n < size && tbl[i].slot != IPACM_CLIENT_INDEX_EMPTY; i = (i + 1) & (size - 1), n++)
+		{
+			if(memcmp(tbl[i].key, key, key_len) == 0)
+			{
+				return;
+			}
+		}
+		if(n == size)
+		{
+			/* full, cannot happen while the owner stays within its capacity */
+			return;
+		}
+		memcpy(tbl[i].key, key, key_len);
+		tbl[i].slot = slot;
+	}
+
+	void remove(const void *key, int slot)
+	{
+		int i, j, n, home;
+
+		if(size == 0)
+		{
+			return;
+		}
+		for(i = hash(key), n = 0; n < size && tbl[i].slot != IPACM_CLIENT_INDEX_EMPTY; i = (i + 1) & (size - 1), n++)
+		{
+			if(tbl[i].slot == slot && memcmp(tbl[i].key, key, key_len) == 0)
+			{
+				break;
+			}
+		}
+		if(n == size || tbl[i].slot == IPACM_CLIENT_INDEX_EMPTY)
+		{
+			return;
+		}
+
+		/* pull back the entries whose probe sequence crosses the hole */
+		for(j = (i + 1) & (size - 1), n = 1; n < size && tbl[j].slot != IPACM_CLIENT_INDEX_EMPTY; j = (j + 1) & (size - 1), n++)
+		{
+			home = hash(tbl[j].key);
+			if(((j - home) & (size - 1)) >= ((j - i) & (size - 1)))
+			{
+				tbl[i] = tbl[j];
+				i = j;
+			}
+		}
+		tbl[i].slot = IPACM_CLIENT_INDEX_EMPTY;
+	}
+
+	/* the client array was compacted over slot */
+	void shift(int slot)
+	{
+		for(int i = 0; i < size; i++)
+		{
+			if(tbl[i].slot > slot)
+			{
+				tbl[i].slot--;
+			}
+		}
+	}
+
+private:
+
+	typedef struct
+	{
+		int slot;
+		uint8_t key[IPA_MAC_ADDR_SIZE];
+	} entry;
+
+	int key_len;
+	int size;
+	entry *tbl;
+
+	/* FNV-1a */
+	int hash(const void *key)
+	{
+		const uint8_t *p = (const uint8_t *)key;
+		uint32_t h = 2166136261u;
+
+		for(int i = 0; i < key_len; i++)
+		{
+			h = (h ^ p[i]) * 16777619u;
+		}
+		return (int)(h & (uint32_t)(size - 1));
+	}
+};
+
+/* Client lookup by MAC, and by IPv4 address for the interfaces that
+   need it. The owner keeps it in step with its client array */
+class IPACM_ClientIndex
+{
+public:
+
+	IPACM_ClientIndex() : mac_tbl(IPA_MAC_ADDR_SIZE), v4_tbl(sizeof(uint32_t))
+	{
+		max_clients = 0;
+		slot_v4 = NULL;
+	}
+
+	~IPACM_ClientIndex()
+	{
+		free(slot_v4);
+	}
+
+	int init(int max, bool with_ipv4)
+	{
+		max_clients = 0;
+		if(mac_tbl.init(max) != IPACM_SUCCESS)
+		{
+			return IPACM_FAILURE;
+		}
+		if(with_ipv4)
+		{
+			slot_v4 = (uint32_t *)calloc(max, sizeof(uint32_t));
+			if(slot_v4 == NULL || v4_tbl.init(max) != IPACM_SUCCESS)
+			{
+				return IPACM_FAILURE;
+			}
+		}
+		max_clients = max;
+		return IPACM_SUCCESS;
+	}
+
+	/* number of clients the index was sized for */
+	inline int get_capacity()
+	{
+		return max_clients;
+	}
+
+	inline int find(const uint8_t *mac)
+	{
+		return mac_tbl.find(mac);
+	}
+
+	inline int find_ipv4(uint32_t addr)
+	{
+		return v4_tbl.find(&addr);
+	}
+
+	inline void add(const uint8_t *mac, int slot)
+	{
+		mac_tbl.add(mac, slot);
+	}
+
+	/* client at slot now uses addr, 0 drops its IPv4 entry */
+	void set_ipv4(int slot, uint32_t addr)
+	{
+		if(slot_v4 == NULL || slot < 0 || slot >= max_clients)
+		{
+			return;
+		}
+		if(slot_v4[slot] != 0)
+		{
+			v4_tbl.remove(&slot_v4[slot], slot);
+		}
+		slot_v4[slot] = addr;
+		if(addr != 0)
+		{
+			v4_tbl.add(&addr, slot);
+		}
+	}
+
+	/* drop the client at slot, the clients behind it move down by one */
+	void remove(const uint8_t *mac, int slot, int num_clients)
+	{
+		mac_tbl.remove(mac, slot);
+		mac_tbl.shift(slot);
+		if(slot_v4 != NULL && slot >= 0 && slot < num_clients)
+		{
+			set_ipv4(slot, 0);
+			v4_tbl.shift(slot);
+			memmove(&slot_v4[slot], &slot_v4[slot + 1], (num_clients - slot - 1) * sizeof(uint32_t));
+			slot_v4[num_clients - 1] = 0;
+		}
+	}
+
+private:
+
+	int max_clients;
+	IPACM_ClientHash mac_tbl;
+	IPACM_ClientHash v4_tbl;
+	/* IPv4 address currently indexed for each slot */
+	uint32_t *slot_v4;
+};
+
+#endif /* IPACM_CLIENTINDEX_H */
@@ -60,10 +60,21 @@ typedef struct cmd_s
 	ipacm_cmd_q_data data;
 }cmd_t;
 
+/* Pooled message nodes in the ring of each queue, power of 2 */
+#define IPACM_MSG_QUEUE_SIZE 1024
+
+/* Sleep state of a thread serving one or more queues */
+typedef struct _msg_waiter
+{
+	int fd;
+	uint32_t sleeping;
+}msg_waiter;
+
 class Message
 {
 private:
 	Message *m_next;
+	uint32_t m_seq;
 
 public:
 	cmd_t evt;
@@ -71,37 +82,60 @@ public:
 	Message()
 	{
 		m_next = NULL;
+		m_seq = 0;
 		evt.callback_ptr = NULL;
 	}
 	~Message() { }
 	void setnext(Message *item) { m_next = item; }
 	Message* getnext()       { return m_next; }
+	void setseq(uint32_t seq) { __atomic_store_n(&m_seq, seq, __ATOMIC_RELEASE); }
+	uint32_t getseq()        { return __atomic_load_n(&m_seq, __ATOMIC_ACQUIRE); }
 };
 
 class MessageQueue
 {
 
 private:
+	/* Bounded ring of pooled nodes, any thread claims a cell through
+	   enq_pos, only the Process thread moves deq_pos */
+	Message *ring;
+	uint32_t enq_pos;
+	uint32_t deq_pos;
+
+	/* Heap nodes used while the ring is full, drained in order */
 	Message *Head;
 	Message *Tail;
-	Message* dequeue(void);
+	uint32_t overflow_cnt;
+	pthread_mutex_t overflow_lock;
+
+	/* Thread to wake once an event is queued */
+	msg_waiter *waiter;
+
 	static MessageQueue *inst_internal;
 	static MessageQueue *inst_external;
+	static MessageQueue *inst_ct[IPACM_CT_WORKERS];
+	static pthread_mutex_t inst_lock;
 
-	MessageQueue()
-	{
-		Head = NULL;
-		Tail = NULL;
-	}
+	/* eventfds the Process and conntrack worker threads sleep on */
+	static msg_waiter main_waiter;
+	static msg_waiter ct_waiters[IPACM_CT_WORKERS];
+
+	MessageQueue(msg_waiter *);
+	bool dequeue(cmd_t *evt);
+	bool pending(void);
+	void wakeup(void);
+	static bool wait(msg_waiter *, MessageQueue **, int);
 
 public:
 
 	~MessageQueue() { }
-	void enqueue(Message *item);
+	int enqueue(const cmd_t *evt);
 
 	static void* Process(void *);
+	static void* ProcessCt(void *);
 	static MessageQueue* getInstanceInternal();
 	static MessageQueue* getInstanceExternal();
+	static MessageQueue* getInstanceCt(int);
 
 };
 
@@ -109,6 +109,17 @@ public:
 
 	int ipa_nat_max_entries;
 
+	/* Client table sizes per wlan/eth interface */
+	int ipa_max_wlan_clients;
+
+	int ipa_max_eth_clients;
+
+	/* Neighbor cache size */
+	int ipa_max_neighbor_clients;
+
+	/* coalescing window for config file notifications */
+	int ipa_cfg_debounce_ms;
+
 	bool ipacm_odu_router_mode;
 
 	bool ipacm_odu_enable;
@@ -219,6 +230,26 @@ public:
 		return ipa_nat_max_entries;
 	}
 
+	inline int GetMaxWlanClients(void)
+	{
+		return ipa_max_wlan_clients;
+	}
+
+	inline int GetMaxEthClients(void)
+	{
+		return ipa_max_eth_clients;
+	}
+
+	inline int GetMaxNeighborClients(void)
+	{
+		return ipa_max_neighbor_clients;
+	}
+
+	inline int GetCfgDebounceMs(void)
+	{
+		return ipa_cfg_debounce_ms;
+	}
+
 	inline int GetNatIfacesCnt()
 	{
 		return ipa_nat_iface_entries;
@@ -36,6 +36,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <linux/netlink.h>
 
 #include "IPACM_ConntrackClient.h"
 #include "IPACM_CmdQueue.h"
@@ -59,6 +60,22 @@ using namespace std;
 #define UDP_TIMEOUT_UPDATE 20
 #define BROADCAST_IPV4_ADDR 0xFFFFFFFF
 
+/* Event records of each conntrack reader thread, the heap is used
+   only while all of them are queued */
+#define IPACM_CT_EVT_SLAB_SIZE 512
+/* Receive buffer of the conntrack reader threads */
+#define IPACM_CT_RCV_BUF_SIZE 8192
+
+/* Only the reader takes records, from free_list, and refills it with
+   the whole ret_list the handling threads push their records on */
+typedef struct _ct_evt_slab
+{
+	ipacm_ct_evt_data recs[IPACM_CT_EVT_SLAB_SIZE];
+	ipacm_ct_evt_data *free_list;
+	ipacm_ct_evt_data *ret_list;
+	uint32_t heap_cnt;
+}ct_evt_slab;
+
 class IPACM_ConntrackClient
 {
 
@@ -69,15 +86,30 @@ private:
    struct nfct_handle *udp_hdl;
    struct nfct_filter *tcp_filter;
    struct nfct_filter *udp_filter;
+   ct_evt_slab tcp_slab;
+   ct_evt_slab udp_slab;
    static int IPA_Conntrack_Filters_Ignore_Local_Addrs(struct nfct_filter *filter);
    static int IPA_Conntrack_Filters_Ignore_Bridge_Addrs(struct nfct_filter *filter);
    static int IPA_Conntrack_Filters_Ignore_Local_Iface(struct nfct_filter *, ipacm_event_iface_up *);
    IPACM_ConntrackClient();
 
+   static void InitCtEvtSlab(ct_evt_slab *);
+   static ipacm_ct_evt_data* AllocCtEvt(ct_evt_slab *);
+   static int PostCtEvt(ipacm_ct_evt_data *);
+#ifdef IPACM_CT_LIBNFCT_PARSE
+   static void FillCtEvt(struct nf_conntrack *, ipacm_ct_evt_data *);
+#else
+   static int ParseCtEvt(const struct nlmsghdr *, ipacm_ct_evt_data *);
+   static int CatchCtEvts(struct nfct_handle *, ct_evt_slab *, unsigned int);
+#endif
+
 public:
+#ifdef IPACM_CT_LIBNFCT_PARSE
    static int IPAConntrackEventCB(enum nf_conntrack_msg_type type,
                                   struct nf_conntrack *ct,
                                   void *data);
+#endif
+   static void FreeCtEvt(ipacm_ct_evt_data *);
 
    static int IPA_Conntrack_UDP_Filter_Init(void);
    static int IPA_Conntrack_TCP_Filter_Init(void);
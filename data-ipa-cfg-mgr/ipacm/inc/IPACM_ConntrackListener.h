@@ -54,7 +54,7 @@ using namespace std;
 
 typedef struct _nat_entry_bundle
 {
-	struct nf_conntrack *ct;
+	uint8_t tcp_state;
 	enum nf_conntrack_msg_type type;
 	nat_table_entry *rule;
 	bool isTempEntry;
@@ -66,10 +66,15 @@ class IPACM_ConntrackListener : public IPACM_Listener
 
 private:
 	bool isCTReg;
+	int CtWorkerCnt;
 	bool isNatThreadStart;
 	bool WanUp;
 	NatApp *nat_inst;
 
+	/* Held for read by the conntrack workers while they process a
+	   message, for write by handlers changing the state below */
+	pthread_rwlock_t ct_lock;
+
 	int NatIfaceCnt;
 	int StaClntCnt;
 	NatIfaces *pNatIfaces;
@@ -77,28 +82,35 @@ private:
 	uint32_t nonnat_iface_ipv4_addr[MAX_IFACE_ADDRESS];
 	uint32_t sta_clnt_ipv4_addr[MAX_STA_CLNT_IFACES];
 	IPACM_Config *pConfig;
+
+	/* Copies of config and wan state the workers match against,
+	   refreshed by the handlers under ct_lock */
+	bool ip_passthrough_mode;
+	uint32_t passthrough_wan_ip;
+	int num_private_subnet;
+	ipa_private_subnet private_subnet_table[IPA_MAX_PRIVATE_SUBNET_ENTRIES];
 #ifdef CT_OPT
 	IPACM_LanToLan *p_lan2lan;
 #endif
 
 	void ProcessCTMessage(void *);
-	void ProcessTCPorUDPMsg(struct nf_conntrack *,
-	enum nf_conntrack_msg_type, u_int8_t);
+	void ProcessTCPorUDPMsg(const ipacm_ct_evt_data *);
 	void TriggerWANUp(void *);
 	void TriggerWANDown(uint32_t);
 	int  CreateNatThreads(void);
 	int  CreateConnTrackThreads(void);
 	bool AddIface(nat_table_entry *, bool *);
+	void UpdateCfgSnapshot(void);
+	bool isPrivateSubnet(uint32_t);
 	void AddORDeleteNatEntry(const nat_entry_bundle *);
-	void PopulateTCPorUDPEntry(struct nf_conntrack *, uint32_t, nat_table_entry *);
+	void PopulateTCPorUDPEntry(const ipacm_ct_evt_data *, uint32_t, nat_table_entry *);
 	void CheckSTAClient(const nat_table_entry *, bool *);
 	int CheckNatIface(ipacm_event_data_all *, bool *);
 	void HandleNonNatIPAddr(void *, bool);
 
 #ifdef CT_OPT
 	void ProcessCTV6Message(void *);
-	void HandleLan2Lan(struct nf_conntrack *,
-		enum nf_conntrack_msg_type, nat_table_entry* );
+	void HandleLan2Lan(const ipacm_ct_evt_data *, nat_table_entry* );
 #endif
 
 public:
@@ -32,6 +32,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>  /* for stderror */
 #include <stdlib.h>
 #include <cstdio>  /* for perror */
+#include <pthread.h>
 
 #include "IPACM_Config.h"
 #include "IPACM_Xml.h"
@@ -43,6 +44,18 @@ extern "C"
 }
 
 #define MAX_TEMP_ENTRIES 25
+/* Max rules pushed to the nat table with one batch add,
+   not below MAX_TEMP_ENTRIES */
+#define MAX_NAT_COMMIT_ENTRIES 32
+
+/* Max conntrack updates packed into one netlink send, and the room
+   reserved in the send buffer for each update message */
+#define MAX_CT_UPDATE_ENTRIES 64
+#define CT_UPDATE_MSG_SIZE 512
+/* Time to wait for the kernel to ack a batch of conntrack updates */
+#define CT_UPDATE_ACK_TIMEOUT_MS 1000
+/* Seconds between re-reads of the conntrack timeout sysctls */
+#define CT_TIMEOUT_REFRESH_SEC 60
 
 #define IPACM_TCP_FULL_FILE_NAME  "/proc/sys/net/ipv4/netfilter/ip_conntrack_tcp_timeout_established"
 #define IPACM_UDP_FULL_FILE_NAME   "/proc/sys/net/ipv4/netfilter/ip_conntrack_udp_timeout_stream"
@@ -67,6 +80,40 @@ typedef struct _nat_table_entry
 
 }nat_table_entry;
 
+/* Per cache slot links into the client (private ip) and
+   target ip lists, used to visit only one client's entries */
+typedef struct _nat_cache_link
+{
+	int priv_next;
+	int priv_prev;
+
+	int trgt_next;
+	int trgt_prev;
+
+}nat_cache_link;
+
+/* The cache index is split into independently locked shards so the
+   conntrack workers rarely wait on each other */
+#define NAT_CACHE_SHARDS IPACM_CT_WORKERS
+
+/* Index and client lists of the flows whose 5-tuple hashes to the
+   shard. Cache slots come from one pool shared by all shards */
+typedef struct _nat_cache_shard
+{
+	pthread_mutex_t lock;
+
+	/* Open addressing (linear probe) index over cache keyed on the
+	   5-tuple, holds cache slot numbers or NAT_INVALID_SLOT */
+	int *hash_tbl;
+
+	/* Client lists, heads hashed by ip with the same mask as hash_tbl */
+	int *priv_ip_bkts;
+	int *trgt_ip_bkts;
+
+}nat_cache_shard;
+
+#define NAT_INVALID_SLOT -1
+
 #define CHK_TBL_HDL()  if(nat_table_hdl == 0){ return -1; }
 
 class NatApp
@@ -83,22 +130,71 @@ private:
 
 	int curCnt, max_entries;
 
+	/* Lock order: temp_lock, shard locks in index order, slot_lock.
+	   Per flow calls hold the flow's shard, calls spanning clients or
+	   the table hold all shards */
+	nat_cache_shard shards[NAT_CACHE_SHARDS];
+	uint32_t hash_mask;
+	pthread_mutex_t temp_lock;
+
+	/* Stack of unused cache slots and curCnt, under slot_lock */
+	int *free_slots;
+	int free_cnt;
+	pthread_mutex_t slot_lock;
+
+	/* Links of each slot into its shard's client lists */
+	nat_cache_link *links;
+
+	/* Cache slot of each nat rule handle, checked against the slot's
+	   rule_hdl on lookup so stale mappings need no cleanup. Sized for
+	   every handle the table can give out, so it is never moved */
+	int *hdl_slots;
+	uint32_t hdl_slots_cnt;
+
+	/* Time stamps of all rules, filled by one query per UDP update */
+	ipa_nat_rule_ts *ts_buf;
+
 	ipacm_alg *pALGPorts;
 	uint16_t nALGPort;
 
 	uint32_t tcp_timeout;
 	uint32_t udp_timeout;
 
-	uint32_t PwrSaveIfs[IPA_MAX_NUM_WIFI_CLIENTS];
+	uint32_t *PwrSaveIfs;
+	int num_pwrsave_ifs;
 
 	struct nf_conntrack *ct;
 	struct nfct_handle *ct_hdl;
 
+	/* Netlink send/receive buffer for batched conntrack updates */
+	char *ct_msg_buf;
+	/* Monotonic time of the last timeout sysctl read, 0 if never */
+	time_t ct_timeout_read;
+
 	NatApp();
 	int Init();
 
-	void UpdateCTUdpTs(nat_table_entry *, uint32_t);
+	void FillCTUpdate(const nat_table_entry *, uint32_t);
+	int UpdateCTUdpTs(const nat_table_entry *, int, uint32_t, int *);
+	void RefreshTimeouts(void);
 	bool ChkForDup(const nat_table_entry *);
+	uint32_t HashTuple(const nat_table_entry *);
+	uint32_t HashIp(uint32_t);
+	nat_cache_shard* ShardOf(uint32_t);
+	void LockShard(const nat_table_entry *);
+	void UnlockShard(const nat_table_entry *);
+	void LockShards();
+	void UnlockShards();
+	int FindEntry(const nat_table_entry *);
+	int AllocSlot();
+	void IndexEntry(int);
+	void UnindexEntry(int);
+	void FreeEntry(int);
+	void DeleteEntries(const int *, int);
+	void MapRuleHdl(int);
+	int SlotOfRuleHdl(uint32_t);
+	int AllocEntry(const nat_table_entry *, int *);
+	void CommitEntries(int *, int);
 	bool isAlgPort(uint8_t, uint16_t);
 	void Reset();
 	bool isPwrSaveIf(uint32_t);
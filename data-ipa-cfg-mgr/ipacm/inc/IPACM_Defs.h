@@ -107,6 +107,10 @@ extern "C"
 #define TCP_RST_SHIFT 18
 #define NUM_IPV6_PREFIX_FLT_RULE 1
 
+/* Threads processing ipv4 conntrack events, each one owns the
+   connections whose tuple hashes to it */
+#define IPACM_CT_WORKERS 4
+
 /*---------------------------------------------------------------------------
 										Return values indicating error status
 ---------------------------------------------------------------------------*/
@@ -117,9 +121,19 @@ extern "C"
 #define IPACM_IP_NULL (ipa_ip_type)0xFF
 #define IPACM_INVALID_INDEX (ipa_ip_type)0xFF
 
+/* wifi/eth defaults, MaxWlanClients/MaxEthClients in IPACM_cfg.xml override them */
 #define IPA_MAX_NUM_WIFI_CLIENTS  32
 #define IPA_MAX_NUM_WAN_CLIENTS  10
 #define IPA_MAX_NUM_ETH_CLIENTS  15
+/* client indexes share the value space of IPACM_INVALID_INDEX */
+#define IPA_MAX_NUM_CLIENTS_LIMIT 254
+/* neighbor cache default, MaxNeighborClients in IPACM_cfg.xml overrides it */
+#define IPA_MAX_NUM_NEIGHBOR_CLIENTS  100
+#define IPA_MAX_NUM_NEIGHBOR_LIMIT  1024
+
+/* window for coalescing config file change notifications, in msec */
+#define IPACM_CFG_DEBOUNCE_MS  200
+#define IPACM_CFG_DEBOUNCE_MAX_MS  5000
 #define IPA_MAX_NUM_AMPDU_RULE  15
 #define IPA_MAC_ADDR_SIZE  6
 
@@ -218,10 +232,34 @@ typedef enum
 	INTERNET
 } ipacm_wlan_access_mode;
 
-typedef struct
+/* Attributes of one conntrack event, in host order. Records come
+   from the slab of the thread reading the events */
+typedef struct _ipacm_ct_evt_data
 {
-	struct nf_conntrack *ct;
 	enum nf_conntrack_msg_type type;
+	uint32_t status;
+	uint8_t l3proto;
+	uint8_t l4proto;
+	uint8_t tcp_state;
+
+	uint32_t orig_src_ip;
+	uint32_t orig_dst_ip;
+	uint32_t repl_src_ip;
+	uint32_t repl_dst_ip;
+	uint16_t orig_src_port;
+	uint16_t orig_dst_port;
+	uint16_t repl_src_port;
+	uint16_t repl_dst_port;
+
+#ifdef CT_OPT
+	/* Orig tuple of ipv6 connections, network order */
+	uint32_t orig_src_ipv6[4];
+	uint32_t orig_dst_ipv6[4];
+#endif
+
+	/* Owning slab, NULL for records taken from the heap */
+	void *slab;
+	struct _ipacm_ct_evt_data *next;
 }ipacm_ct_evt_data;
 
 typedef struct
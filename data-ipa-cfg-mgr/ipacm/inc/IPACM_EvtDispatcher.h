@@ -45,14 +45,14 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Defs.h"
 #include "IPACM_Listener.h"
 
-/* queue */
-typedef struct _cmd_evts
+/* Listeners of one event in registration order. Entries deregistered
+   while an event is dispatched are NULLed and squeezed out after it */
+typedef struct _evt_listeners
 {
-	ipa_cm_event_id event;
-	IPACM_Listener *obj;
-	//int ipa_interface_index;
-	_cmd_evts *next;
-}  cmd_evts;
+	IPACM_Listener **obj;
+	int num;
+	int size;
+}  evt_listeners;
 
 
 
@@ -69,8 +69,21 @@ public:
 	static int PostEvt(ipacm_cmd_q_data *);
 	static void ProcessEvt(ipacm_cmd_q_data *);
 
+	/* api for the conntrack listener to take events on the workers */
+	static int registr_ct(IPACM_Listener *obj);
+
+	/* queue a conntrack event on the worker picked by the flow hash */
+	static int PostCtEvt(ipacm_cmd_q_data *, uint32_t);
+	static void ProcessCtEvt(ipacm_cmd_q_data *);
+
 private:
-	static cmd_evts *head;
+	static evt_listeners listeners[IPACM_EVENT_MAX];
+	static IPACM_Listener *ct_listener;
+	static bool dispatching;
+	static bool stale;
+
+	static void compact(evt_listeners *evt);
+	static void release(ipacm_cmd_q_data *data);
 };
 
 #endif /* IPACM_EvtDispatcher_H */
@@ -43,8 +43,10 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPACM_FILTERING_H
 
 #include <stdint.h>
+#include <pthread.h>
 #include <linux/msm_ipa.h>
 #include <IPACM_Defs.h>
+#include "IPACM_RuleBatch.h"
 #include <linux/rmnet_ipa_fd_ioctl.h>
 
 class IPACM_Filtering
@@ -52,8 +54,10 @@ class IPACM_Filtering
 public:
 	IPACM_Filtering();
 	~IPACM_Filtering();
-	bool AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTable);
-	bool AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after const *ruleTable);
+	bool AddFilteringRule(struct ipa_ioc_add_flt_rule *ruleTable);
+	/* all rules of the batch or none of them are installed */
+	bool AddFilteringRule(IPACM_FltRuleBatch *batch);
+	bool AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after *ruleTable);
 	bool DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable);
 	bool Commit(enum ipa_ip_type ip);
 	bool Reset(enum ipa_ip_type ip);
@@ -67,9 +71,45 @@ public:
 	bool ModifyFilteringRule(struct ipa_ioc_mdfy_flt_rule* ruleTable);
 	ipa_filter_action_enum_v01 GetQmiFilterAction(ipa_flt_action action);
 
+	/* While a scope is open, the commits of the rule adds requested by the
+	   thread that opened it are folded into one commit per ip family at the
+	   end. Deletes and modifies are still committed right away */
+	void BeginDeferredCommit();
+	void EndDeferredCommit();
+
+	static inline uint32_t GetNumCommit()
+	{
+		return num_commit;
+	}
+
+	static inline uint32_t GetNumCommitSaved()
+	{
+		return num_commit_saved;
+	}
+
+	inline IPACM_FltRuleBatch *GetBatch(int expected)
+	{
+		return batch_pool.get(expected);
+	}
+
+	inline void PutBatch(IPACM_FltRuleBatch *batch)
+	{
+		batch_pool.put(batch);
+	}
+
 private:
 	static const char *DEVICE_NAME;
 	int fd; /* File descriptor of the IPA device node /dev/ipa */
+
+	static int commit_depth;
+	static pthread_t commit_owner;
+	static uint32_t commit_pending[IPA_IP_MAX];
+	static uint32_t num_commit;
+	static uint32_t num_commit_saved;
+
+	void DeferCommit(uint8_t *commit, enum ipa_ip_type ip);
+	void CountCommit(uint8_t commit, enum ipa_ip_type ip);
+	IPACM_RuleBatchPool<ipa_ioc_add_flt_rule> batch_pool;
 };
 
 #endif //IPACM_FILTERING_H
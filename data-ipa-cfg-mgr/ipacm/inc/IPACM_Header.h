@@ -41,6 +41,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdint.h>
 #include "linux/msm_ipa.h"
+#include "IPACM_RuleBatch.h"
 
 //////////////////////////////////////////////////////////////////////////////////
 
@@ -48,8 +49,11 @@ class IPACM_Header
 {
 private:
 	int m_fd;
+	IPACM_RuleBatchPool<ipa_ioc_add_hdr> batch_pool;
 public:
 	bool AddHeader(struct ipa_ioc_add_hdr   *pHeaderTable);
+	/* all headers of the batch or none of them are installed */
+	bool AddHeader(IPACM_HdrBatch *batch);
 	bool DeleteHeader(struct ipa_ioc_del_hdr *pHeaderTable);
 	bool GetHeaderHandle(struct ipa_ioc_get_hdr *pHeaderStruct);
 	bool CopyHeader(struct ipa_ioc_copy_hdr *pCopyHeaderStruct);
@@ -59,6 +63,16 @@ public:
 	bool AddHeaderProcCtx(struct ipa_ioc_add_hdr_proc_ctx* pHeader);
 	bool DeleteHeaderProcCtx(uint32_t hdl);
 
+	inline IPACM_HdrBatch *GetBatch(int expected)
+	{
+		return batch_pool.get(expected);
+	}
+
+	inline void PutBatch(IPACM_HdrBatch *batch)
+	{
+		batch_pool.put(batch);
+	}
+
 	IPACM_Header();
 	~IPACM_Header();
 	bool DeviceNodeIsOpened();
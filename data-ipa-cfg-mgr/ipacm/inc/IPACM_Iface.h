@@ -69,6 +69,14 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAX_SOFTWAREROUTING_FILTERTING_RULES 2
 #define INVALID_IFACE -1
 
+/* direct map from linux ifindex to ipa interface, larger ifindexes take the slow path.
+   entries hold ipa index + IPA_IFINDEX_MAP_BIAS so that zero means not resolved yet
+   and one that the link was renamed, to be resolved by name again */
+#define IPA_IFINDEX_MAP_SIZE 512
+#define IPA_IFINDEX_MAP_BIAS 3
+#define IPA_IFINDEX_UNRESOLVED 0
+#define IPA_IFINDEX_RENAMED 1
+
 /* iface */
 class IPACM_Iface :public IPACM_Listener
 {
@@ -120,6 +128,13 @@ public:
 	/* Query ipa_interface_index by given linux interface_index */
 	static int iface_ipa_index_query(int interface_index);
 
+	/* Drop a cached negative lookup, or a positive one whose link now has
+	   another name, called on netlink link events */
+	static void iface_ipa_index_invalidate(int interface_index, const char *ifname);
+
+	/* Drop every cached lookup, called when iface_table is rebuilt */
+	static void iface_ipa_index_flush(void);
+
 	/* Query ipa_interface ipv4_addr by given linux interface_index */
 	static void iface_addr_query(int interface_index);
 
@@ -148,6 +163,19 @@ public:
 private:
 
 	static const char *DEVICE_NAME;
+
+	/* linux ifindex -> ipa index + IPA_IFINDEX_MAP_BIAS */
+	static int16_t ifindex_map[IPA_IFINDEX_MAP_SIZE];
+
+	/* hash of the iface name a positive entry was mapped by */
+	static uint32_t ifindex_name_hash[IPA_IFINDEX_MAP_SIZE];
+
+	/* bumped on every invalidation, guards stores racing a link event */
+	static uint32_t ifindex_map_gen;
+
+	static int iface_ipa_index_resolve(int interface_index, bool by_name, bool *cacheable);
+
+	static uint32_t iface_name_hash(const char *name);
 };
 
 #endif /* IPACM_IFACE_H */
@@ -49,6 +49,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Filtering.h"
 #include "IPACM_Config.h"
 #include "IPACM_Conntrack_NATApp.h"
+#include "IPACM_ClientIndex.h"
 
 #define IPA_WAN_DEFAULT_FILTER_RULE_HANDLES  1
 #define IPA_PRIV_SUBNET_FILTER_RULE_HANDLES  3
@@ -57,12 +58,6 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define NUM_IPV4_ICMP_FLT_RULE 1
 #define NUM_IPV6_ICMP_FLT_RULE 1
 
-/* ndc bandwidth ipatetherstats <ifaceIn> <ifaceOut> */
-/* <in->out_bytes> <in->out_pkts> <out->in_bytes> <out->in_pkts */
-
-#define PIPE_STATS "%s %s %lu %lu %lu %lu"
-#define IPA_PIPE_STATS_FILE_NAME "/data/misc/ipa/tether_stats"
-
 /* store each lan-iface unicast routing rule and its handler*/
 struct ipa_lan_rt_rule
 {
@@ -245,6 +240,9 @@ private:
 
 	int num_eth_client;
 
+	/* MAC lookup into eth_client */
+	IPACM_ClientIndex eth_client_idx;
+
 	NatApp *Nat_App;
 
 	int ipv6_set;
@@ -268,32 +266,17 @@ private:
 	inline int get_eth_client_index(uint8_t *mac_addr)
 	{
 		int cnt;
-		int num_eth_client_tmp = num_eth_client;
 
-		IPACMDBG_H("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
+		IPACMDBG("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
 						 mac_addr[0], mac_addr[1], mac_addr[2],
 						 mac_addr[3], mac_addr[4], mac_addr[5]);
 
-		for(cnt = 0; cnt < num_eth_client_tmp; cnt++)
+		cnt = eth_client_idx.find(mac_addr);
+		if(cnt != IPACM_INVALID_INDEX)
 		{
-			IPACMDBG_H("stored MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
-							 get_client_memptr(eth_client, cnt)->mac[0],
-							 get_client_memptr(eth_client, cnt)->mac[1],
-							 get_client_memptr(eth_client, cnt)->mac[2],
-							 get_client_memptr(eth_client, cnt)->mac[3],
-							 get_client_memptr(eth_client, cnt)->mac[4],
-							 get_client_memptr(eth_client, cnt)->mac[5]);
-
-			if(memcmp(get_client_memptr(eth_client, cnt)->mac,
-								mac_addr,
-								sizeof(get_client_memptr(eth_client, cnt)->mac)) == 0)
-			{
-				IPACMDBG_H("Matched client index: %d\n", cnt);
-				return cnt;
-			}
+			IPACMDBG_H("Matched client index: %d\n", cnt);
 		}
-
-		return IPACM_INVALID_INDEX;
+		return cnt;
 	}
 
 	inline int delete_eth_rtrules(int clt_indx, ipa_ip_type iptype)
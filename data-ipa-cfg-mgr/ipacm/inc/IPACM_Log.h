@@ -48,6 +48,8 @@ extern "C"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
 #include <syslog.h>
 
 #define MAX_BUF_LEN 256
@@ -58,45 +60,219 @@ extern "C"
 #define IPACMLOG_FILE "/etc/ipacm_log_file"
 #endif /* defined(NOT FEATURE_IPA_ANDROID)*/
 
+/* Log levels, the ones above IPACM_LOG_LEVEL compile to nothing */
+#define IPACM_LOG_ERR  0
+#define IPACM_LOG_HIGH 1
+#define IPACM_LOG_DBG  2
+
+#ifndef IPACM_LOG_LEVEL
+#ifdef DEBUG
+#define IPACM_LOG_LEVEL IPACM_LOG_DBG
+#else
+#define IPACM_LOG_LEVEL IPACM_LOG_HIGH
+#endif
+#endif
+
+/* Record flags, applied by the drain thread */
+#define IPACM_LOG_F_PREFIX 0x1	/* file:line function() prefix */
+#define IPACM_LOG_F_SOCK   0x2	/* also sent on the ipacm_log socket */
+#define IPACM_LOG_F_KMSG   0x4	/* also written to /dev/kmsg */
+
+#ifdef DEBUG
+#define IPACM_LOG_F_HIGH (IPACM_LOG_F_PREFIX | IPACM_LOG_F_SOCK)
+#else
+#define IPACM_LOG_F_HIGH IPACM_LOG_F_PREFIX
+#endif
+
+/* Records of each logging thread, power of 2. A full ring drops
+   new records and counts them */
+#define IPACM_LOG_RING_SIZE 512
+/* Encoded arguments of one record, string arguments are copied */
+#define IPACM_LOG_ARG_LEN 176
+
+#define IPACM_LOG_ARG_INT 1
+#define IPACM_LOG_ARG_DBL 2
+#define IPACM_LOG_ARG_PTR 3
+#define IPACM_LOG_ARG_STR 4
+
 typedef struct ipacm_log_buffer_s {
 	char	user_data[MAX_BUF_LEN];
 } ipacm_log_buffer_t;
 
+/* Format string and location are literals, only pointers are kept */
+typedef struct ipacm_log_rec_s {
+	const char *fmt;
+	const char *file;
+	const char *func;
+	uint16_t line;
+	uint8_t level;
+	uint8_t flags;
+	uint16_t len;
+	char args[IPACM_LOG_ARG_LEN];
+} ipacm_log_rec_t;
+
 void ipacm_log_send( void * user_data);
 
-static char buffer_send[MAX_BUF_LEN];
-static char dmesg_cmd[MAX_BUF_LEN];
+/* Next free record of the calling thread's ring, NULL if full */
+ipacm_log_rec_t *ipacm_log_reserve(uint8_t level);
+/* Publishes the record returned by ipacm_log_reserve() */
+void ipacm_log_commit(void);
+/* Formats a record on the calling thread, for errors hitting a full ring */
+void ipacm_log_emit(const ipacm_log_rec_t *rec);
+/* Formats whatever is queued, for exit paths */
+void ipacm_log_flush(void);
 
-#define IPACMDBG_DMESG(fmt, ...) memset(buffer_send, 0, MAX_BUF_LEN);\
-								 snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s: " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-								 ipacm_log_send (buffer_send);\
-								 printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
-								 memset(dmesg_cmd, 0, MAX_BUF_LEN);\
-								 snprintf(dmesg_cmd, MAX_BUF_LEN, "echo %s > /dev/kmsg", buffer_send);\
-								 system(dmesg_cmd);
-#ifdef DEBUG
-#define PERROR(fmt)   memset(buffer_send, 0, MAX_BUF_LEN);\
-					  snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s()", __FILE__, __LINE__, __FUNCTION__);\
-					  ipacm_log_send (buffer_send); \
-                      perror(fmt);
-#define IPACMERR(fmt, ...)	memset(buffer_send, 0, MAX_BUF_LEN);\
-							snprintf(buffer_send,MAX_BUF_LEN,"ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							ipacm_log_send (buffer_send);\
-							printf("ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define IPACMDBG_H(fmt, ...) memset(buffer_send, 0, MAX_BUF_LEN);\
-							 snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							 ipacm_log_send (buffer_send);\
-							 printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#ifdef __cplusplus
+}
+
+/* templates and overloads below, keep them C++ even when this header
+   is reached from inside an extern "C" block */
+extern "C++"
+{
+
+typedef struct ipacm_log_enc_s {
+	char *pos;
+	char *end;
+} ipacm_log_enc_t;
+
+static inline void ipacm_log_put_raw(ipacm_log_enc_t *enc, uint8_t tag, const void *val)
+{
+	if(enc->end - enc->pos < 1 + 8)
+	{
+		enc->pos = enc->end;
+		return;
+	}
+	*enc->pos++ = tag;
+	memcpy(enc->pos, val, 8);
+	enc->pos += 8;
+}
+
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, const char *str)
+{
+	size_t len;
+
+	if(str == NULL)
+	{
+		str = "(null)";
+	}
+	if(enc->end - enc->pos < 2)
+	{
+		enc->pos = enc->end;
+		return;
+	}
+	len = strnlen(str, enc->end - enc->pos - 2);
+	*enc->pos++ = IPACM_LOG_ARG_STR;
+	memcpy(enc->pos, str, len);
+	enc->pos[len] = '\0';
+	enc->pos += len + 1;
+}
+
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, char *str)
+{
+	ipacm_log_put(enc, (const char *)str);
+}
+
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, double val)
+{
+	ipacm_log_put_raw(enc, IPACM_LOG_ARG_DBL, &val);
+}
+
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, float val)
+{
+	ipacm_log_put(enc, (double)val);
+}
+
+template<typename T>
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, T *ptr)
+{
+	uint64_t val = (uint64_t)(uintptr_t)ptr;
+	ipacm_log_put_raw(enc, IPACM_LOG_ARG_PTR, &val);
+}
+
+/* Integers and enums, sign extended */
+template<typename T>
+static inline void ipacm_log_put(ipacm_log_enc_t *enc, T arg)
+{
+	uint64_t val = (uint64_t)(int64_t)arg;
+	ipacm_log_put_raw(enc, IPACM_LOG_ARG_INT, &val);
+}
+
+static inline void ipacm_log_pack(ipacm_log_enc_t *)
+{
+}
+
+template<typename T, typename... Args>
+static inline void ipacm_log_pack(ipacm_log_enc_t *enc, T arg, Args... args)
+{
+	ipacm_log_put(enc, arg);
+	ipacm_log_pack(enc, args...);
+}
+
+/* Copies the arguments into the thread's ring, formatting is left
+   to the drain thread. Only errors are written out when it is full */
+template<typename... Args>
+static inline void ipacm_log_rec(uint8_t level, uint8_t flags, const char *file,
+	int line, const char *func, const char *fmt, Args... args)
+{
+	ipacm_log_rec_t *rec, local;
+	ipacm_log_enc_t enc;
+	int err = errno;
+
+	rec = ipacm_log_reserve(level);
+	if(rec == NULL)
+	{
+		if(level != IPACM_LOG_ERR)
+		{
+			return;
+		}
+		rec = &local;
+	}
+
+	rec->fmt = fmt;
+	rec->file = file;
+	rec->func = func;
+	rec->line = (uint16_t)line;
+	rec->level = level;
+	rec->flags = flags;
+	enc.pos = rec->args;
+	enc.end = rec->args + IPACM_LOG_ARG_LEN;
+	ipacm_log_pack(&enc, args...);
+	rec->len = (uint16_t)(enc.pos - rec->args);
+
+	if(rec == &local)
+	{
+		ipacm_log_emit(rec);
+	}
+	else
+	{
+		ipacm_log_commit();
+	}
+	errno = err;
+}
+
+#define IPACM_LOG_REC(level, flags, fmt, ...) \
+	ipacm_log_rec(level, flags, __FILE__, __LINE__, __FUNCTION__, fmt, ##__VA_ARGS__)
+
+#define IPACMDBG_DMESG(fmt, ...) IPACM_LOG_REC(IPACM_LOG_HIGH, IPACM_LOG_F_PREFIX | IPACM_LOG_F_SOCK | IPACM_LOG_F_KMSG, fmt, ##__VA_ARGS__);
+#define PERROR(fmt) IPACM_LOG_REC(IPACM_LOG_ERR, IPACM_LOG_F_HIGH, "%s: %s\n", fmt, strerror(errno));
+#define IPACMERR(fmt, ...) IPACM_LOG_REC(IPACM_LOG_ERR, IPACM_LOG_F_HIGH, fmt, ##__VA_ARGS__);
+
+#if IPACM_LOG_LEVEL >= IPACM_LOG_HIGH
+#define IPACMDBG_H(fmt, ...) IPACM_LOG_REC(IPACM_LOG_HIGH, IPACM_LOG_F_HIGH, fmt, ##__VA_ARGS__);
 #else
-#define PERROR(fmt)   perror(fmt)
-#define IPACMERR(fmt, ...)   printf("ERR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define IPACMDBG_H(fmt, ...) printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#define IPACMDBG_H(fmt, ...)
 #endif
-#define IPACMDBG(fmt, ...)	printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define IPACMLOG(fmt, ...)  printf(fmt, ##__VA_ARGS__);
 
-#ifdef __cplusplus
-}
+#if IPACM_LOG_LEVEL >= IPACM_LOG_DBG
+#define IPACMDBG(fmt, ...) IPACM_LOG_REC(IPACM_LOG_DBG, IPACM_LOG_F_PREFIX, fmt, ##__VA_ARGS__);
+#define IPACMLOG(fmt, ...) IPACM_LOG_REC(IPACM_LOG_DBG, 0, fmt, ##__VA_ARGS__);
+#else
+#define IPACMDBG(fmt, ...)
+#define IPACMLOG(fmt, ...)
 #endif
 
+}
+
+#endif /* __cplusplus */
+
 #endif /* IPACM_LOG_H */
@@ -47,8 +47,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Filtering.h"
 #include "IPACM_Listener.h"
 #include "IPACM_Iface.h"
+#include "IPACM_ClientIndex.h"
 
-#define IPA_MAX_NUM_NEIGHBOR_CLIENTS  100
+#define IPA_NEIGHBOR_NONE (-1)
 
 struct ipa_neighbor_client
 {
@@ -56,6 +57,12 @@ struct ipa_neighbor_client
 	int iface_index;
 	uint32_t v4_addr;
 	int ipa_if_num;
+	/* last seen ipv6 addresses, replayed on re-connect */
+	int num_v6_addr;
+	uint32_t v6_addr[IPV6_NUM_ADDR][4];
+	/* lru list, the free list reuses next */
+	int prev;
+	int next;
 };
 
 class IPACM_Neighbor : public IPACM_Listener
@@ -65,17 +72,50 @@ public:
 
 	IPACM_Neighbor();
 
+	~IPACM_Neighbor();
+
 	void event_callback(ipa_cm_event_id event,
 											void *data);
 
 private:
 
+	int max_neighbor_client;
+
 	int num_neighbor_client;
 
-	int circular_index;
+	ipa_neighbor_client *neighbor_client;
+
+	/* mac -> slot in neighbor_client */
+	IPACM_ClientHash neighbor_idx;
+
+	/* most and least recently used slots */
+	int lru_head;
+
+	int lru_tail;
+
+	int free_head;
+
+	uint32_t num_hit;
+
+	uint32_t num_miss;
+
+	uint32_t num_evict;
+
+	int find_client(const uint8_t *mac);
+
+	int add_client(const uint8_t *mac, int if_index, int ipa_if_num);
+
+	void del_client(int slot);
+
+	void lru_unlink(int slot);
+
+	void lru_push(int slot);
+
+	void add_client_ipv6(int slot, const uint32_t *addr);
 
-	ipa_neighbor_client neighbor_client[IPA_MAX_NUM_NEIGHBOR_CLIENTS];
+	void del_client_ipv6(int slot, const uint32_t *addr);
 
+	void post_client_addrs(int slot, ipa_cm_event_id event);
 };
 
 #endif /* IPACM_NEIGHBOR_H */
@@ -49,7 +49,6 @@ extern "C"
 #include <stdlib.h>
 #include <errno.h>
 #include <pthread.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <linux/if.h>
 #include <linux/if_addr.h>
@@ -60,6 +59,10 @@ extern "C"
 
 #define MAX_NUM_OF_FD 10
 #define IPA_NL_MSG_MAX_LEN (2048)
+/* Datagrams read by one recvmmsg() call */
+#define IPA_NL_RX_BATCH 16
+/* Decoded events held back for coalescing before they are posted */
+#define IPA_NL_EVT_BATCH 64
 
 /*--------------------------------------------------------------------------- 
 	 Type representing enumeration of NetLink event indication messages
@@ -114,9 +117,8 @@ typedef struct
 typedef struct
 {
 	ipa_nl_sk_fd_map_info_t sk_fds[MAX_NUM_OF_FD];
-	fd_set fdset;
 	int num_fd;
-	int max_fd;
+	int epoll_fd;
 } ipa_nl_sk_fd_set_info_t;
 
 typedef struct
@@ -139,6 +141,7 @@ typedef struct ipa_nl_proto_info_s {
 typedef struct
 {
 	struct ifinfomsg  metainfo;                   /* from header */
+	char              ifname[IF_NAME_LEN];        /* IFLA_IFNAME, empty if absent */
 } ipa_nl_link_info_t;
 
 
@@ -43,8 +43,10 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPACM_ROUTING_H
 
 #include <stdint.h>
+#include <pthread.h>
 #include <linux/msm_ipa.h>
 #include <IPACM_Defs.h>
+#include "IPACM_RuleBatch.h"
 
 using namespace std;
 
@@ -55,6 +57,8 @@ public:
 	~IPACM_Routing();
 
 	bool AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable);
+	/* all rules of the batch or none of them are installed */
+	bool AddRoutingRule(IPACM_RtRuleBatch *batch);
 	bool DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable);
 
 	bool Commit(enum ipa_ip_type ip);
@@ -67,10 +71,46 @@ public:
 
 	bool ModifyRoutingRule(struct ipa_ioc_mdfy_rt_rule *);
 
+	/* While a scope is open, the commits of the rule adds requested by the
+	   thread that opened it are folded into one commit per ip family at the
+	   end. Deletes and modifies are still committed right away */
+	void BeginDeferredCommit();
+	void EndDeferredCommit();
+
+	static inline uint32_t GetNumCommit()
+	{
+		return num_commit;
+	}
+
+	static inline uint32_t GetNumCommitSaved()
+	{
+		return num_commit_saved;
+	}
+
+	inline IPACM_RtRuleBatch *GetBatch(int expected)
+	{
+		return batch_pool.get(expected);
+	}
+
+	inline void PutBatch(IPACM_RtRuleBatch *batch)
+	{
+		batch_pool.put(batch);
+	}
+
 private:
 	static const char *DEVICE_NAME;
 	int m_fd; /* File descriptor of the IPA device node /dev/ipa */
 
+	static int commit_depth;
+	static pthread_t commit_owner;
+	static uint32_t commit_pending[IPA_IP_MAX];
+	static uint32_t num_commit;
+	static uint32_t num_commit_saved;
+
+	void DeferCommit(uint8_t *commit, enum ipa_ip_type ip);
+	void CountCommit(uint8_t commit, enum ipa_ip_type ip);
+	IPACM_RuleBatchPool<ipa_ioc_add_rt_rule> batch_pool;
+
 	bool PutRoutingTable(uint32_t routingTableHandle);
 };
 
@@ -0,0 +1,242 @@
+/* 
+Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_RuleBatch.h
+
+	@brief
+	Reusable buffers for the variable length ipa_ioc_add_* tables, so a
+	handler can collect its rules and install them in one ioctl.
+*/
+#ifndef IPACM_RULEBATCH_H
+#define IPACM_RULEBATCH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <linux/msm_ipa.h>
+#include "IPACM_Defs.h"
+
+/* the ioctl tables count their entries in a uint8_t */
+#define IPACM_RULE_BATCH_MAX 255
+#define IPACM_RULE_BATCH_MIN 4
+
+template <typename Table> struct IPACM_RuleBatchTraits;
+
+template <> struct IPACM_RuleBatchTraits<ipa_ioc_add_rt_rule>
+{
+	typedef ipa_rt_rule_add rule_t;
+	static uint8_t *num(ipa_ioc_add_rt_rule *t) { return &t->num_rules; }
+	static rule_t *rules(ipa_ioc_add_rt_rule *t) { return t->rules; }
+};
+
+template <> struct IPACM_RuleBatchTraits<ipa_ioc_add_flt_rule>
+{
+	typedef ipa_flt_rule_add rule_t;
+	static uint8_t *num(ipa_ioc_add_flt_rule *t) { return &t->num_rules; }
+	static rule_t *rules(ipa_ioc_add_flt_rule *t) { return t->rules; }
+};
+
+template <> struct IPACM_RuleBatchTraits<ipa_ioc_add_hdr>
+{
+	typedef ipa_hdr_add rule_t;
+	static uint8_t *num(ipa_ioc_add_hdr *t) { return &t->num_hdrs; }
+	static rule_t *rules(ipa_ioc_add_hdr *t) { return t->hdr; }
+};
+
+/* One table under construction. The buffer only grows, so a batch that
+   goes back to its pool keeps its memory for the next user */
+template <typename Table>
+class IPACM_RuleBatch
+{
+public:
+
+	typedef IPACM_RuleBatchTraits<Table> traits;
+	typedef typename traits::rule_t rule_t;
+
+	/* pool link */
+	IPACM_RuleBatch *next;
+
+	IPACM_RuleBatch()
+	{
+		tbl = NULL;
+		cap = 0;
+		next = NULL;
+	}
+
+	~IPACM_RuleBatch()
+	{
+		free(tbl);
+	}
+
+	/* empty the table and zero its header, room is made for expected rules */
+	Table *reset(int expected)
+	{
+		if (reserve(expected < IPACM_RULE_BATCH_MIN ? IPACM_RULE_BATCH_MIN : expected) != IPACM_SUCCESS)
+		{
+			return NULL;
+		}
+		memset(tbl, 0, sizeof(Table));
+		return tbl;
+	}
+
+	/* append a zeroed rule. The buffer may move, so table() and rule()
+	   pointers taken before must be fetched again */
+	rule_t *add()
+	{
+		int n;
+
+		if (tbl == NULL || *traits::num(tbl) >= IPACM_RULE_BATCH_MAX)
+		{
+			return NULL;
+		}
+		n = *traits::num(tbl);
+		if (n == cap && reserve(2 * cap) != IPACM_SUCCESS)
+		{
+			return NULL;
+		}
+		memset(&traits::rules(tbl)[n], 0, sizeof(rule_t));
+		*traits::num(tbl) = n + 1;
+		return &traits::rules(tbl)[n];
+	}
+
+	inline Table *table()
+	{
+		return tbl;
+	}
+
+	inline int count()
+	{
+		return (tbl == NULL) ? 0 : *traits::num(tbl);
+	}
+
+	inline rule_t *rule(int i)
+	{
+		return &traits::rules(tbl)[i];
+	}
+
+private:
+
+	Table *tbl;
+	int cap;
+
+	int reserve(int num)
+	{
+		Table *t;
+
+		if (num > IPACM_RULE_BATCH_MAX)
+		{
+			num = IPACM_RULE_BATCH_MAX;
+		}
+		if (tbl != NULL && num <= cap)
+		{
+			return IPACM_SUCCESS;
+		}
+		t = (Table *)realloc(tbl, sizeof(Table) + num * sizeof(rule_t));
+		if (t == NULL)
+		{
+			return IPACM_FAILURE;
+		}
+		if (tbl == NULL)
+		{
+			memset(t, 0, sizeof(Table));
+		}
+		tbl = t;
+		cap = num;
+		return IPACM_SUCCESS;
+	}
+};
+
+/* Batches handed out by IPACM_Routing/Filtering/Header, used from the
+   command queue thread only */
+template <typename Table>
+class IPACM_RuleBatchPool
+{
+public:
+
+	IPACM_RuleBatchPool()
+	{
+		free_list = NULL;
+	}
+
+	~IPACM_RuleBatchPool()
+	{
+		IPACM_RuleBatch<Table> *b;
+
+		while ((b = free_list) != NULL)
+		{
+			free_list = b->next;
+			delete b;
+		}
+	}
+
+	IPACM_RuleBatch<Table> *get(int expected)
+	{
+		IPACM_RuleBatch<Table> *b = free_list;
+
+		if (b != NULL)
+		{
+			free_list = b->next;
+		}
+		else
+		{
+			b = new (std::nothrow) IPACM_RuleBatch<Table>();
+			if (b == NULL)
+			{
+				return NULL;
+			}
+		}
+		if (b->reset(expected) == NULL)
+		{
+			put(b);
+			return NULL;
+		}
+		return b;
+	}
+
+	void put(IPACM_RuleBatch<Table> *b)
+	{
+		if (b != NULL)
+		{
+			b->next = free_list;
+			free_list = b;
+		}
+	}
+
+private:
+
+	IPACM_RuleBatch<Table> *free_list;
+};
+
+typedef IPACM_RuleBatch<ipa_ioc_add_rt_rule> IPACM_RtRuleBatch;
+typedef IPACM_RuleBatch<ipa_ioc_add_flt_rule> IPACM_FltRuleBatch;
+typedef IPACM_RuleBatch<ipa_ioc_add_hdr> IPACM_HdrBatch;
+
+#endif /* IPACM_RULEBATCH_H */
@@ -0,0 +1,227 @@
+/* 
+Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_Stats.h
+
+	@brief
+	Binary tethering/network stats exported through a shared mmapped file.
+	The layout below is also the reader API, it builds as C for clients
+	outside of IPACM.
+*/
+#ifndef IPACM_STATS_H
+#define IPACM_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IPACM_STATS_FILE_NAME "/data/misc/ipa/ipacm_stats"
+#define IPACM_STATS_MAGIC 0x49504153 /* "IPAS" */
+#define IPACM_STATS_VERSION 1
+#define IPACM_STATS_MAX_ENTRIES 32
+#define IPACM_STATS_NAME_LEN 16
+
+/* Minimum seconds between rewrites of the legacy text files, 0 turns them off */
+#define IPACM_STATS_TEXT_INTERVAL_SEC 10
+
+enum ipacm_stats_type
+{
+	IPACM_STATS_TYPE_NONE = 0,
+	IPACM_STATS_TYPE_IFACE, /* per lan iface tethered to upstream */
+	IPACM_STATS_TYPE_APN    /* per wan iface/mux id */
+};
+
+/* Counters are totals as reported by the modem. ul is lan->wan for
+   IFACE entries and wan tx for APN entries. seq is odd while the
+   writer updates the entry */
+struct ipacm_stats_entry
+{
+	uint32_t seq;
+	uint16_t type;
+	uint16_t mux_id;
+	char name[IPACM_STATS_NAME_LEN];
+	char upstream[IPACM_STATS_NAME_LEN];
+	uint64_t ul_bytes;
+	uint64_t ul_packets;
+	uint64_t dl_bytes;
+	uint64_t dl_packets;
+	uint64_t timestamp_ns; /* CLOCK_BOOTTIME of the last update */
+};
+
+/* magic is written last, readers must check it along with version
+   and entry_size before touching the entries */
+struct ipacm_stats_region
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t entry_size;
+	uint32_t max_entries;
+	uint32_t num_entries; /* entries in use, they are never released */
+	struct ipacm_stats_entry entries[IPACM_STATS_MAX_ENTRIES];
+};
+
+/* Reader side */
+struct ipacm_stats_map
+{
+	const struct ipacm_stats_region *region;
+	size_t len;
+};
+
+/* returns 0 on success, -1 if the file is missing or not a region we understand */
+static inline int ipacm_stats_open(const char *path, struct ipacm_stats_map *map)
+{
+	struct stat st;
+	void *ptr;
+	int fd;
+
+	map->region = NULL;
+	map->len = 0;
+	fd = open(path ? path : IPACM_STATS_FILE_NAME, O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct ipacm_stats_region))
+	{
+		close(fd);
+		return -1;
+	}
+	ptr = mmap(NULL, sizeof(struct ipacm_stats_region), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED)
+	{
+		return -1;
+	}
+	map->region = (const struct ipacm_stats_region *)ptr;
+	map->len = sizeof(struct ipacm_stats_region);
+	if (__atomic_load_n(&map->region->magic, __ATOMIC_ACQUIRE) != IPACM_STATS_MAGIC ||
+		map->region->version != IPACM_STATS_VERSION ||
+		map->region->entry_size != sizeof(struct ipacm_stats_entry))
+	{
+		munmap(ptr, map->len);
+		map->region = NULL;
+		map->len = 0;
+		return -1;
+	}
+	return 0;
+}
+
+static inline void ipacm_stats_close(struct ipacm_stats_map *map)
+{
+	if (map->region != NULL)
+	{
+		munmap((void *)map->region, map->len);
+	}
+	map->region = NULL;
+	map->len = 0;
+}
+
+static inline uint32_t ipacm_stats_count(const struct ipacm_stats_map *map)
+{
+	uint32_t num = __atomic_load_n(&map->region->num_entries, __ATOMIC_ACQUIRE);
+
+	return num < IPACM_STATS_MAX_ENTRIES ? num : IPACM_STATS_MAX_ENTRIES;
+}
+
+/* Consistent copy of entry idx, returns 0 on success, -1 if idx is not in use */
+static inline int ipacm_stats_read(const struct ipacm_stats_map *map, uint32_t idx,
+	struct ipacm_stats_entry *out)
+{
+	const struct ipacm_stats_entry *e;
+	uint32_t seq;
+
+	if (idx >= ipacm_stats_count(map))
+	{
+		return -1;
+	}
+	e = &map->region->entries[idx];
+	do
+	{
+		while ((seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE)) & 1)
+		{
+			/* writer holds the entry for a few stores only */
+		}
+		memcpy(out, e, sizeof(*out));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq);
+	out->seq = seq;
+	return 0;
+}
+
+#ifdef __cplusplus
+
+#include <pthread.h>
+#include <time.h>
+
+/* Writer side, one region per IPACM process */
+class IPACM_Stats
+{
+public:
+
+	static IPACM_Stats* GetInstance();
+
+	/* store the counters of one entry, the entry is created on first use.
+	   The legacy text file is rewritten at a bounded rate, counters that
+	   arrive inside the interval are written once it has elapsed */
+	void update(ipacm_stats_type type, const char *name, const char *upstream,
+		uint16_t mux_id, uint64_t ul_bytes, uint64_t ul_packets,
+		uint64_t dl_bytes, uint64_t dl_packets);
+
+private:
+
+	IPACM_Stats();
+
+	int map_region(void);
+
+	int find_entry(ipacm_stats_type type, const char *name, const char *upstream, uint16_t mux_id);
+
+	void write_text(const ipacm_stats_entry *e);
+
+	static void *text_flush(void *param);
+
+	static IPACM_Stats *pInstance;
+
+	pthread_mutex_t lock;
+	ipacm_stats_region *region;
+	/* last legacy text write per entry and whether newer counters
+	   are waiting for it, not exported */
+	time_t text_last[IPACM_STATS_MAX_ENTRIES];
+	bool text_pending[IPACM_STATS_MAX_ENTRIES];
+	/* wakes the flush thread, on CLOCK_MONOTONIC */
+	pthread_cond_t text_cond;
+	bool text_thread;
+};
+
+#endif /* __cplusplus */
+
+#endif /* IPACM_STATS_H */
@@ -48,6 +48,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <IPACM_Iface.h>
 #include <IPACM_Defs.h>
 #include <IPACM_Xml.h>
+#include "IPACM_ClientIndex.h"
 
 #define IPA_NUM_DEFAULT_WAN_FILTER_RULES 3 /*1 for v4, 2 for v6*/
 #define IPA_V2_NUM_DEFAULT_WAN_FILTER_RULE_IPV4 2
@@ -58,9 +59,6 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPA_V2_NUM_DEFAULT_WAN_FILTER_RULE_IPV6 3
 #endif
 
-#define NETWORK_STATS "%s %lu %lu %lu %lu"
-#define IPA_NETWORK_STATS_FILE_NAME "/data/misc/ipa/network_stats"
-
 typedef struct _wan_client_rt_hdl
 {
 	uint32_t wan_rt_rule_hdl_v4;
@@ -225,12 +223,19 @@ private:
 
 	/* IPACM firewall Configuration file*/
 	IPACM_firewall_conf_t firewall_config;
+	/* firewall_config holds the parsed xml, only a change event reads it again */
+	bool firewall_config_valid;
+	/* firewall_config as it was when each ip family's rules were installed */
+	IPACM_firewall_conf_t firewall_installed_v4, firewall_installed_v6;
+	bool firewall_installed_valid_v4, firewall_installed_valid_v6;
 
 	/* STA mode wan-client*/
 	int wan_client_len;
 	ipa_wan_client *wan_client;
 	int header_name_count;
 	int num_wan_client;
+	/* MAC and IPv4 lookup into wan_client */
+	IPACM_ClientIndex wan_client_idx;
 	uint8_t invalid_mac[IPA_MAC_ADDR_SIZE];
 	bool is_xlat;
 
@@ -248,65 +253,41 @@ private:
 	inline int get_wan_client_index(uint8_t *mac_addr)
 	{
 		int cnt;
-		int num_wan_client_tmp = num_wan_client;
 
-		IPACMDBG_H("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
+		IPACMDBG("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
 						 mac_addr[0], mac_addr[1], mac_addr[2],
 						 mac_addr[3], mac_addr[4], mac_addr[5]);
 
-		for(cnt = 0; cnt < num_wan_client_tmp; cnt++)
+		cnt = wan_client_idx.find(mac_addr);
+		if(cnt != IPACM_INVALID_INDEX)
 		{
-			IPACMDBG_H("stored MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
-							 get_client_memptr(wan_client, cnt)->mac[0],
-							 get_client_memptr(wan_client, cnt)->mac[1],
-							 get_client_memptr(wan_client, cnt)->mac[2],
-							 get_client_memptr(wan_client, cnt)->mac[3],
-							 get_client_memptr(wan_client, cnt)->mac[4],
-							 get_client_memptr(wan_client, cnt)->mac[5]);
-
-			if(memcmp(get_client_memptr(wan_client, cnt)->mac,
-								mac_addr,
-								sizeof(get_client_memptr(wan_client, cnt)->mac)) == 0)
-			{
-				IPACMDBG_H("Matched client index: %d\n", cnt);
-				return cnt;
-			}
+			IPACMDBG_H("Matched client index: %d\n", cnt);
 		}
-
-		return IPACM_INVALID_INDEX;
+		return cnt;
 	}
 
 	inline int get_wan_client_index_ipv4(uint32_t ipv4_addr)
 	{
 		int cnt;
-		int num_wan_client_tmp = num_wan_client;
 
 		IPACMDBG_H("Passed IPv4 %x\n", ipv4_addr);
 
-		for(cnt = 0; cnt < num_wan_client_tmp; cnt++)
+		cnt = wan_client_idx.find_ipv4(ipv4_addr);
+		if(cnt != IPACM_INVALID_INDEX)
 		{
-			if (get_client_memptr(wan_client, cnt)->ipv4_set)
-			{
-				IPACMDBG_H("stored IPv4 %x\n", get_client_memptr(wan_client, cnt)->v4_addr);
-
-				if(ipv4_addr == get_client_memptr(wan_client, cnt)->v4_addr)
-				{
-					IPACMDBG_H("Matched client index: %d\n", cnt);
-					IPACMDBG_H("The MAC is %02x:%02x:%02x:%02x:%02x:%02x\n",
-							get_client_memptr(wan_client, cnt)->mac[0],
-							get_client_memptr(wan_client, cnt)->mac[1],
-							get_client_memptr(wan_client, cnt)->mac[2],
-							get_client_memptr(wan_client, cnt)->mac[3],
-							get_client_memptr(wan_client, cnt)->mac[4],
-							get_client_memptr(wan_client, cnt)->mac[5]);
-					IPACMDBG_H("header set ipv4(%d) ipv6(%d)\n",
-							get_client_memptr(wan_client, cnt)->ipv4_header_set,
-							get_client_memptr(wan_client, cnt)->ipv6_header_set);
-					return cnt;
-				}
-			}
+			IPACMDBG_H("Matched client index: %d\n", cnt);
+			IPACMDBG_H("The MAC is %02x:%02x:%02x:%02x:%02x:%02x\n",
+					get_client_memptr(wan_client, cnt)->mac[0],
+					get_client_memptr(wan_client, cnt)->mac[1],
+					get_client_memptr(wan_client, cnt)->mac[2],
+					get_client_memptr(wan_client, cnt)->mac[3],
+					get_client_memptr(wan_client, cnt)->mac[4],
+					get_client_memptr(wan_client, cnt)->mac[5]);
+			IPACMDBG_H("header set ipv4(%d) ipv6(%d)\n",
+					get_client_memptr(wan_client, cnt)->ipv4_header_set,
+					get_client_memptr(wan_client, cnt)->ipv6_header_set);
 		}
-		return IPACM_INVALID_INDEX;
+		return cnt;
 	}
 
 	inline int get_wan_client_index_ipv6(uint32_t* ipv6_addr)
@@ -440,6 +421,28 @@ private:
 #endif
 	int config_dft_firewall_rules(ipa_ip_type iptype);
 
+	/* parse the firewall xml into config */
+	void read_firewall_config(IPACM_firewall_conf_t *config);
+
+	/* compare the firewall rules of one ip family */
+	bool firewall_rules_equal(IPACM_firewall_conf_t *old_config, IPACM_firewall_conf_t *new_config, ipa_ip_type iptype);
+
+	int firewall_entry_rule_cnt(IPACM_extd_firewall_entry_conf_t *entry);
+
+	/* add the filter rules of one firewall entry */
+	int add_dft_firewall_entry(IPACM_extd_firewall_entry_conf_t *entry, ipa_ip_type iptype, uint32_t *hdls, int *num_hdls);
+
+	/* add the default rules behind the firewall entries */
+	int add_dft_firewall_tail(ipa_ip_type iptype);
+
+	/* record firewall_config as the source of the installed iptype rules */
+	void save_firewall_installed(ipa_ip_type iptype);
+
+	/* apply the difference between the installed config and firewall_config */
+	int update_dft_firewall_rules(ipa_ip_type iptype);
+
+	int handle_firewall_change_evt();
+
 	/* configure the initial firewall filter rules */
 	int config_dft_embms_rules(ipa_ioc_add_flt_rule *pFilteringTable_v4, ipa_ioc_add_flt_rule *pFilteringTable_v6);
 
@@ -102,6 +102,8 @@ private:
 
 	int header_name_count;
 	int num_wifi_client;
+	/* MAC lookup into wlan_client */
+	IPACM_ClientIndex wlan_client_idx;
 
 	int wlan_ap_index;
 
@@ -118,32 +120,17 @@ private:
 	inline int get_wlan_client_index(uint8_t *mac_addr)
 	{
 		int cnt;
-		int num_wifi_client_tmp = num_wifi_client;
 
-		IPACMDBG_H("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
+		IPACMDBG("Passed MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
 						 mac_addr[0], mac_addr[1], mac_addr[2],
 						 mac_addr[3], mac_addr[4], mac_addr[5]);
 
-		for(cnt = 0; cnt < num_wifi_client_tmp; cnt++)
+		cnt = wlan_client_idx.find(mac_addr);
+		if(cnt != IPACM_INVALID_INDEX)
 		{
-			IPACMDBG_H("stored MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
-							 get_client_memptr(wlan_client, cnt)->mac[0],
-							 get_client_memptr(wlan_client, cnt)->mac[1],
-							 get_client_memptr(wlan_client, cnt)->mac[2],
-							 get_client_memptr(wlan_client, cnt)->mac[3],
-							 get_client_memptr(wlan_client, cnt)->mac[4],
-							 get_client_memptr(wlan_client, cnt)->mac[5]);
-
-			if(memcmp(get_client_memptr(wlan_client, cnt)->mac,
-								mac_addr,
-								sizeof(get_client_memptr(wlan_client, cnt)->mac)) == 0)
-			{
-				IPACMDBG_H("Matched client index: %d\n", cnt);
-				return cnt;
-			}
+			IPACMDBG_H("Matched client index: %d\n", cnt);
 		}
-
-		return IPACM_INVALID_INDEX;
+		return cnt;
 	}
 
 	inline int delete_default_qos_rtrules(int clt_indx, ipa_ip_type iptype)
@@ -178,6 +178,12 @@ if (!(a)) {                                                 \
 #define IPACMNat_TAG                         "IPACMNAT"
 #define NAT_MaxEntries_TAG                   "MaxNatEntries"
 
+#define IPACMClients_TAG                     "IPACMClients"
+#define MaxWlanClients_TAG                   "MaxWlanClients"
+#define MaxEthClients_TAG                    "MaxEthClients"
+#define MaxNeighborClients_TAG               "MaxNeighborClients"
+#define CfgDebounceMs_TAG                    "CfgDebounceMs"
+
 #define IP_PassthroughFlag_TAG               "IPPassthroughFlag"
 #define IP_PassthroughMode_TAG               "IPPassthroughMode"
 
@@ -275,6 +281,10 @@ typedef struct  _IPACM_conf_t
 	ipacm_private_subnet_conf_t private_subnet_config;
 	ipacm_alg_conf_t alg_config;
 	int nat_max_entries;
+	int max_wlan_clients;
+	int max_eth_clients;
+	int max_neighbor_clients;
+	int cfg_debounce_ms;
 	bool odu_enable;
 	bool router_mode_enable;
 	bool odu_embms_enable;
@@ -282,6 +292,35 @@ typedef struct  _IPACM_conf_t
 	bool ip_passthrough_mode;
 } IPACM_conf_t;  
 
+/* Parsed IPACM_cfg.xml, reused while the source is unchanged */
+#ifdef FEATURE_IPA_ANDROID
+#define IPACM_CFG_CACHE_FILE "/data/misc/ipa/IPACM_cfg.bin"
+#else
+#define IPACM_CFG_CACHE_FILE "/etc/IPACM_cfg.bin"
+#endif
+#define IPACM_CFG_CACHE_MAGIC 0x49504343 /* "IPCC" */
+/* bump when the meaning of IPACM_conf_t changes without its size */
+#define IPACM_CFG_CACHE_VERSION 1
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t conf_size;
+	uint32_t reserved;
+	int64_t src_mtime_sec;
+	int64_t src_mtime_nsec;
+	int64_t src_size;
+	uint64_t src_hash;
+} ipacm_cfg_cache_hdr_t;
+
+/* FNV-1a over what is left to read of fd, tells if a config file really changed */
+int ipacm_hash_fd
+(
+	int fd,                                      /* open file to read     */
+	uint64_t *hash                               /* hash of the content   */
+);
+
 /* This function read IPACM XML configuration*/
 int ipacm_read_cfg_xml
 (
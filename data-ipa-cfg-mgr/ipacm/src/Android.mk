@@ -57,7 +57,8 @@ LOCAL_SRC_FILES := IPACM_Main.cpp \
 		IPACM_Conntrack_NATApp.cpp\
 		IPACM_ConntrackClient.cpp \
 		IPACM_ConntrackListener.cpp \
-                IPACM_Log.cpp
+                IPACM_Log.cpp \
+                IPACM_Stats.cpp
 
 LOCAL_MODULE := ipacm
 LOCAL_CLANG := false
@@ -38,21 +38,52 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include "IPACM_CmdQueue.h"
 #include "IPACM_Log.h"
 #include "IPACM_Iface.h"
 
-pthread_mutex_t mutex    = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t  cond_var = PTHREAD_COND_INITIALIZER;
-
 MessageQueue* MessageQueue::inst_internal = NULL;
 MessageQueue* MessageQueue::inst_external = NULL;
+MessageQueue* MessageQueue::inst_ct[IPACM_CT_WORKERS];
+pthread_mutex_t MessageQueue::inst_lock = PTHREAD_MUTEX_INITIALIZER;
+
+msg_waiter MessageQueue::main_waiter = { -1, 0 };
+msg_waiter MessageQueue::ct_waiters[IPACM_CT_WORKERS];
+
+MessageQueue::MessageQueue(msg_waiter *w)
+{
+	uint32_t cnt;
+
+	waiter = w;
+	Head = NULL;
+	Tail = NULL;
+	overflow_cnt = 0;
+	pthread_mutex_init(&overflow_lock, NULL);
+
+	enq_pos = 0;
+	deq_pos = 0;
+	ring = new Message[IPACM_MSG_QUEUE_SIZE];
+	if(ring == NULL)
+	{
+		IPACMERR("unable to allocate message ring, using the overflow list\n");
+		return;
+	}
+
+	/* A cell is free for position pos while its seq is pos */
+	for(cnt = 0; cnt < IPACM_MSG_QUEUE_SIZE; cnt++)
+	{
+		ring[cnt].setseq(cnt);
+	}
+}
 
 MessageQueue* MessageQueue::getInstanceInternal()
 {
 	if(inst_internal == NULL)
 	{
-		inst_internal = new MessageQueue();
+		inst_internal = new MessageQueue(&main_waiter);
 		if(inst_internal == NULL)
 		{
 			IPACMERR("unable to create internal Message Queue instance\n");
@@ -67,7 +98,7 @@ MessageQueue* MessageQueue::getInstanceExternal()
 {
 	if(inst_external == NULL)
 	{
-		inst_external = new MessageQueue();
+		inst_external = new MessageQueue(&main_waiter);
 		if(inst_external == NULL)
 		{
 			IPACMERR("unable to create external Message Queue instance\n");
@@ -78,128 +109,322 @@ MessageQueue* MessageQueue::getInstanceExternal()
 	return inst_external;
 }
 
-void MessageQueue::enqueue(Message *item)
+/* Queue of one conntrack worker. Both conntrack listener threads post
+   here, so creation is serialised, lookups afterwards take no lock.
+   The worker's eventfd is only used once it announced a sleep */
+MessageQueue* MessageQueue::getInstanceCt(int worker)
 {
-	if(!Head)
+	MessageQueue *inst;
+
+	if(worker < 0 || worker >= IPACM_CT_WORKERS)
 	{
-		Tail = item;
-		Head = item;
+		IPACMERR("Invalid conntrack worker %d\n", worker);
+		return NULL;
 	}
-	else
+
+	inst = __atomic_load_n(&inst_ct[worker], __ATOMIC_ACQUIRE);
+	if(inst != NULL)
 	{
-		if(Tail == NULL)
+		return inst;
+	}
+
+	pthread_mutex_lock(&inst_lock);
+	inst = inst_ct[worker];
+	if(inst == NULL)
+	{
+		inst = new MessageQueue(&ct_waiters[worker]);
+		if(inst == NULL)
 		{
-			IPACMDBG("Tail is null\n");
-			Head->setnext(item);
+			IPACMERR("unable to create conntrack worker %d Message Queue instance\n", worker);
 		}
-		else
+		__atomic_store_n(&inst_ct[worker], inst, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&inst_lock);
+
+	return inst;
+}
+
+/* Wake the thread serving this queue if it is, or is about to be,
+   asleep. Pairs with the fence in wait: either the consumer sees the
+   new event when it looks again, or the producer sees sleeping set */
+void MessageQueue::wakeup(void)
+{
+	uint64_t cnt = 1;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&waiter->sleeping, __ATOMIC_SEQ_CST) == 0)
+	{
+		return;
+	}
+
+	if(write(waiter->fd, &cnt, sizeof(cnt)) != sizeof(cnt))
+	{
+		IPACMERR("unable to wake up cmd queue process: %s\n", strerror(errno));
+	}
+}
+
+/* Safe to call from any thread, the event is copied into a pooled node */
+int MessageQueue::enqueue(const cmd_t *evt)
+{
+	Message *item;
+	uint32_t pos, seq;
+
+	/* Once events spilled over, later ones follow them through the
+	   overflow list until it is drained so the order is kept */
+	if(ring != NULL && __atomic_load_n(&overflow_cnt, __ATOMIC_SEQ_CST) == 0)
+	{
+		pos = __atomic_load_n(&enq_pos, __ATOMIC_RELAXED);
+		while(1)
 		{
-			Tail->setnext(item);
+			item = &ring[pos & (IPACM_MSG_QUEUE_SIZE - 1)];
+			seq = item->getseq();
+			if(seq == pos)
+			{
+				if(__atomic_compare_exchange_n(&enq_pos, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					memcpy(&item->evt, evt, sizeof(cmd_t));
+					/* Publish the cell to the consumer */
+					item->setseq(pos + 1);
+					wakeup();
+					return IPACM_SUCCESS;
+				}
+				/* Lost the cell to another producer, pos is reloaded */
+			}
+			else if((int32_t)(seq - pos) < 0)
+			{
+				/* Cell still holds an event from the last lap */
+				break;
+			}
+			else
+			{
+				pos = __atomic_load_n(&enq_pos, __ATOMIC_RELAXED);
+			}
 		}
-		Tail = item;
 	}
-}
 
+	/* Ring is full. The Process thread posts internal events itself,
+	   so spill to the heap instead of waiting for a free cell */
+	item = new Message();
+	if(item == NULL)
+	{
+		IPACMERR("unable to create new message item\n");
+		return IPACM_FAILURE;
+	}
+	memcpy(&item->evt, evt, sizeof(cmd_t));
+
+	if(pthread_mutex_lock(&overflow_lock) != 0)
+	{
+		IPACMERR("unable to lock the mutex\n");
+		delete item;
+		return IPACM_FAILURE;
+	}
+
+	if(Tail == NULL)
+	{
+		Head = item;
+	}
+	else
+	{
+		Tail->setnext(item);
+	}
+	Tail = item;
+	__atomic_add_fetch(&overflow_cnt, 1, __ATOMIC_SEQ_CST);
+
+	if(pthread_mutex_unlock(&overflow_lock) != 0)
+	{
+		IPACMERR("unable to unlock the mutex\n");
+	}
 
-Message* MessageQueue::dequeue(void)
+	IPACMDBG("Message ring full, event %d queued on overflow list\n", evt->data.event);
+	wakeup();
+	return IPACM_SUCCESS;
+}
+
+/* Only called by the Process thread */
+bool MessageQueue::dequeue(cmd_t *evt)
 {
+	Message *item;
+
+	if(ring != NULL)
+	{
+		item = &ring[deq_pos & (IPACM_MSG_QUEUE_SIZE - 1)];
+		if(item->getseq() == deq_pos + 1)
+		{
+			memcpy(evt, &item->evt, sizeof(cmd_t));
+			/* Hand the cell back to producers for the next lap */
+			item->setseq(deq_pos + IPACM_MSG_QUEUE_SIZE);
+			deq_pos++;
+			return true;
+		}
+	}
+
+	if(__atomic_load_n(&overflow_cnt, __ATOMIC_SEQ_CST) == 0)
+	{
+		return false;
+	}
+
+	if(pthread_mutex_lock(&overflow_lock) != 0)
+	{
+		IPACMERR("unable to lock the mutex\n");
+		return false;
+	}
+
+	item = Head;
+	Head = item->getnext();
 	if(Head == NULL)
 	{
-		return NULL;
+		Tail = NULL;
 	}
-	else
+	__atomic_sub_fetch(&overflow_cnt, 1, __ATOMIC_SEQ_CST);
+
+	if(pthread_mutex_unlock(&overflow_lock) != 0)
 	{
-		Message *tmp = Head;
-		Head = Head->getnext();
+		IPACMERR("unable to unlock the mutex\n");
+	}
+
+	memcpy(evt, &item->evt, sizeof(cmd_t));
+	delete item;
+	return true;
+}
 
-		return tmp;
+/* Only called by the Process thread */
+bool MessageQueue::pending(void)
+{
+	if(ring != NULL &&
+		 ring[deq_pos & (IPACM_MSG_QUEUE_SIZE - 1)].getseq() == deq_pos + 1)
+	{
+		return true;
 	}
+
+	return (__atomic_load_n(&overflow_cnt, __ATOMIC_SEQ_CST) != 0);
 }
 
 
+/* Sleep until one of queues has an event. Announce the sleep, then
+   look once more so an event posted in between is not missed */
+bool MessageQueue::wait(msg_waiter *w, MessageQueue **queues, int num)
+{
+	uint64_t cnt;
+	int i;
+
+	__atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for(i = 0; i < num; i++)
+	{
+		if(queues[i]->pending())
+		{
+			break;
+		}
+	}
+
+	if(i == num)
+	{
+		IPACMDBG("Waiting for Message\n");
+		if(read(w->fd, &cnt, sizeof(cnt)) < 0 && errno != EINTR)
+		{
+			IPACMERR("unable to wait on cmd queue eventfd: %s\n", strerror(errno));
+			__atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+			return false;
+		}
+	}
+
+	__atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+	return true;
+}
+
 void* MessageQueue::Process(void *param)
 {
-	MessageQueue *MsgQueueInternal = NULL;
-	MessageQueue *MsgQueueExternal = NULL;
-	Message *item = NULL;
+	MessageQueue *queues[2];
+	cmd_t evt;
 	IPACMDBG("MessageQueue::Process()\n");
 
-	MsgQueueInternal = MessageQueue::getInstanceInternal();
-	if(MsgQueueInternal == NULL)
+	/* Internal events go ahead of external ones */
+	queues[0] = MessageQueue::getInstanceInternal();
+	if(queues[0] == NULL)
 	{
 		IPACMERR("unable to start internal cmd queue process\n");
 		return NULL;
 	}
 
-	MsgQueueExternal = MessageQueue::getInstanceExternal();
-	if(MsgQueueExternal == NULL)
+	queues[1] = MessageQueue::getInstanceExternal();
+	if(queues[1] == NULL)
 	{
 		IPACMERR("unable to start external cmd queue process\n");
 		return NULL;
 	}
 
+	main_waiter.fd = eventfd(0, 0);
+	if(main_waiter.fd < 0)
+	{
+		IPACMERR("unable to create cmd queue eventfd: %s\n", strerror(errno));
+		return NULL;
+	}
+
 	while(1)
 	{
-		if(pthread_mutex_lock(&mutex) != 0)
+		if(queues[0]->dequeue(&evt))
 		{
-			IPACMERR("unable to lock the mutex\n");
-			return NULL;
+			IPACMDBG("Get event %s from internal queue.\n",
+				IPACM_Iface::ipacmcfg->getEventName(evt.data.event));
 		}
-
-		item = MsgQueueInternal->dequeue();
-		if(item == NULL)
+		else if(queues[1]->dequeue(&evt))
 		{
-			item = MsgQueueExternal->dequeue();
-			if(item)
-			{
-				IPACMDBG("Get event %s from external queue.\n",
-					IPACM_Iface::ipacmcfg->getEventName(item->evt.data.event));
-			}
+			IPACMDBG("Get event %s from external queue.\n",
+				IPACM_Iface::ipacmcfg->getEventName(evt.data.event));
 		}
 		else
 		{
-			IPACMDBG("Get event %s from internal queue.\n",
-				IPACM_Iface::ipacmcfg->getEventName(item->evt.data.event));
+			if(!wait(&main_waiter, queues, 2))
+			{
+				return NULL;
+			}
+			continue;
 		}
 
-		if(item == NULL)
-		{
-			IPACMDBG("Waiting for Message\n");
+		IPACMDBG("Processing event ID: %d\n", evt.data.event);
+		evt.callback_ptr(&evt.data);
 
-			if(pthread_cond_wait(&cond_var, &mutex) != 0)
-			{
-				IPACMERR("unable to lock the mutex\n");
+	} /* Go forever until a termination indication is received */
 
-				if(pthread_mutex_unlock(&mutex) != 0)
-				{
-					IPACMERR("unable to unlock the mutex\n");
-					return NULL;
-				}
+}
 
-				return NULL;
-			}
+/* Conntrack worker, param is the worker number */
+void* MessageQueue::ProcessCt(void *param)
+{
+	int worker = (int)(intptr_t)param;
+	MessageQueue *queue;
+	cmd_t evt;
+	IPACMDBG("MessageQueue::ProcessCt(%d)\n", worker);
 
-			if(pthread_mutex_unlock(&mutex) != 0)
-			{
-				IPACMERR("unable to unlock the mutex\n");
-				return NULL;
-			}
+	queue = MessageQueue::getInstanceCt(worker);
+	if(queue == NULL)
+	{
+		IPACMERR("unable to start conntrack worker %d\n", worker);
+		return NULL;
+	}
 
-		}
-		else
+	ct_waiters[worker].fd = eventfd(0, 0);
+	if(ct_waiters[worker].fd < 0)
+	{
+		IPACMERR("unable to create conntrack worker eventfd: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	while(1)
+	{
+		if(!queue->dequeue(&evt))
 		{
-			if(pthread_mutex_unlock(&mutex) != 0)
+			if(!wait(&ct_waiters[worker], &queue, 1))
 			{
-				IPACMERR("unable to unlock the mutex\n");
 				return NULL;
 			}
-
-			IPACMDBG("Processing item %p event ID: %d\n",item,item->evt.data.event);
-			item->evt.callback_ptr(&item->evt.data);
-			delete item;
-			item = NULL;
+			continue;
 		}
 
-	} /* Go forever until a termination indication is received */
+		IPACMDBG("Worker %d processing event ID: %d\n", worker, evt.data.event);
+		evt.callback_ptr(&evt.data);
+	}
 
 }
@@ -124,6 +124,10 @@ IPACM_Config::IPACM_Config()
 	ipa_num_private_subnet = 0;
 	ipa_num_alg_ports = 0;
 	ipa_nat_max_entries = 0;
+	ipa_max_wlan_clients = IPA_MAX_NUM_WIFI_CLIENTS;
+	ipa_max_eth_clients = IPA_MAX_NUM_ETH_CLIENTS;
+	ipa_max_neighbor_clients = IPA_MAX_NUM_NEIGHBOR_CLIENTS;
+	ipa_cfg_debounce_ms = IPACM_CFG_DEBOUNCE_MS;
 	ipa_nat_iface_entries = 0;
 	ipa_sw_rt_enable = false;
 	ipa_bridge_enable = false;
@@ -280,6 +284,29 @@ int IPACM_Config::Init(void)
 	ipa_nat_max_entries = cfg->nat_max_entries;
 	IPACMDBG_H("Nat Maximum Entries %d\n", ipa_nat_max_entries);
 
+	if (cfg->max_wlan_clients > 0)
+	{
+		ipa_max_wlan_clients = (cfg->max_wlan_clients > IPA_MAX_NUM_CLIENTS_LIMIT) ?
+			IPA_MAX_NUM_CLIENTS_LIMIT : cfg->max_wlan_clients;
+	}
+	if (cfg->max_eth_clients > 0)
+	{
+		ipa_max_eth_clients = (cfg->max_eth_clients > IPA_MAX_NUM_CLIENTS_LIMIT) ?
+			IPA_MAX_NUM_CLIENTS_LIMIT : cfg->max_eth_clients;
+	}
+	if (cfg->max_neighbor_clients > 0)
+	{
+		ipa_max_neighbor_clients = (cfg->max_neighbor_clients > IPA_MAX_NUM_NEIGHBOR_LIMIT) ?
+			IPA_MAX_NUM_NEIGHBOR_LIMIT : cfg->max_neighbor_clients;
+	}
+	if (cfg->cfg_debounce_ms > 0)
+	{
+		ipa_cfg_debounce_ms = (cfg->cfg_debounce_ms > IPACM_CFG_DEBOUNCE_MAX_MS) ?
+			IPACM_CFG_DEBOUNCE_MAX_MS : cfg->cfg_debounce_ms;
+	}
+	IPACMDBG_H("Max wlan clients %d, max eth clients %d, max neighbor clients %d\n",
+		ipa_max_wlan_clients, ipa_max_eth_clients, ipa_max_neighbor_clients);
+
 	/* Find ODU is either router mode or bridge mode*/
 	ipacm_odu_enable = cfg->odu_enable;
 	ipacm_odu_router_mode = cfg->router_mode_enable;
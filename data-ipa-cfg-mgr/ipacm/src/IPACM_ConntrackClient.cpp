@@ -35,6 +35,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <netinet/in.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
+#include <sys/socket.h>
 #include "IPACM_Iface.h"
 #include "IPACM_ConntrackListener.h"
 #include "IPACM_ConntrackClient.h"
@@ -43,7 +44,6 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define LO_NAME "lo"
 
 extern IPACM_EvtDispatcher cm_dis;
-extern void ParseCTMessage(struct nf_conntrack *ct);
 
 IPACM_ConntrackClient *IPACM_ConntrackClient::pInstance = NULL;
 IPACM_ConntrackListener *CtList = NULL;
@@ -60,6 +60,8 @@ IPACM_ConntrackClient::IPACM_ConntrackClient()
 	udp_hdl = NULL;
 	tcp_filter = NULL;
 	udp_filter = NULL;
+	InitCtEvtSlab(&tcp_slab);
+	InitCtEvtSlab(&udp_slab);
 }
 
 IPACM_ConntrackClient* IPACM_ConntrackClient::GetInstance()
@@ -90,6 +92,147 @@ IPACM_ConntrackClient* IPACM_ConntrackClient::GetInstance()
 	return pInstance;
 }
 
+void IPACM_ConntrackClient::InitCtEvtSlab(ct_evt_slab *slab)
+{
+	int cnt;
+
+	slab->free_list = NULL;
+	slab->ret_list = NULL;
+	slab->heap_cnt = 0;
+	for(cnt = IPACM_CT_EVT_SLAB_SIZE - 1; cnt >= 0; cnt--)
+	{
+		slab->recs[cnt].slab = slab;
+		slab->recs[cnt].next = slab->free_list;
+		slab->free_list = &slab->recs[cnt];
+	}
+}
+
+/* Called only by the reader thread owning the slab */
+ipacm_ct_evt_data* IPACM_ConntrackClient::AllocCtEvt(ct_evt_slab *slab)
+{
+	ipacm_ct_evt_data *rec;
+	void *owner;
+
+	if(slab->free_list == NULL)
+	{
+		slab->free_list = __atomic_exchange_n(&slab->ret_list, NULL, __ATOMIC_ACQUIRE);
+	}
+
+	rec = slab->free_list;
+	if(rec != NULL)
+	{
+		slab->free_list = rec->next;
+		owner = rec->slab;
+	}
+	else
+	{
+		rec = (ipacm_ct_evt_data *)malloc(sizeof(ipacm_ct_evt_data));
+		if(rec == NULL)
+		{
+			IPACMERR("unable to allocate memory \n");
+			return NULL;
+		}
+		owner = NULL;
+		slab->heap_cnt++;
+		if((slab->heap_cnt & (slab->heap_cnt - 1)) == 0)
+		{
+			IPACMDBG_H("Conntrack event slab exhausted, %d records from heap\n", slab->heap_cnt);
+		}
+	}
+
+	memset(rec, 0, sizeof(ipacm_ct_evt_data));
+	rec->slab = owner;
+	return rec;
+}
+
+/* Safe from any thread, slab records go back to their reader */
+void IPACM_ConntrackClient::FreeCtEvt(ipacm_ct_evt_data *rec)
+{
+	ct_evt_slab *slab = (ct_evt_slab *)rec->slab;
+
+	if(slab == NULL)
+	{
+		free(rec);
+		return;
+	}
+
+	rec->next = __atomic_load_n(&slab->ret_list, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&slab->ret_list, &rec->next, rec, true,
+		__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+int IPACM_ConntrackClient::PostCtEvt(ipacm_ct_evt_data *rec)
+{
+	ipacm_cmd_q_data evt_data;
+	int ret;
+#ifndef CT_OPT
+	uint32_t hash;
+#endif
+
+	evt_data.event = IPA_PROCESS_CT_MESSAGE;
+	evt_data.evt_data = (void *)rec;
+
+#ifdef CT_OPT
+	/* Lan2Lan handling is not thread safe, keep it on the main dispatcher */
+	if(AF_INET6 == rec->l3proto)
+	{
+		evt_data.event = IPA_PROCESS_CT_MESSAGE_V6;
+	}
+	ret = IPACM_EvtDispatcher::PostEvt(&evt_data);
+#else
+	/* All events of a connection carry the same orig tuple */
+	hash = rec->orig_src_ip;
+	hash = (hash * 0x9e3779b1) ^ rec->orig_dst_ip;
+	hash = (hash * 0x9e3779b1) ^ (((uint32_t)rec->orig_src_port << 16) | rec->orig_dst_port);
+	hash = (hash * 0x9e3779b1) ^ rec->l4proto;
+	ret = IPACM_EvtDispatcher::PostCtEvt(&evt_data, hash);
+#endif
+
+	if(0 != ret)
+	{
+		IPACMERR("Error sending Conntrack message to processing thread!\n");
+		FreeCtEvt(rec);
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef IPACM_CT_LIBNFCT_PARSE
+void IPACM_ConntrackClient::FillCtEvt(struct nf_conntrack *ct, ipacm_ct_evt_data *rec)
+{
+	rec->l3proto = nfct_get_attr_u8(ct, ATTR_ORIG_L3PROTO);
+	rec->l4proto = nfct_get_attr_u8(ct, ATTR_ORIG_L4PROTO);
+	rec->status = nfct_get_attr_u32(ct, ATTR_STATUS);
+	if(IPPROTO_TCP == rec->l4proto)
+	{
+		rec->tcp_state = nfct_get_attr_u8(ct, ATTR_TCP_STATE);
+	}
+
+	rec->orig_src_port = ntohs(nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC));
+	rec->orig_dst_port = ntohs(nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST));
+	rec->repl_src_port = ntohs(nfct_get_attr_u16(ct, ATTR_REPL_PORT_SRC));
+	rec->repl_dst_port = ntohs(nfct_get_attr_u16(ct, ATTR_REPL_PORT_DST));
+
+	if(AF_INET == rec->l3proto)
+	{
+		rec->orig_src_ip = ntohl(nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC));
+		rec->orig_dst_ip = ntohl(nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_DST));
+		rec->repl_src_ip = ntohl(nfct_get_attr_u32(ct, ATTR_REPL_IPV4_SRC));
+		rec->repl_dst_ip = ntohl(nfct_get_attr_u32(ct, ATTR_REPL_IPV4_DST));
+	}
+#ifdef CT_OPT
+	else if(AF_INET6 == rec->l3proto)
+	{
+		struct nfct_attr_grp_ipv6 orig_params;
+
+		nfct_get_attr_grp(ct, ATTR_GRP_ORIG_IPV6, (void *)&orig_params);
+		memcpy(rec->orig_src_ipv6, orig_params.src, sizeof(rec->orig_src_ipv6));
+		memcpy(rec->orig_dst_ipv6, orig_params.dst, sizeof(rec->orig_dst_ipv6));
+	}
+#endif
+}
+
 int IPACM_ConntrackClient::IPAConntrackEventCB
 (
 	 enum nf_conntrack_msg_type type,
@@ -97,7 +240,6 @@ int IPACM_ConntrackClient::IPAConntrackEventCB
 	 void *data
 	 )
 {
-	ipacm_cmd_q_data evt_data;
 	ipacm_ct_evt_data *ct_data;
 	uint8_t ip_type = 0;
 
@@ -110,47 +252,255 @@ int IPACM_ConntrackClient::IPAConntrackEventCB
 	if(AF_INET6 == ip_type)
 	{
 		IPACMDBG("Ignoring ipv6(%d) connections\n", ip_type);
-		goto IGNORE;
+		return NFCT_CB_CONTINUE;
 	}
-
 #endif
 
-	ct_data = (ipacm_ct_evt_data *)malloc(sizeof(ipacm_ct_evt_data));
+	ct_data = AllocCtEvt((ct_evt_slab *)data);
 	if(ct_data == NULL)
 	{
-		IPACMERR("unable to allocate memory \n");
-		goto IGNORE;
+		return NFCT_CB_CONTINUE;
 	}
 
-	ct_data->ct = ct;
+	FillCtEvt(ct, ct_data);
 	ct_data->type = type;
+	PostCtEvt(ct_data);
 
-	evt_data.event = IPA_PROCESS_CT_MESSAGE;
-	evt_data.evt_data = (void *)ct_data;
+	/* Everything needed was copied out, libnetfilter_conntrack releases ct */
+	return NFCT_CB_CONTINUE;
+}
+#else
+/* Sets tb[type] for the attributes of one nest, up to type max */
+static void ct_parse_attrs
+(
+	 const struct nlattr *attr,
+	 int len,
+	 const struct nlattr **tb,
+	 int max
+)
+{
+	int type;
 
-#ifdef CT_OPT
-	if(AF_INET6 == ip_type)
+	memset(tb, 0, sizeof(struct nlattr *) * (max + 1));
+	while(len >= (int)sizeof(struct nlattr) &&
+				attr->nla_len >= sizeof(struct nlattr) && attr->nla_len <= len)
 	{
-		evt_data.event = IPA_PROCESS_CT_MESSAGE_V6;
+		type = attr->nla_type & NLA_TYPE_MASK;
+		if(type <= max)
+		{
+			tb[type] = attr;
+		}
+		len -= NLA_ALIGN(attr->nla_len);
+		attr = (const struct nlattr *)((const char *)attr + NLA_ALIGN(attr->nla_len));
+	}
+}
+
+#define CT_NLA_DATA(attr) ((const void *)((const char *)(attr) + NLA_HDRLEN))
+#define CT_NLA_LEN(attr) ((int)(attr)->nla_len - NLA_HDRLEN)
+#define CT_NLA_U8(attr) (*(const uint8_t *)CT_NLA_DATA(attr))
+#define CT_NLA_U16(attr) ntohs(*(const uint16_t *)CT_NLA_DATA(attr))
+#define CT_NLA_U32(attr) ntohl(*(const uint32_t *)CT_NLA_DATA(attr))
+
+static int ct_parse_tuple
+(
+	 const struct nlattr *nest,
+	 ipacm_ct_evt_data *rec,
+	 bool orig
+)
+{
+	const struct nlattr *tb[CTA_TUPLE_MAX + 1];
+	const struct nlattr *ip[CTA_IP_MAX + 1];
+	const struct nlattr *proto[CTA_PROTO_MAX + 1];
+
+	ct_parse_attrs((const struct nlattr *)CT_NLA_DATA(nest), CT_NLA_LEN(nest), tb, CTA_TUPLE_MAX);
+	if(tb[CTA_TUPLE_IP] == NULL || tb[CTA_TUPLE_PROTO] == NULL)
+	{
+		return -1;
 	}
+	ct_parse_attrs((const struct nlattr *)CT_NLA_DATA(tb[CTA_TUPLE_IP]),
+								 CT_NLA_LEN(tb[CTA_TUPLE_IP]), ip, CTA_IP_MAX);
+	ct_parse_attrs((const struct nlattr *)CT_NLA_DATA(tb[CTA_TUPLE_PROTO]),
+								 CT_NLA_LEN(tb[CTA_TUPLE_PROTO]), proto, CTA_PROTO_MAX);
+
+	if(proto[CTA_PROTO_NUM] == NULL)
+	{
+		return -1;
+	}
+
+	if(orig)
+	{
+		rec->l4proto = CT_NLA_U8(proto[CTA_PROTO_NUM]);
+		if(proto[CTA_PROTO_SRC_PORT] != NULL)
+			rec->orig_src_port = CT_NLA_U16(proto[CTA_PROTO_SRC_PORT]);
+		if(proto[CTA_PROTO_DST_PORT] != NULL)
+			rec->orig_dst_port = CT_NLA_U16(proto[CTA_PROTO_DST_PORT]);
+		if(ip[CTA_IP_V4_SRC] != NULL)
+			rec->orig_src_ip = CT_NLA_U32(ip[CTA_IP_V4_SRC]);
+		if(ip[CTA_IP_V4_DST] != NULL)
+			rec->orig_dst_ip = CT_NLA_U32(ip[CTA_IP_V4_DST]);
+#ifdef CT_OPT
+		if(ip[CTA_IP_V6_SRC] != NULL && CT_NLA_LEN(ip[CTA_IP_V6_SRC]) >= (int)sizeof(rec->orig_src_ipv6))
+			memcpy(rec->orig_src_ipv6, CT_NLA_DATA(ip[CTA_IP_V6_SRC]), sizeof(rec->orig_src_ipv6));
+		if(ip[CTA_IP_V6_DST] != NULL && CT_NLA_LEN(ip[CTA_IP_V6_DST]) >= (int)sizeof(rec->orig_dst_ipv6))
+			memcpy(rec->orig_dst_ipv6, CT_NLA_DATA(ip[CTA_IP_V6_DST]), sizeof(rec->orig_dst_ipv6));
 #endif
+	}
+	else
+	{
+		if(proto[CTA_PROTO_SRC_PORT] != NULL)
+			rec->repl_src_port = CT_NLA_U16(proto[CTA_PROTO_SRC_PORT]);
+		if(proto[CTA_PROTO_DST_PORT] != NULL)
+			rec->repl_dst_port = CT_NLA_U16(proto[CTA_PROTO_DST_PORT]);
+		if(ip[CTA_IP_V4_SRC] != NULL)
+			rec->repl_src_ip = CT_NLA_U32(ip[CTA_IP_V4_SRC]);
+		if(ip[CTA_IP_V4_DST] != NULL)
+			rec->repl_dst_ip = CT_NLA_U32(ip[CTA_IP_V4_DST]);
+	}
 
-	if(0 != IPACM_EvtDispatcher::PostEvt(&evt_data))
+	return 0;
+}
+
+/* Pulls the attributes ipacm uses straight from the ctnetlink message */
+int IPACM_ConntrackClient::ParseCtEvt(const struct nlmsghdr *nlh, ipacm_ct_evt_data *rec)
+{
+	const struct nfgenmsg *nfg = (const struct nfgenmsg *)NLMSG_DATA(nlh);
+	const struct nlattr *tb[CTA_MAX + 1];
+	const struct nlattr *info[CTA_PROTOINFO_MAX + 1];
+	const struct nlattr *tcp[CTA_PROTOINFO_TCP_MAX + 1];
+	int len;
+
+	len = (int)nlh->nlmsg_len - NLMSG_SPACE(sizeof(struct nfgenmsg));
+	if(len < 0)
 	{
-		IPACMERR("Error sending Conntrack message to processing thread!\n");
-		free(ct_data);
-		goto IGNORE;
+		return -1;
 	}
+	ct_parse_attrs((const struct nlattr *)((const char *)nfg + NLMSG_ALIGN(sizeof(struct nfgenmsg))),
+								 len, tb, CTA_MAX);
 
-/* NFCT_CB_STOLEN means that the conntrack object is not released after the
-	 callback That must be manually done later when the object is no longer needed. */
-	return NFCT_CB_STOLEN;
+	if(tb[CTA_TUPLE_ORIG] == NULL || tb[CTA_TUPLE_REPLY] == NULL)
+	{
+		IPACMDBG("Conntrack message without tuples\n");
+		return -1;
+	}
 
-IGNORE:
-	nfct_destroy(ct);
-	return NFCT_CB_STOLEN;
+	rec->l3proto = nfg->nfgen_family;
+	if(ct_parse_tuple(tb[CTA_TUPLE_ORIG], rec, true) < 0 ||
+		 ct_parse_tuple(tb[CTA_TUPLE_REPLY], rec, false) < 0)
+	{
+		IPACMDBG("Unable to parse conntrack tuples\n");
+		return -1;
+	}
 
+	if(tb[CTA_STATUS] != NULL)
+	{
+		rec->status = CT_NLA_U32(tb[CTA_STATUS]);
+	}
+
+	if(IPPROTO_TCP == rec->l4proto && tb[CTA_PROTOINFO] != NULL)
+	{
+		ct_parse_attrs((const struct nlattr *)CT_NLA_DATA(tb[CTA_PROTOINFO]),
+									 CT_NLA_LEN(tb[CTA_PROTOINFO]), info, CTA_PROTOINFO_MAX);
+		if(info[CTA_PROTOINFO_TCP] != NULL)
+		{
+			ct_parse_attrs((const struct nlattr *)CT_NLA_DATA(info[CTA_PROTOINFO_TCP]),
+										 CT_NLA_LEN(info[CTA_PROTOINFO_TCP]), tcp, CTA_PROTOINFO_TCP_MAX);
+			if(tcp[CTA_PROTOINFO_TCP_STATE] != NULL)
+			{
+				rec->tcp_state = CT_NLA_U8(tcp[CTA_PROTOINFO_TCP_STATE]);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Replaces nfct_catch(): one receive buffer for the thread, no
+   nf_conntrack object per message. Returns only on socket errors */
+int IPACM_ConntrackClient::CatchCtEvts
+(
+	 struct nfct_handle *hdl,
+	 ct_evt_slab *slab,
+	 unsigned int types
+)
+{
+	char buf[IPACM_CT_RCV_BUF_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+	const struct nlmsghdr *nlh;
+	const struct nfgenmsg *nfg;
+	ipacm_ct_evt_data *rec;
+	enum nf_conntrack_msg_type type;
+	int fd, len;
+
+	fd = nfct_fd(hdl);
+	while(1)
+	{
+		len = recv(fd, buf, sizeof(buf), 0);
+		if(len < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno == ENOBUFS)
+			{
+				IPACMERR("Conntrack socket overrun, events were lost\n");
+				continue;
+			}
+			return -1;
+		}
+
+		for(nlh = (const struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+		{
+			if(NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_CTNETLINK)
+			{
+				continue;
+			}
+
+			switch(NFNL_MSG_TYPE(nlh->nlmsg_type))
+			{
+			case IPCTNL_MSG_CT_NEW:
+				type = (nlh->nlmsg_flags & (NLM_F_CREATE | NLM_F_EXCL)) ? NFCT_T_NEW : NFCT_T_UPDATE;
+				break;
+			case IPCTNL_MSG_CT_DELETE:
+				type = NFCT_T_DESTROY;
+				break;
+			default:
+				continue;
+			}
+
+			if(!(type & types))
+			{
+				continue;
+			}
+			IPACMDBG("Conntrack event with msgtype: %d\n", type);
+
+			nfg = (const struct nfgenmsg *)NLMSG_DATA(nlh);
+#ifndef CT_OPT
+			if(AF_INET6 == nfg->nfgen_family)
+			{
+				IPACMDBG("Ignoring ipv6(%d) connections\n", nfg->nfgen_family);
+				continue;
+			}
+#endif
+
+			rec = AllocCtEvt(slab);
+			if(rec == NULL)
+			{
+				continue;
+			}
+
+			if(ParseCtEvt(nlh, rec) < 0)
+			{
+				FreeCtEvt(rec);
+				continue;
+			}
+			rec->type = type;
+			PostCtEvt(rec);
+		}
+	}
+
+	return -1;
 }
+#endif
 
 int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Bridge_Addrs
 (
@@ -414,6 +764,7 @@ void* IPACM_ConntrackClient::TCPRegisterWithConnTrack(void *)
 	int ret;
 	IPACM_ConntrackClient *pClient;
 	unsigned subscrips = 0;
+	unsigned types;
 
 	IPACMDBG("\n");
 
@@ -452,22 +803,29 @@ void* IPACM_ConntrackClient::TCPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Register callback with netfilter handler */
 	IPACMDBG_H("tcp handle:%p, fd:%d\n", pClient->tcp_hdl, nfct_fd(pClient->tcp_hdl));
 #ifndef CT_OPT
-	nfct_callback_register(pClient->tcp_hdl,
-			(nf_conntrack_msg_type)	(NFCT_T_UPDATE | NFCT_T_DESTROY | NFCT_T_NEW),
-						IPAConntrackEventCB, NULL);
+	types = (NFCT_T_UPDATE | NFCT_T_DESTROY | NFCT_T_NEW);
 #else
-	nfct_callback_register(pClient->tcp_hdl, (nf_conntrack_msg_type) NFCT_T_ALL, IPAConntrackEventCB, NULL);
+	types = NFCT_T_ALL;
 #endif
 
+#ifdef IPACM_CT_LIBNFCT_PARSE
+	/* Register callback with netfilter handler */
+	nfct_callback_register(pClient->tcp_hdl, (nf_conntrack_msg_type)types,
+						IPAConntrackEventCB, &pClient->tcp_slab);
+
 	/* Block to catch events from net filter connection track */
 	/* nfct_catch() receives conntrack events from kernel-space, by default it
 			 blocks waiting for events. */
 	IPACMDBG("Waiting for events\n");
 
 	ret = nfct_catch(pClient->tcp_hdl);
+#else
+	IPACMDBG("Waiting for events\n");
+
+	ret = CatchCtEvts(pClient->tcp_hdl, &pClient->tcp_slab, types);
+#endif
 	if(ret == -1)
 	{
 		IPACMERR("(%d)(%s)\n", ret, strerror(errno));
@@ -529,16 +887,22 @@ void* IPACM_ConntrackClient::UDPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Register callback with netfilter handler */
 	IPACMDBG_H("udp handle:%p, fd:%d\n", pClient->udp_hdl, nfct_fd(pClient->udp_hdl));
+#ifdef IPACM_CT_LIBNFCT_PARSE
+	/* Register callback with netfilter handler */
 	nfct_callback_register(pClient->udp_hdl,
 			(nf_conntrack_msg_type)(NFCT_T_NEW | NFCT_T_DESTROY),
 			IPAConntrackEventCB,
-			NULL);
+			&pClient->udp_slab);
+#endif
 
 	/* Block to catch events from net filter connection track */
 ctcatch:
+#ifdef IPACM_CT_LIBNFCT_PARSE
 	ret = nfct_catch(pClient->udp_hdl);
+#else
+	ret = CatchCtEvts(pClient->udp_hdl, &pClient->udp_slab, (NFCT_T_NEW | NFCT_T_DESTROY));
+#endif
 	if(ret == -1)
 	{
 		IPACMDBG("(%d)(%s)\n", ret, strerror(errno));
@@ -38,10 +38,13 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 IPACM_ConntrackListener::IPACM_ConntrackListener()
 {
+	 pthread_rwlockattr_t attr;
+
 	 IPACMDBG("\n");
 
 	 isNatThreadStart = false;
 	 isCTReg = false;
+	 CtWorkerCnt = 0;
 	 WanUp = false;
 	 nat_inst = NatApp::GetInstance();
 
@@ -53,7 +56,17 @@ IPACM_ConntrackListener::IPACM_ConntrackListener()
 	 memset(nat_iface_ipv4_addr, 0, sizeof(nat_iface_ipv4_addr));
 	 memset(nonnat_iface_ipv4_addr, 0, sizeof(nonnat_iface_ipv4_addr));
 	 memset(sta_clnt_ipv4_addr, 0, sizeof(sta_clnt_ipv4_addr));
+	 UpdateCfgSnapshot();
+
+	 /* Workers read constantly, do not let them starve the handlers */
+	 pthread_rwlockattr_init(&attr);
+#ifdef PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP
+	 pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	 pthread_rwlock_init(&ct_lock, &attr);
+	 pthread_rwlockattr_destroy(&attr);
 
+	 IPACM_EvtDispatcher::registr_ct(this);
 	 IPACM_EvtDispatcher::registr(IPA_HANDLE_WAN_UP, this);
 	 IPACM_EvtDispatcher::registr(IPA_HANDLE_WAN_DOWN, this);
 	 IPACM_EvtDispatcher::registr(IPA_PROCESS_CT_MESSAGE, this);
@@ -62,6 +75,8 @@ IPACM_ConntrackListener::IPACM_ConntrackListener()
 	 IPACM_EvtDispatcher::registr(IPA_HANDLE_LAN_UP, this);
 	 IPACM_EvtDispatcher::registr(IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT, this);
 	 IPACM_EvtDispatcher::registr(IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT, this);
+	 IPACM_EvtDispatcher::registr(IPA_PRIVATE_SUBNET_CHANGE_EVENT, this);
+	 IPACM_EvtDispatcher::registr(IPA_CFG_CHANGE_EVENT, this);
 
 #ifdef CT_OPT
 	 p_lan2lan = IPACM_LanToLan::getLan2LanInstance();
@@ -73,6 +88,17 @@ void IPACM_ConntrackListener::event_callback(ipa_cm_event_id evt,
 {
 	 ipacm_event_iface_up *wan_down = NULL;
 
+	 /* these may carry no data; the iface manager, registered ahead
+	    of us, has already rebuilt the config tables */
+	 if(evt == IPA_CFG_CHANGE_EVENT || evt == IPA_PRIVATE_SUBNET_CHANGE_EVENT)
+	 {
+		 IPACMDBG("Received event %d, refreshing config snapshot\n", evt);
+		 pthread_rwlock_wrlock(&ct_lock);
+		 UpdateCfgSnapshot();
+		 pthread_rwlock_unlock(&ct_lock);
+		 return;
+	 }
+
 	 if(data == NULL)
 	 {
 		 IPACMERR("Invalid Data\n");
@@ -96,6 +122,9 @@ void IPACM_ConntrackListener::event_callback(ipa_cm_event_id evt,
 	 case IPA_HANDLE_WAN_UP:
 			IPACMDBG_H("Received IPA_HANDLE_WAN_UP event\n");
 			CreateConnTrackThreads();
+			pthread_rwlock_wrlock(&ct_lock);
+			UpdateCfgSnapshot();
+			pthread_rwlock_unlock(&ct_lock);
 			if(!isWanUp())
 			{
 				TriggerWANUp(data);
@@ -125,12 +154,16 @@ void IPACM_ConntrackListener::event_callback(ipa_cm_event_id evt,
 
 	 case IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT:
 		 IPACMDBG("Received IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT event\n");
+		 pthread_rwlock_wrlock(&ct_lock);
 		 HandleNonNatIPAddr(data, true);
+		 pthread_rwlock_unlock(&ct_lock);
 		 break;
 
 	 case IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT:
 		 IPACMDBG("Received IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT event\n");
+		 pthread_rwlock_wrlock(&ct_lock);
 		 HandleNonNatIPAddr(data, false);
+		 pthread_rwlock_unlock(&ct_lock);
 		 break;
 
 	 default:
@@ -287,6 +320,7 @@ void IPACM_ConntrackListener::HandleNeighIpAddrAddEvt(
 	bool NatIface = false;
 	int j, ret;
 
+	pthread_rwlock_wrlock(&ct_lock);
 	ret = CheckNatIface(data, &NatIface);
 	if (NatIface && ret == IPACM_SUCCESS)
 	{
@@ -312,6 +346,7 @@ void IPACM_ConntrackListener::HandleNeighIpAddrAddEvt(
 			nat_inst->FlushTempEntries(data->ipv4_addr, true);
 		}
 	}
+	pthread_rwlock_unlock(&ct_lock);
 	return;
 }
 
@@ -327,6 +362,7 @@ void IPACM_ConntrackListener::HandleNeighIpAddrDelEvt(
 	}
 
 	iptodot("HandleNeighIpAddrDelEvt(): Received ip addr", ipv4_addr);
+	pthread_rwlock_wrlock(&ct_lock);
 	for(cnt = 0; cnt<MAX_IFACE_ADDRESS; cnt++)
 	{
 		if (nat_iface_ipv4_addr[cnt] == ipv4_addr)
@@ -338,6 +374,7 @@ void IPACM_ConntrackListener::HandleNeighIpAddrDelEvt(
 			nat_inst->DelEntriesOnClntDiscon(ipv4_addr);
 		}
 	}
+	pthread_rwlock_unlock(&ct_lock);
 
 	return;
 }
@@ -356,6 +393,7 @@ void IPACM_ConntrackListener::TriggerWANUp(void *in_param)
 		 return;
 	 }
 
+	 pthread_rwlock_wrlock(&ct_lock);
 	 WanUp = true;
 	 isStaMode = wanup_data->is_sta;
 	 IPACMDBG("isStaMode: %d\n", isStaMode);
@@ -367,6 +405,7 @@ void IPACM_ConntrackListener::TriggerWANUp(void *in_param)
 	 {
 		 nat_inst->AddTable(wanup_data->ipv4_addr);
 	 }
+	 pthread_rwlock_unlock(&ct_lock);
 
 	 IPACMDBG("creating nat threads\n");
 	 CreateNatThreads();
@@ -375,10 +414,32 @@ void IPACM_ConntrackListener::TriggerWANUp(void *in_param)
 int IPACM_ConntrackListener::CreateConnTrackThreads(void)
 {
 	int ret;
-	pthread_t tcp_thread = 0, udp_thread = 0;
+	pthread_t tcp_thread = 0, udp_thread = 0, ct_worker = 0;
+	char name[16];
 
 	if(isCTReg == false)
 	{
+		/* Workers first, the listeners post to them right away.
+		   Each queue must have exactly one worker, a retry only
+		   starts the ones missing */
+		for(; CtWorkerCnt < IPACM_CT_WORKERS; CtWorkerCnt++)
+		{
+			ret = pthread_create(&ct_worker, NULL, MessageQueue::ProcessCt, (void *)(intptr_t)CtWorkerCnt);
+			if(0 != ret)
+			{
+				IPACMERR("unable to create conntrack worker thread %d\n", CtWorkerCnt);
+				PERROR("unable to create conntrack worker\n");
+				return -1;
+			}
+
+			IPACMDBG("created conntrack worker thread %d\n", CtWorkerCnt);
+			snprintf(name, sizeof(name), "ct worker %d", CtWorkerCnt);
+			if(pthread_setname_np(ct_worker, name) != 0)
+			{
+				IPACMERR("unable to set thread name\n");
+			}
+		}
+
 		if(!tcp_thread)
 		{
 			ret = pthread_create(&tcp_thread, NULL, IPACM_ConntrackClient::TCPRegisterWithConnTrack, NULL);
@@ -460,61 +521,50 @@ void IPACM_ConntrackListener::TriggerWANDown(uint32_t wan_addr)
 		    ((wan_addr>>24) & 0xFF), ((wan_addr>>16) & 0xFF), 
 		    ((wan_addr>>8) & 0xFF), (wan_addr & 0xFF));
 	 
+	 pthread_rwlock_wrlock(&ct_lock);
 	 WanUp = false;
 
 	 if(nat_inst != NULL)
 	 {
 		 nat_inst->DeleteTable(wan_addr);
 	 }
+	 pthread_rwlock_unlock(&ct_lock);
 }
 
 
-void ParseCTMessage(struct nf_conntrack *ct)
+void ParseCTMessage(const ipacm_ct_evt_data *ct)
 {
-	 uint32_t status, timeout;
 	 IPACMDBG("Printing conntrack parameters\n");
 
-	 iptodot("ATTR_IPV4_SRC = ATTR_ORIG_IPV4_SRC:", nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC));
-	 iptodot("ATTR_IPV4_DST = ATTR_ORIG_IPV4_DST:", nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_DST));
-	 IPACMDBG("ATTR_PORT_SRC = ATTR_ORIG_PORT_SRC: 0x%x\n", nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC));
-	 IPACMDBG("ATTR_PORT_DST = ATTR_ORIG_PORT_DST: 0x%x\n", nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST));
-
-	 iptodot("ATTR_REPL_IPV4_SRC:", nfct_get_attr_u32(ct, ATTR_REPL_IPV4_SRC));
-	 iptodot("ATTR_REPL_IPV4_DST:", nfct_get_attr_u32(ct, ATTR_REPL_IPV4_DST));
-	 IPACMDBG("ATTR_REPL_PORT_SRC: 0x%x\n", nfct_get_attr_u16(ct, ATTR_REPL_PORT_SRC));
-	 IPACMDBG("ATTR_REPL_PORT_DST: 0x%x\n", nfct_get_attr_u16(ct, ATTR_REPL_PORT_DST));
-
-	 iptodot("ATTR_SNAT_IPV4:", nfct_get_attr_u32(ct, ATTR_SNAT_IPV4));
-	 iptodot("ATTR_DNAT_IPV4:", nfct_get_attr_u32(ct, ATTR_DNAT_IPV4));
-	 IPACMDBG("ATTR_SNAT_PORT: 0x%x\n", nfct_get_attr_u16(ct, ATTR_SNAT_PORT));
-	 IPACMDBG("ATTR_DNAT_PORT: 0x%x\n", nfct_get_attr_u16(ct, ATTR_DNAT_PORT));
+	 iptodot("ATTR_IPV4_SRC = ATTR_ORIG_IPV4_SRC:", ct->orig_src_ip);
+	 iptodot("ATTR_IPV4_DST = ATTR_ORIG_IPV4_DST:", ct->orig_dst_ip);
+	 IPACMDBG("ATTR_PORT_SRC = ATTR_ORIG_PORT_SRC: 0x%x\n", ct->orig_src_port);
+	 IPACMDBG("ATTR_PORT_DST = ATTR_ORIG_PORT_DST: 0x%x\n", ct->orig_dst_port);
 
-	 IPACMDBG("ATTR_MARK: 0x%x\n", nfct_get_attr_u32(ct, ATTR_MARK));
-	 IPACMDBG("ATTR_USE: 0x%x\n", nfct_get_attr_u32(ct, ATTR_USE));
-	 IPACMDBG("ATTR_ID: 0x%x\n", nfct_get_attr_u32(ct, ATTR_ID));
+	 iptodot("ATTR_REPL_IPV4_SRC:", ct->repl_src_ip);
+	 iptodot("ATTR_REPL_IPV4_DST:", ct->repl_dst_ip);
+	 IPACMDBG("ATTR_REPL_PORT_SRC: 0x%x\n", ct->repl_src_port);
+	 IPACMDBG("ATTR_REPL_PORT_DST: 0x%x\n", ct->repl_dst_port);
 
-	 status = nfct_get_attr_u32(ct, ATTR_STATUS);
-	 IPACMDBG("ATTR_STATUS: 0x%x\n", status);
+	 IPACMDBG("ATTR_ORIG_L4PROTO: 0x%x\n", ct->l4proto);
+	 IPACMDBG("ATTR_STATUS: 0x%x\n", ct->status);
 
-	 timeout = nfct_get_attr_u32(ct, ATTR_TIMEOUT);
-	 IPACMDBG("ATTR_TIMEOUT: 0x%x\n", timeout);
-
-	 if(IPS_SRC_NAT & status)
+	 if(IPS_SRC_NAT & ct->status)
 	 {
 			IPACMDBG("IPS_SRC_NAT set\n");
 	 }
 
-	 if(IPS_DST_NAT & status)
+	 if(IPS_DST_NAT & ct->status)
 	 {
 			IPACMDBG("IPS_DST_NAT set\n");
 	 }
 
-	 if(IPS_SRC_NAT_DONE & status)
+	 if(IPS_SRC_NAT_DONE & ct->status)
 	 {
 			IPACMDBG("IPS_SRC_NAT_DONE set\n");
 	 }
 
-	 if(IPS_DST_NAT_DONE & status)
+	 if(IPS_DST_NAT_DONE & ct->status)
 	 {
 			IPACMDBG(" IPS_DST_NAT_DONE set\n");
 	 }
@@ -523,94 +573,67 @@ void ParseCTMessage(struct nf_conntrack *ct)
 	 return;
 }
 
-void ParseCTV6Message(struct nf_conntrack *ct)
+#ifdef CT_OPT
+void ParseCTV6Message(const ipacm_ct_evt_data *ct)
 {
-	 uint32_t status, timeout;
-	 struct nfct_attr_grp_ipv6 orig_params;
-	 uint8_t l4proto, tcp_flags, tcp_state;
-
 	 IPACMDBG("Printing conntrack parameters\n");
 
-	 nfct_get_attr_grp(ct, ATTR_GRP_ORIG_IPV6, (void *)&orig_params);
-	 IPACMDBG("Orig src_v6_addr: 0x%08x%08x%08x%08x\n", orig_params.src[0], orig_params.src[1],
-                	orig_params.src[2], orig_params.src[3]);
-	IPACMDBG("Orig dst_v6_addr: 0x%08x%08x%08x%08x\n", orig_params.dst[0], orig_params.dst[1],
-                	orig_params.dst[2], orig_params.dst[3]);
-
-	 IPACMDBG("ATTR_PORT_SRC = ATTR_ORIG_PORT_SRC: 0x%x\n", nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC));
-	 IPACMDBG("ATTR_PORT_DST = ATTR_ORIG_PORT_DST: 0x%x\n", nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST));
-
-	 IPACMDBG("ATTR_MARK: 0x%x\n", nfct_get_attr_u32(ct, ATTR_MARK));
-	 IPACMDBG("ATTR_USE: 0x%x\n", nfct_get_attr_u32(ct, ATTR_USE));
-	 IPACMDBG("ATTR_ID: 0x%x\n", nfct_get_attr_u32(ct, ATTR_ID));
+	 IPACMDBG("Orig src_v6_addr: 0x%08x%08x%08x%08x\n", ct->orig_src_ipv6[0], ct->orig_src_ipv6[1],
+                	ct->orig_src_ipv6[2], ct->orig_src_ipv6[3]);
+	IPACMDBG("Orig dst_v6_addr: 0x%08x%08x%08x%08x\n", ct->orig_dst_ipv6[0], ct->orig_dst_ipv6[1],
+                	ct->orig_dst_ipv6[2], ct->orig_dst_ipv6[3]);
 
-	 timeout = nfct_get_attr_u32(ct, ATTR_TIMEOUT);
-	 IPACMDBG("ATTR_TIMEOUT: 0x%x\n", timeout);
+	 IPACMDBG("ATTR_PORT_SRC = ATTR_ORIG_PORT_SRC: 0x%x\n", ct->orig_src_port);
+	 IPACMDBG("ATTR_PORT_DST = ATTR_ORIG_PORT_DST: 0x%x\n", ct->orig_dst_port);
 
-	 status = nfct_get_attr_u32(ct, ATTR_STATUS);
-	 IPACMDBG("ATTR_STATUS: 0x%x\n", status);
+	 IPACMDBG("ATTR_STATUS: 0x%x\n", ct->status);
 
-	 l4proto = nfct_get_attr_u8(ct, ATTR_ORIG_L4PROTO);
-	 IPACMDBG("ATTR_ORIG_L4PROTO: 0x%x\n", l4proto);
-	 if(l4proto == IPPROTO_TCP)
+	 IPACMDBG("ATTR_ORIG_L4PROTO: 0x%x\n", ct->l4proto);
+	 if(ct->l4proto == IPPROTO_TCP)
 	 {
-		tcp_state = nfct_get_attr_u8(ct, ATTR_TCP_STATE);
-		IPACMDBG("ATTR_TCP_STATE: 0x%x\n", tcp_state);
-
-		tcp_flags =  nfct_get_attr_u8(ct, ATTR_TCP_FLAGS_ORIG);
-		IPACMDBG("ATTR_TCP_FLAGS_ORIG: 0x%x\n", tcp_flags);
+		IPACMDBG("ATTR_TCP_STATE: 0x%x\n", ct->tcp_state);
 	 }
 
 	 IPACMDBG("\n");
 	 return;
 }
 
-#ifdef CT_OPT
 void IPACM_ConntrackListener::ProcessCTV6Message(void *param)
 {
 	ipacm_ct_evt_data *evt_data = (ipacm_ct_evt_data *)param;
 	u_int8_t l4proto = 0;
 	uint32_t status = 0;
-	struct nf_conntrack *ct = evt_data->ct;
 
 #ifdef IPACM_DEBUG
-	 char buf[1024];
-
-	 /* Process message and generate ioctl call to kernel thread */
-	 nfct_snprintf(buf, sizeof(buf), evt_data->ct,
-								 evt_data->type, NFCT_O_PLAIN, NFCT_OF_TIME);
-	 IPACMDBG("%s\n", buf);
-	 IPACMDBG("\n");
-	 ParseCTV6Message(ct);
+	 IPACMDBG("Received type:%d\n", evt_data->type);
+	 ParseCTV6Message(evt_data);
 #endif
 
 	if(p_lan2lan == NULL)
 	{
 		IPACMERR("Lan2Lan Instance is null\n");
-		goto IGNORE;
+		return;
 	}
 
-	status = nfct_get_attr_u32(ct, ATTR_STATUS);
+	status = evt_data->status;
 	if((IPS_DST_NAT & status) || (IPS_SRC_NAT & status))
 	{
 		IPACMDBG("Either Destination or Source nat flag Set\n");
-		goto IGNORE;
+		return;
 	}
 
-	l4proto = nfct_get_attr_u8(ct, ATTR_ORIG_L4PROTO);
+	l4proto = evt_data->l4proto;
 	if(IPPROTO_UDP != l4proto && IPPROTO_TCP != l4proto)
 	{
 		 IPACMDBG("Received unexpected protocl %d conntrack message\n", l4proto);
-		 goto IGNORE;
+		 return;
 	}
 
 	IPACMDBG("Neither Destination nor Source nat flag Set\n");
-	struct nfct_attr_grp_ipv6 orig_params;
-	nfct_get_attr_grp(ct, ATTR_GRP_ORIG_IPV6, (void *)&orig_params);
 
 	ipacm_event_connection lan2lan_conn;
 	lan2lan_conn.iptype = IPA_IP_v6;
-	memcpy(lan2lan_conn.src_ipv6_addr, orig_params.src,
+	memcpy(lan2lan_conn.src_ipv6_addr, evt_data->orig_src_ipv6,
 				 sizeof(lan2lan_conn.src_ipv6_addr));
     IPACMDBG("Before convert, src_v6_addr: 0x%08x%08x%08x%08x\n", lan2lan_conn.src_ipv6_addr[0], lan2lan_conn.src_ipv6_addr[1],
                 	lan2lan_conn.src_ipv6_addr[2], lan2lan_conn.src_ipv6_addr[3]);
@@ -621,7 +644,7 @@ void IPACM_ConntrackListener::ProcessCTV6Message(void *param)
 	IPACMDBG("After convert src_v6_addr: 0x%08x%08x%08x%08x\n", lan2lan_conn.src_ipv6_addr[0], lan2lan_conn.src_ipv6_addr[1],
                 	lan2lan_conn.src_ipv6_addr[2], lan2lan_conn.src_ipv6_addr[3]);
 
-	memcpy(lan2lan_conn.dst_ipv6_addr, orig_params.dst,
+	memcpy(lan2lan_conn.dst_ipv6_addr, evt_data->orig_dst_ipv6,
 				 sizeof(lan2lan_conn.dst_ipv6_addr));
 	IPACMDBG("Before convert, dst_ipv6_addr: 0x%08x%08x%08x%08x\n", lan2lan_conn.dst_ipv6_addr[0], lan2lan_conn.dst_ipv6_addr[1],
                 	lan2lan_conn.dst_ipv6_addr[2], lan2lan_conn.dst_ipv6_addr[3]);
@@ -634,21 +657,19 @@ void IPACM_ConntrackListener::ProcessCTV6Message(void *param)
 
 	if(((IPPROTO_UDP == l4proto) && (NFCT_T_NEW == evt_data->type)) ||
 		 ((IPPROTO_TCP == l4proto) &&
-			(nfct_get_attr_u8(ct, ATTR_TCP_STATE) == TCP_CONNTRACK_ESTABLISHED))
+			(evt_data->tcp_state == TCP_CONNTRACK_ESTABLISHED))
 		 )
 	{
 			p_lan2lan->handle_new_connection(&lan2lan_conn);
 	}
 	else if((IPPROTO_UDP == l4proto && NFCT_T_DESTROY == evt_data->type) ||
 					(IPPROTO_TCP == l4proto &&
-					 nfct_get_attr_u8(ct, ATTR_TCP_STATE) == TCP_CONNTRACK_FIN_WAIT))
+					 evt_data->tcp_state == TCP_CONNTRACK_FIN_WAIT))
 	{
 			p_lan2lan->handle_del_connection(&lan2lan_conn);
 	}
 
-IGNORE:
-	/* Cleanup item that was allocated during the original CT callback */
-	nfct_destroy(ct);
+	/* The record goes back to its slab once the dispatcher is done */
 	return;
 }
 #endif
@@ -659,30 +680,22 @@ void IPACM_ConntrackListener::ProcessCTMessage(void *param)
 	 u_int8_t l4proto = 0;
 
 #ifdef IPACM_DEBUG
-	 char buf[1024];
-	 unsigned int out_flags;
-
-	 /* Process message and generate ioctl call to kernel thread */
-	 out_flags = (NFCT_OF_SHOW_LAYER3 | NFCT_OF_TIME | NFCT_OF_ID);
-	 nfct_snprintf(buf, sizeof(buf), evt_data->ct,
-								 evt_data->type, NFCT_O_PLAIN, out_flags);
-	 IPACMDBG_H("%s\n", buf);
-
-	 ParseCTMessage(evt_data->ct);
+	 IPACMDBG_H("Received type:%d\n", evt_data->type);
+	 ParseCTMessage(evt_data);
 #endif
 
-	 l4proto = nfct_get_attr_u8(evt_data->ct, ATTR_ORIG_L4PROTO);
+	 l4proto = evt_data->l4proto;
 	 if(IPPROTO_UDP != l4proto && IPPROTO_TCP != l4proto)
 	 {
 			IPACMDBG("Received unexpected protocl %d conntrack message\n", l4proto);
 	 }
 	 else
 	 {
-			ProcessTCPorUDPMsg(evt_data->ct, evt_data->type, l4proto);
+			pthread_rwlock_rdlock(&ct_lock);
+			ProcessTCPorUDPMsg(evt_data);
+			pthread_rwlock_unlock(&ct_lock);
 	 }
 
-	 /* Cleanup item that was allocated during the original CT callback */
-	 nfct_destroy(evt_data->ct);
 	 return;
 }
 
@@ -694,9 +707,9 @@ bool IPACM_ConntrackListener::AddIface(
 	*isTempEntry = false;
 
 	/* Special handling for Passthrough IP. */
-	if (IPACM_Iface::ipacmcfg->ipacm_ip_passthrough_mode)
+	if (ip_passthrough_mode)
 	{
-		if (rule->private_ip == IPACM_Wan::getWANIP())
+		if (rule->private_ip == passthrough_wan_ip)
 		{
 			IPACMDBG("In Passthrough mode and entry matched with Wan IP (0x%x)\n",
 				rule->private_ip);
@@ -746,22 +759,63 @@ bool IPACM_ConntrackListener::AddIface(
 	else
 		IPACMDBG("In STA mode, don't compare against non nat ifaces\n");
 
+	if (isPrivateSubnet(rule->private_ip) ||
+		isPrivateSubnet(rule->target_ip))
+	{
+		IPACMDBG("Matching with Private subnet\n");
+		*isTempEntry = true;
+		return true;
+	}
+
+	return false;
+}
+
+/* Called with ct_lock held for write, or before the workers exist */
+void IPACM_ConntrackListener::UpdateCfgSnapshot(void)
+{
+	int cnt;
+
+	passthrough_wan_ip = IPACM_Wan::getWANIP();
+
 	if(pConfig == NULL)
 	{
 		pConfig = IPACM_Config::GetInstance();
 		if(pConfig == NULL)
 		{
 			IPACMERR("Unable to get Config instance\n");
-			return false;
+			ip_passthrough_mode = false;
+			num_private_subnet = 0;
+			return;
 		}
 	}
 
-	if (pConfig->isPrivateSubnet(rule->private_ip) ||
-		pConfig->isPrivateSubnet(rule->target_ip))
+	ip_passthrough_mode = pConfig->ipacm_ip_passthrough_mode;
+	num_private_subnet = pConfig->ipa_num_private_subnet;
+	if(num_private_subnet > IPA_MAX_PRIVATE_SUBNET_ENTRIES)
 	{
-		IPACMDBG("Matching with Private subnet\n");
-		*isTempEntry = true;
-		return true;
+		num_private_subnet = IPA_MAX_PRIVATE_SUBNET_ENTRIES;
+	}
+
+	for(cnt = 0; cnt < num_private_subnet; cnt++)
+	{
+		private_subnet_table[cnt] = pConfig->private_subnet_table[cnt];
+	}
+
+	IPACMDBG("passthrough mode %d wan ip 0x%x, %d private subnets\n",
+		ip_passthrough_mode, passthrough_wan_ip, num_private_subnet);
+}
+
+bool IPACM_ConntrackListener::isPrivateSubnet(uint32_t ip_addr)
+{
+	int cnt;
+
+	for(cnt = 0; cnt < num_private_subnet; cnt++)
+	{
+		if(private_subnet_table[cnt].subnet_addr ==
+			 (private_subnet_table[cnt].subnet_mask & ip_addr))
+		{
+			return true;
+		}
 	}
 
 	return false;
@@ -793,7 +847,7 @@ void IPACM_ConntrackListener::AddORDeleteNatEntry(const nat_entry_bundle *input)
 
 	if (IPPROTO_TCP == input->rule->protocol)
 	{
-		tcp_state = nfct_get_attr_u8(input->ct, ATTR_TCP_STATE);
+		tcp_state = input->tcp_state;
 		if (TCP_CONNTRACK_ESTABLISHED == tcp_state)
 		{
 			IPACMDBG("TCP state TCP_CONNTRACK_ESTABLISHED(%d)\n", tcp_state);
@@ -858,7 +912,7 @@ void IPACM_ConntrackListener::AddORDeleteNatEntry(const nat_entry_bundle *input)
 }
 
 void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
-	 struct nf_conntrack *ct,
+	 const ipacm_ct_evt_data *ct,
 	 uint32_t status,
 	 nat_table_entry *rule)
 {
@@ -868,24 +922,20 @@ void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
 		rule->dst_nat = true;
 
 		IPACMDBG("Parse reply tuple\n");
-		rule->target_ip = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC);
-		rule->target_ip = ntohl(rule->target_ip);
+		rule->target_ip = ct->orig_src_ip;
 		iptodot("PopulateTCPorUDPEntry(): target ip", rule->target_ip);
 
 		/* Retriev target/dst port */
-		rule->target_port = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC);
-		rule->target_port = ntohs(rule->target_port);
+		rule->target_port = ct->orig_src_port;
 		if (0 == rule->target_port)
 		{
 			IPACMDBG("unable to retrieve target port\n");
 		}
 
-		rule->public_port = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST);
-		rule->public_port = ntohs(rule->public_port);
+		rule->public_port = ct->orig_dst_port;
 
 		/* Retriev src/private ip address */
-		rule->private_ip = nfct_get_attr_u32(ct, ATTR_REPL_IPV4_SRC);
-		rule->private_ip = ntohl(rule->private_ip);
+		rule->private_ip = ct->repl_src_ip;
 		iptodot("PopulateTCPorUDPEntry(): private ip", rule->private_ip);
 		if (0 == rule->private_ip)
 		{
@@ -893,8 +943,7 @@ void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
 		}
 
 		/* Retriev src/private port */
-		rule->private_port = nfct_get_attr_u16(ct, ATTR_REPL_PORT_SRC);
-		rule->private_port = ntohs(rule->private_port);
+		rule->private_port = ct->repl_src_port;
 		if (0 == rule->private_port)
 		{
 			IPACMDBG("unable to retrieve private port\n");
@@ -907,32 +956,28 @@ void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
 
 		/* Retriev target/dst ip address */
 		IPACMDBG("Parse source tuple\n");
-		rule->target_ip = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_DST);
-		rule->target_ip = ntohl(rule->target_ip);
+		rule->target_ip = ct->orig_dst_ip;
 		iptodot("PopulateTCPorUDPEntry(): target ip", rule->target_ip);
 		if (0 == rule->target_ip)
 		{
 			IPACMDBG("unable to retrieve target ip address\n");
 		}
 		/* Retriev target/dst port */
-		rule->target_port = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST);
-		rule->target_port = ntohs(rule->target_port);
+		rule->target_port = ct->orig_dst_port;
 		if (0 == rule->target_port)
 		{
 			IPACMDBG("unable to retrieve target port\n");
 		}
 
 		/* Retriev public port */
-		rule->public_port = nfct_get_attr_u16(ct, ATTR_REPL_PORT_DST);
-		rule->public_port = ntohs(rule->public_port);
+		rule->public_port = ct->repl_dst_port;
 		if (0 == rule->public_port)
 		{
 			IPACMDBG("unable to retrieve public port\n");
 		}
 
 		/* Retriev src/private ip address */
-		rule->private_ip = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC);
-		rule->private_ip = ntohl(rule->private_ip);
+		rule->private_ip = ct->orig_src_ip;
 		iptodot("PopulateTCPorUDPEntry(): private ip", rule->private_ip);
 		if (0 == rule->private_ip)
 		{
@@ -940,8 +985,7 @@ void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
 		}
 
 		/* Retriev src/private port */
-		rule->private_port = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC);
-		rule->private_port = ntohs(rule->private_port);
+		rule->private_port = ct->orig_src_port;
 		if (0 == rule->private_port)
 		{
 			IPACMDBG("unable to retrieve private port\n");
@@ -952,8 +996,7 @@ void IPACM_ConntrackListener::PopulateTCPorUDPEntry(
 }
 
 #ifdef CT_OPT
-void IPACM_ConntrackListener::HandleLan2Lan(struct nf_conntrack *ct,
-	enum nf_conntrack_msg_type type,
+void IPACM_ConntrackListener::HandleLan2Lan(const ipacm_ct_evt_data *ct,
 	 nat_table_entry *rule)
 {
 	ipacm_event_connection lan2lan_conn = { 0 };
@@ -965,17 +1008,17 @@ void IPACM_ConntrackListener::HandleLan2Lan(struct nf_conntrack *ct,
 	}
 
 	lan2lan_conn.iptype = IPA_IP_v4;
-	lan2lan_conn.src_ipv4_addr = orig_src_ip;
-	lan2lan_conn.dst_ipv4_addr = orig_dst_ip;
+	lan2lan_conn.src_ipv4_addr = ct->orig_src_ip;
+	lan2lan_conn.dst_ipv4_addr = ct->orig_dst_ip;
 
-	if (((IPPROTO_UDP == rule->protocol) && (NFCT_T_NEW == type)) ||
-		((IPPROTO_TCP == rule->protocol) && (nfct_get_attr_u8(ct, ATTR_TCP_STATE) == TCP_CONNTRACK_ESTABLISHED)))
+	if (((IPPROTO_UDP == rule->protocol) && (NFCT_T_NEW == ct->type)) ||
+		((IPPROTO_TCP == rule->protocol) && (ct->tcp_state == TCP_CONNTRACK_ESTABLISHED)))
 	{
 		p_lan2lan->handle_new_connection(&lan2lan_conn);
 	}
-	else if ((IPPROTO_UDP == rule->protocol && NFCT_T_DESTROY == type) ||
+	else if ((IPPROTO_UDP == rule->protocol && NFCT_T_DESTROY == ct->type) ||
 			   (IPPROTO_TCP == rule->protocol &&
-				nfct_get_attr_u8(ct, ATTR_TCP_STATE) == TCP_CONNTRACK_FIN_WAIT))
+				ct->tcp_state == TCP_CONNTRACK_FIN_WAIT))
 	{
 		p_lan2lan->handle_del_connection(&lan2lan_conn);
 	}
@@ -1020,9 +1063,7 @@ void IPACM_ConntrackListener::CheckSTAClient(
 
 /* conntrack send in host order and ipa expects in host order */
 void IPACM_ConntrackListener::ProcessTCPorUDPMsg(
-	 struct nf_conntrack *ct,
-	 enum nf_conntrack_msg_type type,
-	 u_int8_t l4proto)
+	 const ipacm_ct_evt_data *ct)
 {
 	 nat_table_entry rule;
 	 uint32_t status = 0;
@@ -1031,15 +1072,15 @@ void IPACM_ConntrackListener::ProcessTCPorUDPMsg(
 
 	 nat_entry_bundle nat_entry;
 	 nat_entry.isTempEntry = false;
-	 nat_entry.ct = ct;
-	 nat_entry.type = type;
+	 nat_entry.tcp_state = ct->tcp_state;
+	 nat_entry.type = ct->type;
 
  	 memset(&rule, 0, sizeof(rule));
-	 IPACMDBG("Received type:%d with proto:%d\n", type, l4proto);
-	 status = nfct_get_attr_u32(ct, ATTR_STATUS);
+	 IPACMDBG("Received type:%d with proto:%d\n", ct->type, ct->l4proto);
+	 status = ct->status;
 
 	 /* Retrieve Protocol */
-	 rule.protocol = nfct_get_attr_u8(ct, ATTR_REPL_L4PROTO);
+	 rule.protocol = ct->l4proto;
 
 	 if(IPS_DST_NAT & status)
 	 {
@@ -1052,16 +1093,14 @@ void IPACM_ConntrackListener::ProcessTCPorUDPMsg(
 	 else
 	 {
 		 IPACMDBG("Neither Destination nor Source nat flag Set\n");
-		 orig_src_ip = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC);
-		 orig_src_ip = ntohl(orig_src_ip);
+		 orig_src_ip = ct->orig_src_ip;
 		 if(orig_src_ip == 0)
 		 {
 			 IPACMERR("unable to retrieve orig src ip address\n");
 			 return;
 		 }
 
-		 orig_dst_ip = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_DST);
-		 orig_dst_ip = ntohl(orig_dst_ip);
+		 orig_dst_ip = ct->orig_dst_ip;
 		 if(orig_dst_ip == 0)
 		 {
 			 IPACMERR("unable to retrieve orig dst ip address\n");
@@ -1084,7 +1123,7 @@ void IPACM_ConntrackListener::ProcessTCPorUDPMsg(
 					   orig_src_ip, orig_dst_ip, wan_ipaddr);
 
 #ifdef CT_OPT
-			HandleLan2Lan(ct, type, &rule);
+			HandleLan2Lan(ct, &rule);
 #endif
 			return;
 		}
@@ -1144,9 +1183,11 @@ void IPACM_ConntrackListener::HandleSTAClientAddEvt(uint32_t clnt_ip_addr)
 	 int cnt;
 	 IPACMDBG_H("Received STA client 0x%x\n", clnt_ip_addr);
 
+	 pthread_rwlock_wrlock(&ct_lock);
 	 if(StaClntCnt >= MAX_STA_CLNT_IFACES)
 	 {
 		IPACMDBG("Max STA client reached, ignore 0x%x\n", clnt_ip_addr);
+		pthread_rwlock_unlock(&ct_lock);
 		return;
 	 }
 
@@ -1172,6 +1213,7 @@ void IPACM_ConntrackListener::HandleSTAClientAddEvt(uint32_t clnt_ip_addr)
 	 }
 
 	 nat_inst->FlushTempEntries(clnt_ip_addr, true);
+	 pthread_rwlock_unlock(&ct_lock);
 	 return;
 }
 
@@ -1180,6 +1222,7 @@ void IPACM_ConntrackListener::HandleSTAClientDelEvt(uint32_t clnt_ip_addr)
 	 int cnt;
 	 IPACMDBG_H("Received STA client 0x%x\n", clnt_ip_addr);
 
+	 pthread_rwlock_wrlock(&ct_lock);
 	 for(cnt=0; cnt<MAX_STA_CLNT_IFACES; cnt++)
 	 {
 		if(sta_clnt_ipv4_addr[cnt] != 0 &&
@@ -1196,5 +1239,6 @@ void IPACM_ConntrackListener::HandleSTAClientDelEvt(uint32_t clnt_ip_addr)
 	 }
 
 	 nat_inst->FlushTempEntries(clnt_ip_addr, false);
+	 pthread_rwlock_unlock(&ct_lock);
    return;
 }
@@ -26,6 +26,12 @@ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
 OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
 #include "IPACM_Conntrack_NATApp.h"
 #include "IPACM_ConntrackClient.h"
 
@@ -38,6 +44,25 @@ NatApp::NatApp()
 	max_entries = 0;
 	cache = NULL;
 
+	for(int cnt = 0; cnt < NAT_CACHE_SHARDS; cnt++)
+	{
+		pthread_mutex_init(&shards[cnt].lock, NULL);
+		shards[cnt].hash_tbl = NULL;
+		shards[cnt].priv_ip_bkts = NULL;
+		shards[cnt].trgt_ip_bkts = NULL;
+	}
+	hash_mask = 0;
+	pthread_mutex_init(&temp_lock, NULL);
+	free_slots = NULL;
+	free_cnt = 0;
+	pthread_mutex_init(&slot_lock, NULL);
+	links = NULL;
+	hdl_slots = NULL;
+	hdl_slots_cnt = 0;
+	ts_buf = NULL;
+	PwrSaveIfs = NULL;
+	num_pwrsave_ifs = 0;
+
 	nat_table_hdl = 0;
 	pub_ip_addr = 0;
 
@@ -48,6 +73,8 @@ NatApp::NatApp()
 
 	ct = NULL;
 	ct_hdl = NULL;
+	ct_msg_buf = NULL;
+	ct_timeout_read = 0;
 
 	memset(temp, 0, sizeof(temp));
 }
@@ -55,7 +82,10 @@ NatApp::NatApp()
 int NatApp::Init(void)
 {
 	IPACM_Config *pConfig;
+	nat_cache_shard *shard;
 	int size = 0;
+	uint32_t hash_size = 1;
+	int cnt, sh;
 
 	pConfig = IPACM_Config::GetInstance();
 	if(pConfig == NULL)
@@ -76,6 +106,65 @@ int NatApp::Init(void)
 	IPACMDBG("Allocated %d bytes for config manager nat cache\n", size);
 	memset(cache, 0, size);
 
+	/* Keep the index at most half full so probe chains stay short.
+	   Flows need not spread evenly, any shard may hold all of them */
+	while(hash_size < (uint32_t)(2 * max_entries))
+	{
+		hash_size <<= 1;
+	}
+	hash_mask = hash_size - 1;
+
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
+	{
+		shard = &shards[sh];
+		shard->hash_tbl = (int *)malloc(sizeof(int) * hash_size);
+		shard->priv_ip_bkts = (int *)malloc(sizeof(int) * hash_size);
+		shard->trgt_ip_bkts = (int *)malloc(sizeof(int) * hash_size);
+		if(shard->hash_tbl == NULL || shard->priv_ip_bkts == NULL ||
+			 shard->trgt_ip_bkts == NULL)
+		{
+			IPACMERR("Unable to allocate memory for nat cache shard %d\n", sh);
+			goto fail;
+		}
+
+		for(cnt = 0; cnt < (int)hash_size; cnt++)
+		{
+			shard->hash_tbl[cnt] = NAT_INVALID_SLOT;
+			shard->priv_ip_bkts[cnt] = NAT_INVALID_SLOT;
+			shard->trgt_ip_bkts[cnt] = NAT_INVALID_SLOT;
+		}
+	}
+
+	free_slots = (int *)malloc(sizeof(int) * (max_entries + 1));
+	links = (nat_cache_link *)malloc(sizeof(nat_cache_link) * (max_entries + 1));
+	/* Rule handles are dense and bounded by the base and expansion
+	   entries of the table, below twice max_entries plus the minimum
+	   sizes of both tables */
+	hdl_slots_cnt = 2 * max_entries + 4;
+	hdl_slots = (int *)malloc(sizeof(int) * hdl_slots_cnt);
+	ts_buf = (ipa_nat_rule_ts *)malloc(sizeof(ipa_nat_rule_ts) * (max_entries + 1));
+	ct_msg_buf = (char *)malloc(MAX_CT_UPDATE_ENTRIES * CT_UPDATE_MSG_SIZE);
+	/* one power save entry per wifi client */
+	num_pwrsave_ifs = pConfig->GetMaxWlanClients();
+	PwrSaveIfs = (uint32_t *)calloc(num_pwrsave_ifs, sizeof(uint32_t));
+	if(free_slots == NULL || links == NULL || hdl_slots == NULL ||
+		 ts_buf == NULL || ct_msg_buf == NULL || PwrSaveIfs == NULL)
+	{
+		IPACMERR("Unable to allocate memory for nat cache index\n");
+		goto fail;
+	}
+	for(cnt = 0; cnt < (int)hdl_slots_cnt; cnt++)
+	{
+		hdl_slots[cnt] = NAT_INVALID_SLOT;
+	}
+
+	/* Hand out the lowest slots first */
+	for(cnt = max_entries - 1; cnt >= 0; cnt--)
+	{
+		free_slots[free_cnt++] = cnt;
+	}
+	IPACMDBG("nat cache index with %d shards of %d buckets\n", NAT_CACHE_SHARDS, hash_size);
+
 	nALGPort = pConfig->GetAlgPortCnt();
 	if(nALGPort > 0)
 	{
@@ -104,6 +193,18 @@ int NatApp::Init(void)
 
 fail:
 	free(cache);
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
+	{
+		free(shards[sh].hash_tbl);
+		free(shards[sh].priv_ip_bkts);
+		free(shards[sh].trgt_ip_bkts);
+	}
+	free(free_slots);
+	free(links);
+	free(hdl_slots);
+	free(ts_buf);
+	free(ct_msg_buf);
+	free(PwrSaveIfs);
 	free(pALGPorts);
 	return -1;
 }
@@ -133,6 +234,7 @@ int NatApp::AddTable(uint32_t pub_ip)
 	ipa_nat_ipv4_rule nat_rule;
 	IPACMDBG_H("%s() %d\n", __FUNCTION__, __LINE__);
 
+	LockShards();
 	/* Not reset the cache wait it timeout by destroy event */
 #if 0
 	if (pub_ip != pub_ip_addr_pre)
@@ -146,6 +248,7 @@ int NatApp::AddTable(uint32_t pub_ip)
 	if(ret)
 	{
 		IPACMERR("unable to create nat table Error:%d\n", ret);
+		UnlockShards();
 		return ret;
 	}
 
@@ -168,11 +271,11 @@ int NatApp::AddTable(uint32_t pub_ip)
 				if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
 				{
 					IPACMERR("unable to add the rule delete from cache\n");
-					memset(&cache[cnt], 0, sizeof(cache[cnt]));
-					curCnt--;
+					FreeEntry(cnt);
 					continue;
 				}
 				cache[cnt].enabled = true;
+				MapRuleHdl(cnt);
 
 				IPACMDBG("On wan-iface reset added below rule successfully\n");
 				iptodot("Private IP", nat_rule.private_ip);
@@ -185,6 +288,7 @@ int NatApp::AddTable(uint32_t pub_ip)
 	}
 
 	pub_ip_addr = pub_ip;
+	UnlockShards();
 	return 0;
 }
 
@@ -208,10 +312,12 @@ int NatApp::DeleteTable(uint32_t pub_ip)
 
 	CHK_TBL_HDL();
 
+	LockShards();
 	if(pub_ip_addr != pub_ip)
 	{
 		IPACMDBG("Public ip address is not matching\n");
 		IPACMERR("unable to delete the nat table\n");
+		UnlockShards();
 		return -1;
 	}
 
@@ -219,32 +325,281 @@ int NatApp::DeleteTable(uint32_t pub_ip)
 	if(ret)
 	{
 		IPACMERR("unable to delete nat table Error: %d\n", ret);;
+		UnlockShards();
 		return ret;
 	}
 
 	pub_ip_addr_pre = pub_ip_addr;
 	Reset();
+	UnlockShards();
 	return 0;
 }
 
+static inline uint32_t nat_mix32(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline bool nat_same_tuple(const nat_table_entry *a, const nat_table_entry *b)
+{
+	return (a->private_ip == b->private_ip &&
+					a->target_ip == b->target_ip &&
+					a->private_port == b->private_port &&
+					a->target_port == b->target_port &&
+					a->protocol == b->protocol);
+}
+
+/* Full 32 bit hash, the high bits pick the shard and
+   the low bits the position in its index */
+uint32_t NatApp::HashTuple(const nat_table_entry *rule)
+{
+	uint32_t h;
+
+	h = nat_mix32(rule->private_ip ^ (rule->target_ip * 0x9e3779b1));
+	h ^= ((uint32_t)rule->private_port << 16) | rule->target_port;
+	h ^= (uint32_t)rule->protocol << 24;
+
+	return nat_mix32(h);
+}
+
+uint32_t NatApp::HashIp(uint32_t ip_addr)
+{
+	return nat_mix32(ip_addr) & hash_mask;
+}
+
+nat_cache_shard* NatApp::ShardOf(uint32_t hash)
+{
+	return &shards[((uint64_t)hash * NAT_CACHE_SHARDS) >> 32];
+}
+
+void NatApp::LockShard(const nat_table_entry *rule)
+{
+	pthread_mutex_lock(&ShardOf(HashTuple(rule))->lock);
+}
+
+void NatApp::UnlockShard(const nat_table_entry *rule)
+{
+	pthread_mutex_unlock(&ShardOf(HashTuple(rule))->lock);
+}
+
+void NatApp::LockShards()
+{
+	for(int cnt = 0; cnt < NAT_CACHE_SHARDS; cnt++)
+	{
+		pthread_mutex_lock(&shards[cnt].lock);
+	}
+}
+
+void NatApp::UnlockShards()
+{
+	for(int cnt = NAT_CACHE_SHARDS - 1; cnt >= 0; cnt--)
+	{
+		pthread_mutex_unlock(&shards[cnt].lock);
+	}
+}
+
+/* Returns the cache slot holding the 5-tuple of rule or NAT_INVALID_SLOT,
+   the shard of rule must be held */
+int NatApp::FindEntry(const nat_table_entry *rule)
+{
+	nat_cache_shard *shard;
+	uint32_t hash, pos;
+
+	hash = HashTuple(rule);
+	shard = ShardOf(hash);
+	pos = hash & hash_mask;
+	while(shard->hash_tbl[pos] != NAT_INVALID_SLOT)
+	{
+		if(nat_same_tuple(&cache[shard->hash_tbl[pos]], rule))
+		{
+			return shard->hash_tbl[pos];
+		}
+		pos = (pos + 1) & hash_mask;
+	}
+
+	return NAT_INVALID_SLOT;
+}
+
+int NatApp::AllocSlot()
+{
+	int slot = NAT_INVALID_SLOT;
+
+	pthread_mutex_lock(&slot_lock);
+	if(free_cnt > 0)
+	{
+		slot = free_slots[--free_cnt];
+		curCnt++;
+	}
+	pthread_mutex_unlock(&slot_lock);
+
+	return slot;
+}
+
+/* Add a filled cache slot to the tuple index and client lists
+   of its shard, which must be held */
+void NatApp::IndexEntry(int slot)
+{
+	nat_cache_shard *shard;
+	uint32_t hash, pos, bkt;
+
+	hash = HashTuple(&cache[slot]);
+	shard = ShardOf(hash);
+	pos = hash & hash_mask;
+	while(shard->hash_tbl[pos] != NAT_INVALID_SLOT)
+	{
+		pos = (pos + 1) & hash_mask;
+	}
+	shard->hash_tbl[pos] = slot;
+
+	bkt = HashIp(cache[slot].private_ip);
+	links[slot].priv_prev = NAT_INVALID_SLOT;
+	links[slot].priv_next = shard->priv_ip_bkts[bkt];
+	if(shard->priv_ip_bkts[bkt] != NAT_INVALID_SLOT)
+	{
+		links[shard->priv_ip_bkts[bkt]].priv_prev = slot;
+	}
+	shard->priv_ip_bkts[bkt] = slot;
+
+	bkt = HashIp(cache[slot].target_ip);
+	links[slot].trgt_prev = NAT_INVALID_SLOT;
+	links[slot].trgt_next = shard->trgt_ip_bkts[bkt];
+	if(shard->trgt_ip_bkts[bkt] != NAT_INVALID_SLOT)
+	{
+		links[shard->trgt_ip_bkts[bkt]].trgt_prev = slot;
+	}
+	shard->trgt_ip_bkts[bkt] = slot;
+}
+
+/* Remove a cache slot from the tuple index and client lists,
+   the slot contents must still be intact */
+void NatApp::UnindexEntry(int slot)
+{
+	nat_cache_shard *shard;
+	uint32_t hash, pos, next, home;
+
+	hash = HashTuple(&cache[slot]);
+	shard = ShardOf(hash);
+	pos = hash & hash_mask;
+	while(shard->hash_tbl[pos] != slot)
+	{
+		if(shard->hash_tbl[pos] == NAT_INVALID_SLOT)
+		{
+			IPACMERR("nat cache slot %d missing from index\n", slot);
+			return;
+		}
+		pos = (pos + 1) & hash_mask;
+	}
+
+	/* Backward shift deletion, no tombstones needed */
+	next = pos;
+	while(1)
+	{
+		next = (next + 1) & hash_mask;
+		if(shard->hash_tbl[next] == NAT_INVALID_SLOT)
+		{
+			break;
+		}
+
+		home = HashTuple(&cache[shard->hash_tbl[next]]) & hash_mask;
+		if(((next - home) & hash_mask) >= ((next - pos) & hash_mask))
+		{
+			shard->hash_tbl[pos] = shard->hash_tbl[next];
+			pos = next;
+		}
+	}
+	shard->hash_tbl[pos] = NAT_INVALID_SLOT;
+
+	if(links[slot].priv_prev != NAT_INVALID_SLOT)
+	{
+		links[links[slot].priv_prev].priv_next = links[slot].priv_next;
+	}
+	else
+	{
+		shard->priv_ip_bkts[HashIp(cache[slot].private_ip)] = links[slot].priv_next;
+	}
+	if(links[slot].priv_next != NAT_INVALID_SLOT)
+	{
+		links[links[slot].priv_next].priv_prev = links[slot].priv_prev;
+	}
+
+	if(links[slot].trgt_prev != NAT_INVALID_SLOT)
+	{
+		links[links[slot].trgt_prev].trgt_next = links[slot].trgt_next;
+	}
+	else
+	{
+		shard->trgt_ip_bkts[HashIp(cache[slot].target_ip)] = links[slot].trgt_next;
+	}
+	if(links[slot].trgt_next != NAT_INVALID_SLOT)
+	{
+		links[links[slot].trgt_next].trgt_prev = links[slot].trgt_prev;
+	}
+}
+
+/* Drop a cache entry and return its slot to the free list */
+void NatApp::FreeEntry(int slot)
+{
+	UnindexEntry(slot);
+	memset(&cache[slot], 0, sizeof(cache[slot]));
+
+	pthread_mutex_lock(&slot_lock);
+	free_slots[free_cnt++] = slot;
+	curCnt--;
+	pthread_mutex_unlock(&slot_lock);
+}
+
+/* Remember the cache slot owning its rule handle. A handle belongs
+   to one rule at a time, so shards never write the same element */
+void NatApp::MapRuleHdl(int slot)
+{
+	uint32_t hdl = cache[slot].rule_hdl;
+
+	if(hdl >= hdl_slots_cnt)
+	{
+		IPACMERR("Rule handle %d beyond the handle map of %d\n", hdl, hdl_slots_cnt);
+		return;
+	}
+
+	hdl_slots[hdl] = slot;
+}
+
+/* Cache slot of an enabled rule, NAT_INVALID_SLOT if none.
+   All shards must be held */
+int NatApp::SlotOfRuleHdl(uint32_t hdl)
+{
+	int slot;
+
+	if(hdl == 0 || hdl >= hdl_slots_cnt)
+	{
+		return NAT_INVALID_SLOT;
+	}
+
+	slot = hdl_slots[hdl];
+	if(slot == NAT_INVALID_SLOT ||
+		 cache[slot].enabled == false ||
+		 cache[slot].rule_hdl != hdl)
+	{
+		return NAT_INVALID_SLOT;
+	}
+
+	return slot;
+}
+
 /* Check for duplicate entries */
 bool NatApp::ChkForDup(const nat_table_entry *rule)
 {
-	int cnt = 0;
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
-	for(; cnt < max_entries; cnt++)
+	if(FindEntry(rule) != NAT_INVALID_SLOT)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
-		{
-			log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
-			rule->target_port,"Duplicate Rule\n");
-			return true;
-		}
+		log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
+		rule->target_port,"Duplicate Rule\n");
+		return true;
 	}
 
 	return false;
@@ -259,46 +614,74 @@ int NatApp::DeleteEntry(const nat_table_entry *rule)
 	log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
 	rule->target_port,"for deletion\n");
 
-
-	for(; cnt < max_entries; cnt++)
+	LockShard(rule);
+	cnt = FindEntry(rule);
+	if(cnt != NAT_INVALID_SLOT)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
+		if(cache[cnt].enabled == true)
 		{
-
-			if(cache[cnt].enabled == true)
-			{
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
-				{
-					IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
-				}
-
-				IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
-			}
-			else
+			if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
 			{
-				IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
+				IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
 			}
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
-			break;
+			IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
+		}
+		else
+		{
+			IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
 		}
+
+		FreeEntry(cnt);
 	}
+	UnlockShard(rule);
 
 	return 0;
 }
 
+/* Delete the cached entries in slots along with their nat rules,
+   the rules are removed with batched deletes */
+void NatApp::DeleteEntries(const int *slots, int num)
+{
+	uint32_t rule_hdls[MAX_NAT_COMMIT_ENTRIES];
+	int cnt, hdl_cnt = 0;
+
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		if(cache[slots[cnt]].enabled == true)
+		{
+			rule_hdls[hdl_cnt++] = cache[slots[cnt]].rule_hdl;
+		}
+
+		if(hdl_cnt == MAX_NAT_COMMIT_ENTRIES ||
+			 (cnt == num - 1 && hdl_cnt > 0))
+		{
+			if(ipa_nat_del_ipv4_rules(nat_table_hdl, rule_hdls, hdl_cnt) < 0)
+			{
+				IPACMERR("%s() %d deletion of %d rules failed\n", __FUNCTION__, __LINE__, hdl_cnt);
+			}
+			hdl_cnt = 0;
+		}
+	}
+
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		log_nat(cache[slots[cnt]].protocol,cache[slots[cnt]].private_ip,cache[slots[cnt]].target_ip,\
+		cache[slots[cnt]].private_port,cache[slots[cnt]].target_port,"deleted\n");
+		FreeEntry(slots[cnt]);
+	}
+	IPACMDBG_H("Deleted %d Nat entries\n", num);
+}
+
 /* Add new entry to the nat table on new connection */
-int NatApp::AddEntry(const nat_table_entry *rule)
+/* Validate the rule and cache it as disabled entry, *slot is
+   NAT_INVALID_SLOT if the rule is ignored. The shard of rule
+   must be held */
+int NatApp::AllocEntry(const nat_table_entry *rule, int *slot)
 {
 	int cnt = 0;
-	ipa_nat_ipv4_rule nat_rule;
 
-	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
+	*slot = NAT_INVALID_SLOT;
 
 	CHK_TBL_HDL();
 	log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
@@ -320,111 +703,142 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 		return 0;
 	}
 
-	if(!ChkForDup(rule))
+	if(ChkForDup(rule))
 	{
-		for(; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
-
-		if(max_entries == cnt)
-		{
-			IPACMERR("Error: Unable to add, reached maximum rules\n");
-			return -1;
-		}
-		else
-		{
-			nat_rule.private_ip = rule->private_ip;
-			nat_rule.target_ip = rule->target_ip;
-			nat_rule.target_port = rule->target_port;
-			nat_rule.private_port = rule->private_port;
-			nat_rule.public_port = rule->public_port;
-			nat_rule.protocol = rule->protocol;
+		IPACMERR("Duplicate rule. Ignore it\n");
+		return -1;
+	}
 
-			if(isPwrSaveIf(rule->private_ip) ||
-				 isPwrSaveIf(rule->target_ip))
-			{
-				IPACMDBG("Device is Power Save mode: Dont insert into nat table but cache\n");
-				cache[cnt].enabled = false;
-				cache[cnt].rule_hdl = 0;
-			}
-			else
-			{
+	cnt = AllocSlot();
+	if(cnt == NAT_INVALID_SLOT)
+	{
+		IPACMERR("Error: Unable to add, reached maximum rules\n");
+		return -1;
+	}
 
-				if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
-				{
-					IPACMERR("unable to add the rule\n");
-					return -1;
-				}
+	cache[cnt].enabled = false;
+	cache[cnt].rule_hdl = 0;
+	cache[cnt].private_ip = rule->private_ip;
+	cache[cnt].target_ip = rule->target_ip;
+	cache[cnt].target_port = rule->target_port;
+	cache[cnt].private_port = rule->private_port;
+	cache[cnt].protocol = rule->protocol;
+	cache[cnt].timestamp = 0;
+	cache[cnt].public_port = rule->public_port;
+	cache[cnt].dst_nat = rule->dst_nat;
+	IndexEntry(cnt);
+
+	*slot = cnt;
+	return 0;
+}
 
-				cache[cnt].enabled = true;
-			}
+/* Add the cached entries in slots to the nat table with one batch.
+   Entries which could not be added are removed from the cache and
+   their slot is set to NAT_INVALID_SLOT. The shards of the entries
+   must be held */
+void NatApp::CommitEntries(int *slots, int num)
+{
+	ipa_nat_ipv4_rule nat_rules[MAX_NAT_COMMIT_ENTRIES];
+	uint32_t rule_hdls[MAX_NAT_COMMIT_ENTRIES];
+	int cnt, ret;
 
-			cache[cnt].private_ip = rule->private_ip;
-			cache[cnt].target_ip = rule->target_ip;
-			cache[cnt].target_port = rule->target_port;
-			cache[cnt].private_port = rule->private_port;
-			cache[cnt].protocol = rule->protocol;
-			cache[cnt].timestamp = 0;
-			cache[cnt].public_port = rule->public_port;
-			cache[cnt].dst_nat = rule->dst_nat;
-			curCnt++;
-		}
+	if(num <= 0)
+	{
+		return;
+	}
 
+	memset(nat_rules, 0, sizeof(nat_rules));
+	memset(rule_hdls, 0, sizeof(rule_hdls));
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		nat_rules[cnt].private_ip = cache[slots[cnt]].private_ip;
+		nat_rules[cnt].target_ip = cache[slots[cnt]].target_ip;
+		nat_rules[cnt].target_port = cache[slots[cnt]].target_port;
+		nat_rules[cnt].private_port = cache[slots[cnt]].private_port;
+		nat_rules[cnt].public_port = cache[slots[cnt]].public_port;
+		nat_rules[cnt].protocol = cache[slots[cnt]].protocol;
 	}
-	else
+
+	ret = ipa_nat_add_ipv4_rules(nat_table_hdl, nat_rules, num, rule_hdls);
+	if(ret < 0)
 	{
-		IPACMERR("Duplicate rule. Ignore it\n");
-		return -1;
+		IPACMERR("unable to add all of %d rules, error %d\n", num, ret);
 	}
 
-	if(cache[cnt].enabled == true)
+	for(cnt = 0; cnt < num; cnt++)
 	{
-		IPACMDBG_H("Added rule(%d) successfully\n", cnt);
+		if(rule_hdls[cnt] == 0)
+		{
+			IPACMERR("unable to add the rule delete from cache\n");
+			FreeEntry(slots[cnt]);
+			slots[cnt] = NAT_INVALID_SLOT;
+			continue;
+		}
+
+		cache[slots[cnt]].enabled = true;
+		cache[slots[cnt]].rule_hdl = rule_hdls[cnt];
+		MapRuleHdl(slots[cnt]);
+
+		IPACMDBG("Added below rule successfully\n");
+		iptodot("Private IP", nat_rules[cnt].private_ip);
+		iptodot("Target IP", nat_rules[cnt].target_ip);
+		IPACMDBG("Private Port:%d \t Target Port: %d\t", nat_rules[cnt].private_port, nat_rules[cnt].target_port);
+		IPACMDBG("Public Port:%d\n", nat_rules[cnt].public_port);
+		IPACMDBG("protocol: %d\n", nat_rules[cnt].protocol);
 	}
-  else
-  {
-    IPACMDBG_H("Cached rule(%d) successfully\n", cnt);
-  }
 
-	return 0;
+	return;
 }
 
-void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
+int NatApp::AddEntry(const nat_table_entry *rule)
 {
-	int ret;
+	int cnt = NAT_INVALID_SLOT;
+	int ret = 0;
 
-	iptodot("Private IP:", rule->private_ip);
-	iptodot("Target IP:",  rule->target_ip);
-	IPACMDBG("Private Port: %d, Target Port: %d\n", rule->private_port, rule->target_port);
+	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
-	if(!ct_hdl)
+	LockShard(rule);
+	if(AllocEntry(rule, &cnt) != 0)
 	{
-		ct_hdl = nfct_open(CONNTRACK, 0);
-		if(!ct_hdl)
-		{
-			PERROR("nfct_open");
-			return;
-		}
+		ret = -1;
+		goto unlock;
 	}
 
-	if(!ct)
+	if(cnt == NAT_INVALID_SLOT)
 	{
-		ct = nfct_new();
-		if(!ct)
-		{
-			PERROR("nfct_new");
-			return;
-		}
+		goto unlock;
 	}
 
+	if(isPwrSaveIf(rule->private_ip) ||
+		 isPwrSaveIf(rule->target_ip))
+	{
+		IPACMDBG("Device is Power Save mode: Dont insert into nat table but cache\n");
+		IPACMDBG_H("Cached rule(%d) successfully\n", cnt);
+		goto unlock;
+	}
+
+	CommitEntries(&cnt, 1);
+	if(cnt == NAT_INVALID_SLOT)
+	{
+		IPACMERR("unable to add the rule\n");
+		ret = -1;
+		goto unlock;
+	}
+
+	IPACMDBG_H("Added rule(%d) successfully\n", cnt);
+
+unlock:
+	UnlockShard(rule);
+	return ret;
+}
+
+/* Fill ct with the update of rule's conntrack timeout */
+void NatApp::FillCTUpdate(const nat_table_entry *rule, uint32_t pub_ip)
+{
+	iptodot("Private IP:", rule->private_ip);
+	iptodot("Target IP:",  rule->target_ip);
+	IPACMDBG("Private Port: %d, Target Port: %d\n", rule->private_port, rule->target_port);
+
 	nfct_set_attr_u8(ct, ATTR_L3PROTO, AF_INET);
 	if(rule->protocol == IPPROTO_UDP)
 	{
@@ -452,7 +866,7 @@ void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
 		nfct_set_attr_u32(ct, ATTR_IPV4_SRC, htonl(rule->target_ip));
 		nfct_set_attr_u16(ct, ATTR_PORT_SRC, htons(rule->target_port));
 
-		nfct_set_attr_u32(ct, ATTR_IPV4_DST, htonl(pub_ip_addr));
+		nfct_set_attr_u32(ct, ATTR_IPV4_DST, htonl(pub_ip));
 		nfct_set_attr_u16(ct, ATTR_PORT_DST, htons(rule->public_port));
 
 		IPACMDBG("dst nat is set\n");
@@ -465,57 +879,251 @@ void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
 
 	IPACMDBG("updating %d connection with time: %d\n",
 					 rule->protocol, nfct_get_attr_u32(ct, ATTR_TIMEOUT));
+}
 
-	ret = nfct_query(ct_hdl, NFCT_Q_UPDATE, ct);
-	if(ret == -1)
+/* Refresh the conntrack timeout of rules with one netlink send and one
+   ack collection. ack_err of each rule is set to 0 once updated, to the
+   negative error the kernel rejected it with, or to 1 if it was not
+   acked; the number of rejected rules is returned. Works on copies of
+   the cache entries, no shard needs to be held */
+int NatApp::UpdateCTUdpTs(const nat_table_entry *rules, int num,
+		uint32_t pub_ip, int *ack_err)
+{
+	struct sockaddr_nl nladdr;
+	struct nlmsghdr *nlh;
+	struct nlmsgerr *nlerr;
+	struct pollfd pfd;
+	/* sequence number and rule index of each update that went out */
+	uint32_t seqs[MAX_CT_UPDATE_ENTRIES];
+	int idx[MAX_CT_UPDATE_ENTRIES];
+	int cnt, len = 0, sent, pending = 0, failed = 0, ret;
+
+	for(cnt = 0; cnt < num; cnt++)
 	{
-		IPACMERR("unable to update time stamp");
-		DeleteEntry(rule);
+		ack_err[cnt] = 1;
 	}
-	else
+
+	if(!ct_hdl)
 	{
-		rule->timestamp = new_ts;
-		IPACMDBG("Updated time stamp successfully\n");
+		ct_hdl = nfct_open(CONNTRACK, 0);
+		if(!ct_hdl)
+		{
+			PERROR("nfct_open");
+			return 0;
+		}
 	}
 
-	return;
+	if(!ct)
+	{
+		ct = nfct_new();
+		if(!ct)
+		{
+			PERROR("nfct_new");
+			return 0;
+		}
+	}
+
+	/* Pack all updates into one buffer, each in its own fixed room */
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		FillCTUpdate(&rules[cnt], pub_ip);
+
+		nlh = (struct nlmsghdr *)(ct_msg_buf + len);
+		if(nfct_build_conntrack(nfct_subsys_ct(ct_hdl), nlh, CT_UPDATE_MSG_SIZE,
+					IPCTNL_MSG_CT_NEW, NLM_F_REQUEST | NLM_F_ACK, ct) < 0)
+		{
+			IPACMERR("unable to build conntrack update for rule %d\n", rules[cnt].rule_hdl);
+			continue;
+		}
+
+		seqs[pending] = nlh->nlmsg_seq;
+		idx[pending] = cnt;
+		len += NLMSG_ALIGN(nlh->nlmsg_len);
+		pending++;
+	}
+	sent = pending;
+
+	if(pending == 0)
+	{
+		return 0;
+	}
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	if(sendto(nfct_fd(ct_hdl), ct_msg_buf, len, 0,
+						(struct sockaddr *)&nladdr, sizeof(nladdr)) < 0)
+	{
+		PERROR("unable to send conntrack updates");
+		return 0;
+	}
+	IPACMDBG("Sent %d conntrack updates, %d bytes\n", pending, len);
+
+	/* Every update is acked with its sequence number */
+	pfd.fd = nfct_fd(ct_hdl);
+	pfd.events = POLLIN;
+	while(pending > 0)
+	{
+		ret = poll(&pfd, 1, CT_UPDATE_ACK_TIMEOUT_MS);
+		if(ret <= 0)
+		{
+			IPACMERR("%d conntrack updates not acked\n", pending);
+			break;
+		}
+
+		ret = recv(pfd.fd, ct_msg_buf, MAX_CT_UPDATE_ENTRIES * CT_UPDATE_MSG_SIZE, 0);
+		if(ret < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			PERROR("unable to receive conntrack acks");
+			break;
+		}
+
+		for(nlh = (struct nlmsghdr *)ct_msg_buf; NLMSG_OK(nlh, ret); nlh = NLMSG_NEXT(nlh, ret))
+		{
+			if(nlh->nlmsg_type != NLMSG_ERROR)
+			{
+				continue;
+			}
+
+			nlerr = (struct nlmsgerr *)NLMSG_DATA(nlh);
+			for(cnt = 0; cnt < sent; cnt++)
+			{
+				if(ack_err[idx[cnt]] > 0 && seqs[cnt] == nlh->nlmsg_seq)
+				{
+					ack_err[idx[cnt]] = nlerr->error;
+					pending--;
+					break;
+				}
+			}
+		}
+	}
+
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		if(ack_err[cnt] < 0)
+		{
+			IPACMERR("unable to update time stamp of rule %d, error %d\n",
+							 rules[cnt].rule_hdl, -ack_err[cnt]);
+			failed++;
+		}
+	}
+
+	IPACMDBG("Updated time stamp of %d rules, %d failed\n", num - failed, failed);
+	return failed;
+}
+
+/* Re-read the conntrack timeouts once the cached values are older than
+   CT_TIMEOUT_REFRESH_SEC, the procfs sysctls give no inotify events */
+void NatApp::RefreshTimeouts(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if(ct_timeout_read != 0 &&
+		 now.tv_sec - ct_timeout_read < CT_TIMEOUT_REFRESH_SEC)
+	{
+		return;
+	}
+
+	Read_TcpUdp_Timeout();
+	ct_timeout_read = now.tv_sec;
 }
 
 void NatApp::UpdateUDPTimeStamp()
 {
-	int cnt;
-	uint32_t ts;
-	bool read_to = false;
+	int cnt = 0, idx, slot;
+	uint16_t num = 0;
+	uint32_t tbl_hdl, pub_ip;
+	nat_table_entry ct_rules[MAX_CT_UPDATE_ENTRIES];
+	int ct_slots[MAX_CT_UPDATE_ENTRIES];
+	uint32_t ct_ts[MAX_CT_UPDATE_ENTRIES];
+	int ct_err[MAX_CT_UPDATE_ENTRIES];
+	int ct_cnt, failed;
+
+	LockShards();
+	tbl_hdl = nat_table_hdl;
+	UnlockShards();
+
+	if(tbl_hdl == 0)
+	{
+		return;
+	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	/* Time stamps of all enabled rules with one walk of the nat table */
+	if(ipa_nat_query_timestamps(tbl_hdl, ts_buf, max_entries, &num) < 0)
+	{
+		IPACMERR("unable to retrieve time stamps of nat rules\n");
+		return;
+	}
+
+	RefreshTimeouts();
+
+	/* The shards are held to pick a batch of changed entries and to
+	   apply the kernel's answer, not across the netlink round trip */
+	while(cnt < num)
 	{
-		ts = 0;
-		if(cache[cnt].enabled == true &&
-		   (cache[cnt].private_ip != cache[cnt].public_ip))
+		ct_cnt = 0;
+		LockShards();
+		pub_ip = pub_ip_addr;
+		for(; cnt < num && ct_cnt < MAX_CT_UPDATE_ENTRIES; cnt++)
 		{
-			IPACMDBG("\n");
-			if(ipa_nat_query_timestamp(nat_table_hdl, cache[cnt].rule_hdl, &ts) < 0)
+			slot = SlotOfRuleHdl(ts_buf[cnt].rule_hdl);
+			if(slot == NAT_INVALID_SLOT ||
+				 cache[slot].private_ip == cache[slot].public_ip)
 			{
-				IPACMERR("unable to retrieve timeout for rule hanle: %d\n", cache[cnt].rule_hdl);
 				continue;
 			}
 
-			if(cache[cnt].timestamp == ts)
+			if(cache[slot].timestamp == ts_buf[cnt].time_stamp)
 			{
 				IPACMDBG("No Change in Time Stamp: cahce:%d, ipahw:%d\n",
-								                  cache[cnt].timestamp, ts);
+								 cache[slot].timestamp, ts_buf[cnt].time_stamp);
 				continue;
 			}
 
-			if (read_to == false) {
-				read_to = true;
-				Read_TcpUdp_Timeout();
-			}
+			memcpy(&ct_rules[ct_cnt], &cache[slot], sizeof(nat_table_entry));
+			ct_slots[ct_cnt] = slot;
+			ct_ts[ct_cnt] = ts_buf[cnt].time_stamp;
+			ct_cnt++;
+		}
+		UnlockShards();
+
+		if(ct_cnt == 0)
+		{
+			continue;
+		}
 
-			UpdateCTUdpTs(&cache[cnt], ts);
-		} /* end of outer if */
+		UpdateCTUdpTs(ct_rules, ct_cnt, pub_ip, ct_err);
 
-	} /* end of for loop */
+		/* Entries deleted or replaced meanwhile are left alone,
+		   connections the kernel no longer tracks are dropped together */
+		LockShards();
+		failed = 0;
+		for(idx = 0; idx < ct_cnt; idx++)
+		{
+			slot = ct_slots[idx];
+			if(cache[slot].enabled == false ||
+				 cache[slot].rule_hdl != ct_rules[idx].rule_hdl ||
+				 !nat_same_tuple(&cache[slot], &ct_rules[idx]))
+			{
+				continue;
+			}
+
+			if(ct_err[idx] == 0)
+			{
+				cache[slot].timestamp = ct_ts[idx];
+			}
+			else if(ct_err[idx] < 0)
+			{
+				ct_slots[failed++] = slot;
+			}
+		}
+		DeleteEntries(ct_slots, failed);
+		UnlockShards();
+	}
 
 }
 
@@ -538,7 +1146,7 @@ bool NatApp::isPwrSaveIf(uint32_t ip_addr)
 {
 	int cnt;
 
-	for(cnt = 0; cnt < IPA_MAX_NUM_WIFI_CLIENTS; cnt++)
+	for(cnt = 0; cnt < num_pwrsave_ifs; cnt++)
 	{
 		if(0 != PwrSaveIfs[cnt] &&
 			 ip_addr == PwrSaveIfs[cnt])
@@ -552,7 +1160,7 @@ bool NatApp::isPwrSaveIf(uint32_t ip_addr)
 
 int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt;
+	int cnt, sh;
 	IPACMDBG_H("Received IP address: 0x%x\n", client_lan_ip);
 
 	if(client_lan_ip == INVALID_IP_ADDR)
@@ -561,17 +1169,19 @@ int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 		return -1;
 	}
 
+	LockShards();
 	/* check for duplicate events */
-	for(cnt = 0; cnt < IPA_MAX_NUM_WIFI_CLIENTS; cnt++)
+	for(cnt = 0; cnt < num_pwrsave_ifs; cnt++)
 	{
 		if(PwrSaveIfs[cnt] == client_lan_ip)
 		{
 			IPACMDBG("The client 0x%x is already in power save\n", client_lan_ip);
+			UnlockShards();
 			return 0;
 		}
 	}
 
-	for(cnt = 0; cnt < IPA_MAX_NUM_WIFI_CLIENTS; cnt++)
+	for(cnt = 0; cnt < num_pwrsave_ifs; cnt++)
 	{
 		if(PwrSaveIfs[cnt] == 0)
 		{
@@ -580,29 +1190,35 @@ int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
 	{
-		if(cache[cnt].private_ip == client_lan_ip &&
-			 cache[cnt].enabled == true)
+		for(cnt = shards[sh].priv_ip_bkts[HashIp(client_lan_ip)]; cnt != NAT_INVALID_SLOT;
+				cnt = links[cnt].priv_next)
 		{
-			if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+			if(cache[cnt].private_ip == client_lan_ip &&
+				 cache[cnt].enabled == true)
 			{
-				IPACMERR("unable to delete the rule\n");
-				continue;
-			}
+				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+				{
+					IPACMERR("unable to delete the rule\n");
+					continue;
+				}
 
-			cache[cnt].enabled = false;
-			cache[cnt].rule_hdl = 0;
+				cache[cnt].enabled = false;
+				cache[cnt].rule_hdl = 0;
+			}
 		}
 	}
+	UnlockShards();
 
 	return 0;
 }
 
 int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt;
-	ipa_nat_ipv4_rule nat_rule;
+	int cnt, next, sh;
+	int slots[MAX_NAT_COMMIT_ENTRIES];
+	int num = 0;
 
 	IPACMDBG_H("Received ip address: 0x%x\n", client_lan_ip);
 
@@ -612,7 +1228,8 @@ int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 		return -1;
 	}
 
-	for(cnt = 0; cnt < IPA_MAX_NUM_WIFI_CLIENTS; cnt++)
+	LockShards();
+	for(cnt = 0; cnt < num_pwrsave_ifs; cnt++)
 	{
 		if(PwrSaveIfs[cnt] == client_lan_ip)
 		{
@@ -621,51 +1238,46 @@ int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	/* Push the cached flows of the client back in batches */
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
 	{
-		IPACMDBG("cache (%d): enable %d, ip 0x%x\n", cnt, cache[cnt].enabled, cache[cnt].private_ip);
-
-		if(cache[cnt].private_ip == client_lan_ip &&
-			 cache[cnt].enabled == false)
+		for(cnt = shards[sh].priv_ip_bkts[HashIp(client_lan_ip)]; cnt != NAT_INVALID_SLOT; cnt = next)
 		{
-			memset(&nat_rule, 0 , sizeof(nat_rule));
-			nat_rule.private_ip = cache[cnt].private_ip;
-			nat_rule.target_ip = cache[cnt].target_ip;
-			nat_rule.target_port = cache[cnt].target_port;
-			nat_rule.private_port = cache[cnt].private_port;
-			nat_rule.public_port = cache[cnt].public_port;
-			nat_rule.protocol = cache[cnt].protocol;
+			next = links[cnt].priv_next;
+			IPACMDBG("cache (%d): enable %d, ip 0x%x\n", cnt, cache[cnt].enabled, cache[cnt].private_ip);
 
-			if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
+			if(cache[cnt].private_ip == client_lan_ip &&
+				 cache[cnt].enabled == false)
 			{
-				IPACMERR("unable to add the rule delete from cache\n");
-				memset(&cache[cnt], 0, sizeof(cache[cnt]));
-				curCnt--;
-				continue;
+				slots[num++] = cnt;
+				if(num == MAX_NAT_COMMIT_ENTRIES)
+				{
+					CommitEntries(slots, num);
+					num = 0;
+				}
 			}
-			cache[cnt].enabled = true;
-
-			IPACMDBG("On power reset added below rule successfully\n");
-			iptodot("Private IP", nat_rule.private_ip);
-			iptodot("Target IP", nat_rule.target_ip);
-			IPACMDBG("Private Port:%d \t Target Port: %d\t", nat_rule.private_port, nat_rule.target_port);
-			IPACMDBG("Public Port:%d\n", nat_rule.public_port);
-			IPACMDBG("protocol: %d\n", nat_rule.protocol);
-
 		}
 	}
 
+	CommitEntries(slots, num);
+	UnlockShards();
+	IPACMDBG("On power reset added cached rules of client\n");
+
 	return -1;
 }
 
 uint32_t NatApp::GetTableHdl(uint32_t in_ip_addr)
 {
+	uint32_t hdl = -1;
+
+	LockShards();
 	if(in_ip_addr == pub_ip_addr)
 	{
-		return nat_table_hdl;
+		hdl = nat_table_hdl;
 	}
+	UnlockShards();
 
-	return -1;
+	return hdl;
 }
 
 void NatApp::AddTempEntry(const nat_table_entry *new_entry)
@@ -685,11 +1297,16 @@ void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 		return;
 	}
 
+	/* A flow added after the check is caught again when flushed */
+	LockShard(new_entry);
 	if(ChkForDup(new_entry))
 	{
+		UnlockShard(new_entry);
 		return;
 	}
+	UnlockShard(new_entry);
 
+	pthread_mutex_lock(&temp_lock);
 	for(cnt=0; cnt<MAX_TEMP_ENTRIES; cnt++)
 	{
 		if(temp[cnt].private_ip == new_entry->private_ip &&
@@ -699,6 +1316,7 @@ void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 			 temp[cnt].protocol == new_entry->protocol)
 		{
 			IPACMDBG("Received duplicate Temp entry\n");
+			pthread_mutex_unlock(&temp_lock);
 			return;
 		}
 	}
@@ -710,9 +1328,11 @@ void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 		{
 			memcpy(&temp[cnt], new_entry, sizeof(nat_table_entry));
 			IPACMDBG("Added Temp Entry\n");
+			pthread_mutex_unlock(&temp_lock);
 			return;
 		}
 	}
+	pthread_mutex_unlock(&temp_lock);
 
 	IPACMDBG("Unable to add temp entry, cache full\n");
 	return;
@@ -728,6 +1348,7 @@ void NatApp::DeleteTempEntry(const nat_table_entry *entry)
 	IPACMDBG("Private Port: %d\t Target Port: %d\n", entry->private_port, entry->target_port);
 	IPACMDBG("protocol: %d\n", entry->protocol);
 
+	pthread_mutex_lock(&temp_lock);
 	for(cnt=0; cnt<MAX_TEMP_ENTRIES; cnt++)
 	{
 		if(temp[cnt].private_ip == entry->private_ip &&
@@ -738,9 +1359,11 @@ void NatApp::DeleteTempEntry(const nat_table_entry *entry)
 		{
 			memset(&temp[cnt], 0, sizeof(nat_table_entry));
 			IPACMDBG("Delete Temp Entry\n");
+			pthread_mutex_unlock(&temp_lock);
 			return;
 		}
 	}
+	pthread_mutex_unlock(&temp_lock);
 
 	IPACMDBG("No Such Temp Entry exists\n");
 	return;
@@ -751,10 +1374,14 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 {
 	int cnt;
 	int ret;
+	int slots[MAX_TEMP_ENTRIES], temp_idx[MAX_TEMP_ENTRIES];
+	int num = 0;
 
 	IPACMDBG_H("Received below with isAdd:%d ", isAdd);
 	iptodot("IP Address: ", ip_addr);
 
+	pthread_mutex_lock(&temp_lock);
+	LockShards();
 	for(cnt=0; cnt<MAX_TEMP_ENTRIES; cnt++)
 	{
 		if(temp[cnt].private_ip == ip_addr ||
@@ -772,24 +1399,46 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 						iptodot("Private IP", temp[cnt].private_ip);
 					}
 
-					ret = AddEntry(&temp[cnt]);
+					ret = AllocEntry(&temp[cnt], &slots[num]);
 					if(ret)
 					{
 						IPACMERR("unable to add temp entry: %d\n", ret);
 						continue;
 					}
+
+					/* Temp entry is cleared once the batch made it to hw */
+					if(slots[num] != NAT_INVALID_SLOT &&
+						 !isPwrSaveIf(temp[cnt].private_ip) &&
+						 !isPwrSaveIf(temp[cnt].target_ip))
+					{
+						temp_idx[num++] = cnt;
+						continue;
+					}
 				}
 			}
 			memset(&temp[cnt], 0, sizeof(nat_table_entry));
 		}
 	}
 
+	CommitEntries(slots, num);
+	for(cnt = 0; cnt < num; cnt++)
+	{
+		if(slots[cnt] == NAT_INVALID_SLOT)
+		{
+			IPACMERR("unable to add temp entry: %d\n", -1);
+			continue;
+		}
+		memset(&temp[temp_idx[cnt]], 0, sizeof(nat_table_entry));
+	}
+	UnlockShards();
+	pthread_mutex_unlock(&temp_lock);
+
 	return;
 }
 
 int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = 0;
+	int cnt, sh, tmp = 0;
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
 
 	if(ip_addr == INVALID_IP_ADDR)
@@ -798,7 +1447,8 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 		return -1;
 	}
 
-	for(cnt = 0; cnt < IPA_MAX_NUM_WIFI_CLIENTS; cnt++)
+	LockShards();
+	for(cnt = 0; cnt < num_pwrsave_ifs; cnt++)
 	{
 		if(PwrSaveIfs[cnt] == ip_addr)
 		{
@@ -808,27 +1458,32 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
 	{
-		if(cache[cnt].private_ip == ip_addr)
+		for(cnt = shards[sh].priv_ip_bkts[HashIp(ip_addr)]; cnt != NAT_INVALID_SLOT;
+				cnt = links[cnt].priv_next)
 		{
-			if(cache[cnt].enabled == true)
+			if(cache[cnt].private_ip == ip_addr)
 			{
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
-				{
-					IPACMERR("unable to delete the rule\n");
-					continue;
-				}
-				else
+				if(cache[cnt].enabled == true)
 				{
-					IPACMDBG("won't delete the rule\n");
-					cache[cnt].enabled = false;
-					tmp++;
+					if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+					{
+						IPACMERR("unable to delete the rule\n");
+						continue;
+					}
+					else
+					{
+						IPACMDBG("won't delete the rule\n");
+						cache[cnt].enabled = false;
+						tmp++;
+					}
 				}
+				IPACMDBG("won't delete the rule for entry %d, enabled %d\n",cnt, cache[cnt].enabled);
 			}
-			IPACMDBG("won't delete the rule for entry %d, enabled %d\n",cnt, cache[cnt].enabled);
 		}
 	}
+	UnlockShards();
 
 	IPACMDBG("Deleted (but cached) %d entries\n", tmp);
 	return 0;
@@ -836,7 +1491,7 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 
 int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = curCnt;
+	int cnt, next, sh, tmp = 0;
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
 
 	if(ip_addr == INVALID_IP_ADDR)
@@ -846,25 +1501,31 @@ int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 	}
 
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	LockShards();
+	for(sh = 0; sh < NAT_CACHE_SHARDS; sh++)
 	{
-		if(cache[cnt].target_ip == ip_addr)
+		for(cnt = shards[sh].trgt_ip_bkts[HashIp(ip_addr)]; cnt != NAT_INVALID_SLOT; cnt = next)
 		{
-			if(cache[cnt].enabled == true)
+			next = links[cnt].trgt_next;
+			if(cache[cnt].target_ip == ip_addr)
 			{
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+				if(cache[cnt].enabled == true)
 				{
-					IPACMERR("unable to delete the rule\n");
-					continue;
+					if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+					{
+						IPACMERR("unable to delete the rule\n");
+						continue;
+					}
 				}
-			}
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
+				FreeEntry(cnt);
+				tmp++;
+			}
 		}
 	}
+	UnlockShards();
 
-	IPACMDBG("Deleted %d entries\n", (tmp - curCnt));
+	IPACMDBG("Deleted %d entries\n", tmp);
 	return 0;
 }
 
@@ -882,23 +1543,14 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 		return;
 	}
 
+	LockShard(rule);
 	if(!ChkForDup(rule))
 	{
-		for(cnt=0; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
-
-		if(max_entries == cnt)
+		cnt = AllocSlot();
+		if(cnt == NAT_INVALID_SLOT)
 		{
 			IPACMERR("Error: Unable to add, reached maximum rules\n");
+			UnlockShard(rule);
 			return;
 		}
 		else
@@ -914,15 +1566,17 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 			cache[cnt].public_port = rule->public_port;
 			cache[cnt].public_ip = rule->public_ip;
 			cache[cnt].dst_nat = rule->dst_nat;
-			curCnt++;
+			IndexEntry(cnt);
 		}
 
 	}
 	else
 	{
 		IPACMERR("Duplicate rule. Ignore it\n");
+		UnlockShard(rule);
 		return;
 	}
+	UnlockShard(rule);
 
 	IPACMDBG("Cached rule(%d) successfully\n", cnt);
 	return;
@@ -37,25 +37,30 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 #include <string.h>
+#include <time.h>
 #include <pthread.h>
 #include <IPACM_EvtDispatcher.h>
 #include <IPACM_Neighbor.h>
+#include "IPACM_Iface.h"
 #include "IPACM_CmdQueue.h"
+#include "IPACM_ConntrackClient.h"
 #include "IPACM_Defs.h"
 
 
-extern pthread_mutex_t mutex;
-extern pthread_cond_t  cond_var;
-
-cmd_evts *IPACM_EvtDispatcher::head = NULL;
+evt_listeners IPACM_EvtDispatcher::listeners[IPACM_EVENT_MAX];
+bool IPACM_EvtDispatcher::dispatching = false;
+bool IPACM_EvtDispatcher::stale = false;
+IPACM_Listener *IPACM_EvtDispatcher::ct_listener = NULL;
 extern uint32_t ipacm_event_stats[IPACM_EVENT_MAX];
+extern uint64_t ipacm_event_dispatch_us[IPACM_EVENT_MAX];
+extern uint32_t ipacm_event_dispatch_max_us[IPACM_EVENT_MAX];
 
 int IPACM_EvtDispatcher::PostEvt
 (
 	 ipacm_cmd_q_data *data
 )
 {
-	Message *item = NULL;
+	cmd_t evt;
 	MessageQueue *MsgQueue = NULL;
 
 	if(data->event < IPA_EXTERNAL_EVENT_MAX)
@@ -74,140 +79,263 @@ int IPACM_EvtDispatcher::PostEvt
 		return IPACM_FAILURE;
 	}
 
-	item = new Message();
-	if(item == NULL)
+	evt.callback_ptr = IPACM_EvtDispatcher::ProcessEvt;
+	memcpy(&evt.data, data, sizeof(ipacm_cmd_q_data));
+
+	IPACMDBG("Enqueing event %d\n", data->event);
+	if(MsgQueue->enqueue(&evt) != IPACM_SUCCESS)
 	{
-		IPACMERR("unable to create new message item\n");
+		IPACMERR("unable to enqueue event %d\n", data->event);
 		return IPACM_FAILURE;
 	}
+	IPACMDBG("Enqueued event %d\n", data->event);
+
+	return IPACM_SUCCESS;
+}
 
-	item->evt.callback_ptr = IPACM_EvtDispatcher::ProcessEvt;
-	memcpy(&item->evt.data, data, sizeof(ipacm_cmd_q_data));
+/* Events of one flow hash to the same worker and keep their order,
+   without a worker listening they go to the main dispatcher */
+int IPACM_EvtDispatcher::PostCtEvt
+(
+	 ipacm_cmd_q_data *data,
+	 uint32_t hash
+)
+{
+	cmd_t evt;
+	MessageQueue *MsgQueue = NULL;
+	int worker;
 
-	if(pthread_mutex_lock(&mutex) != 0)
+	if(__atomic_load_n(&ct_listener, __ATOMIC_ACQUIRE) == NULL)
 	{
-		IPACMERR("unable to lock the mutex\n");
-		return IPACM_FAILURE;
+		return PostEvt(data);
 	}
 
-	IPACMDBG("Enqueing item\n");
-	MsgQueue->enqueue(item);
-	IPACMDBG("Enqueued item %p\n", item);
+	hash ^= hash >> 16;
+	hash *= 0x7feb352d;
+	hash ^= hash >> 15;
+	worker = hash % IPACM_CT_WORKERS;
 
-	if(pthread_cond_signal(&cond_var) != 0)
+	MsgQueue = MessageQueue::getInstanceCt(worker);
+	if(MsgQueue == NULL)
 	{
-		IPACMDBG("unable to lock the mutex\n");
-		/* Release the mutex before you return failure */
-		if(pthread_mutex_unlock(&mutex) != 0)
-		{
-			IPACMERR("unable to unlock the mutex\n");
-			return IPACM_FAILURE;
-		}
+		IPACMERR("unable to retrieve conntrack worker %d MsgQueue instance\n", worker);
 		return IPACM_FAILURE;
 	}
 
-	if(pthread_mutex_unlock(&mutex) != 0)
+	evt.callback_ptr = IPACM_EvtDispatcher::ProcessCtEvt;
+	memcpy(&evt.data, data, sizeof(ipacm_cmd_q_data));
+
+	if(MsgQueue->enqueue(&evt) != IPACM_SUCCESS)
 	{
-		IPACMERR("unable to unlock the mutex\n");
+		IPACMERR("unable to enqueue event %d on worker %d\n", data->event, worker);
 		return IPACM_FAILURE;
 	}
+	IPACMDBG("Enqueued event %d on worker %d\n", data->event, worker);
 
 	return IPACM_SUCCESS;
 }
 
+/* Runs on the conntrack workers, the registered listener must handle
+   the event without touching state owned by the main dispatcher */
+void IPACM_EvtDispatcher::ProcessCtEvt(ipacm_cmd_q_data *data)
+{
+	IPACM_Listener *obj;
+	struct timespec start, end;
+	uint32_t usec;
+
+	if(data->event >= IPACM_EVENT_MAX)
+	{
+		IPACMERR("Invalid event %d\n", data->event);
+		release(data);
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	obj = __atomic_load_n(&ct_listener, __ATOMIC_ACQUIRE);
+	__atomic_add_fetch(&ipacm_event_stats[data->event], 1, __ATOMIC_RELAXED);
+	obj->event_callback(data->event, data->evt_data);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	usec = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+	__atomic_add_fetch(&ipacm_event_dispatch_us[data->event], usec, __ATOMIC_RELAXED);
+	if(usec > __atomic_load_n(&ipacm_event_dispatch_max_us[data->event], __ATOMIC_RELAXED))
+	{
+		__atomic_store_n(&ipacm_event_dispatch_max_us[data->event], usec, __ATOMIC_RELAXED);
+	}
+
+	release(data);
+	return;
+}
+
 void IPACM_EvtDispatcher::ProcessEvt(ipacm_cmd_q_data *data)
 {
+	evt_listeners *evt;
+	struct timespec start, end;
+	uint32_t usec;
+	int cnt;
 
-	cmd_evts *tmp = head, tmp1;
+	if(data->event >= IPACM_EVENT_MAX)
+	{
+		IPACMERR("Invalid event %d\n", data->event);
+		release(data);
+		return;
+	}
 
-	if(head == NULL)
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	evt = &listeners[data->event];
+	if(evt->num == 0)
 	{
-		IPACMDBG("Queue is empty\n");
+		IPACMDBG("No listener for event %d\n", data->event);
 	}
 
-	while(tmp != NULL)
+	/* num and obj are read again on every round: a callback may register
+	   new listeners, which get this event too, or deregister some */
+	dispatching = true;
+	/* every listener of the event edits the tables before they are
+	   committed, once per ip family. Routing goes out first so new
+	   filter rules never point at an uncommitted table */
+	IPACM_Iface::m_filtering.BeginDeferredCommit();
+	IPACM_Iface::m_routing.BeginDeferredCommit();
+	for(cnt = 0; cnt < evt->num; cnt++)
 	{
-	        memcpy(&tmp1, tmp, sizeof(tmp1));
-		if(data->event == tmp1.event)
+		if(evt->obj[cnt] != NULL)
 		{
-			ipacm_event_stats[data->event]++;
-			tmp1.obj->event_callback(data->event, data->evt_data);
+			__atomic_add_fetch(&ipacm_event_stats[data->event], 1, __ATOMIC_RELAXED);
+			evt->obj[cnt]->event_callback(data->event, data->evt_data);
 			IPACMDBG(" Find matched registered events\n");
 		}
-	        tmp = tmp1.next;
+	}
+	IPACM_Iface::m_routing.EndDeferredCommit();
+	IPACM_Iface::m_filtering.EndDeferredCommit();
+	dispatching = false;
+
+	if(stale)
+	{
+		for(cnt = 0; cnt < IPACM_EVENT_MAX; cnt++)
+		{
+			compact(&listeners[cnt]);
+		}
+		stale = false;
 	}
 
 	IPACMDBG(" Finished process events\n");
-			
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	usec = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+	ipacm_event_dispatch_us[data->event] += usec;
+	if(usec > ipacm_event_dispatch_max_us[data->event])
+	{
+		ipacm_event_dispatch_max_us[data->event] = usec;
+	}
+
 	if(data->evt_data != NULL)
 	{
 		IPACMDBG("free the event:%d data: %p\n", data->event, data->evt_data);
-		free(data->evt_data);
+		release(data);
 	}
 	return;
 }
 
-int IPACM_EvtDispatcher::registr(ipa_cm_event_id event, IPACM_Listener *obj)
+/* Conntrack records go back to the slab of their reader thread */
+void IPACM_EvtDispatcher::release(ipacm_cmd_q_data *data)
 {
-	cmd_evts *tmp = head,*nw;
+	if(data->evt_data == NULL)
+	{
+		return;
+	}
 
-	nw = (cmd_evts *)malloc(sizeof(cmd_evts));
-	if(nw != NULL)
+	if(data->event == IPA_PROCESS_CT_MESSAGE || data->event == IPA_PROCESS_CT_MESSAGE_V6)
 	{
-		nw->event = event;
-		nw->obj = obj;
-		nw->next = NULL;
+		IPACM_ConntrackClient::FreeCtEvt((ipacm_ct_evt_data *)data->evt_data);
 	}
 	else
 	{
-		return IPACM_FAILURE;
+		free(data->evt_data);
 	}
+}
+
+/* Squeeze deregistered entries out, keeping the listener order */
+void IPACM_EvtDispatcher::compact(evt_listeners *evt)
+{
+	int cnt, num = 0;
 
-	if(head == NULL)
+	for(cnt = 0; cnt < evt->num; cnt++)
 	{
-		head = nw;
+		if(evt->obj[cnt] != NULL)
+		{
+			evt->obj[num++] = evt->obj[cnt];
+		}
 	}
-	else
+	evt->num = num;
+}
+
+int IPACM_EvtDispatcher::registr(ipa_cm_event_id event, IPACM_Listener *obj)
+{
+	evt_listeners *evt;
+	IPACM_Listener **tmp;
+	int size;
+
+	if(event >= IPACM_EVENT_MAX)
+	{
+		IPACMERR("Invalid event %d\n", event);
+		return IPACM_FAILURE;
+	}
+
+	evt = &listeners[event];
+	if(evt->num == evt->size)
 	{
-		while(tmp->next)
+		size = (evt->size == 0) ? 4 : 2 * evt->size;
+		tmp = (IPACM_Listener **)realloc(evt->obj, sizeof(IPACM_Listener *) * size);
+		if(tmp == NULL)
 		{
-			tmp = tmp->next;
+			return IPACM_FAILURE;
 		}
-		tmp->next = nw;
+		evt->obj = tmp;
+		evt->size = size;
 	}
+
+	evt->obj[evt->num++] = obj;
 	return IPACM_SUCCESS;
 }
 
 
+/* Only one listener takes the worker events, it is never deregistered */
+int IPACM_EvtDispatcher::registr_ct(IPACM_Listener *obj)
+{
+	if(__atomic_load_n(&ct_listener, __ATOMIC_ACQUIRE) != NULL)
+	{
+		IPACMERR("conntrack worker listener already registered\n");
+		return IPACM_FAILURE;
+	}
+
+	__atomic_store_n(&ct_listener, obj, __ATOMIC_RELEASE);
+	return IPACM_SUCCESS;
+}
+
 int IPACM_EvtDispatcher::deregistr(IPACM_Listener *param)
 {
-	cmd_evts *tmp = head,*tmp1,*prev = head;
+	int event, cnt;
 
-	while(tmp != NULL)
+	for(event = 0; event < IPACM_EVENT_MAX; event++)
 	{
-		if(tmp->obj == param)
+		for(cnt = 0; cnt < listeners[event].num; cnt++)
 		{
-			tmp1 = tmp;
-			if(tmp == head)
-			{
-				head = head->next;
-			}
-			else if(tmp->next == NULL)
+			if(listeners[event].obj[cnt] == param)
 			{
-				prev->next = NULL;
-			}
-			else
-			{
-				prev->next = tmp->next;
+				listeners[event].obj[cnt] = NULL;
 			}
+		}
 
-			tmp = tmp->next;
-			free(tmp1);
+		/* ProcessEvt is walking the list, it compacts when done */
+		if(dispatching)
+		{
+			stale = true;
 		}
 		else
 		{
-			prev = tmp;
-			tmp = tmp->next;
+			compact(&listeners[event]);
 		}
 	}
 	return IPACM_SUCCESS;
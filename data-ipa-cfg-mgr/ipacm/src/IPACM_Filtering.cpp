@@ -50,6 +50,12 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 const char *IPACM_Filtering::DEVICE_NAME = "/dev/ipa";
 
+int IPACM_Filtering::commit_depth = 0;
+pthread_t IPACM_Filtering::commit_owner;
+uint32_t IPACM_Filtering::commit_pending[IPA_IP_MAX];
+uint32_t IPACM_Filtering::num_commit = 0;
+uint32_t IPACM_Filtering::num_commit_saved = 0;
+
 IPACM_Filtering::IPACM_Filtering()
 {
 	fd = open(DEVICE_NAME, O_RDWR);
@@ -69,7 +75,7 @@ bool IPACM_Filtering::DeviceNodeIsOpened()
 	return fd;
 }
 
-bool IPACM_Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTable)
+bool IPACM_Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule *ruleTable)
 {
 	int retval = 0;
 
@@ -84,6 +90,7 @@ bool IPACM_Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTa
 				ruleTable->rules[cnt].rule.attrib.attrib_mask);
 	}
 
+	DeferCommit(&ruleTable->commit, ruleTable->ip);
 	retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE, ruleTable);
 	if (retval != 0)
 	{
@@ -114,7 +121,50 @@ bool IPACM_Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTa
 	return true;
 }
 
-bool IPACM_Filtering::AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after const *ruleTable)
+bool IPACM_Filtering::AddFilteringRule(IPACM_FltRuleBatch *batch)
+{
+	struct ipa_ioc_add_flt_rule *flt_rule = batch->table();
+	int cnt, num = batch->count();
+	bool res;
+
+	if (num == 0)
+	{
+		return true;
+	}
+
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		batch->rule(cnt)->status = -1;
+		batch->rule(cnt)->flt_rule_hdl = 0;
+	}
+
+	res = AddFilteringRule(flt_rule);
+	for (cnt = 0; cnt < num && res; cnt++)
+	{
+		if (batch->rule(cnt)->status != 0)
+		{
+			res = false;
+		}
+	}
+	if (res)
+	{
+		return true;
+	}
+
+	/* the driver stops at the first bad rule, drop the ones it took */
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		if (batch->rule(cnt)->status == 0 && batch->rule(cnt)->flt_rule_hdl != 0)
+		{
+			DeleteFilteringHdls(&batch->rule(cnt)->flt_rule_hdl, flt_rule->ip, 1);
+			batch->rule(cnt)->flt_rule_hdl = 0;
+		}
+	}
+	IPACMERR("Filtering rule batch %p rolled back\n", flt_rule);
+	return false;
+}
+
+bool IPACM_Filtering::AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after *ruleTable)
 {
 #ifdef FEATURE_IPA_V3
 	int retval = 0;
@@ -125,6 +175,7 @@ bool IPACM_Filtering::AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after co
 	IPACMDBG("End point: %d\n", ruleTable->ep);
 	IPACMDBG("commit value: %d\n", ruleTable->commit);
 
+	DeferCommit(&ruleTable->commit, ruleTable->ip);
 	retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE_AFTER, ruleTable);
 
 	for (int cnt = 0; cnt<ruleTable->num_rules; cnt++)
@@ -156,6 +207,7 @@ bool IPACM_Filtering::DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable
 		IPACMERR("Failed deleting Filtering rule %p\n", ruleTable);
 		return false;
 	}
+	CountCommit(ruleTable->commit, ruleTable->ip);
 
 	IPACMDBG("Deleted Filtering rule %p\n", ruleTable);
 	return true;
@@ -164,6 +216,13 @@ bool IPACM_Filtering::DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable
 bool IPACM_Filtering::Commit(enum ipa_ip_type ip)
 {
 	int retval = 0;
+	uint8_t commit = 1;
+
+	DeferCommit(&commit, ip);
+	if (commit == 0)
+	{
+		return true;
+	}
 
 	retval = ioctl(fd, IPA_IOC_COMMIT_FLT, ip);
 	if (retval != 0)
@@ -182,6 +241,11 @@ bool IPACM_Filtering::Reset(enum ipa_ip_type ip)
 
 	retval = ioctl(fd, IPA_IOC_RESET_FLT, ip);
 	retval |= ioctl(fd, IPA_IOC_COMMIT_FLT, ip);
+	if (ip < IPA_IP_MAX)
+	{
+		/* anything deferred went out with the reset */
+		commit_pending[ip] = 0;
+	}
 	if (retval)
 	{
 		IPACMERR("failed resetting Filtering block.\n");
@@ -529,8 +593,72 @@ bool IPACM_Filtering::ModifyFilteringRule(struct ipa_ioc_mdfy_flt_rule* ruleTabl
 		}
 		return false;
 	}
+	CountCommit(ruleTable->commit, ruleTable->ip);
 
 	IPACMDBG("Modified filtering rule %p\n", ruleTable);
 	return true;
 }
 
+void IPACM_Filtering::BeginDeferredCommit()
+{
+	if (commit_depth++ == 0)
+	{
+		commit_owner = pthread_self();
+	}
+}
+
+void IPACM_Filtering::EndDeferredCommit()
+{
+	int ip;
+
+	if (commit_depth == 0 || --commit_depth > 0)
+	{
+		return;
+	}
+
+	for (ip = 0; ip < IPA_IP_MAX; ip++)
+	{
+		if (commit_pending[ip] == 0)
+		{
+			continue;
+		}
+		num_commit_saved += commit_pending[ip] - 1;
+		commit_pending[ip] = 0;
+		Commit((enum ipa_ip_type)ip);
+	}
+	IPACMDBG("filtering commits: %u, saved: %u\n", num_commit, num_commit_saved);
+}
+
+/* clear the commit flag of an add while a scope of this thread is open */
+void IPACM_Filtering::DeferCommit(uint8_t *commit, enum ipa_ip_type ip)
+{
+	if (*commit == 0)
+	{
+		return;
+	}
+
+	if (commit_depth > 0 && ip < IPA_IP_MAX && pthread_equal(commit_owner, pthread_self()))
+	{
+		*commit = 0;
+		commit_pending[ip]++;
+		return;
+	}
+	num_commit++;
+}
+
+/* deletes and modifies commit at once, so the hw never points at an entry
+   that is gone. That commit also carries the adds deferred for ip so far */
+void IPACM_Filtering::CountCommit(uint8_t commit, enum ipa_ip_type ip)
+{
+	if (commit == 0)
+	{
+		return;
+	}
+
+	num_commit++;
+	if (commit_depth > 0 && ip < IPA_IP_MAX && pthread_equal(commit_owner, pthread_self()))
+	{
+		num_commit_saved += commit_pending[ip];
+		commit_pending[ip] = 0;
+	}
+}
@@ -81,6 +81,49 @@ bool IPACM_Header::AddHeader(struct ipa_ioc_add_hdr *pHeaderTableToAdd)
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool IPACM_Header::AddHeader(IPACM_HdrBatch *batch)
+{
+	int cnt, num = batch->count();
+	bool res;
+
+	if (num == 0)
+	{
+		return true;
+	}
+
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		batch->rule(cnt)->status = -1;
+		batch->rule(cnt)->hdr_hdl = 0;
+	}
+
+	res = AddHeader(batch->table());
+	for (cnt = 0; cnt < num && res; cnt++)
+	{
+		if (batch->rule(cnt)->status != 0)
+		{
+			IPACMERR("Header %s of batch failed with status %d\n", batch->rule(cnt)->name, batch->rule(cnt)->status);
+			res = false;
+		}
+	}
+	if (res)
+	{
+		return true;
+	}
+
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		if (batch->rule(cnt)->status == 0 && batch->rule(cnt)->hdr_hdl != 0)
+		{
+			DeleteHeaderHdl(batch->rule(cnt)->hdr_hdl);
+			batch->rule(cnt)->hdr_hdl = 0;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool IPACM_Header::DeleteHeader(struct ipa_ioc_del_hdr *pHeaderTableToDelete)
 {
 	int nRetVal = 0;
@@ -59,6 +59,10 @@ IPACM_Header IPACM_Iface::m_header;
 
 IPACM_Config *IPACM_Iface::ipacmcfg = IPACM_Config::GetInstance();
 
+int16_t IPACM_Iface::ifindex_map[IPA_IFINDEX_MAP_SIZE];
+uint32_t IPACM_Iface::ifindex_name_hash[IPA_IFINDEX_MAP_SIZE];
+uint32_t IPACM_Iface::ifindex_map_gen;
+
 IPACM_Iface::IPACM_Iface(int iface_index)
 {
 	ip_type = IPACM_IP_NULL; /* initially set invalid */
@@ -312,10 +316,26 @@ fail:
 	return res;
 }
 
-/* Query ipa_interface_index by given linux interface_index */
-int IPACM_Iface::iface_ipa_index_query
+/* FNV-1a of an iface name */
+uint32_t IPACM_Iface::iface_name_hash(const char *name)
+{
+	uint32_t h = 2166136261u;
+	int i;
+
+	for(i = 0; i < IPA_IFACE_NAME_LEN && name[i] != '\0'; i++)
+	{
+		h = (h ^ (uint8_t)name[i]) * 16777619u;
+	}
+	return h;
+}
+
+/* Resolve ipa_interface_index the slow way: table scan, then SIOCGIFNAME.
+   by_name skips the scan, the link was renamed since it was recorded */
+int IPACM_Iface::iface_ipa_index_resolve
 (
-	 int interface_index
+	 int interface_index,
+	 bool by_name,
+	 bool *cacheable
 )
 {
 	int fd;
@@ -323,7 +343,7 @@ int IPACM_Iface::iface_ipa_index_query
 	int i = 0;
 	struct ifreq ifr;
 
-
+	*cacheable = false;
 	if(IPACM_Iface::ipacmcfg->iface_table == NULL)
 	{
 		IPACMERR("Iface table in IPACM_Config is not available.\n");
@@ -331,7 +351,7 @@ int IPACM_Iface::iface_ipa_index_query
 	}
 
 	/* Search known linux interface-index and map to IPA interface-index*/
-	for (i = 0; i < IPACM_Iface::ipacmcfg->ipa_num_ipa_interfaces; i++)
+	for (i = 0; i < IPACM_Iface::ipacmcfg->ipa_num_ipa_interfaces && !by_name; i++)
 	{
 		if (interface_index == IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index)
 		{
@@ -340,8 +360,8 @@ int IPACM_Iface::iface_ipa_index_query
 							 IPACM_Iface::ipacmcfg->iface_table[i].iface_name,
 							 IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index,
 							 link);
+			*cacheable = true;
 			return link;
-			break;
 		}
 	}
 
@@ -352,6 +372,8 @@ int IPACM_Iface::iface_ipa_index_query
 		return IPACM_FAILURE;
 	}
 
+	/* from here on the answer only changes with a link event */
+	*cacheable = true;
 	memset(&ifr, 0, sizeof(struct ifreq));
 
 	ifr.ifr_ifindex = interface_index;
@@ -370,20 +392,113 @@ int IPACM_Iface::iface_ipa_index_query
 	{
 		if (strncmp(ifr.ifr_name,
 								IPACM_Iface::ipacmcfg->iface_table[i].iface_name,
-								sizeof(IPACM_Iface::ipacmcfg->iface_table[i].iface_name)) == 0)
+								sizeof(IPACM_Iface::ipacmcfg->iface_table[i].iface_name)) != 0)
+		{
+			/* forget the linux index of an entry that no longer has this name */
+			if (IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index == interface_index)
+			{
+				IPACMDBG_H("Interface (%s) no longer linux(%d)\n",
+								 IPACM_Iface::ipacmcfg->iface_table[i].iface_name, interface_index);
+				IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index = 0;
+			}
+		}
+		else if (link == INVALID_IFACE)
 		{
 			IPACMDBG_H("Interface (%s) linux(%d) mapped to ipa(%d) \n", ifr.ifr_name,
 							 IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index, i);
 
 			link = i;
 			IPACM_Iface::ipacmcfg->iface_table[i].netlink_interface_index = interface_index;
-			break;
 		}
 	}
 
 	return link;
 }
 
+/* Query ipa_interface_index by given linux interface_index */
+int IPACM_Iface::iface_ipa_index_query
+(
+	 int interface_index
+)
+{
+	int link;
+	int cached = IPA_IFINDEX_UNRESOLVED;
+	uint32_t gen = 0;
+	bool cacheable = false;
+	bool mapped = (interface_index > 0 && interface_index < IPA_IFINDEX_MAP_SIZE);
+
+	if(mapped)
+	{
+		cached = __atomic_load_n(&ifindex_map[interface_index], __ATOMIC_ACQUIRE);
+		if(cached != IPA_IFINDEX_UNRESOLVED && cached != IPA_IFINDEX_RENAMED)
+		{
+			return cached - IPA_IFINDEX_MAP_BIAS;
+		}
+		gen = __atomic_load_n(&ifindex_map_gen, __ATOMIC_ACQUIRE);
+	}
+
+	link = iface_ipa_index_resolve(interface_index, cached == IPA_IFINDEX_RENAMED, &cacheable);
+
+	/* a link event racing with the resolve wins, so do not store a stale result */
+	if(mapped && cacheable && gen == __atomic_load_n(&ifindex_map_gen, __ATOMIC_ACQUIRE))
+	{
+		if(link >= 0)
+		{
+			__atomic_store_n(&ifindex_name_hash[interface_index],
+					iface_name_hash(IPACM_Iface::ipacmcfg->iface_table[link].iface_name), __ATOMIC_RELAXED);
+		}
+		__atomic_store_n(&ifindex_map[interface_index],
+				(int16_t)(link + IPA_IFINDEX_MAP_BIAS), __ATOMIC_RELEASE);
+	}
+	return link;
+}
+
+/* Forget the cached mapping of one linux interface_index */
+void IPACM_Iface::iface_ipa_index_invalidate
+(
+	 int interface_index,
+	 const char *ifname
+)
+{
+	int cached;
+
+	if(interface_index <= 0 || interface_index >= IPA_IFINDEX_MAP_SIZE)
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&ifindex_map_gen, 1, __ATOMIC_ACQ_REL);
+	/* a positive entry stays valid for the LINK_DOWN handling which still
+	   queries it after the link is gone, unless the link changed its name */
+	cached = __atomic_load_n(&ifindex_map[interface_index], __ATOMIC_ACQUIRE);
+	if(cached == INVALID_IFACE + IPA_IFINDEX_MAP_BIAS)
+	{
+		__atomic_store_n(&ifindex_map[interface_index],
+				(int16_t)IPA_IFINDEX_UNRESOLVED, __ATOMIC_RELEASE);
+	}
+	else if(cached >= IPA_IFINDEX_MAP_BIAS && ifname != NULL && ifname[0] != '\0' &&
+		 iface_name_hash(ifname) != __atomic_load_n(&ifindex_name_hash[interface_index], __ATOMIC_RELAXED))
+	{
+		IPACMDBG_H("linux(%d) is now %s, dropping ipa(%d)\n", interface_index, ifname,
+				cached - IPA_IFINDEX_MAP_BIAS);
+		__atomic_store_n(&ifindex_map[interface_index],
+				(int16_t)IPA_IFINDEX_RENAMED, __ATOMIC_RELEASE);
+	}
+}
+
+/* Forget all cached mappings, iface_table was rebuilt */
+void IPACM_Iface::iface_ipa_index_flush(void)
+{
+	int i;
+
+	__atomic_add_fetch(&ifindex_map_gen, 1, __ATOMIC_ACQ_REL);
+	for(i = 0; i < IPA_IFINDEX_MAP_SIZE; i++)
+	{
+		__atomic_store_n(&ifindex_map[i], (int16_t)IPA_IFINDEX_UNRESOLVED, __ATOMIC_RELEASE);
+	}
+	IPACMDBG_H("ifindex map flushed\n");
+}
+
 /* Query ipa_interface ipv4_addr by given linux interface_index */
 void IPACM_Iface::iface_addr_query
 (
@@ -50,6 +50,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "linux/ipa_qmi_service_v01.h"
 #include "linux/msm_ipa.h"
 #include "IPACM_ConntrackListener.h"
+#include "IPACM_Stats.h"
 #include <sys/ioctl.h>
 #include <fcntl.h>
 
@@ -65,7 +66,7 @@ IPACM_Lan::IPACM_Lan(int iface_index) : IPACM_Iface(iface_index)
 	odu_route_rule_v4_hdl = NULL;
 	odu_route_rule_v6_hdl = NULL;
 	eth_client = NULL;
-	int i, m_fd_odu, ret = IPACM_SUCCESS;
+	int i, m_fd_odu, ret = IPACM_SUCCESS, max_clients;
 
 	Nat_App = NatApp::GetInstance();
 	if (Nat_App == NULL)
@@ -80,12 +81,21 @@ IPACM_Lan::IPACM_Lan(int iface_index) : IPACM_Iface(iface_index)
 		if(ipa_if_cate != WLAN_IF)
 		{
 			eth_client_len = (sizeof(ipa_eth_client)) + (iface_query->num_tx_props * sizeof(eth_client_rt_hdl));
-			eth_client = (ipa_eth_client *)calloc(IPA_MAX_NUM_ETH_CLIENTS, eth_client_len);
+			max_clients = IPACM_Iface::ipacmcfg->GetMaxEthClients();
+			eth_client = (ipa_eth_client *)calloc(max_clients, eth_client_len);
 			if (eth_client == NULL)
 			{
 				IPACMERR("unable to allocate memory\n");
 				return;
 			}
+			/* eth_client and its index are sized once, the limit in the config may change later */
+			if (eth_client_idx.init(max_clients, false) != IPACM_SUCCESS)
+			{
+				IPACMERR("unable to allocate eth client index\n");
+				free(eth_client);
+				eth_client = NULL;
+				return;
+			}
 		}
 
 		IPACMDBG_H(" IPACM->IPACM_Lan(%d) constructor: Tx:%d Rx:%d \n", ipa_if_num,
@@ -1427,9 +1437,9 @@ int IPACM_Lan::handle_eth_hdr_init(uint8_t *mac_addr)
 	}
 
 	/* add header to IPA */
-	if (num_eth_client >= IPA_MAX_NUM_ETH_CLIENTS)
+	if (num_eth_client >= eth_client_idx.get_capacity())
 	{
-		IPACMERR("Reached maximum number(%d) of eth clients\n", IPA_MAX_NUM_ETH_CLIENTS);
+		IPACMERR("Reached maximum number(%d) of eth clients\n", eth_client_idx.get_capacity());
 		return IPACM_FAILURE;
 	}
 
@@ -1666,6 +1676,7 @@ int IPACM_Lan::handle_eth_hdr_init(uint8_t *mac_addr)
 		get_client_memptr(eth_client, num_eth_client)->route_rule_set_v6 = 0;
 		get_client_memptr(eth_client, num_eth_client)->ipv4_set = false;
 		get_client_memptr(eth_client, num_eth_client)->ipv6_set = 0;
+		eth_client_idx.add(get_client_memptr(eth_client, num_eth_client)->mac, num_eth_client);
 		num_eth_client++;
 		header_name_count++; //keep increasing header_name_count
 		res = IPACM_SUCCESS;
@@ -1790,11 +1801,11 @@ int IPACM_Lan::handle_eth_client_ipaddr(ipacm_event_data_all *data)
 /*handle eth client routing rule*/
 int IPACM_Lan::handle_eth_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptype)
 {
-	struct ipa_ioc_add_rt_rule *rt_rule;
+	IPACM_RtRuleBatch *lan_batch = NULL, *wan_batch = NULL;
 	struct ipa_rt_rule_add *rt_rule_entry;
 	uint32_t tx_index;
-	int eth_index,v6_num;
-	const int NUM = 1;
+	int eth_index, v6_num, num_addr, cnt;
+	int res = IPACM_SUCCESS;
 
 	if(tx_prop == NULL)
 	{
@@ -1838,90 +1849,101 @@ int IPACM_Lan::handle_eth_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptyp
 			IPACMDBG_H("depend Got pipe %d rm index : %d \n", tx_prop->tx[0].dst_pipe, IPACM_Iface::ipacmcfg->ipa_client_rm_map_tbl[tx_prop->tx[0].dst_pipe]);
 			IPACM_Iface::ipacmcfg->AddRmDepend(IPACM_Iface::ipacmcfg->ipa_client_rm_map_tbl[tx_prop->tx[0].dst_pipe],false);
 		}
-		rt_rule = (struct ipa_ioc_add_rt_rule *)
-			 calloc(1, sizeof(struct ipa_ioc_add_rt_rule) +
-						NUM * sizeof(struct ipa_rt_rule_add));
+		/* one rule per tx prop and address, installed in one ioctl per table */
+		num_addr = (iptype == IPA_IP_v4) ? 1 :
+			get_client_memptr(eth_client, eth_index)->ipv6_set - get_client_memptr(eth_client, eth_index)->route_rule_set_v6;
 
-		if (rt_rule == NULL)
+		lan_batch = m_routing.GetBatch(iface_query->num_tx_props * num_addr);
+		if (lan_batch == NULL)
 		{
 			PERROR("Error Locate ipa_ioc_add_rt_rule memory...\n");
 			return IPACM_FAILURE;
 		}
+		lan_batch->table()->commit = 1;
+		lan_batch->table()->ip = iptype;
+		strlcpy(lan_batch->table()->rt_tbl_name,
+				(iptype == IPA_IP_v4) ? IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name : IPACM_Iface::ipacmcfg->rt_tbl_v6.name,
+				sizeof(lan_batch->table()->rt_tbl_name));
+		lan_batch->table()->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
 
-		rt_rule->commit = 1;
-		rt_rule->num_rules = (uint8_t)NUM;
-		rt_rule->ip = iptype;
+		if (iptype == IPA_IP_v6)
+		{
+			wan_batch = m_routing.GetBatch(iface_query->num_tx_props * num_addr);
+			if (wan_batch == NULL)
+			{
+				PERROR("Error Locate ipa_ioc_add_rt_rule memory...\n");
+				res = IPACM_FAILURE;
+				goto fail;
+			}
+			wan_batch->table()->commit = 1;
+			wan_batch->table()->ip = iptype;
+			strlcpy(wan_batch->table()->rt_tbl_name,
+					IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.name,
+					sizeof(wan_batch->table()->rt_tbl_name));
+			wan_batch->table()->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
+		}
 
 		for (tx_index = 0; tx_index < iface_query->num_tx_props; tx_index++)
 		{
 			if(iptype != tx_prop->tx[tx_index].ip)
-		    {
+			{
 				IPACMDBG_H("Tx:%d, ip-type: %d conflict ip-type: %d no RT-rule added\n",
 						tx_index, tx_prop->tx[tx_index].ip,iptype);
-		   	        continue;
-		    }
-
-  	   	    rt_rule_entry = &rt_rule->rules[0];
-			rt_rule_entry->at_rear = 0;
+				continue;
+			}
 
 			if (iptype == IPA_IP_v4)
 			{
-		        IPACMDBG_H("client index(%d):ipv4 address: 0x%x\n", eth_index,
-		  		        get_client_memptr(eth_client, eth_index)->v4_addr);
-
-                IPACMDBG_H("client(%d): v4 header handle:(0x%x)\n",
-		  				 eth_index,
-		  				 get_client_memptr(eth_client, eth_index)->hdr_hdl_v4);
-				strlcpy(rt_rule->rt_tbl_name,
-								IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name,
-								sizeof(rt_rule->rt_tbl_name));
-				rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
-			    rt_rule_entry->rule.dst = tx_prop->tx[tx_index].dst_pipe;
-			    memcpy(&rt_rule_entry->rule.attrib,
-						 &tx_prop->tx[tx_index].attrib,
-						 sizeof(rt_rule_entry->rule.attrib));
-			    rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-		   	    rt_rule_entry->rule.hdr_hdl = get_client_memptr(eth_client, eth_index)->hdr_hdl_v4;
+				IPACMDBG_H("client index(%d):ipv4 address: 0x%x\n", eth_index,
+						get_client_memptr(eth_client, eth_index)->v4_addr);
+
+				IPACMDBG_H("client(%d): v4 header handle:(0x%x)\n",
+						eth_index,
+						get_client_memptr(eth_client, eth_index)->hdr_hdl_v4);
+
+				rt_rule_entry = lan_batch->add();
+				if (rt_rule_entry == NULL)
+				{
+					IPACMERR("Routing rule batch is full\n");
+					res = IPACM_FAILURE;
+					goto fail;
+				}
+				rt_rule_entry->rule.dst = tx_prop->tx[tx_index].dst_pipe;
+				memcpy(&rt_rule_entry->rule.attrib,
+						&tx_prop->tx[tx_index].attrib,
+						sizeof(rt_rule_entry->rule.attrib));
+				rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
+				rt_rule_entry->rule.hdr_hdl = get_client_memptr(eth_client, eth_index)->hdr_hdl_v4;
 				rt_rule_entry->rule.attrib.u.v4.dst_addr = get_client_memptr(eth_client, eth_index)->v4_addr;
 				rt_rule_entry->rule.attrib.u.v4.dst_addr_mask = 0xFFFFFFFF;
 #ifdef FEATURE_IPA_V3
 				rt_rule_entry->rule.hashable = true;
 #endif
-			    if (false == m_routing.AddRoutingRule(rt_rule))
-  	            {
-  	          	            IPACMERR("Routing rule addition failed!\n");
-  	          	            free(rt_rule);
-  	          	            return IPACM_FAILURE;
-			    }
-
-			    /* copy ipv4 RT hdl */
-		        get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v4 =
-  	   	        rt_rule->rules[0].rt_rule_hdl;
-		        IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-		      	get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v4, iptype);
-
-  	   	    } else {
-
-		        for(v6_num = get_client_memptr(eth_client, eth_index)->route_rule_set_v6;v6_num < get_client_memptr(eth_client, eth_index)->ipv6_set;v6_num++)
-			    {
-                    IPACMDBG_H("client(%d): v6 header handle:(0x%x)\n",
-		  	    			 eth_index,
-		  	    			 get_client_memptr(eth_client, eth_index)->hdr_hdl_v6);
-
-		            /* v6 LAN_RT_TBL */
-				strlcpy(rt_rule->rt_tbl_name,
-			    					IPACM_Iface::ipacmcfg->rt_tbl_v6.name,
-			    					sizeof(rt_rule->rt_tbl_name));
-				rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
-		            /* Support QCMAP LAN traffic feature, send to A5 */
+			}
+			else
+			{
+				for(v6_num = get_client_memptr(eth_client, eth_index)->route_rule_set_v6;v6_num < get_client_memptr(eth_client, eth_index)->ipv6_set;v6_num++)
+				{
+					IPACMDBG_H("client(%d): v6 header handle:(0x%x)\n",
+							eth_index,
+							get_client_memptr(eth_client, eth_index)->hdr_hdl_v6);
+
+					/* v6 LAN_RT_TBL */
+					rt_rule_entry = lan_batch->add();
+					if (rt_rule_entry == NULL)
+					{
+						IPACMERR("Routing rule batch is full\n");
+						res = IPACM_FAILURE;
+						goto fail;
+					}
+					/* Support QCMAP LAN traffic feature, send to A5 */
 					rt_rule_entry->rule.dst = IPA_CLIENT_APPS_LAN_CONS;
-			        memset(&rt_rule_entry->rule.attrib, 0, sizeof(rt_rule_entry->rule.attrib));
-		   	        rt_rule_entry->rule.hdr_hdl = 0;
-			        rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[0] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][0];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[1] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][1];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[2] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][2];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[3] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][3];
+					rt_rule_entry->rule.hdr_hdl = 0;
+					rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[0] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][0];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[1] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][1];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[2] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][2];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[3] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][3];
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[0] = 0xFFFFFFFF;
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[1] = 0xFFFFFFFF;
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[2] = 0xFFFFFFFF;
@@ -1929,31 +1951,26 @@ int IPACM_Lan::handle_eth_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptyp
 #ifdef FEATURE_IPA_V3
 					rt_rule_entry->rule.hashable = true;
 #endif
-   	                if (false == m_routing.AddRoutingRule(rt_rule))
-  	                {
-  	                	    IPACMERR("Routing rule addition failed!\n");
-  	                	    free(rt_rule);
-  	                	    return IPACM_FAILURE;
-			        }
-
-		            get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6[v6_num] = rt_rule->rules[0].rt_rule_hdl;
-		            IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-		            				 get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6[v6_num], iptype);
-
-			        /*Copy same rule to v6 WAN RT TBL*/
-				strlcpy(rt_rule->rt_tbl_name, IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.name, sizeof(rt_rule->rt_tbl_name));
-				rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
-				/* Downlink traffic from Wan iface, directly through IPA */
+
+					/*Copy same rule to v6 WAN RT TBL*/
+					rt_rule_entry = wan_batch->add();
+					if (rt_rule_entry == NULL)
+					{
+						IPACMERR("Routing rule batch is full\n");
+						res = IPACM_FAILURE;
+						goto fail;
+					}
+					/* Downlink traffic from Wan iface, directly through IPA */
 					rt_rule_entry->rule.dst = tx_prop->tx[tx_index].dst_pipe;
-			        memcpy(&rt_rule_entry->rule.attrib,
-						 &tx_prop->tx[tx_index].attrib,
-						 sizeof(rt_rule_entry->rule.attrib));
-		   	        rt_rule_entry->rule.hdr_hdl = get_client_memptr(eth_client, eth_index)->hdr_hdl_v6;
-			        rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[0] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][0];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[1] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][1];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[2] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][2];
-		   	        rt_rule_entry->rule.attrib.u.v6.dst_addr[3] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][3];
+					memcpy(&rt_rule_entry->rule.attrib,
+							&tx_prop->tx[tx_index].attrib,
+							sizeof(rt_rule_entry->rule.attrib));
+					rt_rule_entry->rule.hdr_hdl = get_client_memptr(eth_client, eth_index)->hdr_hdl_v6;
+					rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[0] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][0];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[1] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][1];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[2] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][2];
+					rt_rule_entry->rule.attrib.u.v6.dst_addr[3] = get_client_memptr(eth_client, eth_index)->v6_addr[v6_num][3];
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[0] = 0xFFFFFFFF;
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[1] = 0xFFFFFFFF;
 					rt_rule_entry->rule.attrib.u.v6.dst_addr_mask[2] = 0xFFFFFFFF;
@@ -1961,22 +1978,58 @@ int IPACM_Lan::handle_eth_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptyp
 #ifdef FEATURE_IPA_V3
 					rt_rule_entry->rule.hashable = true;
 #endif
-		            if (false == m_routing.AddRoutingRule(rt_rule))
-		            {
-							IPACMERR("Routing rule addition failed!\n");
-							free(rt_rule);
-							return IPACM_FAILURE;
-		            }
-
-		            get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6_wan[v6_num] = rt_rule->rules[0].rt_rule_hdl;
-					IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-		            				 get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6_wan[v6_num], iptype);
-			    }
+				}
 			}
 
-  	    } /* end of for loop */
+		} /* end of for loop */
 
-		free(rt_rule);
+		if (false == m_routing.AddRoutingRule(lan_batch))
+		{
+			IPACMERR("Routing rule addition failed!\n");
+			res = IPACM_FAILURE;
+			goto fail;
+		}
+		if (wan_batch != NULL && false == m_routing.AddRoutingRule(wan_batch))
+		{
+			IPACMERR("Routing rule addition failed!\n");
+			for (cnt = 0; cnt < lan_batch->count(); cnt++)
+			{
+				m_routing.DeleteRoutingHdl(lan_batch->rule(cnt)->rt_rule_hdl, iptype);
+			}
+			res = IPACM_FAILURE;
+			goto fail;
+		}
+
+		/* hand out the handles in the order the rules were built */
+		cnt = 0;
+		for (tx_index = 0; tx_index < iface_query->num_tx_props; tx_index++)
+		{
+			if(iptype != tx_prop->tx[tx_index].ip)
+			{
+				continue;
+			}
+
+			if (iptype == IPA_IP_v4)
+			{
+				/* copy ipv4 RT hdl */
+				get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v4 =
+					lan_batch->rule(cnt++)->rt_rule_hdl;
+				IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
+						get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v4, iptype);
+			}
+			else
+			{
+				for(v6_num = get_client_memptr(eth_client, eth_index)->route_rule_set_v6;v6_num < get_client_memptr(eth_client, eth_index)->ipv6_set;v6_num++)
+				{
+					get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6[v6_num] = lan_batch->rule(cnt)->rt_rule_hdl;
+					get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6_wan[v6_num] = wan_batch->rule(cnt)->rt_rule_hdl;
+					cnt++;
+					IPACMDBG_H("tx:%d, rt rule hdl=%x wan hdl=%x ip-type: %d\n", tx_index,
+							get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6[v6_num],
+							get_client_memptr(eth_client, eth_index)->eth_rt_hdl[tx_index].eth_rt_rule_hdl_v6_wan[v6_num], iptype);
+				}
+			}
+		}
 
 		if (iptype == IPA_IP_v4)
 		{
@@ -1987,7 +2040,11 @@ int IPACM_Lan::handle_eth_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptyp
 			get_client_memptr(eth_client, eth_index)->route_rule_set_v6 = get_client_memptr(eth_client, eth_index)->ipv6_set;
 		}
 	}
-	return IPACM_SUCCESS;
+
+fail:
+	m_routing.PutBatch(lan_batch);
+	m_routing.PutBatch(wan_batch);
+	return res;
 }
 
 /* handle odu client initial, construct full headers (tx property) */
@@ -2384,6 +2441,8 @@ int IPACM_Lan::handle_eth_client_down_evt(uint8_t *mac_addr)
 	get_client_memptr(eth_client, clt_indx)->route_rule_set_v4 = false;
 	get_client_memptr(eth_client, clt_indx)->route_rule_set_v6 = 0;
 
+	/* the entries behind clt_indx move down by one */
+	eth_client_idx.remove(mac_addr, clt_indx, num_eth_client_tmp);
 	for (; clt_indx < num_eth_client_tmp - 1; clt_indx++)
 	{
 		memcpy(get_client_memptr(eth_client, clt_indx)->mac,
@@ -3158,118 +3217,102 @@ int IPACM_Lan::handle_lan_client_reset_rt(ipa_ip_type iptype)
 
 int IPACM_Lan::install_ipv4_icmp_flt_rule()
 {
-	int len;
-	struct ipa_ioc_add_flt_rule* flt_rule;
-	struct ipa_flt_rule_add flt_rule_entry;
+	IPACM_FltRuleBatch *batch;
+	struct ipa_flt_rule_add *flt_rule_entry;
+	int res = IPACM_SUCCESS;
 
 	if(rx_prop != NULL)
 	{
-		len = sizeof(struct ipa_ioc_add_flt_rule) + sizeof(struct ipa_flt_rule_add);
-
-		flt_rule = (struct ipa_ioc_add_flt_rule *)calloc(1, len);
-		if (!flt_rule)
+		batch = m_filtering.GetBatch(1);
+		if (batch == NULL || (flt_rule_entry = batch->add()) == NULL)
 		{
 			IPACMERR("Error Locate ipa_flt_rule_add memory...\n");
+			m_filtering.PutBatch(batch);
 			return IPACM_FAILURE;
 		}
 
-		flt_rule->commit = 1;
-		flt_rule->ep = rx_prop->rx[0].src_pipe;
-		flt_rule->global = false;
-		flt_rule->ip = IPA_IP_v4;
-		flt_rule->num_rules = 1;
-
-		memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+		batch->table()->commit = 1;
+		batch->table()->ep = rx_prop->rx[0].src_pipe;
+		batch->table()->global = false;
+		batch->table()->ip = IPA_IP_v4;
 
-		flt_rule_entry.rule.retain_hdr = 1;
-		flt_rule_entry.rule.to_uc = 0;
-		flt_rule_entry.rule.eq_attrib_type = 0;
-		flt_rule_entry.at_rear = true;
-		flt_rule_entry.flt_rule_hdl = -1;
-		flt_rule_entry.status = -1;
-		flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+		flt_rule_entry->rule.retain_hdr = 1;
+		flt_rule_entry->rule.to_uc = 0;
+		flt_rule_entry->rule.eq_attrib_type = 0;
+		flt_rule_entry->at_rear = true;
+		flt_rule_entry->rule.action = IPA_PASS_TO_EXCEPTION;
 #ifdef FEATURE_IPA_V3
-		flt_rule_entry.rule.hashable = true;
+		flt_rule_entry->rule.hashable = true;
 #endif
-		memcpy(&flt_rule_entry.rule.attrib, &rx_prop->rx[0].attrib, sizeof(flt_rule_entry.rule.attrib));
+		memcpy(&flt_rule_entry->rule.attrib, &rx_prop->rx[0].attrib, sizeof(flt_rule_entry->rule.attrib));
 
-		flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_PROTOCOL;
-		flt_rule_entry.rule.attrib.u.v4.protocol = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP;
-		memcpy(&(flt_rule->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+		flt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_PROTOCOL;
+		flt_rule_entry->rule.attrib.u.v4.protocol = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP;
 
-		if (m_filtering.AddFilteringRule(flt_rule) == false)
+		if (m_filtering.AddFilteringRule(batch) == false)
 		{
 			IPACMERR("Error Adding Filtering rule, aborting...\n");
-			free(flt_rule);
-			return IPACM_FAILURE;
+			res = IPACM_FAILURE;
 		}
 		else
 		{
 			IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-			ipv4_icmp_flt_rule_hdl[0] = flt_rule->rules[0].flt_rule_hdl;
+			ipv4_icmp_flt_rule_hdl[0] = batch->rule(0)->flt_rule_hdl;
 			IPACMDBG_H("IPv4 icmp filter rule HDL:0x%x\n", ipv4_icmp_flt_rule_hdl[0]);
-                        free(flt_rule);
 		}
+		m_filtering.PutBatch(batch);
 	}
-	return IPACM_SUCCESS;
+	return res;
 }
 
 int IPACM_Lan::install_ipv6_icmp_flt_rule()
 {
-
-	int len;
-	struct ipa_ioc_add_flt_rule* flt_rule;
-	struct ipa_flt_rule_add flt_rule_entry;
+	IPACM_FltRuleBatch *batch;
+	struct ipa_flt_rule_add *flt_rule_entry;
+	int res = IPACM_SUCCESS;
 
 	if(rx_prop != NULL)
 	{
-		len = sizeof(struct ipa_ioc_add_flt_rule) + sizeof(struct ipa_flt_rule_add);
-
-		flt_rule = (struct ipa_ioc_add_flt_rule *)calloc(1, len);
-		if (!flt_rule)
+		batch = m_filtering.GetBatch(1);
+		if (batch == NULL || (flt_rule_entry = batch->add()) == NULL)
 		{
 			IPACMERR("Error Locate ipa_flt_rule_add memory...\n");
+			m_filtering.PutBatch(batch);
 			return IPACM_FAILURE;
 		}
 
-		flt_rule->commit = 1;
-		flt_rule->ep = rx_prop->rx[0].src_pipe;
-		flt_rule->global = false;
-		flt_rule->ip = IPA_IP_v6;
-		flt_rule->num_rules = 1;
-
-		memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+		batch->table()->commit = 1;
+		batch->table()->ep = rx_prop->rx[0].src_pipe;
+		batch->table()->global = false;
+		batch->table()->ip = IPA_IP_v6;
 
-		flt_rule_entry.rule.retain_hdr = 1;
-		flt_rule_entry.rule.to_uc = 0;
-		flt_rule_entry.rule.eq_attrib_type = 0;
-		flt_rule_entry.at_rear = true;
-		flt_rule_entry.flt_rule_hdl = -1;
-		flt_rule_entry.status = -1;
-		flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+		flt_rule_entry->rule.retain_hdr = 1;
+		flt_rule_entry->rule.to_uc = 0;
+		flt_rule_entry->rule.eq_attrib_type = 0;
+		flt_rule_entry->at_rear = true;
+		flt_rule_entry->rule.action = IPA_PASS_TO_EXCEPTION;
 #ifdef FEATURE_IPA_V3
-		flt_rule_entry.rule.hashable = false;
+		flt_rule_entry->rule.hashable = false;
 #endif
-		memcpy(&flt_rule_entry.rule.attrib, &rx_prop->rx[0].attrib, sizeof(flt_rule_entry.rule.attrib));
-		flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_NEXT_HDR;
-		flt_rule_entry.rule.attrib.u.v6.next_hdr = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP6;
-		memcpy(&(flt_rule->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+		memcpy(&flt_rule_entry->rule.attrib, &rx_prop->rx[0].attrib, sizeof(flt_rule_entry->rule.attrib));
 
-		if (m_filtering.AddFilteringRule(flt_rule) == false)
+		flt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_NEXT_HDR;
+		flt_rule_entry->rule.attrib.u.v6.next_hdr = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP6;
+
+		if (m_filtering.AddFilteringRule(batch) == false)
 		{
 			IPACMERR("Error Adding Filtering rule, aborting...\n");
-			free(flt_rule);
-			return IPACM_FAILURE;
+			res = IPACM_FAILURE;
 		}
 		else
 		{
 			IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-			ipv6_icmp_flt_rule_hdl[0] = flt_rule->rules[0].flt_rule_hdl;
+			ipv6_icmp_flt_rule_hdl[0] = batch->rule(0)->flt_rule_hdl;
 			IPACMDBG_H("IPv6 icmp filter rule HDL:0x%x\n", ipv6_icmp_flt_rule_hdl[0]);
-			free(flt_rule);
 		}
+		m_filtering.PutBatch(batch);
 	}
-	return IPACM_SUCCESS;
+	return res;
 }
 
 int IPACM_Lan::add_dummy_private_subnet_flt_rule(ipa_ip_type iptype)
@@ -3697,7 +3740,6 @@ int IPACM_Lan::handle_tethering_stats_event(ipa_get_data_stats_resp_msg_v01 *dat
 	uint64_t num_ul_packets, num_ul_bytes;
 	uint64_t num_dl_packets, num_dl_bytes;
 	bool ul_pipe_found, dl_pipe_found;
-	FILE *fp = NULL;
 
 	fd = open(IPA_DEVICE_NAME, O_RDWR);
 	if (fd < 0)
@@ -3778,22 +3820,9 @@ int IPACM_Lan::handle_tethering_stats_event(ipa_get_data_stats_resp_msg_v01 *dat
 								num_dl_bytes,
 									dev_name,
 										IPACM_Wan::wan_up_dev_name);
-		fp = fopen(IPA_PIPE_STATS_FILE_NAME, "w");
-		if ( fp == NULL )
-		{
-			IPACMERR("Failed to write pipe stats to %s, error is %d - %s\n",
-					IPA_PIPE_STATS_FILE_NAME, errno, strerror(errno));
-			return IPACM_FAILURE;
-		}
-
-		fprintf(fp, PIPE_STATS,
-				dev_name,
-					IPACM_Wan::wan_up_dev_name,
-						num_ul_bytes,
-						num_ul_packets,
-							    num_dl_bytes,
-							num_dl_packets);
-		fclose(fp);
+		IPACM_Stats::GetInstance()->update(IPACM_STATS_TYPE_IFACE,
+				dev_name, IPACM_Wan::wan_up_dev_name, 0,
+				num_ul_bytes, num_ul_packets, num_dl_bytes, num_dl_packets);
 	}
 	return IPACM_SUCCESS;
 }
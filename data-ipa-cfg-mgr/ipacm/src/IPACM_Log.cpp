@@ -48,11 +48,491 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <linux/if.h>
 #include <sys/un.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 #include <IPACM_Defs.h>
 
-void logmessage(int log_level)
+/* Single producer (the owning thread), single consumer (the drain) */
+typedef struct ipacm_log_ring_s {
+	ipacm_log_rec_t recs[IPACM_LOG_RING_SIZE];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t dropped;
+	bool dead;
+	struct ipacm_log_ring_s *next;
+} ipacm_log_ring_t;
+
+/* Drain poll period while every ring is empty, in msec */
+#define IPACM_LOG_DRAIN_MS 20
+
+static pthread_once_t ipacm_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ipacm_log_key;
+static pthread_mutex_t ipacm_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static ipacm_log_ring_t *ipacm_log_rings = NULL;
+static pthread_once_t ipacm_log_kmsg_once = PTHREAD_ONCE_INIT;
+static int ipacm_log_kmsg_fd = -1;
+static pthread_once_t ipacm_log_sock_once = PTHREAD_ONCE_INIT;
+static int ipacm_log_sockfd = -1;
+/* Written by a producer whose ring reaches half full */
+static int ipacm_log_wake_fd = -1;
+/* No drain thread, every record is written out as it is committed */
+static bool ipacm_log_sync = false;
+
+static void *ipacm_log_drain(void *);
+
+/* The ring outlives its thread until the drain has emptied it */
+static void ipacm_log_thread_exit(void *ptr)
 {
-	return;
+	ipacm_log_ring_t *ring = (ipacm_log_ring_t *)ptr, **prev;
+
+	if(!ipacm_log_sync)
+	{
+		__atomic_store_n(&ring->dead, true, __ATOMIC_RELEASE);
+		return;
+	}
+
+	/* nobody else frees it */
+	pthread_mutex_lock(&ipacm_log_lock);
+	for(prev = &ipacm_log_rings; *prev != NULL; prev = &(*prev)->next)
+	{
+		if(*prev == ring)
+		{
+			*prev = ring->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&ipacm_log_lock);
+	free(ring);
+}
+
+static void ipacm_log_init(void)
+{
+	pthread_t thread;
+
+	pthread_key_create(&ipacm_log_key, ipacm_log_thread_exit);
+	ipacm_log_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(pthread_create(&thread, NULL, ipacm_log_drain, NULL) != 0)
+	{
+		printf("unable to create ipacm_log drain thread, logging synchronously\n");
+		ipacm_log_sync = true;
+		return;
+	}
+	pthread_setname_np(thread, "ipacm log drain");
+	pthread_detach(thread);
+	atexit(ipacm_log_flush);
+}
+
+static ipacm_log_ring_t *ipacm_log_ring(void)
+{
+	ipacm_log_ring_t *ring;
+
+	pthread_once(&ipacm_log_once, ipacm_log_init);
+	ring = (ipacm_log_ring_t *)pthread_getspecific(ipacm_log_key);
+	if(ring != NULL)
+	{
+		return ring;
+	}
+
+	ring = (ipacm_log_ring_t *)calloc(1, sizeof(ipacm_log_ring_t));
+	if(ring == NULL)
+	{
+		return NULL;
+	}
+	pthread_setspecific(ipacm_log_key, ring);
+
+	pthread_mutex_lock(&ipacm_log_lock);
+	ring->next = ipacm_log_rings;
+	ipacm_log_rings = ring;
+	pthread_mutex_unlock(&ipacm_log_lock);
+	return ring;
+}
+
+ipacm_log_rec_t *ipacm_log_reserve(uint8_t level)
+{
+	ipacm_log_ring_t *ring = ipacm_log_ring();
+	uint32_t head;
+
+	if(ring == NULL)
+	{
+		return NULL;
+	}
+
+	head = ring->head;
+	if(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= IPACM_LOG_RING_SIZE)
+	{
+		if(level != IPACM_LOG_ERR)
+		{
+			__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		}
+		return NULL;
+	}
+	return &ring->recs[head & (IPACM_LOG_RING_SIZE - 1)];
+}
+
+void ipacm_log_commit(void)
+{
+	ipacm_log_ring_t *ring = (ipacm_log_ring_t *)pthread_getspecific(ipacm_log_key);
+	uint32_t head = ring->head + 1;
+	uint64_t one = 1;
+
+	if(ipacm_log_sync)
+	{
+		/* same lock as a flush, so a record is never written twice */
+		pthread_mutex_lock(&ipacm_log_lock);
+		ipacm_log_emit(&ring->recs[ring->head & (IPACM_LOG_RING_SIZE - 1)]);
+		ring->head = head;
+		__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&ipacm_log_lock);
+		fflush(stdout);
+		return;
+	}
+
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+	if(head - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == IPACM_LOG_RING_SIZE / 2 &&
+		 ipacm_log_wake_fd >= 0)
+	{
+		write(ipacm_log_wake_fd, &one, sizeof(one));
+	}
+}
+
+/* Takes the next encoded argument whatever its type, so a mismatch
+   only costs that one argument. Returns its tag when it is one of the
+   two given, 0 otherwise */
+static int ipacm_log_arg(const char **pos, const char *end,
+	uint8_t tag, uint8_t alt, uint64_t *val, const char **str)
+{
+	const char *cur = *pos;
+	int found;
+
+	if(cur >= end)
+	{
+		return 0;
+	}
+
+	found = (*cur == tag || *cur == alt) ? *cur : 0;
+	if(*cur == IPACM_LOG_ARG_STR)
+	{
+		*str = cur + 1;
+		*pos = *str + strnlen(*str, end - *str) + 1;
+		return found;
+	}
+
+	if(end - cur < 1 + 8)
+	{
+		*pos = end;
+		return 0;
+	}
+	memcpy(val, cur + 1, 8);
+	*pos = cur + 1 + 8;
+	return found;
+}
+
+/* printf() of the record, each conversion is done on its own
+   since the arguments only exist in encoded form */
+static int ipacm_log_format(const ipacm_log_rec_t *rec, char *buf, int size)
+{
+	const char *fmt = rec->fmt, *pos = rec->args, *end = rec->args + rec->len;
+	const char *str = NULL;
+	char spec[32];
+	int len = 0, slen, bits, star[2], nstar, ret, tag;
+	uint64_t val;
+	double dbl;
+
+	if(rec->level == IPACM_LOG_ERR)
+	{
+		len += snprintf(buf + len, size - len, "ERROR: ");
+	}
+	if(rec->flags & IPACM_LOG_F_PREFIX)
+	{
+		len += snprintf(buf + len, size - len, "%s:%d %s() ", rec->file, rec->line, rec->func);
+	}
+
+	while(*fmt != '\0' && len < size - 1)
+	{
+		if(*fmt != '%')
+		{
+			buf[len++] = *fmt++;
+			continue;
+		}
+		if(fmt[1] == '%')
+		{
+			buf[len++] = '%';
+			fmt += 2;
+			continue;
+		}
+
+		/* flags, width and precision are kept, '*' takes an argument */
+		slen = 0;
+		nstar = 0;
+		spec[slen++] = *fmt++;
+		while(*fmt != '\0' && strchr("-+ #0123456789.*", *fmt) != NULL && slen < 20)
+		{
+			if(*fmt == '*' && nstar < 2)
+			{
+				if(!ipacm_log_arg(&pos, end, IPACM_LOG_ARG_INT, IPACM_LOG_ARG_INT, &val, &str))
+				{
+					val = 0;
+				}
+				star[nstar++] = (int)val;
+			}
+			spec[slen++] = *fmt++;
+		}
+
+		/* the length modifier only tells how wide the argument was */
+		bits = 32;
+		while(*fmt != '\0' && strchr("hlLqjzt", *fmt) != NULL)
+		{
+			switch(*fmt)
+			{
+			case 'h':
+				bits = (bits == 16) ? 8 : 16;
+				break;
+			case 'l':
+				bits = (bits == 8 * (int)sizeof(long)) ? 64 : 8 * (int)sizeof(long);
+				break;
+			case 'z':
+			case 't':
+				bits = 8 * (int)sizeof(size_t);
+				break;
+			default:
+				bits = 64;
+				break;
+			}
+			fmt++;
+		}
+		if(*fmt == '\0')
+		{
+			break;
+		}
+
+		switch(*fmt)
+		{
+		case 'd':
+		case 'i':
+			if(!ipacm_log_arg(&pos, end, IPACM_LOG_ARG_INT, IPACM_LOG_ARG_PTR, &val, &str))
+				goto bad_arg;
+			if(bits < 64)
+				val = (uint64_t)(((int64_t)(val << (64 - bits))) >> (64 - bits));
+			spec[slen++] = 'l';
+			spec[slen++] = 'l';
+			spec[slen++] = *fmt;
+			spec[slen] = '\0';
+			if(nstar == 2)
+				ret = snprintf(buf + len, size - len, spec, star[0], star[1], (long long)val);
+			else if(nstar == 1)
+				ret = snprintf(buf + len, size - len, spec, star[0], (long long)val);
+			else
+				ret = snprintf(buf + len, size - len, spec, (long long)val);
+			break;
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+		case 'c':
+			if(!ipacm_log_arg(&pos, end, IPACM_LOG_ARG_INT, IPACM_LOG_ARG_PTR, &val, &str))
+				goto bad_arg;
+			if(bits < 64)
+				val &= (((uint64_t)1) << bits) - 1;
+			if(*fmt != 'c')
+			{
+				spec[slen++] = 'l';
+				spec[slen++] = 'l';
+			}
+			spec[slen++] = *fmt;
+			spec[slen] = '\0';
+			if(*fmt == 'c')
+				ret = snprintf(buf + len, size - len, spec, (int)val);
+			else if(nstar == 2)
+				ret = snprintf(buf + len, size - len, spec, star[0], star[1], (unsigned long long)val);
+			else if(nstar == 1)
+				ret = snprintf(buf + len, size - len, spec, star[0], (unsigned long long)val);
+			else
+				ret = snprintf(buf + len, size - len, spec, (unsigned long long)val);
+			break;
+
+		case 'p':
+			/* a char pointer was copied as a string, show that instead */
+			tag = ipacm_log_arg(&pos, end, IPACM_LOG_ARG_PTR, IPACM_LOG_ARG_STR, &val, &str);
+			if(tag == IPACM_LOG_ARG_STR)
+				ret = snprintf(buf + len, size - len, "%s", str);
+			else if(tag == IPACM_LOG_ARG_PTR)
+				ret = snprintf(buf + len, size - len, "%p", (void *)(uintptr_t)val);
+			else
+				goto bad_arg;
+			break;
+
+		case 's':
+			/* only char pointers are copied, print other pointers' address */
+			tag = ipacm_log_arg(&pos, end, IPACM_LOG_ARG_STR, IPACM_LOG_ARG_PTR, &val, &str);
+			if(tag == IPACM_LOG_ARG_PTR)
+			{
+				ret = snprintf(buf + len, size - len, "%p", (void *)(uintptr_t)val);
+				break;
+			}
+			if(tag == 0)
+				goto bad_arg;
+			spec[slen++] = 's';
+			spec[slen] = '\0';
+			if(nstar == 2)
+				ret = snprintf(buf + len, size - len, spec, star[0], star[1], str);
+			else if(nstar == 1)
+				ret = snprintf(buf + len, size - len, spec, star[0], str);
+			else
+				ret = snprintf(buf + len, size - len, spec, str);
+			break;
+
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if(!ipacm_log_arg(&pos, end, IPACM_LOG_ARG_DBL, IPACM_LOG_ARG_DBL, &val, &str))
+				goto bad_arg;
+			memcpy(&dbl, &val, sizeof(dbl));
+			spec[slen++] = *fmt;
+			spec[slen] = '\0';
+			if(nstar == 2)
+				ret = snprintf(buf + len, size - len, spec, star[0], star[1], dbl);
+			else if(nstar == 1)
+				ret = snprintf(buf + len, size - len, spec, star[0], dbl);
+			else
+				ret = snprintf(buf + len, size - len, spec, dbl);
+			break;
+
+		default:
+			/* unknown conversion, drop the argument */
+			ipacm_log_arg(&pos, end, IPACM_LOG_ARG_INT, IPACM_LOG_ARG_PTR, &val, &str);
+			ret = 0;
+			break;
+
+		bad_arg:
+			/* missing or of a type the conversion cannot take, the
+			   rest of the record is still printed */
+			ret = snprintf(buf + len, size - len, "<?>");
+			break;
+		}
+		fmt++;
+
+		if(ret > 0)
+		{
+			len += ret;
+			if(len > size - 1)
+			{
+				len = size - 1;
+			}
+		}
+	}
+
+	if(len > size - 1)
+	{
+		len = size - 1;
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+static void ipacm_log_kmsg_open(void)
+{
+	ipacm_log_kmsg_fd = open("/dev/kmsg", O_WRONLY | O_CLOEXEC);
+}
+
+/* Called by the drain and by threads writing out errors themselves */
+void ipacm_log_emit(const ipacm_log_rec_t *rec)
+{
+	char buf[2 * MAX_BUF_LEN];
+	int len;
+
+	len = ipacm_log_format(rec, buf, sizeof(buf));
+	fwrite(buf, 1, len, stdout);
+
+	if(rec->flags & IPACM_LOG_F_SOCK)
+	{
+		ipacm_log_send(buf);
+	}
+
+	if(rec->flags & IPACM_LOG_F_KMSG)
+	{
+		pthread_once(&ipacm_log_kmsg_once, ipacm_log_kmsg_open);
+		if(ipacm_log_kmsg_fd >= 0)
+		{
+			write(ipacm_log_kmsg_fd, buf, len);
+		}
+	}
+}
+
+/* Formats the queued records of every thread, returns how many */
+static int ipacm_log_drain_once(void)
+{
+	ipacm_log_ring_t *ring, **prev;
+	uint32_t head, tail, dropped;
+	bool dead;
+	int cnt = 0;
+
+	pthread_mutex_lock(&ipacm_log_lock);
+	prev = &ipacm_log_rings;
+	while((ring = *prev) != NULL)
+	{
+		dead = __atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		for(tail = ring->tail; tail != head; tail++)
+		{
+			ipacm_log_emit(&ring->recs[tail & (IPACM_LOG_RING_SIZE - 1)]);
+			cnt++;
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+		dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+		if(dropped != 0)
+		{
+			printf("ipacm_log: %u records dropped\n", dropped);
+			cnt++;
+		}
+
+		if(dead)
+		{
+			*prev = ring->next;
+			free(ring);
+			continue;
+		}
+		prev = &ring->next;
+	}
+	pthread_mutex_unlock(&ipacm_log_lock);
+
+	if(cnt != 0)
+	{
+		fflush(stdout);
+	}
+	return cnt;
+}
+
+static void *ipacm_log_drain(void *)
+{
+	struct pollfd pfd;
+	uint64_t cnt;
+
+	pfd.fd = ipacm_log_wake_fd;
+	pfd.events = POLLIN;
+	while(1)
+	{
+		if(ipacm_log_drain_once() == 0)
+		{
+			if(poll(&pfd, 1, IPACM_LOG_DRAIN_MS) > 0)
+			{
+				read(ipacm_log_wake_fd, &cnt, sizeof(cnt));
+			}
+		}
+	}
+	return NULL;
+}
+
+void ipacm_log_flush(void)
+{
+	ipacm_log_drain_once();
 }
 
 /* start IPACMDIAG socket*/
@@ -73,22 +553,30 @@ int create_socket(unsigned int *sockfd)
   return IPACM_SUCCESS;
 }
 
+static void ipacm_log_sock_open(void)
+{
+	unsigned int sockfd;
+
+	/* start ipacm_log socket */
+	if(create_socket(&sockfd) < 0)
+	{
+		printf("unable to create ipacm_log socket\n");
+		return;
+	}
+	printf("create ipacm_log socket successfully\n");
+	ipacm_log_sockfd = (int)sockfd;
+}
+
 void ipacm_log_send( void * user_data)
 {
 	ipacm_log_buffer_t ipacm_log_buffer;
 	int numBytes=0, len;
 	struct sockaddr_un ipacmlog_socket;
-	static unsigned int ipacm_log_sockfd = 0;
 
-	if(ipacm_log_sockfd == 0)
+	pthread_once(&ipacm_log_sock_once, ipacm_log_sock_open);
+	if(ipacm_log_sockfd < 0)
 	{
-		/* start ipacm_log socket */
-		if(create_socket(&ipacm_log_sockfd) < 0)
-		{
-			printf("unable to create ipacm_log socket\n");
-			return;
-		}
-		printf("create ipacm_log socket successfully\n");
+		return;
 	}
 	ipacmlog_socket.sun_family = AF_UNIX;
 	strcpy(ipacmlog_socket.sun_path, IPACMLOG_FILE);
@@ -53,6 +53,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <linux/rtnetlink.h>
 #include <fcntl.h>
 #include <sys/inotify.h>
+#include <poll.h>
+#include <time.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <signal.h>
 #include "linux/ipa_qmi_service_v01.h"
@@ -87,7 +90,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPACM_NAME "ipacm"
 
 #define INOTIFY_EVENT_SIZE  (sizeof(struct inotify_event))
-#define INOTIFY_BUF_LEN     (INOTIFY_EVENT_SIZE + 2*sizeof(IPACM_FIREWALL_FILE_NAME))
+/* room for a burst of events with names up to NAME_MAX */
+#define INOTIFY_BUF_LEN     (16 * (INOTIFY_EVENT_SIZE + NAME_MAX + 1))
 
 #define IPA_DRIVER_WLAN_EVENT_MAX_OF_ATTRIBS  3
 #define IPA_DRIVER_WLAN_EVENT_SIZE  (sizeof(struct ipa_wlan_msg_ex)+ IPA_DRIVER_WLAN_EVENT_MAX_OF_ATTRIBS*sizeof(ipa_wlan_hdr_attrib_val))
@@ -96,6 +100,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPA_DRIVER_WLAN_BUF_LEN     (IPA_DRIVER_PIPE_STATS_EVENT_SIZE + IPA_DRIVER_WLAN_META_MSG)
 
 uint32_t ipacm_event_stats[IPACM_EVENT_MAX];
+/* Time spent dispatching each event to its listeners, in usec */
+uint64_t ipacm_event_dispatch_us[IPACM_EVENT_MAX];
+uint32_t ipacm_event_dispatch_max_us[IPACM_EVENT_MAX];
 bool ipacm_logging = true;
 
 void ipa_is_ipacm_running(void);
@@ -122,20 +129,95 @@ void* netlink_start(void *param)
 	return NULL;
 }
 
+/* config files watched by the firewall monitor */
+typedef struct
+{
+	const char *name;
+	ipa_cm_event_id event;
+	bool pending;
+	uint64_t deadline_ms;
+	uint64_t hash;
+	bool hash_valid;
+} ipacm_monitor_file;
+
+static uint64_t ipacm_monotonic_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* hash of the content of a file in IPACM_DIR_NAME */
+static int ipacm_file_hash(const char *name, uint64_t *hash)
+{
+	char path[sizeof(IPACM_DIR_NAME) + NAME_MAX + 1];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "%s/%s", IPACM_DIR_NAME, name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return IPACM_FAILURE;
+	}
+	ret = ipacm_hash_fd(fd, hash);
+	close(fd);
+	return ret;
+}
+
+/* the window is over, post the change unless the content is the same */
+static void ipacm_monitor_flush(ipacm_monitor_file *file)
+{
+	ipacm_cmd_q_data evt_data;
+	uint64_t hash;
+
+	file->pending = false;
+	if (ipacm_file_hash(file->name, &hash) == IPACM_SUCCESS)
+	{
+		if (file->hash_valid && file->hash == hash)
+		{
+			IPACMDBG_H("File %s content unchanged, skip re-read\n", file->name);
+			return;
+		}
+		file->hash = hash;
+		file->hash_valid = true;
+	}
+	else
+	{
+		/* let the handler deal with a missing file */
+		file->hash_valid = false;
+	}
+
+	IPACMDBG_H("The interested file %s changed, post event %d\n", file->name, file->event);
+	evt_data.event = file->event;
+	evt_data.evt_data = NULL;
+	IPACM_EvtDispatcher::PostEvt(&evt_data);
+}
+
 /* start firewall-rule monitor*/
 void* firewall_monitor(void *param)
 {
-	int length;
+	int length, offset, i;
 	int wd;
-	char buffer[INOTIFY_BUF_LEN];
+	char buffer[INOTIFY_BUF_LEN] __attribute__((aligned(__alignof__(struct inotify_event))));
 	int inotify_fd;
-	ipacm_cmd_q_data evt_data;
+	int timeout;
+	uint64_t now, window;
+	struct pollfd pfd;
+	struct inotify_event *event;
 	uint32_t mask = IN_MODIFY | IN_MOVE;
+	ipacm_monitor_file files[] =
+	{
+		{ IPACM_FIREWALL_FILE_NAME, IPA_FIREWALL_CHANGE_EVENT, false, 0, 0, false },
+		{ IPACM_CFG_FILE_NAME, IPA_CFG_CHANGE_EVENT, false, 0, 0, false },
+	};
+	int num_files = sizeof(files) / sizeof(files[0]);
 
 	inotify_fd = inotify_init();
 	if (inotify_fd < 0)
 	{
 		PERROR("inotify_init");
+		return NULL;
 	}
 
 	IPACMDBG_H("Waiting for nofications in dir %s with mask: 0x%x\n", IPACM_DIR_NAME, mask);
@@ -144,59 +226,79 @@ void* firewall_monitor(void *param)
 												 IPACM_DIR_NAME,
 												 mask);
 
+	/* content at start up, a later touch without change is not a change */
+	for (i = 0; i < num_files; i++)
+	{
+		files[i].hash_valid = (ipacm_file_hash(files[i].name, &files[i].hash) == IPACM_SUCCESS);
+	}
+
+	pfd.fd = inotify_fd;
+	pfd.events = POLLIN;
+
 	while (1)
 	{
-		length = read(inotify_fd, buffer, INOTIFY_BUF_LEN);
-		if (length < 0)
+		/* sleep until the earliest pending window closes */
+		timeout = -1;
+		now = ipacm_monotonic_ms();
+		for (i = 0; i < num_files; i++)
+		{
+			if (files[i].pending)
+			{
+				if (files[i].deadline_ms <= now)
+				{
+					ipacm_monitor_flush(&files[i]);
+					continue;
+				}
+				if (timeout < 0 || (int)(files[i].deadline_ms - now) < timeout)
+				{
+					timeout = (int)(files[i].deadline_ms - now);
+				}
+			}
+		}
+
+		if (poll(&pfd, 1, timeout) <= 0)
 		{
-			IPACMERR("inotify read() error return length: %d and mask: 0x%x\n", length, mask);
 			continue;
 		}
 
-		struct inotify_event* event;
-		event = (struct inotify_event*)malloc(length);
-		if(event == NULL)
+		length = read(inotify_fd, buffer, INOTIFY_BUF_LEN);
+		if (length < 0)
 		{
-			IPACMERR("Failed to allocate memory.\n");
-			return NULL;
+			IPACMERR("inotify read() error return length: %d and mask: 0x%x\n", length, mask);
+			continue;
 		}
-		memset(event, 0, length);
-		memcpy(event, buffer, length);
 
-		if (event->len > 0)
+		window = IPACM_Iface::ipacmcfg->GetCfgDebounceMs();
+		now = ipacm_monotonic_ms();
+		/* a read returns as many whole events as fit */
+		for (offset = 0; offset + (int)INOTIFY_EVENT_SIZE <= length;
+				 offset += INOTIFY_EVENT_SIZE + event->len)
 		{
-			if ( (event->mask & IN_MODIFY) || (event->mask & IN_MOVE))
+			event = (struct inotify_event *)(buffer + offset);
+			if (event->len == 0 || !(event->mask & (IN_MODIFY | IN_MOVE)))
 			{
-				if (event->mask & IN_ISDIR)
-				{
-					IPACMDBG_H("The directory %s was 0x%x\n", event->name, event->mask);
-				}
-				else if (!strncmp(event->name, IPACM_FIREWALL_FILE_NAME, event->len)) // firewall_rule change
-				{
-					IPACMDBG_H("File \"%s\" was 0x%x\n", event->name, event->mask);
-					IPACMDBG_H("The interested file %s .\n", IPACM_FIREWALL_FILE_NAME);
-
-					evt_data.event = IPA_FIREWALL_CHANGE_EVENT;
-					evt_data.evt_data = NULL;
-
-					/* Insert IPA_FIREWALL_CHANGE_EVENT to command queue */
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
-				}
-				else if (!strncmp(event->name, IPACM_CFG_FILE_NAME, event->len)) // IPACM_configuration change
+				continue;
+			}
+			if (event->mask & IN_ISDIR)
+			{
+				IPACMDBG_H("The directory %s was 0x%x\n", event->name, event->mask);
+				continue;
+			}
+			for (i = 0; i < num_files; i++)
+			{
+				if (strcmp(event->name, files[i].name) == 0)
 				{
-					IPACMDBG_H("File \"%s\" was 0x%x\n", event->name, event->mask);
-					IPACMDBG_H("The interested file %s .\n", IPACM_CFG_FILE_NAME);
-
-					evt_data.event = IPA_CFG_CHANGE_EVENT;
-					evt_data.evt_data = NULL;
-
-					/* Insert IPA_FIREWALL_CHANGE_EVENT to command queue */
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					IPACMDBG_H("File \"%s\" was 0x%x%s\n", event->name, event->mask,
+						files[i].pending ? ", coalesced" : "");
+					if (!files[i].pending)
+					{
+						files[i].pending = true;
+						files[i].deadline_ms = now + window;
+					}
+					break;
 				}
 			}
-			IPACMDBG_H("Received monitoring event %s.\n", event->name);
 		}
-		free(event);
 	}
 
 	(void)inotify_rm_watch(inotify_fd, wd);
@@ -45,23 +45,240 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Log.h"
 
 
-IPACM_Neighbor::IPACM_Neighbor()
+IPACM_Neighbor::IPACM_Neighbor() : neighbor_idx(IPA_MAC_ADDR_SIZE)
 {
+	int i;
+
 	num_neighbor_client = 0;
-	circular_index = 0;
-	memset(neighbor_client, 0, IPA_MAX_NUM_NEIGHBOR_CLIENTS * sizeof(ipa_neighbor_client));
+	num_hit = 0;
+	num_miss = 0;
+	num_evict = 0;
+	lru_head = IPA_NEIGHBOR_NONE;
+	lru_tail = IPA_NEIGHBOR_NONE;
+	free_head = IPA_NEIGHBOR_NONE;
+
+	max_neighbor_client = IPACM_Iface::ipacmcfg->GetMaxNeighborClients();
+	neighbor_client = (ipa_neighbor_client *)calloc(max_neighbor_client, sizeof(ipa_neighbor_client));
+	if (neighbor_client == NULL || neighbor_idx.init(max_neighbor_client) != IPACM_SUCCESS)
+	{
+		IPACMERR("unable to allocate neighbor cache of %d clients\n", max_neighbor_client);
+		free(neighbor_client);
+		neighbor_client = NULL;
+		max_neighbor_client = 0;
+	}
+	for (i = max_neighbor_client - 1; i >= 0; i--)
+	{
+		neighbor_client[i].next = free_head;
+		free_head = i;
+	}
+	IPACMDBG_H("neighbor cache of %d clients\n", max_neighbor_client);
+
 	IPACM_EvtDispatcher::registr(IPA_WLAN_CLIENT_ADD_EVENT_EX, this);
 	IPACM_EvtDispatcher::registr(IPA_NEW_NEIGH_EVENT, this);
 	IPACM_EvtDispatcher::registr(IPA_DEL_NEIGH_EVENT, this);
 	return;
 }
 
+IPACM_Neighbor::~IPACM_Neighbor()
+{
+	free(neighbor_client);
+}
+
+void IPACM_Neighbor::lru_unlink(int slot)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+
+	if (c->prev != IPA_NEIGHBOR_NONE)
+		neighbor_client[c->prev].next = c->next;
+	else
+		lru_head = c->next;
+	if (c->next != IPA_NEIGHBOR_NONE)
+		neighbor_client[c->next].prev = c->prev;
+	else
+		lru_tail = c->prev;
+	c->prev = IPA_NEIGHBOR_NONE;
+	c->next = IPA_NEIGHBOR_NONE;
+}
+
+void IPACM_Neighbor::lru_push(int slot)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+
+	c->prev = IPA_NEIGHBOR_NONE;
+	c->next = lru_head;
+	if (lru_head != IPA_NEIGHBOR_NONE)
+		neighbor_client[lru_head].prev = slot;
+	else
+		lru_tail = slot;
+	lru_head = slot;
+}
+
+/* returns the slot of the client and marks it most recently used */
+int IPACM_Neighbor::find_client(const uint8_t *mac)
+{
+	int slot = neighbor_idx.lookup(mac);
+
+	if (slot == IPACM_CLIENT_INDEX_EMPTY)
+	{
+		num_miss++;
+		return IPA_NEIGHBOR_NONE;
+	}
+	num_hit++;
+	if (slot != lru_head)
+	{
+		lru_unlink(slot);
+		lru_push(slot);
+	}
+	return slot;
+}
+
+/* cache a new client, the least recently used one makes room if full */
+int IPACM_Neighbor::add_client(const uint8_t *mac, int if_index, int ipa_if_num)
+{
+	ipa_neighbor_client *c;
+	int slot;
+
+	if (max_neighbor_client == 0)
+	{
+		return IPA_NEIGHBOR_NONE;
+	}
+
+	if (free_head == IPA_NEIGHBOR_NONE)
+	{
+		num_evict++;
+		IPACMERR("neighbor cache full, evict MAC %02x:%02x:%02x:%02x:%02x:%02x (hit %u miss %u evict %u)\n",
+				neighbor_client[lru_tail].mac_addr[0], neighbor_client[lru_tail].mac_addr[1],
+				neighbor_client[lru_tail].mac_addr[2], neighbor_client[lru_tail].mac_addr[3],
+				neighbor_client[lru_tail].mac_addr[4], neighbor_client[lru_tail].mac_addr[5],
+				num_hit, num_miss, num_evict);
+		del_client(lru_tail);
+	}
+
+	slot = free_head;
+	c = &neighbor_client[slot];
+	free_head = c->next;
+	memset(c, 0, sizeof(ipa_neighbor_client));
+	memcpy(c->mac_addr, mac, sizeof(c->mac_addr));
+	c->iface_index = if_index;
+	c->ipa_if_num = ipa_if_num;
+	neighbor_idx.add(mac, slot);
+	lru_push(slot);
+	num_neighbor_client++;
+	IPACMDBG_H("Cache client MAC %02x:%02x:%02x:%02x:%02x:%02x in %d-entry, total client: %d\n",
+			mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], slot, num_neighbor_client);
+	return slot;
+}
+
+void IPACM_Neighbor::del_client(int slot)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+
+	IPACMDBG_H("Clean %d-st Cached client-MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
+			slot, c->mac_addr[0], c->mac_addr[1], c->mac_addr[2],
+			c->mac_addr[3], c->mac_addr[4], c->mac_addr[5], num_neighbor_client);
+	neighbor_idx.remove(c->mac_addr, slot);
+	lru_unlink(slot);
+	memset(c, 0, sizeof(ipa_neighbor_client));
+	c->next = free_head;
+	free_head = slot;
+	num_neighbor_client--;
+}
+
+void IPACM_Neighbor::add_client_ipv6(int slot, const uint32_t *addr)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+	int i;
+
+	for (i = 0; i < c->num_v6_addr; i++)
+	{
+		if (memcmp(c->v6_addr[i], addr, sizeof(c->v6_addr[i])) == 0)
+		{
+			return;
+		}
+	}
+	if (c->num_v6_addr == IPV6_NUM_ADDR)
+	{
+		/* drop the oldest address */
+		memmove(c->v6_addr[0], c->v6_addr[1], (IPV6_NUM_ADDR - 1) * sizeof(c->v6_addr[0]));
+		c->num_v6_addr--;
+	}
+	memcpy(c->v6_addr[c->num_v6_addr], addr, sizeof(c->v6_addr[0]));
+	c->num_v6_addr++;
+}
+
+void IPACM_Neighbor::del_client_ipv6(int slot, const uint32_t *addr)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+	int i;
+
+	for (i = 0; i < c->num_v6_addr; i++)
+	{
+		if (memcmp(c->v6_addr[i], addr, sizeof(c->v6_addr[i])) == 0)
+		{
+			memmove(c->v6_addr[i], c->v6_addr[i + 1], (c->num_v6_addr - i - 1) * sizeof(c->v6_addr[0]));
+			c->num_v6_addr--;
+			return;
+		}
+	}
+}
+
+/* post the cached addresses of the client, used on re-connect */
+void IPACM_Neighbor::post_client_addrs(int slot, ipa_cm_event_id event)
+{
+	ipa_neighbor_client *c = &neighbor_client[slot];
+	ipacm_event_data_all *data_all;
+	ipacm_cmd_q_data evt_data;
+	int i, ipa_interface_index;
+
+	for (i = -1; i < c->num_v6_addr; i++)
+	{
+		/* i == -1 is the ipv4 address */
+		if (i < 0 && c->v4_addr == 0) /* not 0.0.0.0 */
+		{
+			continue;
+		}
+		data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
+		if (data_all == NULL)
+		{
+			IPACMERR("Unable to allocate memory\n");
+			return;
+		}
+		memset(data_all, 0, sizeof(ipacm_event_data_all));
+		if (i < 0)
+		{
+			data_all->iptype = IPA_IP_v4;
+			data_all->ipv4_addr = c->v4_addr; //use previous ipv4 address
+		}
+		else
+		{
+			data_all->iptype = IPA_IP_v6;
+			memcpy(data_all->ipv6_addr, c->v6_addr[i], sizeof(data_all->ipv6_addr));
+		}
+		data_all->if_index = c->iface_index;
+		memcpy(data_all->mac_addr, c->mac_addr, sizeof(data_all->mac_addr));
+		evt_data.event = event;
+		evt_data.evt_data = (void *)data_all;
+		IPACM_EvtDispatcher::PostEvt(&evt_data);
+		/* ask for replaced iface name*/
+		ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
+		/* check for failure return */
+		if (IPACM_FAILURE == ipa_interface_index) {
+			IPACMERR("not supported iface id: %d\n", data_all->if_index);
+		} else {
+			IPACMDBG_H("Posted event %d, with %s for %s client re-connect\n",
+				evt_data.event,
+				IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name,
+				(i < 0) ? "ipv4" : "ipv6");
+		}
+	}
+}
+
 void IPACM_Neighbor::event_callback(ipa_cm_event_id event, void *param)
 {
 	ipacm_event_data_all *data_all = NULL;
-	int i, ipa_interface_index;
+	int i, slot, ipa_interface_index;
 	ipacm_cmd_q_data evt_data;
-	int num_neighbor_client_temp = num_neighbor_client;
+	bool is_bridge;
 
 	IPACMDBG("Recieved event %d\n", event);
 
@@ -78,6 +295,7 @@ void IPACM_Neighbor::event_callback(ipa_cm_event_id event, void *param)
 			}
 			uint8_t client_mac_addr[6];
 
+			memset(client_mac_addr, 0, sizeof(client_mac_addr));
 			IPACMDBG_H("Received IPA_WLAN_CLIENT_ADD_EVENT\n");
 			for(i = 0; i < data->num_of_attribs; i++)
 			{
@@ -96,59 +314,29 @@ void IPACM_Neighbor::event_callback(ipa_cm_event_id event, void *param)
 				}
 			}
 
-			for (i = 0; i < num_neighbor_client_temp; i++)
+			slot = find_client(client_mac_addr);
+			if (slot == IPA_NEIGHBOR_NONE)
 			{
-				/* find the client */
-				if (memcmp(neighbor_client[i].mac_addr, client_mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
+				break;
+			}
+			/* check if iface is not bridge interface*/
+			if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) != 0)
+			{
+				/* use previous ipv4 first */
+				if(data->if_index != neighbor_client[slot].iface_index)
 				{
-					/* check if iface is not bridge interface*/
-					if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) != 0)
-					{
-						/* use previous ipv4 first */
-						if(data->if_index != neighbor_client[i].iface_index)
-						{
-							IPACMERR("update new kernel iface index \n");
-							neighbor_client[i].iface_index = data->if_index;
-						}
-
-						/* check if client associated with previous network interface */
-						if(ipa_interface_index != neighbor_client[i].ipa_if_num)
-						{
-							IPACMERR("client associate to different AP \n");
-							return;
-						}
+					IPACMERR("update new kernel iface index \n");
+					neighbor_client[slot].iface_index = data->if_index;
+				}
 
-						if (neighbor_client[i].v4_addr != 0) /* not 0.0.0.0 */
-						{
-							evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-							data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-							if (data_all == NULL)
-							{
-								IPACMERR("Unable to allocate memory\n");
-								return;
-							}
-							data_all->iptype = IPA_IP_v4;
-							data_all->if_index = neighbor_client[i].iface_index;
-							data_all->ipv4_addr = neighbor_client[i].v4_addr; //use previous ipv4 address
-							memcpy(data_all->mac_addr,
-									neighbor_client[i].mac_addr,
-												sizeof(data_all->mac_addr));
-							evt_data.evt_data = (void *)data_all;
-							IPACM_EvtDispatcher::PostEvt(&evt_data);
-							/* ask for replaced iface name*/
-							ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
-							/* check for failure return */
-							if (IPACM_FAILURE == ipa_interface_index) {
-								IPACMERR("not supported iface id: %d\n", data_all->if_index);
-							} else {
-								IPACMDBG_H("Posted event %d, with %s for ipv4 client re-connect\n",
-									evt_data.event,
-									IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
-							}
-						}
-					}
-					break;
+				/* check if client associated with previous network interface */
+				if(ipa_interface_index != neighbor_client[slot].ipa_if_num)
+				{
+					IPACMERR("client associate to different AP \n");
+					return;
 				}
+
+				post_client_addrs(slot, IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT);
 			}
 		}
 		break;
@@ -171,398 +359,152 @@ void IPACM_Neighbor::event_callback(ipa_cm_event_id event, void *param)
 				IPACMERR("not supported iface id: %d\n", data->if_index);
 				break;
 			}
-			if (data->iptype == IPA_IP_v4)
+			/* check if iface is bridge interface*/
+			is_bridge = (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name,
+					IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) == 0);
+
+			if ((data->iptype == IPA_IP_v4 && data->ipv4_addr == 0) ||
+				(data->iptype != IPA_IP_v4 && !data->ipv6_addr[0] && !data->ipv6_addr[1] &&
+				 !data->ipv6_addr[2] && !data->ipv6_addr[3]))
 			{
-				if (data->ipv4_addr != 0) /* not 0.0.0.0 */
+				if (data->iptype == IPA_IP_v4)
 				{
-					IPACMDBG("Got Neighbor event with ipv4 address: 0x%x \n", data->ipv4_addr);
-					/* check if ipv4 address is link local(169.254.xxx.xxx) */
-					if ((data->ipv4_addr & IPV4_ADDR_LINKLOCAL_MASK) == IPV4_ADDR_LINKLOCAL)
-					{
-						IPACMDBG_H("This is link local ipv4 address: 0x%x : ignore this NEIGH_EVENT\n", data->ipv4_addr);
-						return;
-					}
-					/* check if iface is bridge interface*/
-					if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) == 0)
-					{
-						/* searh if seen this client or not*/
-						for (i = 0; i < num_neighbor_client_temp; i++)
-						{
-							if (memcmp(neighbor_client[i].mac_addr, data->mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
-							{
-								data->if_index = neighbor_client[i].iface_index;
-								neighbor_client[i].v4_addr = data->ipv4_addr; // cache client's previous ipv4 address
-								/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
-								if (event == IPA_NEW_NEIGH_EVENT)
-									evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-								else
-									/* not to clean-up the client mac cache on bridge0 delneigh */
-									evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
-								data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-								if (data_all == NULL)
-								{
-									IPACMERR("Unable to allocate memory\n");
-									return;
-								}
-								memcpy(data_all, data, sizeof(ipacm_event_data_all));
-								evt_data.evt_data = (void *)data_all;
-								IPACM_EvtDispatcher::PostEvt(&evt_data);
-
-								/* ask for replaced iface name*/
-								ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
-								/* check for failure return */
-								if (IPACM_FAILURE == ipa_interface_index) {
-									IPACMERR("not supported iface id: %d\n", data_all->if_index);
-								} else {
-									IPACMDBG_H("Posted event %d,\
-										with %s for ipv4\n",
-										evt_data.event,
-										IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
-								}
-								break;
-							}
-						}
-					}
-					else
+					/* ipv4 event without address, nothing to do */
+					break;
+				}
+				IPACMDBG(" Got Neighbor event with no ipv6/ipv4 address \n");
+				slot = find_client(data->mac_addr);
+				if (slot != IPA_NEIGHBOR_NONE)
+				{
+					IPACMDBG_H(" find %d-st client, MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
+							slot,
+							data->mac_addr[0], data->mac_addr[1], data->mac_addr[2],
+							data->mac_addr[3], data->mac_addr[4], data->mac_addr[5],
+							num_neighbor_client);
+					if (!is_bridge)
 					{
-						/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
-						if (event == IPA_NEW_NEIGH_EVENT)
-						{
-							evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-							/* Also save to cache for ipv4 */
-							/*searh if seen this client or not*/
-							for (i = 0; i < num_neighbor_client_temp; i++)
-							{
-								/* find the client */
-								if (memcmp(neighbor_client[i].mac_addr, data->mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
-								{
-									/* update the network interface client associated */
-									neighbor_client[i].iface_index = data->if_index;
-									neighbor_client[i].ipa_if_num = ipa_interface_index;
-									neighbor_client[i].v4_addr = data->ipv4_addr; // cache client's previous ipv4 address
-									IPACMDBG_H("update cache %d-entry, with %s iface, ipv4 address: 0x%x\n",
-													i,
-													IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name,
-													data->ipv4_addr);
-									break;
-								}
-							}
-							/* not find client */
-							if (i == num_neighbor_client_temp)
-							{
-								if (num_neighbor_client_temp < IPA_MAX_NUM_NEIGHBOR_CLIENTS)
-								{
-									memcpy(neighbor_client[num_neighbor_client_temp].mac_addr,
-												data->mac_addr,
-												sizeof(data->mac_addr));
-									neighbor_client[num_neighbor_client_temp].iface_index = data->if_index;
-									/* cache the network interface client associated */
-									neighbor_client[num_neighbor_client_temp].ipa_if_num = ipa_interface_index;
-									neighbor_client[num_neighbor_client_temp].v4_addr = data->ipv4_addr;
-									num_neighbor_client++;
-									IPACMDBG_H("Cache client MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
-												neighbor_client[num_neighbor_client_temp].mac_addr[0],
-												neighbor_client[num_neighbor_client_temp].mac_addr[1],
-												neighbor_client[num_neighbor_client_temp].mac_addr[2],
-												neighbor_client[num_neighbor_client_temp].mac_addr[3],
-												neighbor_client[num_neighbor_client_temp].mac_addr[4],
-												neighbor_client[num_neighbor_client_temp].mac_addr[5],
-												num_neighbor_client);
-								}
-								else
-								{
-
-									IPACMERR("error:  neighbor client oversize! recycle %d-st entry ! \n", circular_index);
-									memcpy(neighbor_client[circular_index].mac_addr,
-												data->mac_addr,
-												sizeof(data->mac_addr));
-									neighbor_client[circular_index].iface_index = data->if_index;
-									/* cache the network interface client associated */
-									neighbor_client[circular_index].ipa_if_num = ipa_interface_index;
-									neighbor_client[circular_index].v4_addr = 0;
-									IPACMDBG_H("Copy wlan-iface client MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d, circular %d\n",
-													neighbor_client[circular_index].mac_addr[0],
-													neighbor_client[circular_index].mac_addr[1],
-													neighbor_client[circular_index].mac_addr[2],
-													neighbor_client[circular_index].mac_addr[3],
-													neighbor_client[circular_index].mac_addr[4],
-													neighbor_client[circular_index].mac_addr[5],
-													num_neighbor_client,
-													circular_index);
-									circular_index++;
-								}
-							}
-						}
-						else
+						/* use previous ipv4 first */
+						if(data->if_index != neighbor_client[slot].iface_index)
 						{
-							evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
-							/*searh if seen this client or not*/
-							for (i = 0; i < num_neighbor_client_temp; i++)
-							{
-								/* find the client */
-								if (memcmp(neighbor_client[i].mac_addr, data->mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
-								{
-									IPACMDBG_H("Clean %d-st Cached client-MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
-												i,
-												neighbor_client[i].mac_addr[0],
-												neighbor_client[i].mac_addr[1],
-												neighbor_client[i].mac_addr[2],
-												neighbor_client[i].mac_addr[3],
-												neighbor_client[i].mac_addr[4],
-												neighbor_client[i].mac_addr[5],
-												num_neighbor_client);
-
-									memset(neighbor_client[i].mac_addr, 0, sizeof(neighbor_client[i].mac_addr));
-									neighbor_client[i].iface_index = 0;
-									neighbor_client[i].v4_addr = 0;
-									neighbor_client[i].ipa_if_num = 0;
-									for (; i < num_neighbor_client_temp - 1; i++)
-									{
-										memcpy(neighbor_client[i].mac_addr,
-													neighbor_client[i+1].mac_addr,
-													sizeof(neighbor_client[i].mac_addr));
-										neighbor_client[i].iface_index = neighbor_client[i+1].iface_index;
-										neighbor_client[i].v4_addr = neighbor_client[i+1].v4_addr;
-										neighbor_client[i].ipa_if_num = neighbor_client[i+1].ipa_if_num;
-									}
-									num_neighbor_client--;
-									IPACMDBG_H(" total number of left cased clients: %d\n", num_neighbor_client);
-									break;
-								}
-							}
-							/* not find client, no need clean-up */
+							IPACMDBG_H("update new kernel iface index \n");
+							neighbor_client[slot].iface_index = data->if_index;
 						}
 
-						data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-						if (data_all == NULL)
+						/* check if client associated with previous network interface */
+						if(ipa_interface_index != neighbor_client[slot].ipa_if_num)
 						{
-							IPACMERR("Unable to allocate memory\n");
-							return;
+							IPACMDBG_H("client associate to different AP \n");
 						}
-						memcpy(data_all, data, sizeof(ipacm_event_data_all));
-						evt_data.evt_data = (void *)data_all;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
-						IPACMDBG_H("Posted event %d with %s for ipv4\n",
-									evt_data.event,
-									IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
+
+						post_client_addrs(slot, (event == IPA_NEW_NEIGH_EVENT) ?
+							IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT : IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT);
+					}
+					/* delete cache neighbor entry */
+					if (event == IPA_DEL_NEIGH_EVENT)
+					{
+						del_client(slot);
+						IPACMDBG_H(" total number of left cased clients: %d\n", num_neighbor_client);
 					}
 				}
+				else if (event == IPA_NEW_NEIGH_EVENT && !is_bridge)
+				{
+					add_client(data->mac_addr, data->if_index, ipa_interface_index);
+				}
+				break;
+			}
+
+			if (data->iptype == IPA_IP_v4)
+			{
+				IPACMDBG("Got Neighbor event with ipv4 address: 0x%x \n", data->ipv4_addr);
+				/* check if ipv4 address is link local(169.254.xxx.xxx) */
+				if ((data->ipv4_addr & IPV4_ADDR_LINKLOCAL_MASK) == IPV4_ADDR_LINKLOCAL)
+				{
+					IPACMDBG_H("This is link local ipv4 address: 0x%x : ignore this NEIGH_EVENT\n", data->ipv4_addr);
+					return;
+				}
 			}
 			else
-			{   //ipv6 starts
+			{
+				IPACMDBG("Got New_Neighbor event with ipv6 address \n");
+			}
 
-				if ((data->ipv6_addr[0]) || (data->ipv6_addr[1]) || (data->ipv6_addr[2]) || (data->ipv6_addr[3]))
+			slot = find_client(data->mac_addr);
+			if (is_bridge)
+			{
+				/* only clients seen on a lan iface can be mapped back */
+				if (slot == IPA_NEIGHBOR_NONE)
+				{
+					break;
+				}
+				data->if_index = neighbor_client[slot].iface_index;
+				if (data->iptype == IPA_IP_v4)
+				{
+					neighbor_client[slot].v4_addr = data->ipv4_addr; // cache client's previous ipv4 address
+				}
+				/* not to clean-up the client mac cache on bridge0 delneigh */
+			}
+			else if (event == IPA_NEW_NEIGH_EVENT)
+			{
+				if (slot == IPA_NEIGHBOR_NONE)
 				{
-					IPACMDBG("Got New_Neighbor event with ipv6 address \n");
-					/* check if iface is bridge interface*/
-					if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) == 0)
+					slot = add_client(data->mac_addr, data->if_index, ipa_interface_index);
+				}
+				if (slot != IPA_NEIGHBOR_NONE)
+				{
+					/* update the network interface client associated */
+					neighbor_client[slot].iface_index = data->if_index;
+					neighbor_client[slot].ipa_if_num = ipa_interface_index;
+					if (data->iptype == IPA_IP_v4)
 					{
-						/* searh if seen this client or not*/
-						for (i = 0; i < num_neighbor_client_temp; i++)
-						{
-							if (memcmp(neighbor_client[i].mac_addr, data->mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
-							{
-								data->if_index = neighbor_client[i].iface_index;
-								/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
-								if (event == IPA_NEW_NEIGH_EVENT) evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-								else evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
-								data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-								if (data_all == NULL)
-								{
-									IPACMERR("Unable to allocate memory\n");
-									return;
-								}
-								memcpy(data_all, data, sizeof(ipacm_event_data_all));
-								evt_data.evt_data = (void *)data_all;
-								IPACM_EvtDispatcher::PostEvt(&evt_data);
-								/* ask for replaced iface name*/
-								ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
-								/* check for failure return */
-								if (IPACM_FAILURE == ipa_interface_index) {
-									IPACMERR("not supported iface id: %d\n", data_all->if_index);
-								} else {
-									IPACMDBG_H("Posted event %d,\
-										with %s for ipv6\n",
-										evt_data.event,
-										IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
-								}
-								break;
-							};
-						}
+						neighbor_client[slot].v4_addr = data->ipv4_addr; // cache client's previous ipv4 address
 					}
 					else
 					{
-						/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
-						if (event == IPA_NEW_NEIGH_EVENT)
-							evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-						else
-							evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
-						data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-						if (data_all == NULL)
-						{
-							IPACMERR("Unable to allocate memory\n");
-							return;
-						}
-						memcpy(data_all, data, sizeof(ipacm_event_data_all));
-						evt_data.evt_data = (void *)data_all;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
-						IPACMDBG_H("Posted event %d with %s for ipv6\n",
-										evt_data.event,
-										IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
+						add_client_ipv6(slot, data->ipv6_addr);
 					}
+					IPACMDBG_H("update cache %d-entry, with %s iface\n", slot,
+							IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
+				}
+			}
+			else if (slot != IPA_NEIGHBOR_NONE)
+			{
+				if (data->iptype == IPA_IP_v4)
+				{
+					del_client(slot);
+					IPACMDBG_H(" total number of left cased clients: %d\n", num_neighbor_client);
 				}
 				else
 				{
-					IPACMDBG(" Got Neighbor event with no ipv6/ipv4 address \n");
-					/*no ipv6 in data searh if seen this client or not*/
-					for (i = 0; i < num_neighbor_client_temp; i++)
-					{
-						/* find the client */
-						if (memcmp(neighbor_client[i].mac_addr, data->mac_addr, sizeof(neighbor_client[i].mac_addr)) == 0)
-						{
-							IPACMDBG_H(" find %d-st client, MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
-												i,
-												neighbor_client[i].mac_addr[0],
-												neighbor_client[i].mac_addr[1],
-												neighbor_client[i].mac_addr[2],
-												neighbor_client[i].mac_addr[3],
-												neighbor_client[i].mac_addr[4],
-												neighbor_client[i].mac_addr[5],
-												num_neighbor_client);
-							/* check if iface is not bridge interface*/
-							if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) != 0)
-							{
-								/* use previous ipv4 first */
-								if(data->if_index != neighbor_client[i].iface_index)
-								{
-									IPACMDBG_H("update new kernel iface index \n");
-									neighbor_client[i].iface_index = data->if_index;
-								}
-
-								/* check if client associated with previous network interface */
-								if(ipa_interface_index != neighbor_client[i].ipa_if_num)
-								{
-									IPACMDBG_H("client associate to different AP \n");
-								}
-
-								if (neighbor_client[i].v4_addr != 0) /* not 0.0.0.0 */
-								{
-									/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
-									if (event == IPA_NEW_NEIGH_EVENT)
-										evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
-									else
-										evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
-									data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
-									if (data_all == NULL)
-									{
-										IPACMERR("Unable to allocate memory\n");
-										return;
-									}
-									data_all->iptype = IPA_IP_v4;
-									data_all->if_index = neighbor_client[i].iface_index;
-									data_all->ipv4_addr = neighbor_client[i].v4_addr; //use previous ipv4 address
-									memcpy(data_all->mac_addr,
-											neighbor_client[i].mac_addr,
-														sizeof(data_all->mac_addr));
-									evt_data.evt_data = (void *)data_all;
-									IPACM_EvtDispatcher::PostEvt(&evt_data);
-									/* ask for replaced iface name*/
-									ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
-									/* check for failure return */
-									if (IPACM_FAILURE == ipa_interface_index) {
-										IPACMERR("not supported iface id: %d\n", data_all->if_index);
-									} else {
-										IPACMDBG_H("Posted event %d,\
-											with %s for ipv4 client re-connect\n",
-											evt_data.event,
-											IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name);
-									}
-								}
-							}
-							/* delete cache neighbor entry */
-							if (event == IPA_DEL_NEIGH_EVENT)
-							{
-								IPACMDBG_H("Clean %d-st Cached client-MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
-										i,
-										neighbor_client[i].mac_addr[0],
-										neighbor_client[i].mac_addr[1],
-										neighbor_client[i].mac_addr[2],
-										neighbor_client[i].mac_addr[3],
-										neighbor_client[i].mac_addr[4],
-										neighbor_client[i].mac_addr[5],
-										num_neighbor_client);
-
-								memset(neighbor_client[i].mac_addr, 0, sizeof(neighbor_client[i].mac_addr));
-								neighbor_client[i].iface_index = 0;
-								neighbor_client[i].v4_addr = 0;
-								neighbor_client[i].ipa_if_num = 0;
-								for (; i < num_neighbor_client_temp - 1; i++)
-								{
-									memcpy(neighbor_client[i].mac_addr,
-												neighbor_client[i+1].mac_addr,
-												sizeof(neighbor_client[i].mac_addr));
-									neighbor_client[i].iface_index = neighbor_client[i+1].iface_index;
-									neighbor_client[i].v4_addr = neighbor_client[i+1].v4_addr;
-									neighbor_client[i].ipa_if_num = neighbor_client[i+1].ipa_if_num;
-								}
-								num_neighbor_client--;
-								IPACMDBG_H(" total number of left cased clients: %d\n", num_neighbor_client);
-							}
-							break;
-						}
-					}
-					/* not find client */
-					if ((i == num_neighbor_client_temp) && (event == IPA_NEW_NEIGH_EVENT))
-					{
-						/* check if iface is not bridge interface*/
-						if (strcmp(IPACM_Iface::ipacmcfg->ipa_virtual_iface_name, IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name) != 0)
-						{
-							if (num_neighbor_client_temp < IPA_MAX_NUM_NEIGHBOR_CLIENTS)
-							{
-								memcpy(neighbor_client[num_neighbor_client_temp].mac_addr,
-											data->mac_addr,
-											sizeof(data->mac_addr));
-								neighbor_client[num_neighbor_client_temp].iface_index = data->if_index;
-								/* cache the network interface client associated */
-								neighbor_client[num_neighbor_client_temp].ipa_if_num = ipa_interface_index;
-								neighbor_client[num_neighbor_client_temp].v4_addr = 0;
-								num_neighbor_client++;
-								IPACMDBG_H("Copy client MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d\n",
-												neighbor_client[num_neighbor_client_temp].mac_addr[0],
-												neighbor_client[num_neighbor_client_temp].mac_addr[1],
-												neighbor_client[num_neighbor_client_temp].mac_addr[2],
-												neighbor_client[num_neighbor_client_temp].mac_addr[3],
-												neighbor_client[num_neighbor_client_temp].mac_addr[4],
-												neighbor_client[num_neighbor_client_temp].mac_addr[5],
-												num_neighbor_client);
-								return;
-							}
-							else
-							{
-								IPACMERR("error:  neighbor client oversize! recycle %d-st entry ! \n", circular_index);
-								memcpy(neighbor_client[circular_index].mac_addr,
-											data->mac_addr,
-											sizeof(data->mac_addr));
-								neighbor_client[circular_index].iface_index = data->if_index;
-								/* cache the network interface client associated */
-								neighbor_client[circular_index].ipa_if_num = ipa_interface_index;
-								neighbor_client[circular_index].v4_addr = 0;
-								IPACMDBG_H("Copy wlan-iface client MAC %02x:%02x:%02x:%02x:%02x:%02x\n, total client: %d, circular %d\n",
-												neighbor_client[circular_index].mac_addr[0],
-												neighbor_client[circular_index].mac_addr[1],
-												neighbor_client[circular_index].mac_addr[2],
-												neighbor_client[circular_index].mac_addr[3],
-												neighbor_client[circular_index].mac_addr[4],
-												neighbor_client[circular_index].mac_addr[5],
-												num_neighbor_client,
-												circular_index);
-								circular_index++;
-								return;
-							}
-						}
-					}
+					del_client_ipv6(slot, data->ipv6_addr);
 				}
-			} //ipv6 ends
+			}
+
+			/* construct IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT command and insert to command-queue */
+			if (event == IPA_NEW_NEIGH_EVENT)
+				evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_ADD_EVENT;
+			else
+				evt_data.event = IPA_NEIGH_CLIENT_IP_ADDR_DEL_EVENT;
+			data_all = (ipacm_event_data_all *)malloc(sizeof(ipacm_event_data_all));
+			if (data_all == NULL)
+			{
+				IPACMERR("Unable to allocate memory\n");
+				return;
+			}
+			memcpy(data_all, data, sizeof(ipacm_event_data_all));
+			evt_data.evt_data = (void *)data_all;
+			IPACM_EvtDispatcher::PostEvt(&evt_data);
+
+			/* ask for replaced iface name*/
+			ipa_interface_index = IPACM_Iface::iface_ipa_index_query(data_all->if_index);
+			/* check for failure return */
+			if (IPACM_FAILURE == ipa_interface_index) {
+				IPACMERR("not supported iface id: %d\n", data_all->if_index);
+			} else {
+				IPACMDBG_H("Posted event %d with %s for %s\n",
+					evt_data.event,
+					IPACM_Iface::ipacmcfg->iface_table[ipa_interface_index].iface_name,
+					(data_all->iptype == IPA_IP_v4) ? "ipv4" : "ipv6");
+			}
 		}
 		break;
 	}
@@ -40,16 +40,37 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
 #include "IPACM_CmdQueue.h"
 #include "IPACM_Defs.h"
 #include "IPACM_Netlink.h"
 #include "IPACM_EvtDispatcher.h"
+#include "IPACM_Iface.h"
 #include "IPACM_Log.h"
 
 int ipa_get_if_name(char *if_name, int if_index);
 int find_mask(int ip_v4_last, int *mask_value);
 
+/* Receive buffers of the netlink thread, reused for every batch */
+typedef struct
+{
+	struct mmsghdr msgs[IPA_NL_RX_BATCH];
+	struct iovec iov[IPA_NL_RX_BATCH];
+	struct sockaddr_nl addr[IPA_NL_RX_BATCH];
+	char buf[IPA_NL_RX_BATCH][IPA_NL_MSG_MAX_LEN] __attribute__((aligned(NLMSG_ALIGNTO)));
+	bool ready;
+} ipa_nl_rx_ring_t;
+
+static ipa_nl_rx_ring_t ipa_nl_rx;
+static ipa_nl_msg_t ipa_nl_msg;
+
+/* Events decoded from the current batch, not posted yet */
+static ipacm_cmd_q_data ipa_nl_evts[IPA_NL_EVT_BATCH];
+static int ipa_nl_evt_cnt = 0;
+
+static void ipa_nl_post_evt(ipacm_cmd_q_data *evt_data);
+
 #ifdef FEATURE_IPA_ANDROID
 
 #define IPACM_NL_COPY_ADDR( event_info, element )                                        \
@@ -181,16 +202,12 @@ static int ipa_nl_addfd_map
 {
 	if(info->num_fd < MAX_NUM_OF_FD)
 	{
-		FD_SET(fd, &info->fdset);
-
 		/* Add fd to fdmap array and store read handler function ptr */
 		info->sk_fds[info->num_fd].sk_fd = fd;
 		info->sk_fds[info->num_fd].read_func = read_f;
 
 		/* Increment number of fds stored in fdmap */
 		info->num_fd++;
-		if(info->max_fd < fd)
-			info->max_fd = fd;
 	}
 	else
 	{
@@ -206,214 +223,169 @@ static int ipa_nl_sock_listener_start
 	 ipa_nl_sk_fd_set_info_t *sk_fd_set
 	 )
 {
-	int i, ret;
+	struct epoll_event ev, events[MAX_NUM_OF_FD];
+	int i, num, ret;
 
-	while(true)
+	sk_fd_set->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(sk_fd_set->epoll_fd < 0)
 	{
-	    for(i = 0; i < sk_fd_set->num_fd; i++ )
+		PERROR("ipa_nl epoll_create1 failed");
+		return IPACM_FAILURE;
+	}
+
+	for(i = 0; i < sk_fd_set->num_fd; i++)
+	{
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		if(epoll_ctl(sk_fd_set->epoll_fd, EPOLL_CTL_ADD, sk_fd_set->sk_fds[i].sk_fd, &ev) < 0)
 		{
-			FD_SET(sk_fd_set->sk_fds[i].sk_fd, &(sk_fd_set->fdset));
+			IPACMERR("unable to add fd=%d to epoll\n", sk_fd_set->sk_fds[i].sk_fd);
+			close(sk_fd_set->epoll_fd);
+			return IPACM_FAILURE;
 		}
+	}
 
-		if((ret = select(sk_fd_set->max_fd + 1, &(sk_fd_set->fdset), NULL, NULL, NULL)) < 0)
+	while(true)
+	{
+		num = epoll_wait(sk_fd_set->epoll_fd, events, MAX_NUM_OF_FD, -1);
+		if(num < 0)
 		{
-			IPACMERR("ipa_nl select failed\n");
+			if(errno != EINTR)
+			{
+				IPACMERR("ipa_nl epoll_wait failed\n");
+			}
+			continue;
 		}
-		else
+
+		for(ret = 0; ret < num; ret++)
 		{
-			for(i = 0; i < sk_fd_set->num_fd; i++)
+			i = events[ret].data.u32;
+			if(sk_fd_set->sk_fds[i].read_func)
 			{
-
-				if(FD_ISSET(sk_fd_set->sk_fds[i].sk_fd, &(sk_fd_set->fdset)))
+				if(IPACM_SUCCESS != ((sk_fd_set->sk_fds[i].read_func)(sk_fd_set->sk_fds[i].sk_fd)))
 				{
-
-					if(sk_fd_set->sk_fds[i].read_func)
-					{
-						if(IPACM_SUCCESS != ((sk_fd_set->sk_fds[i].read_func)(sk_fd_set->sk_fds[i].sk_fd)))
-						{
-							IPACMERR("Error on read callback[%d] fd=%d\n",
-											 i,
-											 sk_fd_set->sk_fds[i].sk_fd);
-						}
-						FD_CLR(sk_fd_set->sk_fds[i].sk_fd, &(sk_fd_set->fdset));
-					}
-					else
-					{
-						IPACMERR("No read function\n");
-					}
+					IPACMERR("Error on read callback[%d] fd=%d\n",
+									 i,
+									 sk_fd_set->sk_fds[i].sk_fd);
 				}
-
-			} /* end of for loop*/
-		} /* end of else */
+			}
+			else
+			{
+				IPACMERR("No read function\n");
+			}
+		} /* end of for loop*/
 	} /* end of while */
 
 	return IPACM_SUCCESS;
 }
 
-/* allocate memory for ipa_nl__msg */
-static struct msghdr* ipa_nl_alloc_msg
-(
-	 uint32_t msglen
-	 )
+/* Set up the receive ring once, recvmmsg() only updates the lengths */
+static void ipa_nl_rx_ring_init(void)
 {
-	unsigned char *buf = NULL;
-	struct sockaddr_nl *nladdr = NULL;
-	struct iovec *iov = NULL;
-	struct msghdr *msgh = NULL;
-
-	if(IPA_NL_MSG_MAX_LEN < msglen)
-	{
-		IPACMERR("Netlink message exceeds maximum length\n");
-		return NULL;
-	}
-
-	msgh = (struct msghdr *)malloc(sizeof(struct msghdr));
-	if(msgh == NULL)
-	{
-		IPACMERR("Failed malloc for msghdr\n");
-		return NULL;
-	}
+	int cnt;
 
-	nladdr = (struct sockaddr_nl *)malloc(sizeof(struct sockaddr_nl));
-	if(nladdr == NULL)
+	memset(&ipa_nl_rx, 0, sizeof(ipa_nl_rx));
+	for(cnt = 0; cnt < IPA_NL_RX_BATCH; cnt++)
 	{
-		IPACMERR("Failed malloc for sockaddr\n");
-		free(msgh);
-		return NULL;
+		ipa_nl_rx.iov[cnt].iov_base = ipa_nl_rx.buf[cnt];
+		ipa_nl_rx.iov[cnt].iov_len = IPA_NL_MSG_MAX_LEN;
+		ipa_nl_rx.msgs[cnt].msg_hdr.msg_name = &ipa_nl_rx.addr[cnt];
+		ipa_nl_rx.msgs[cnt].msg_hdr.msg_iov = &ipa_nl_rx.iov[cnt];
+		ipa_nl_rx.msgs[cnt].msg_hdr.msg_iovlen = 1;
 	}
-
-	iov = (struct iovec *)malloc(sizeof(struct iovec));
-	if(iov == NULL)
-	{
-		PERROR("Failed malloc for iovec");
-		free(nladdr);
-		free(msgh);
-		return NULL;
-	}
-
-	buf = (unsigned char *)malloc(msglen);
-	if(buf == NULL)
-	{
-		IPACMERR("Failed malloc for mglen\n");
-		free(iov);
-		free(nladdr);
-		free(msgh);
-		return NULL;
-	}
-
-	memset(nladdr, 0, sizeof(struct sockaddr_nl));
-	nladdr->nl_family = AF_NETLINK;
-
-	memset(msgh, 0x0, sizeof(struct msghdr));
-	msgh->msg_name = nladdr;
-	msgh->msg_namelen = sizeof(struct sockaddr_nl);
-	msgh->msg_iov = iov;
-	msgh->msg_iovlen = 1;
-
-	memset(iov, 0x0, sizeof(struct iovec));
-	iov->iov_base = buf;
-	iov->iov_len = msglen;
-
-	return msgh;
+	ipa_nl_rx.ready = true;
 }
 
-/* release IPA message */
-static void ipa_nl_release_msg
-(
-	 struct msghdr *msgh
-	 )
+/* Neighbor and address events are coalesced, the others are barriers */
+static int ipa_nl_evt_class(const ipacm_cmd_q_data *evt_data, size_t *len)
 {
-	unsigned char *buf = NULL;
-	struct sockaddr_nl *nladdr = NULL;
-	struct iovec *iov = NULL;
-
-	if(NULL == msgh)
+	switch(evt_data->event)
 	{
-		return;
+	case IPA_NEW_NEIGH_EVENT:
+	case IPA_DEL_NEIGH_EVENT:
+		*len = sizeof(ipacm_event_data_all);
+		return 1;
+	case IPA_ADDR_ADD_EVENT:
+		*len = sizeof(ipacm_event_data_addr);
+		return 2;
+	default:
+		*len = 0;
+		return 0;
 	}
+}
 
-	nladdr = (struct sockaddr_nl *)msgh->msg_name;
-	iov = msgh->msg_iov;
-	if(msgh->msg_iov)
+/* Same neighbor or same address, whatever the event says about it */
+static bool ipa_nl_evt_same_key(int evt_class, const void *data1, const void *data2)
+{
+	if(evt_class == 1)
 	{
-		buf = (unsigned char *)msgh->msg_iov->iov_base;
-	}
+		const ipacm_event_data_all *a = (const ipacm_event_data_all *)data1;
+		const ipacm_event_data_all *b = (const ipacm_event_data_all *)data2;
 
-	if(buf)
-	{
-	free(buf);
-	}
-	if(iov)
-	{
-	free(iov);
+		return a->if_index == b->if_index && a->iptype == b->iptype &&
+			a->ipv4_addr == b->ipv4_addr &&
+			memcmp(a->ipv6_addr, b->ipv6_addr, sizeof(a->ipv6_addr)) == 0;
 	}
-	if(nladdr)
-	{
-	free(nladdr);
-	}
-	if(msgh)
+	else
 	{
-	free(msgh);
+		const ipacm_event_data_addr *a = (const ipacm_event_data_addr *)data1;
+		const ipacm_event_data_addr *b = (const ipacm_event_data_addr *)data2;
+
+		return a->if_index == b->if_index && a->iptype == b->iptype &&
+			a->ipv4_addr == b->ipv4_addr &&
+			memcmp(a->ipv6_addr, b->ipv6_addr, sizeof(a->ipv6_addr)) == 0;
 	}
-	return;
 }
 
-/* receive and process nl message */
-static int ipa_nl_recv
-(
-	 int              fd,
-	 struct msghdr **msg_pptr,
-	 unsigned int  *msglen_ptr
-	 )
+static void ipa_nl_flush_evts(void)
 {
-	struct msghdr *msgh = NULL;
-	int rmsgl;
+	int cnt;
 
-	msgh = ipa_nl_alloc_msg(IPA_NL_MSG_MAX_LEN);
-	if(NULL == msgh)
+	for(cnt = 0; cnt < ipa_nl_evt_cnt; cnt++)
 	{
-		IPACMERR("Failed to allocate NL message\n");
-		goto error;
+		if(IPACM_EvtDispatcher::PostEvt(&ipa_nl_evts[cnt]) != IPACM_SUCCESS)
+		{
+			free(ipa_nl_evts[cnt].evt_data);
+		}
 	}
+	ipa_nl_evt_cnt = 0;
+}
 
+/* Holds the event until the end of the receive batch. An event
+   repeating the last one pending for the same neighbor or address,
+   with nothing else posted in between, is dropped */
+static void ipa_nl_post_evt(ipacm_cmd_q_data *evt_data)
+{
+	size_t len, prev_len;
+	int evt_class, cnt;
 
-	/* Receive message over the socket */
-	rmsgl = recvmsg(fd, msgh, 0);
-
-	/* Verify that something was read */
-	if(rmsgl <= 0)
-	{
-		PERROR("NL recv error");
-		goto error;
-	}
-
-	/* Verify that NL address length in the received message is expected value */
-	if(sizeof(struct sockaddr_nl) != msgh->msg_namelen)
+	evt_class = ipa_nl_evt_class(evt_data, &len);
+	for(cnt = ipa_nl_evt_cnt - 1; evt_class != 0 && cnt >= 0; cnt--)
 	{
-		IPACMERR("rcvd msg with namelen != sizeof sockaddr_nl\n");
-		goto error;
+		if(ipa_nl_evt_class(&ipa_nl_evts[cnt], &prev_len) != evt_class)
+		{
+			break;
+		}
+		if(!ipa_nl_evt_same_key(evt_class, ipa_nl_evts[cnt].evt_data, evt_data->evt_data))
+		{
+			continue;
+		}
+		if(ipa_nl_evts[cnt].event == evt_data->event &&
+			 memcmp(ipa_nl_evts[cnt].evt_data, evt_data->evt_data, len) == 0)
+		{
+			IPACMDBG("Coalesced duplicate netlink event %d\n", evt_data->event);
+			free(evt_data->evt_data);
+			return;
+		}
+		break;
 	}
 
-	/* Verify that message was not truncated. This should not occur */
-	if(msgh->msg_flags & MSG_TRUNC)
+	if(ipa_nl_evt_cnt == IPA_NL_EVT_BATCH)
 	{
-		IPACMERR("Rcvd msg truncated!\n");
-		goto error;
+		ipa_nl_flush_evts();
 	}
-
-	*msg_pptr    = msgh;
-	*msglen_ptr = rmsgl;
-
-	return IPACM_SUCCESS;
-
-/* An error occurred while receiving the message. Free all memory before
-				 returning. */
-error:
-	ipa_nl_release_msg(msgh);
-	*msg_pptr    = NULL;
-	*msglen_ptr  = 0;
-
-	return IPACM_FAILURE;
+	ipa_nl_evts[ipa_nl_evt_cnt++] = *evt_data;
 }
 
 /* decode the rtm netlink message */
@@ -424,13 +396,34 @@ static int ipa_nl_decode_rtm_link
 	 ipa_nl_link_info_t      *link_info
 )
 {
-	struct rtattr;
 	/* NL message header */
 	struct nlmsghdr *nlh = (struct nlmsghdr *)buffer;
+	struct rtattr *rtah = NULL;
 
 	/* Extract the header data */
 	link_info->metainfo = *(struct ifinfomsg *)NLMSG_DATA(nlh);
-	buflen -= sizeof(struct nlmsghdr);
+	buflen = IFLA_PAYLOAD(nlh);
+
+	/* Extract the available attributes */
+	memset(link_info->ifname, 0, sizeof(link_info->ifname));
+
+	rtah = IFLA_RTA(NLMSG_DATA(nlh));
+
+	while(RTA_OK(rtah, buflen))
+	{
+		switch(rtah->rta_type)
+		{
+
+		case IFLA_IFNAME:
+			strlcpy(link_info->ifname, (char *)RTA_DATA(rtah), sizeof(link_info->ifname));
+			break;
+		default:
+			break;
+
+		}
+		/* Advance to next attribute */
+		rtah = RTA_NEXT(rtah, buflen);
+	}
 
 	return IPACM_SUCCESS;
 }
@@ -448,7 +441,7 @@ static int ipa_nl_decode_rtm_addr
 
 	/* Extract the header data */
 	addr_info->metainfo = *((struct ifaddrmsg *)NLMSG_DATA(nlh));
-	buflen -= sizeof(struct nlmsghdr);
+	buflen = IFA_PAYLOAD(nlh);
 
 	/* Extract the available attributes */
 	addr_info->attr_info.param_mask = IPA_NLA_PARAM_NONE;
@@ -489,7 +482,7 @@ static int ipa_nl_decode_rtm_neigh
 
 	/* Extract the header data */
 	neigh_info->metainfo = *((struct ndmsg *)NLMSG_DATA(nlh));
-	buflen -= sizeof(struct nlmsghdr);
+	buflen = NLMSG_PAYLOAD(nlh, sizeof(struct ndmsg));
 
 	/* Extract the available attributes */
 	neigh_info->attr_info.param_mask = IPA_NLA_PARAM_NONE;
@@ -537,7 +530,7 @@ static int ipa_nl_decode_rtm_route
 
 	/* Extract the header data */
 	route_info->metainfo = *((struct rtmsg *)NLMSG_DATA(nlh));
-	buflen -= sizeof(struct nlmsghdr);
+	buflen = RTM_PAYLOAD(nlh);
 
 	route_info->attr_info.param_mask = IPA_RTA_PARAM_NONE;
 	rtah = RTM_RTA(NLMSG_DATA(nlh));
@@ -627,7 +620,7 @@ static int ipa_nl_decode_nlmsg
 		case RTM_NEWLINK:
 			msg_ptr->type = nlh->nlmsg_type;
 			msg_ptr->link_event = true;
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_link(buffer, buflen, &(msg_ptr->nl_link_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_link((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_link_info)))
 			{
 				IPACMERR("Failed to decode rtm link message\n");
 				return IPACM_FAILURE;
@@ -639,6 +632,10 @@ static int ipa_nl_decode_nlmsg
 				IPACMDBG("RTM_NEWLINK, ifi_flags:%d\n", msg_ptr->nl_link_info.metainfo.ifi_flags);
 				IPACMDBG("RTM_NEWLINK, ifi_index:%d\n", msg_ptr->nl_link_info.metainfo.ifi_index);
 				IPACMDBG("RTM_NEWLINK, family:%d\n", msg_ptr->nl_link_info.metainfo.ifi_family);
+				/* a new link may now resolve where an earlier lookup failed,
+				   or carry a new name for an ifindex already mapped */
+				IPACM_Iface::iface_ipa_index_invalidate(msg_ptr->nl_link_info.metainfo.ifi_index,
+						msg_ptr->nl_link_info.ifname);
 				/* RTM_NEWLINK event with AF_BRIDGE family should be ignored in Android
 				   but this should be processed in case of MDM for Ehernet interface.
 				*/
@@ -684,7 +681,7 @@ static int ipa_nl_decode_nlmsg
 										 data_fid->if_index);
 					}
 					evt_data.evt_data = data_fid;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 				}
 
 				/* Add IPACM support for ECM plug-in/plug_out */
@@ -719,7 +716,7 @@ static int ipa_nl_decode_nlmsg
 					evt_data.evt_data = data_fid;
 					IPACMDBG_H("Posting usb IPA_LINK_UP_EVENT with if index: %d\n",
 										 data_fid->if_index);
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
                 }
                 else if (!(msg_ptr->nl_link_info.metainfo.ifi_flags & IFF_LOWER_UP))
 				{
@@ -746,7 +743,7 @@ static int ipa_nl_decode_nlmsg
 					evt_data.evt_data = data_fid;
 					IPACMDBG_H("Posting usb IPA_LINK_DOWN_EVENT with if index: %d\n",
 										 data_fid->if_index);
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 				}
 			}
 			break;
@@ -756,7 +753,7 @@ static int ipa_nl_decode_nlmsg
 			msg_ptr->type = nlh->nlmsg_type;
 			msg_ptr->link_event = true;
 			IPACMDBG("entering rtm decode\n");
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_link(buffer, buflen, &(msg_ptr->nl_link_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_link((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_link_info)))
 			{
 				IPACMERR("Failed to decode rtm link message\n");
 				return IPACM_FAILURE;
@@ -800,14 +797,14 @@ static int ipa_nl_decode_nlmsg
 				IPACMDBG_H("posting IPA_LINK_DOWN_EVENT with if idnex:%d\n",
 								 data_fid->if_index);
 				evt_data.evt_data = data_fid;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 				/* finish command queue */
 			}
 			break;
 
 		case RTM_NEWADDR:
 			IPACMDBG("\n GOT RTM_NEWADDR event\n");
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_addr(buffer, buflen, &(msg_ptr->nl_addr_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_addr((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_addr_info)))
 			{
 				IPACMERR("Failed to decode rtm addr message\n");
 				return IPACM_FAILURE;
@@ -827,6 +824,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMERR("unable to allocate memory for event data_addr\n");
 					return IPACM_FAILURE;
 				}
+				memset(data_addr, 0, sizeof(ipacm_event_data_addr));
 
 				if(AF_INET6 == msg_ptr->nl_addr_info.attr_info.prefix_addr.ss_family)
 				{
@@ -865,13 +863,13 @@ static int ipa_nl_decode_nlmsg
 								 data_addr->ipv4_addr);
 				}
 				evt_data.evt_data = data_addr;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 			}
 			break;
 
 		case RTM_NEWROUTE:
 
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_route(buffer, buflen, &(msg_ptr->nl_route_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_route((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_route_info)))
 			{
 				IPACMERR("Failed to decode rtm route message\n");
 				return IPACM_FAILURE;
@@ -928,7 +926,7 @@ static int ipa_nl_decode_nlmsg
 									 data_addr->ipv4_addr,
 									 data_addr->ipv4_addr_mask);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 
 				}
@@ -988,7 +986,7 @@ static int ipa_nl_decode_nlmsg
 						IPACMDBG("Posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 address\n",
 										 data_addr->if_index);
 						evt_data.evt_data = data_addr;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
+						ipa_nl_post_evt(&evt_data);
 						/* finish command queue */
 
 					}
@@ -1023,7 +1021,7 @@ static int ipa_nl_decode_nlmsg
 										 data_addr->ipv4_addr_mask,
 										 data_addr->ipv4_addr_gw);
 						evt_data.evt_data = data_addr;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
+						ipa_nl_post_evt(&evt_data);
 						/* finish command queue */
 					}
 				}
@@ -1100,7 +1098,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG("Posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 addr\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 				if(msg_ptr->nl_route_info.attr_info.param_mask & IPA_RTA_PARAM_GATEWAY)
@@ -1139,14 +1137,14 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG("posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 address\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
 			break;
 
 		case RTM_DELROUTE:
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_route(buffer, buflen, &(msg_ptr->nl_route_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_route((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_route_info)))
 			{
 				IPACMERR("Failed to decode rtm route message\n");
 				return IPACM_FAILURE;
@@ -1193,7 +1191,7 @@ static int ipa_nl_decode_nlmsg
 									 data_addr->ipv4_addr,
 									 data_addr->ipv4_addr_mask);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 				else
@@ -1265,7 +1263,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG_H("Posting IPA_ROUTE_DEL_EVENT with if index:%d\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
@@ -1352,14 +1350,14 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG_H("posting event IPA_ROUTE_DEL_EVENT with if index:%d, ipv4 address\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
 			break;
 
 		case RTM_NEWNEIGH:
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_neigh(buffer, buflen, &(msg_ptr->nl_neigh_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_neigh((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_neigh_info)))
 			{
 				IPACMERR("Failed to decode rtm neighbor message\n");
 				return IPACM_FAILURE;
@@ -1441,12 +1439,12 @@ static int ipa_nl_decode_nlmsg
 		    				 msg_ptr->nl_neigh_info.attr_info.local_addr.ss_family);
 			}
 		    evt_data.evt_data = data_all;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 			break;
 
 		case RTM_DELNEIGH:
-			if(IPACM_SUCCESS != ipa_nl_decode_rtm_neigh(buffer, buflen, &(msg_ptr->nl_neigh_info)))
+			if(IPACM_SUCCESS != ipa_nl_decode_rtm_neigh((const char *)nlh, nlh->nlmsg_len, &(msg_ptr->nl_neigh_info)))
 			{
 				IPACMERR("Failed to decode rtm neighbor message\n");
 				return IPACM_FAILURE;
@@ -1514,7 +1512,7 @@ static int ipa_nl_decode_nlmsg
  		                    data_all->if_index,
 		    				 msg_ptr->nl_neigh_info.attr_info.local_addr.ss_family);
 				evt_data.evt_data = data_all;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 				/* finish command queue */
 			break;
 
@@ -1533,63 +1531,78 @@ static int ipa_nl_decode_nlmsg
 /*  Virtual function registered to receive incoming messages over the NETLINK routing socket*/
 int ipa_nl_recv_msg(int fd)
 {
-	struct msghdr *msghdr = NULL;
-	struct iovec *iov = NULL;
-	unsigned int msglen = 0;
-	ipa_nl_msg_t *nlmsg = NULL;
+	struct msghdr *msgh;
+	int cnt, num, ret = IPACM_SUCCESS;
 
-	nlmsg = (ipa_nl_msg_t *)malloc(sizeof(ipa_nl_msg_t));
-	if(NULL == nlmsg)
+	if(!ipa_nl_rx.ready)
 	{
-		IPACMERR("Failed alloc of nlmsg \n");
-		goto error;
+		ipa_nl_rx_ring_init();
 	}
-	else
+
+	/* Drain the socket, IPA_NL_RX_BATCH datagrams per call */
+	while(true)
 	{
-		if(IPACM_SUCCESS != ipa_nl_recv(fd, &msghdr, &msglen))
+		for(cnt = 0; cnt < IPA_NL_RX_BATCH; cnt++)
 		{
-			IPACMERR("Failed to receive nl message \n");
-			goto error;
+			ipa_nl_rx.msgs[cnt].msg_hdr.msg_namelen = sizeof(struct sockaddr_nl);
 		}
 
-		if(msghdr== NULL)
+		num = recvmmsg(fd, ipa_nl_rx.msgs, IPA_NL_RX_BATCH, MSG_DONTWAIT, NULL);
+		if(num < 0)
 		{
-			IPACMERR(" failed to get msghdr\n");
-			goto error;
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno == ENOBUFS)
+			{
+				IPACMERR("Netlink socket overrun, events were lost\n");
+				continue;
+			}
+			if(errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				PERROR("NL recv error");
+				ret = IPACM_FAILURE;
+			}
+			break;
 		}
 
-		iov = msghdr->msg_iov;
-
-		memset(nlmsg, 0, sizeof(ipa_nl_msg_t));
-		if(IPACM_SUCCESS != ipa_nl_decode_nlmsg((char *)iov->iov_base, msglen, nlmsg))
+		for(cnt = 0; cnt < num; cnt++)
 		{
-			IPACMERR("Failed to decode nl message \n");
-			goto error;
-		}
-		/* Release NetLink message buffer */
-		if(msghdr)
-		{
-			ipa_nl_release_msg(msghdr);
+			msgh = &ipa_nl_rx.msgs[cnt].msg_hdr;
+
+			/* Verify that NL address length in the received message is expected value */
+			if(sizeof(struct sockaddr_nl) != msgh->msg_namelen)
+			{
+				IPACMERR("rcvd msg with namelen != sizeof sockaddr_nl\n");
+				ret = IPACM_FAILURE;
+				continue;
+			}
+
+			/* Verify that message was not truncated. This should not occur */
+			if(msgh->msg_flags & MSG_TRUNC)
+			{
+				IPACMERR("Rcvd msg truncated!\n");
+				ret = IPACM_FAILURE;
+				continue;
+			}
+
+			memset(&ipa_nl_msg, 0, sizeof(ipa_nl_msg_t));
+			if(IPACM_SUCCESS != ipa_nl_decode_nlmsg(ipa_nl_rx.buf[cnt], ipa_nl_rx.msgs[cnt].msg_len, &ipa_nl_msg))
+			{
+				IPACMERR("Failed to decode nl message \n");
+				ret = IPACM_FAILURE;
+			}
 		}
-		if(nlmsg)
+
+		if(num < IPA_NL_RX_BATCH)
 		{
-			free(nlmsg);
+			break;
 		}
 	}
 
-	return IPACM_SUCCESS;
-
-error:
-	if(msghdr)
-	{
-		ipa_nl_release_msg(msghdr);
-	}
-	if(nlmsg)
-	{
-		free(nlmsg);
-	}
-
-	return IPACM_FAILURE;
+	ipa_nl_flush_evts();
+	return ret;
 }
 
 /*  get ipa interface name */
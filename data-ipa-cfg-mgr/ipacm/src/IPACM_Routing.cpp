@@ -48,6 +48,12 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 const char *IPACM_Routing::DEVICE_NAME = "/dev/ipa";
 
+int IPACM_Routing::commit_depth = 0;
+pthread_t IPACM_Routing::commit_owner;
+uint32_t IPACM_Routing::commit_pending[IPA_IP_MAX];
+uint32_t IPACM_Routing::num_commit = 0;
+uint32_t IPACM_Routing::num_commit_saved = 0;
+
 IPACM_Routing::IPACM_Routing()
 {
 	m_fd = open(DEVICE_NAME, O_RDWR);
@@ -96,6 +102,7 @@ bool IPACM_Routing::AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable)
 		return false;
 	}
 
+	DeferCommit(&ruleTable->commit, ruleTable->ip);
 	retval = ioctl(m_fd, IPA_IOC_ADD_RT_RULE, ruleTable);
 	if (retval)
 	{
@@ -112,6 +119,49 @@ bool IPACM_Routing::AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable)
 	return true;
 }
 
+bool IPACM_Routing::AddRoutingRule(IPACM_RtRuleBatch *batch)
+{
+	struct ipa_ioc_add_rt_rule *rt_rule = batch->table();
+	int cnt, num = batch->count();
+	bool res;
+
+	if (num == 0)
+	{
+		return true;
+	}
+
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		batch->rule(cnt)->status = -1;
+		batch->rule(cnt)->rt_rule_hdl = 0;
+	}
+
+	res = AddRoutingRule(rt_rule);
+	for (cnt = 0; cnt < num && res; cnt++)
+	{
+		if (batch->rule(cnt)->status != 0)
+		{
+			IPACMERR("Routing rule %d of batch %p failed with status %d\n", cnt, rt_rule, batch->rule(cnt)->status);
+			res = false;
+		}
+	}
+	if (res)
+	{
+		return true;
+	}
+
+	/* the driver stops at the first bad rule, drop the ones it took */
+	for (cnt = 0; cnt < num; cnt++)
+	{
+		if (batch->rule(cnt)->status == 0 && batch->rule(cnt)->rt_rule_hdl != 0)
+		{
+			DeleteRoutingHdl(batch->rule(cnt)->rt_rule_hdl, rt_rule->ip);
+			batch->rule(cnt)->rt_rule_hdl = 0;
+		}
+	}
+	return false;
+}
+
 bool IPACM_Routing::DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable)
 {
 	int retval = 0;
@@ -124,6 +174,7 @@ bool IPACM_Routing::DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable)
 		IPACMERR("Failed deleting routing rule table %p\n", ruleTable);
 		return false;
 	}
+	CountCommit(ruleTable->commit, ruleTable->ip);
 
 	IPACMDBG_H("Deleted routing rule %p\n", ruleTable);
 	return true;
@@ -132,9 +183,16 @@ bool IPACM_Routing::DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable)
 bool IPACM_Routing::Commit(enum ipa_ip_type ip)
 {
 	int retval = 0;
+	uint8_t commit = 1;
 
 	if (!DeviceNodeIsOpened()) return false;
 
+	DeferCommit(&commit, ip);
+	if (commit == 0)
+	{
+		return true;
+	}
+
 	retval = ioctl(m_fd, IPA_IOC_COMMIT_RT, ip);
 	if (retval)
 	{
@@ -154,6 +212,11 @@ bool IPACM_Routing::Reset(enum ipa_ip_type ip)
 
 	retval = ioctl(m_fd, IPA_IOC_RESET_RT, ip);
 	retval |= ioctl(m_fd, IPA_IOC_COMMIT_RT, ip);
+	if (ip < IPA_IP_MAX)
+	{
+		/* anything deferred went out with the reset */
+		commit_pending[ip] = 0;
+	}
 	if (retval)
 	{
 		IPACMERR("Failed resetting routing block.\n");
@@ -262,6 +325,7 @@ bool IPACM_Routing::ModifyRoutingRule(struct ipa_ioc_mdfy_rt_rule *mdfyRules)
 		IPACMERR("Failed modifying routing rules %p\n", mdfyRules);
 		return false;
 	}
+	CountCommit(mdfyRules->commit, mdfyRules->ip);
 
 	for(cnt=0; cnt<mdfyRules->num_rules; cnt++)
 	{
@@ -274,3 +338,67 @@ bool IPACM_Routing::ModifyRoutingRule(struct ipa_ioc_mdfy_rt_rule *mdfyRules)
 	IPACMDBG_H("Modified routing rules %p\n", mdfyRules);
 	return true;
 }
+
+void IPACM_Routing::BeginDeferredCommit()
+{
+	if (commit_depth++ == 0)
+	{
+		commit_owner = pthread_self();
+	}
+}
+
+void IPACM_Routing::EndDeferredCommit()
+{
+	int ip;
+
+	if (commit_depth == 0 || --commit_depth > 0)
+	{
+		return;
+	}
+
+	for (ip = 0; ip < IPA_IP_MAX; ip++)
+	{
+		if (commit_pending[ip] == 0)
+		{
+			continue;
+		}
+		num_commit_saved += commit_pending[ip] - 1;
+		commit_pending[ip] = 0;
+		Commit((enum ipa_ip_type)ip);
+	}
+	IPACMDBG("routing commits: %u, saved: %u\n", num_commit, num_commit_saved);
+}
+
+/* clear the commit flag of an add while a scope of this thread is open */
+void IPACM_Routing::DeferCommit(uint8_t *commit, enum ipa_ip_type ip)
+{
+	if (*commit == 0)
+	{
+		return;
+	}
+
+	if (commit_depth > 0 && ip < IPA_IP_MAX && pthread_equal(commit_owner, pthread_self()))
+	{
+		*commit = 0;
+		commit_pending[ip]++;
+		return;
+	}
+	num_commit++;
+}
+
+/* deletes and modifies commit at once, so the hw never points at an entry
+   that is gone. That commit also carries the adds deferred for ip so far */
+void IPACM_Routing::CountCommit(uint8_t commit, enum ipa_ip_type ip)
+{
+	if (commit == 0)
+	{
+		return;
+	}
+
+	num_commit++;
+	if (commit_depth > 0 && ip < IPA_IP_MAX && pthread_equal(commit_owner, pthread_self()))
+	{
+		num_commit_saved += commit_pending[ip];
+		commit_pending[ip] = 0;
+	}
+}
@@ -0,0 +1,311 @@
+/* 
+Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The Linux Foundation nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_Stats.cpp
+
+	@brief
+	This file implements the writer side of the mmapped stats region.
+*/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "IPACM_Stats.h"
+#include "IPACM_Log.h"
+#include "IPACM_Defs.h"
+
+/* ndc bandwidth ipatetherstats <ifaceIn> <ifaceOut> */
+/* <in->out_bytes> <in->out_pkts> <out->in_bytes> <out->in_pkts */
+
+#define PIPE_STATS "%s %s %lu %lu %lu %lu"
+#define IPA_PIPE_STATS_FILE_NAME "/data/misc/ipa/tether_stats"
+
+#define NETWORK_STATS "%s %lu %lu %lu %lu"
+#define IPA_NETWORK_STATS_FILE_NAME "/data/misc/ipa/network_stats"
+
+IPACM_Stats *IPACM_Stats::pInstance = NULL;
+
+IPACM_Stats::IPACM_Stats()
+{
+	pthread_condattr_t attr;
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&text_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	region = NULL;
+	memset(text_last, 0, sizeof(text_last));
+	memset(text_pending, 0, sizeof(text_pending));
+	text_thread = false;
+}
+
+IPACM_Stats* IPACM_Stats::GetInstance()
+{
+	if (pInstance == NULL)
+	{
+		pInstance = new IPACM_Stats();
+		IPACMDBG_H("Creating stats region %s\n", IPACM_STATS_FILE_NAME);
+		if (pInstance->map_region() != IPACM_SUCCESS)
+		{
+			IPACMERR("Stats region not mapped, binary stats export disabled\n");
+		}
+	}
+	return pInstance;
+}
+
+/* The region is rebuilt from scratch on every start */
+int IPACM_Stats::map_region(void)
+{
+	void *ptr;
+	int fd;
+
+	fd = open(IPACM_STATS_FILE_NAME, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0)
+	{
+		IPACMERR("Failed to open %s, error is %d - %s\n",
+				IPACM_STATS_FILE_NAME, errno, strerror(errno));
+		return IPACM_FAILURE;
+	}
+	if (ftruncate(fd, sizeof(ipacm_stats_region)) < 0)
+	{
+		IPACMERR("Failed to size %s, error is %d - %s\n",
+				IPACM_STATS_FILE_NAME, errno, strerror(errno));
+		close(fd);
+		return IPACM_FAILURE;
+	}
+	ptr = mmap(NULL, sizeof(ipacm_stats_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED)
+	{
+		IPACMERR("Failed to map %s, error is %d - %s\n",
+				IPACM_STATS_FILE_NAME, errno, strerror(errno));
+		return IPACM_FAILURE;
+	}
+
+	region = (ipacm_stats_region *)ptr;
+	__atomic_store_n(&region->magic, 0, __ATOMIC_RELEASE);
+	memset(region, 0, sizeof(ipacm_stats_region));
+	region->version = IPACM_STATS_VERSION;
+	region->entry_size = sizeof(ipacm_stats_entry);
+	region->max_entries = IPACM_STATS_MAX_ENTRIES;
+	__atomic_store_n(&region->magic, IPACM_STATS_MAGIC, __ATOMIC_RELEASE);
+	return IPACM_SUCCESS;
+}
+
+int IPACM_Stats::find_entry(ipacm_stats_type type, const char *name, const char *upstream, uint16_t mux_id)
+{
+	ipacm_stats_entry *e;
+	uint32_t i;
+
+	for (i = 0; i < region->num_entries; i++)
+	{
+		e = &region->entries[i];
+		if (e->type == type && e->mux_id == mux_id &&
+				strncmp(e->name, name, sizeof(e->name)) == 0 &&
+				strncmp(e->upstream, upstream, sizeof(e->upstream)) == 0)
+		{
+			return i;
+		}
+	}
+
+	if (region->num_entries >= IPACM_STATS_MAX_ENTRIES)
+	{
+		IPACMERR("Stats region full, no entry for %s\n", name);
+		return IPACM_FAILURE;
+	}
+
+	/* fill the entry before publishing it through num_entries */
+	e = &region->entries[i];
+	e->type = type;
+	e->mux_id = mux_id;
+	strlcpy(e->name, name, sizeof(e->name));
+	strlcpy(e->upstream, upstream, sizeof(e->upstream));
+	__atomic_store_n(&region->num_entries, i + 1, __ATOMIC_RELEASE);
+	IPACMDBG_H("Stats entry %d for %s/%s mux %d\n", i, name, upstream, mux_id);
+	return i;
+}
+
+/* Called with lock held */
+void IPACM_Stats::write_text(const ipacm_stats_entry *e)
+{
+	FILE *fp = NULL;
+
+	if (e->type == IPACM_STATS_TYPE_IFACE)
+	{
+		fp = fopen(IPA_PIPE_STATS_FILE_NAME, "w");
+		if (fp == NULL)
+		{
+			IPACMERR("Failed to write pipe stats to %s, error is %d - %s\n",
+					IPA_PIPE_STATS_FILE_NAME, errno, strerror(errno));
+			return;
+		}
+		fprintf(fp, PIPE_STATS, e->name, e->upstream,
+				e->ul_bytes, e->ul_packets, e->dl_bytes, e->dl_packets);
+	}
+	else
+	{
+		fp = fopen(IPA_NETWORK_STATS_FILE_NAME, "w");
+		if (fp == NULL)
+		{
+			IPACMERR("Failed to write pipe stats to %s, error is %d - %s\n",
+					IPA_NETWORK_STATS_FILE_NAME, errno, strerror(errno));
+			return;
+		}
+		fprintf(fp, NETWORK_STATS, e->name,
+				e->ul_packets, e->ul_bytes, e->dl_packets, e->dl_bytes);
+	}
+	fclose(fp);
+}
+
+/* Writes the counters left pending at the end of a burst */
+void *IPACM_Stats::text_flush(void *param)
+{
+	IPACM_Stats *stats = (IPACM_Stats *)param;
+	struct timespec now, deadline;
+	time_t wait, left;
+	uint32_t i;
+
+	pthread_mutex_lock(&stats->lock);
+	while (1)
+	{
+		clock_gettime(CLOCK_BOOTTIME, &now);
+		wait = 0;
+		for (i = 0; i < stats->region->num_entries; i++)
+		{
+			if (!stats->text_pending[i])
+			{
+				continue;
+			}
+			left = stats->text_last[i] + IPACM_STATS_TEXT_INTERVAL_SEC - now.tv_sec;
+			if (left <= 0)
+			{
+				stats->text_last[i] = now.tv_sec;
+				stats->text_pending[i] = false;
+				stats->write_text(&stats->region->entries[i]);
+			}
+			else if (wait == 0 || left < wait)
+			{
+				wait = left;
+			}
+		}
+
+		if (wait == 0)
+		{
+			pthread_cond_wait(&stats->text_cond, &stats->lock);
+		}
+		else
+		{
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			deadline.tv_sec += wait;
+			pthread_cond_timedwait(&stats->text_cond, &stats->lock, &deadline);
+		}
+	}
+	return NULL;
+}
+
+void IPACM_Stats::update(ipacm_stats_type type, const char *name, const char *upstream,
+	uint16_t mux_id, uint64_t ul_bytes, uint64_t ul_packets,
+	uint64_t dl_bytes, uint64_t dl_packets)
+{
+	ipacm_stats_entry *e;
+	ipacm_stats_entry tmp;
+	struct timespec ts;
+	pthread_t thread;
+	int idx;
+
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	if (upstream == NULL)
+	{
+		upstream = "";
+	}
+
+	pthread_mutex_lock(&lock);
+	idx = (region == NULL) ? IPACM_FAILURE : find_entry(type, name, upstream, mux_id);
+	if (idx < 0)
+	{
+		/* no binary export, keep the text files current */
+		memset(&tmp, 0, sizeof(tmp));
+		tmp.type = type;
+		strlcpy(tmp.name, name, sizeof(tmp.name));
+		strlcpy(tmp.upstream, upstream, sizeof(tmp.upstream));
+		tmp.ul_bytes = ul_bytes;
+		tmp.ul_packets = ul_packets;
+		tmp.dl_bytes = dl_bytes;
+		tmp.dl_packets = dl_packets;
+		write_text(&tmp);
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	e = &region->entries[idx];
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	e->ul_bytes = ul_bytes;
+	e->ul_packets = ul_packets;
+	e->dl_bytes = dl_bytes;
+	e->dl_packets = dl_packets;
+	e->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	__atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELEASE);
+
+	if (IPACM_STATS_TEXT_INTERVAL_SEC > 0)
+	{
+		if (text_last[idx] == 0 || ts.tv_sec - text_last[idx] >= IPACM_STATS_TEXT_INTERVAL_SEC)
+		{
+			text_last[idx] = ts.tv_sec;
+			text_pending[idx] = false;
+			write_text(e);
+		}
+		else
+		{
+			/* inside the interval, the flush thread writes the latest
+			   counters once it has elapsed */
+			text_pending[idx] = true;
+			if (!text_thread)
+			{
+				if (pthread_create(&thread, NULL, text_flush, this) != 0)
+				{
+					IPACMERR("unable to create stats text flush thread\n");
+					PERROR("unable to create stats text flush\n");
+				}
+				else
+				{
+					text_thread = true;
+					pthread_detach(thread);
+					if (pthread_setname_np(thread, "stats text") != 0)
+					{
+						IPACMERR("unable to set thread name\n");
+					}
+				}
+			}
+			pthread_cond_signal(&text_cond);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
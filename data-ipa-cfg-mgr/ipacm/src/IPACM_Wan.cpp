@@ -50,6 +50,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Defs.h"
 #include <IPACM_ConntrackListener.h>
 #include "linux/ipa_qmi_service_v01.h"
+#include "IPACM_Stats.h"
 
 bool IPACM_Wan::wan_up = false;
 bool IPACM_Wan::wan_up_v6 = false;
@@ -121,6 +122,10 @@ IPACM_Wan::IPACM_Wan(int iface_index,
 	ext_prop = NULL;
 	is_ipv6_frag_firewall_flt_rule_installed = false;
 	ipv6_frag_firewall_flt_rule_hdl = 0;
+	memset(&firewall_config, 0, sizeof(firewall_config));
+	firewall_config_valid = false;
+	firewall_installed_valid_v4 = false;
+	firewall_installed_valid_v6 = false;
 
 	num_wan_client = 0;
 	header_name_count = 0;
@@ -139,6 +144,13 @@ IPACM_Wan::IPACM_Wan(int iface_index,
 			IPACMERR("unable to allocate memory\n");
 			return;
 		}
+		if (wan_client_idx.init(IPA_MAX_NUM_WAN_CLIENTS, true) != IPACM_SUCCESS)
+		{
+			IPACMERR("unable to allocate wan client index\n");
+			free(wan_client);
+			wan_client = NULL;
+			return;
+		}
 		IPACMDBG_H("index:%d constructor: Tx properties:%d\n", iface_index, iface_query->num_tx_props);
 	}
 
@@ -1113,55 +1125,7 @@ void IPACM_Wan::event_callback(ipa_cm_event_id event, void *param)
 
 	case IPA_FIREWALL_CHANGE_EVENT:
 		IPACMDBG_H("Received IPA_FIREWALL_CHANGE_EVENT\n");
-
-		if(m_is_sta_mode == Q6_WAN)
-		{
-			if(is_default_gateway == false)
-			{
-				IPACMDBG_H("Interface %s is not default gw, return.\n", dev_name);
-				return;
-			}
-
-			if(ip_type == IPA_IP_v4)
-			{
-				del_wan_firewall_rule(IPA_IP_v4);
-				config_wan_firewall_rule(IPA_IP_v4);
-				install_wan_filtering_rule(false);
-			}
-			else if(ip_type == IPA_IP_v6)
-			{
-				del_wan_firewall_rule(IPA_IP_v6);
-				config_wan_firewall_rule(IPA_IP_v6);
-				install_wan_filtering_rule(false);
-			}
-			else if(ip_type == IPA_IP_MAX)
-			{
-				del_wan_firewall_rule(IPA_IP_v4);
-				config_wan_firewall_rule(IPA_IP_v4);
-
-				del_wan_firewall_rule(IPA_IP_v6);
-				config_wan_firewall_rule(IPA_IP_v6);
-				install_wan_filtering_rule(false);
-			}
-			else
-			{
-				IPACMERR("IP type is not expected.\n");
-			}
-		}
-		else
-		{
-			if (active_v4)
-			{
-				del_dft_firewall_rules(IPA_IP_v4);
-				config_dft_firewall_rules(IPA_IP_v4);
-			}
-			if (active_v6)
-			{
-
-				del_dft_firewall_rules(IPA_IP_v6);
-				config_dft_firewall_rules(IPA_IP_v6);
-			}
-		}
+		handle_firewall_change_evt();
 		break;
 
 		case IPA_WLAN_SWITCH_TO_SCC:
@@ -1906,49 +1870,196 @@ bool IPACM_Wan::check_dft_firewall_rules_attr_mask(IPACM_firewall_conf_t *firewa
 	return false;
 }
 
-/* for STA mode: add firewall rules */
-int IPACM_Wan::config_dft_firewall_rules(ipa_ip_type iptype)
+/* parse the QCMAP firewall xml, a missing file leaves the firewall disabled */
+void IPACM_Wan::read_firewall_config(IPACM_firewall_conf_t *config)
 {
-	struct ipa_flt_rule_add flt_rule_entry;
-	int i, rule_v4 = 0, rule_v6 = 0, len;
+	/* default firewall is disable and the rule action is drop */
+	memset(config, 0, sizeof(IPACM_firewall_conf_t));
+	strlcpy(config->firewall_config_file, "/etc/mobileap_firewall.xml", sizeof(config->firewall_config_file));
 
-	IPACMDBG_H("ip-family: %d; \n", iptype);
+	IPACMDBG_H("Firewall XML file is %s \n", config->firewall_config_file);
+	if (IPACM_SUCCESS == IPACM_read_firewall_xml(config->firewall_config_file, config))
+	{
+		IPACMDBG_H("QCMAP Firewall XML read OK \n");
+	}
+	else
+	{
+		IPACMERR("QCMAP Firewall XML read failed, no that file, use default configuration \n");
+	}
+}
 
-	if (rx_prop == NULL)
+/* The config is zeroed before parsing, so the attribute bytes of an
+   entry are its key. Entries of the other ip family are skipped */
+bool IPACM_Wan::firewall_rules_equal(IPACM_firewall_conf_t *old_config, IPACM_firewall_conf_t *new_config, ipa_ip_type iptype)
+{
+	firewall_ip_version_enum ip_vsn = (iptype == IPA_IP_v4) ? IP_V4 : IP_V6;
+	int i = 0, j = 0;
+
+	if (old_config->firewall_enable != new_config->firewall_enable)
 	{
-		IPACMDBG_H("No rx properties registered for iface %s\n", dev_name);
-		return IPACM_SUCCESS;
+		return false;
+	}
+	if (new_config->firewall_enable == false)
+	{
+		return true;
+	}
+	if (old_config->rule_action_accept != new_config->rule_action_accept)
+	{
+		return false;
 	}
 
-	/* default firewall is disable and the rule action is drop */
-	memset(&firewall_config, 0, sizeof(firewall_config));
-	strlcpy(firewall_config.firewall_config_file, "/etc/mobileap_firewall.xml", sizeof(firewall_config.firewall_config_file));
+	while (true)
+	{
+		while (i < old_config->num_extd_firewall_entries && old_config->extd_firewall_entries[i].ip_vsn != ip_vsn)
+		{
+			i++;
+		}
+		while (j < new_config->num_extd_firewall_entries && new_config->extd_firewall_entries[j].ip_vsn != ip_vsn)
+		{
+			j++;
+		}
+		if (i == old_config->num_extd_firewall_entries || j == new_config->num_extd_firewall_entries)
+		{
+			return (i == old_config->num_extd_firewall_entries && j == new_config->num_extd_firewall_entries);
+		}
+		if (memcmp(&old_config->extd_firewall_entries[i].attrib,
+							 &new_config->extd_firewall_entries[j].attrib, sizeof(struct ipa_rule_attrib)) != 0)
+		{
+			return false;
+		}
+		i++;
+		j++;
+	}
+}
 
-	IPACMDBG_H("Firewall XML file is %s \n", firewall_config.firewall_config_file);
-	if (IPACM_SUCCESS == IPACM_read_firewall_xml(firewall_config.firewall_config_file, &firewall_config))
+/* number of filter rules a firewall entry takes, TCP_UDP is split in two */
+int IPACM_Wan::firewall_entry_rule_cnt(IPACM_extd_firewall_entry_conf_t *entry)
+{
+	if (entry->ip_vsn == IP_V4)
 	{
-		IPACMDBG_H("QCMAP Firewall XML read OK \n");
-		/* find the number of v4/v6 firewall rules */
-		for (i = 0; i < firewall_config.num_extd_firewall_entries; i++)
+		return (entry->attrib.u.v4.protocol == IPACM_FIREWALL_IPPROTO_TCP_UDP) ? 2 : 1;
+	}
+	return (entry->attrib.u.v6.next_hdr == IPACM_FIREWALL_IPPROTO_TCP_UDP) ? 2 : 1;
+}
+
+/* for STA mode: add the filter rules of one firewall entry at rear,
+   the routing table handles must have been fetched by the caller */
+int IPACM_Wan::add_dft_firewall_entry(IPACM_extd_firewall_entry_conf_t *entry, ipa_ip_type iptype, uint32_t *hdls, int *num_hdls)
+{
+	struct ipa_flt_rule_add flt_rule_entry;
+	ipa_ioc_add_flt_rule *m_pFilteringTable;
+	int i, len, num_rules;
+	uint8_t proto[2];
+
+	*num_hdls = 0;
+	num_rules = firewall_entry_rule_cnt(entry);
+	if (num_rules == 2)
+	{
+		proto[0] = IPACM_FIREWALL_IPPROTO_TCP;
+		proto[1] = IPACM_FIREWALL_IPPROTO_UDP;
+	}
+
+	len = sizeof(struct ipa_ioc_add_flt_rule) + 1 * sizeof(struct ipa_flt_rule_add);
+	m_pFilteringTable = (struct ipa_ioc_add_flt_rule *)calloc(1, len);
+	if (!m_pFilteringTable)
+	{
+		IPACMERR("Error Locate ipa_flt_rule_add memory...\n");
+		return IPACM_FAILURE;
+	}
+	m_pFilteringTable->commit = 1;
+	m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
+	m_pFilteringTable->global = false;
+	m_pFilteringTable->ip = iptype;
+	m_pFilteringTable->num_rules = (uint8_t)1;
+
+	memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+	flt_rule_entry.at_rear = true;
+	flt_rule_entry.flt_rule_hdl = -1;
+	flt_rule_entry.status = -1;
+	if (iptype == IPA_IP_v4)
+	{
+		flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl;
+		/* Accept v4 matched rules*/
+		if (firewall_config.rule_action_accept == true)
 		{
-			if (firewall_config.extd_firewall_entries[i].ip_vsn == 4)
+			if (IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
 			{
-				rule_v4++;
+				flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
 			}
 			else
 			{
-				rule_v6++;
+				flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
 			}
 		}
-		IPACMDBG_H("firewall rule v4:%d v6:%d total:%d\n", rule_v4, rule_v6, firewall_config.num_extd_firewall_entries);
+		else
+		{
+			flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+		}
 	}
 	else
 	{
-		IPACMERR("QCMAP Firewall XML read failed, no that file, use default configuration \n");
+		flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.hdl;
+		/* matched rules for v6 go PASS_TO_ROUTE */
+		if (firewall_config.rule_action_accept == true)
+		{
+			flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
+		}
+		else
+		{
+			flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+		}
 	}
+#ifdef FEATURE_IPA_V3
+	flt_rule_entry.rule.hashable = true;
+#endif
+	memcpy(&flt_rule_entry.rule.attrib, &entry->attrib, sizeof(struct ipa_rule_attrib));
+
+	IPACMDBG_H("rx property attrib mask: 0x%x\n", rx_prop->rx[0].attrib.attrib_mask);
+	flt_rule_entry.rule.attrib.attrib_mask |= rx_prop->rx[0].attrib.attrib_mask;
+	flt_rule_entry.rule.attrib.meta_data_mask = rx_prop->rx[0].attrib.meta_data_mask;
+	flt_rule_entry.rule.attrib.meta_data = rx_prop->rx[0].attrib.meta_data;
+
+	for (i = 0; i < num_rules; i++)
+	{
+		if (num_rules == 2)
+		{
+			if (iptype == IPA_IP_v4)
+			{
+				flt_rule_entry.rule.attrib.u.v4.protocol = proto[i];
+			}
+			else
+			{
+				flt_rule_entry.rule.attrib.u.v6.next_hdr = proto[i];
+			}
+		}
+		memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+
+		IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
+						 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
+		if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
+		{
+			IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
+			free(m_pFilteringTable);
+			return IPACM_FAILURE;
+		}
+		IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, iptype, 1);
+		IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+		hdls[i] = m_pFilteringTable->rules[0].flt_rule_hdl;
+		(*num_hdls)++;
+	}
+
+	free(m_pFilteringTable);
+	return IPACM_SUCCESS;
+}
+
+/* for STA mode: add the rules behind the firewall entries, the v4
+   default rule, or the v6 ICMP and default rules */
+int IPACM_Wan::add_dft_firewall_tail(ipa_ip_type iptype)
+{
+	struct ipa_flt_rule_add flt_rule_entry;
+	ipa_ioc_add_flt_rule *m_pFilteringTable;
+	int len;
 
-	/* construct ipa_ioc_add_flt_rule with N firewall rules */
-	ipa_ioc_add_flt_rule *m_pFilteringTable = NULL;
 	len = sizeof(struct ipa_ioc_add_flt_rule) + 1 * sizeof(struct ipa_flt_rule_add);
 	m_pFilteringTable = (struct ipa_ioc_add_flt_rule *)calloc(1, len);
 	if (!m_pFilteringTable)
@@ -1956,11 +2067,170 @@ int IPACM_Wan::config_dft_firewall_rules(ipa_ip_type iptype)
 		IPACMERR("Error Locate ipa_flt_rule_add memory...\n");
 		return IPACM_FAILURE;
 	}
+	m_pFilteringTable->commit = 1;
+	m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
+	m_pFilteringTable->global = false;
+	m_pFilteringTable->ip = iptype;
+	m_pFilteringTable->num_rules = (uint8_t)1;
+
+	if (iptype == IPA_IP_v6)
+	{
+		/* Construct ICMP rule */
+		memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+		flt_rule_entry.at_rear = true;
+		flt_rule_entry.flt_rule_hdl = -1;
+		flt_rule_entry.status = -1;
+		flt_rule_entry.rule.retain_hdr = 1;
+		flt_rule_entry.rule.eq_attrib_type = 0;
+		flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+#ifdef FEATURE_IPA_V3
+		flt_rule_entry.rule.hashable = true;
+#endif
+		memcpy(&flt_rule_entry.rule.attrib,
+				 &rx_prop->rx[0].attrib,
+				 sizeof(struct ipa_rule_attrib));
+		flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_NEXT_HDR;
+		flt_rule_entry.rule.attrib.u.v6.next_hdr = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP6;
+		memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+
+		if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
+		{
+			IPACMERR("Error Adding Filtering rules, aborting...\n");
+			free(m_pFilteringTable);
+			return IPACM_FAILURE;
+		}
+		IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
+		IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+		/* copy filter hdls */
+		dft_wan_fl_hdl[2] = m_pFilteringTable->rules[0].flt_rule_hdl;
+		/* End of construct ICMP rule */
+	}
+
+	/* setup default wan filter rule */
+	memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+	flt_rule_entry.at_rear = true;
+	flt_rule_entry.flt_rule_hdl = -1;
+	flt_rule_entry.status = -1;
+#ifdef FEATURE_IPA_V3
+	flt_rule_entry.rule.hashable = true;
+#endif
+	memcpy(&flt_rule_entry.rule.attrib,
+				 &rx_prop->rx[0].attrib,
+				 sizeof(struct ipa_rule_attrib));
+	flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
+
+	/* with the firewall enabled in accept mode, unmatched traffic goes to exception */
+	if (firewall_config.firewall_enable == true && firewall_config.rule_action_accept == true)
+	{
+		flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
+	}
+	else if (iptype == IPA_IP_v4 && IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
+	{
+		flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
+	}
+	else
+	{
+		flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
+	}
+
+	if (iptype == IPA_IP_v4)
+	{
+		flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl;
+		flt_rule_entry.rule.attrib.u.v4.dst_addr_mask = 0x00000000;
+		flt_rule_entry.rule.attrib.u.v4.dst_addr = 0x00000000;
+	}
+	else
+	{
+		flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.hdl;
+		memset(flt_rule_entry.rule.attrib.u.v6.dst_addr_mask, 0, sizeof(flt_rule_entry.rule.attrib.u.v6.dst_addr_mask));
+		memset(flt_rule_entry.rule.attrib.u.v6.dst_addr, 0, sizeof(flt_rule_entry.rule.attrib.u.v6.dst_addr));
+	}
+
+	memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+
+	IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
+					 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
+	if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
+	{
+		IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
+		free(m_pFilteringTable);
+		return IPACM_FAILURE;
+	}
+	IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, iptype, 1);
+	IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+
+	/* copy filter hdls */
+	if (iptype == IPA_IP_v4)
+	{
+		dft_wan_fl_hdl[0] = m_pFilteringTable->rules[0].flt_rule_hdl;
+	}
+	else
+	{
+		dft_wan_fl_hdl[1] = m_pFilteringTable->rules[0].flt_rule_hdl;
+	}
+
+	free(m_pFilteringTable);
+	return IPACM_SUCCESS;
+}
+
+/* for STA mode: add firewall rules */
+int IPACM_Wan::config_dft_firewall_rules(ipa_ip_type iptype)
+{
+	struct ipa_flt_rule_add flt_rule_entry;
+	int i, rule_v4 = 0, rule_v6 = 0, len, num_hdls;
+	IPACM_extd_firewall_entry_conf_t *entry;
+
+	IPACMDBG_H("ip-family: %d; \n", iptype);
+
+	if (rx_prop == NULL)
+	{
+		IPACMDBG_H("No rx properties registered for iface %s\n", dev_name);
+		return IPACM_SUCCESS;
+	}
+
+	if (firewall_config_valid == false)
+	{
+		read_firewall_config(&firewall_config);
+		firewall_config_valid = true;
+	}
+	/* only record the config once every rule of it is in */
+	if (iptype == IPA_IP_v4)
+	{
+		firewall_installed_valid_v4 = false;
+	}
+	else
+	{
+		firewall_installed_valid_v6 = false;
+	}
+
+	/* find the number of v4/v6 firewall rules */
+	for (i = 0; i < firewall_config.num_extd_firewall_entries; i++)
+	{
+		if (firewall_config.extd_firewall_entries[i].ip_vsn == 4)
+		{
+			rule_v4++;
+		}
+		else
+		{
+			rule_v6++;
+		}
+	}
+	IPACMDBG_H("firewall rule v4:%d v6:%d total:%d\n", rule_v4, rule_v6, firewall_config.num_extd_firewall_entries);
 
 	if(iptype == IPA_IP_v6 &&
 			firewall_config.firewall_enable == true &&
 			check_dft_firewall_rules_attr_mask(&firewall_config))
 	{
+		/* construct ipa_ioc_add_flt_rule with 1 rule */
+		ipa_ioc_add_flt_rule *m_pFilteringTable = NULL;
+		len = sizeof(struct ipa_ioc_add_flt_rule) + 1 * sizeof(struct ipa_flt_rule_add);
+		m_pFilteringTable = (struct ipa_ioc_add_flt_rule *)calloc(1, len);
+		if (!m_pFilteringTable)
+		{
+			IPACMERR("Error Locate ipa_flt_rule_add memory...\n");
+			return IPACM_FAILURE;
+		}
+
 		m_pFilteringTable->commit = 1;
 		m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
 		m_pFilteringTable->global = false;
@@ -1992,633 +2262,377 @@ int IPACM_Wan::config_dft_firewall_rules(ipa_ip_type iptype)
 			is_ipv6_frag_firewall_flt_rule_installed = true;
 			IPACMDBG_H("Installed IPv6 frag firewall rule, handle %d.\n", ipv6_frag_firewall_flt_rule_hdl);
 		}
+		free(m_pFilteringTable);
 	}
 
 	if (iptype == IPA_IP_v4)
 	{
-		if (rule_v4 == 0)
+		IPACMDBG_H("Retreiving Routing handle for routing table name:%s\n",
+						 IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name);
+		if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_lan_v4))
 		{
-			memset(m_pFilteringTable, 0, len);
-
-			m_pFilteringTable->commit = 1;
-			m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
-			m_pFilteringTable->global = false;
-			m_pFilteringTable->ip = IPA_IP_v4;
-			m_pFilteringTable->num_rules = (uint8_t)1;
-
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-
-			if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_lan_v4))
-			{
-				IPACMERR("m_routing.GetRoutingTable(rt_tbl_lan_v4) Failed.\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
-			}
-
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-
-			/* firewall disable, all traffic are allowed */
-			if(firewall_config.firewall_enable == true)
-			{
-				flt_rule_entry.at_rear = true;
-
-				/* default action for v4 is go DST_NAT unless user set to exception*/
-				if(firewall_config.rule_action_accept == true)
-				{
-					flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-				}
-				else
-				{
-					if(IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
-					{
-						flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
-					}
-					else
-					{
-						flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-					}
-				}
-			}
-			else
-			{
-				flt_rule_entry.at_rear = true;
-				if(IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
-				{
-					flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
-				}
-				else
-				{
-					flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-				}
-            }
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.at_rear = true;
-			flt_rule_entry.rule.hashable = true;
-#endif
-			flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl;
-			memcpy(&flt_rule_entry.rule.attrib,
-						 &rx_prop->rx[0].attrib,
-						 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-			flt_rule_entry.rule.attrib.u.v4.dst_addr_mask = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v4.dst_addr = 0x00000000;
-
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-			{
-				IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
-			}
-			else
-			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
-			}
-
-			/* copy filter hdls */
-			dft_wan_fl_hdl[0] = m_pFilteringTable->rules[0].flt_rule_hdl;
+			IPACMERR("m_routing.GetRoutingTable(&rt_tbl_lan_v4=0x%p) Failed.\n", &IPACM_Iface::ipacmcfg->rt_tbl_lan_v4);
+			return IPACM_FAILURE;
 		}
-		else
+		IPACMDBG_H("Routing handle for wan routing table:0x%x\n", IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl);
+	}
+	else
+	{
+		if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_wan_v6))
 		{
-			memset(m_pFilteringTable, 0, len);
-
-			m_pFilteringTable->commit = 1;
-			m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
-			m_pFilteringTable->global = false;
-			m_pFilteringTable->ip = IPA_IP_v4;
-			m_pFilteringTable->num_rules = (uint8_t)1;
+			IPACMERR("m_routing.GetRoutingTable(rt_tbl_wan_v6) Failed.\n");
+			return IPACM_FAILURE;
+		}
+	}
 
-			IPACMDBG_H("Retreiving Routing handle for routing table name:%s\n",
-							 IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name);
-			if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_lan_v4))
+	if (firewall_config.firewall_enable == true)
+	{
+		for (i = 0; i < firewall_config.num_extd_firewall_entries; i++)
+		{
+			entry = &firewall_config.extd_firewall_entries[i];
+			if (entry->ip_vsn != ((iptype == IPA_IP_v4) ? IP_V4 : IP_V6))
 			{
-				IPACMERR("m_routing.GetRoutingTable(&rt_tbl_lan_v4=0x%p) Failed.\n", &IPACM_Iface::ipacmcfg->rt_tbl_lan_v4);
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				continue;
 			}
-			IPACMDBG_H("Routing handle for wan routing table:0x%x\n", IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl);
-
-            if(firewall_config.firewall_enable == true)
-            {
-			rule_v4 = 0;
-			for (i = 0; i < firewall_config.num_extd_firewall_entries; i++)
-			{
-				if (firewall_config.extd_firewall_entries[i].ip_vsn == 4)
-				{
-					memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-
-		    			flt_rule_entry.at_rear = true;
-					flt_rule_entry.flt_rule_hdl = -1;
-					flt_rule_entry.status = -1;
-					flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl;
-
-					/* Accept v4 matched rules*/
-                    if(firewall_config.rule_action_accept == true)
-			        {
-						if(IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
-						{
-							flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
-						}
-						else
-						{
-							flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-						}
-			        }
-			        else
-			        {
-			            flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-                    }
-#ifdef FEATURE_IPA_V3
-					flt_rule_entry.rule.hashable = true;
-#endif
-					memcpy(&flt_rule_entry.rule.attrib,
-								 &firewall_config.extd_firewall_entries[i].attrib,
-								 sizeof(struct ipa_rule_attrib));
-
-					IPACMDBG_H("rx property attrib mask: 0x%x\n", rx_prop->rx[0].attrib.attrib_mask);
-					flt_rule_entry.rule.attrib.attrib_mask |= rx_prop->rx[0].attrib.attrib_mask;
-					flt_rule_entry.rule.attrib.meta_data_mask = rx_prop->rx[0].attrib.meta_data_mask;
-					flt_rule_entry.rule.attrib.meta_data = rx_prop->rx[0].attrib.meta_data;
-
-					/* check if the rule is define as TCP_UDP, split into 2 rules, 1 for TCP and 1 UDP */
-					if (firewall_config.extd_firewall_entries[i].attrib.u.v4.protocol
-							== IPACM_FIREWALL_IPPROTO_TCP_UDP)
-					{
-						/* insert TCP rule*/
-						flt_rule_entry.rule.attrib.u.v4.protocol = IPACM_FIREWALL_IPPROTO_TCP;
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-						IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
-										 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-							/* save v4 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n",
-											 m_pFilteringTable->rules[rule_v4].flt_rule_hdl,
-											 m_pFilteringTable->rules[rule_v4].status);
-							firewall_hdl_v4[rule_v4] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v4++;
-							rule_v4++;
-						}
-
-						/* insert UDP rule*/
-						flt_rule_entry.rule.attrib.u.v4.protocol = IPACM_FIREWALL_IPPROTO_UDP;
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-						IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
-										 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-							/* save v4 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n",
-											 m_pFilteringTable->rules[rule_v4].flt_rule_hdl,
-											 m_pFilteringTable->rules[rule_v4].status);
-							firewall_hdl_v4[rule_v4] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v4++;
-							rule_v4++;
-						}
-					}
-					else
-					{
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
 
-						IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
-										 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-							/* save v4 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n",
-											 m_pFilteringTable->rules[rule_v4].flt_rule_hdl,
-											 m_pFilteringTable->rules[rule_v4].status);
-							firewall_hdl_v4[rule_v4] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v4++;
-							rule_v4++;
-						}
-					}
-				}
-			} /* end of firewall ipv4 filter rule add for loop*/
-            }
-			/* configure default filter rule */
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-
-			/* firewall disable, all traffic are allowed */
-            if(firewall_config.firewall_enable == true)
-			{
-			     flt_rule_entry.at_rear = true;
-
-			     /* default action for v4 is go DST_NAT unless user set to exception*/
-                             if(firewall_config.rule_action_accept == true)
-			     {
-			        flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-			     }
-			     else
-			     {
-					if(IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
-					{
-						flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
-					}
-					else
-					{
-						flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-					}
-				}
-		    }
-			else
+			if (iptype == IPA_IP_v4)
 			{
-			    flt_rule_entry.at_rear = true;
-				if(IPACM_Iface::ipacmcfg->iface_table[ipa_if_num].if_mode == ROUTER)
+				if (num_firewall_v4 + firewall_entry_rule_cnt(entry) > IPACM_MAX_FIREWALL_ENTRIES)
 				{
-					flt_rule_entry.rule.action = IPA_PASS_TO_DST_NAT;
+					IPACMERR("the number of v4 firewall entries overflow, aborting...\n");
+					return IPACM_FAILURE;
 				}
-				else
+				if (add_dft_firewall_entry(entry, IPA_IP_v4, &firewall_hdl_v4[num_firewall_v4], &num_hdls) != IPACM_SUCCESS)
 				{
-					flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
+					num_firewall_v4 += num_hdls;
+					return IPACM_FAILURE;
 				}
-            }
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.rule.hashable = true;
-#endif
-			flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.hdl;
-			memcpy(&flt_rule_entry.rule.attrib,
-						 &rx_prop->rx[0].attrib,
-						 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-			flt_rule_entry.rule.attrib.u.v4.dst_addr_mask = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v4.dst_addr = 0x00000000;
-
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-			IPACMDBG_H("Filter rule attrib mask: 0x%x\n",
-							 m_pFilteringTable->rules[0].rule.attrib.attrib_mask);
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-			{
-				IPACMERR("Error Adding RuleTable(0) to Filtering, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				/* save v4 firewall filter rule handler */
+				num_firewall_v4 += num_hdls;
 			}
 			else
 			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v4, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+				if (num_firewall_v6 + firewall_entry_rule_cnt(entry) > IPACM_MAX_FIREWALL_ENTRIES)
+				{
+					IPACMERR("the number of v6 firewall entries overflow, aborting...\n");
+					return IPACM_FAILURE;
+				}
+				if (add_dft_firewall_entry(entry, IPA_IP_v6, &firewall_hdl_v6[num_firewall_v6], &num_hdls) != IPACM_SUCCESS)
+				{
+					num_firewall_v6 += num_hdls;
+					return IPACM_FAILURE;
+				}
+				/* save v6 firewall filter rule handler */
+				num_firewall_v6 += num_hdls;
 			}
-
-			/* copy filter hdls */
-			dft_wan_fl_hdl[0] = m_pFilteringTable->rules[0].flt_rule_hdl;
 		}
+	}
+
+	/* configure default filter rule */
+	if (add_dft_firewall_tail(iptype) != IPACM_SUCCESS)
+	{
+		return IPACM_FAILURE;
+	}
+	save_firewall_installed(iptype);
+	return IPACM_SUCCESS;
+}
 
+void IPACM_Wan::save_firewall_installed(ipa_ip_type iptype)
+{
+	if (iptype == IPA_IP_v4)
+	{
+		memcpy(&firewall_installed_v4, &firewall_config, sizeof(IPACM_firewall_conf_t));
+		firewall_installed_valid_v4 = true;
 	}
 	else
 	{
-		if (rule_v6 == 0)
-		{
-			memset(m_pFilteringTable, 0, len);
-
-			m_pFilteringTable->commit = 1;
-			m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
-			m_pFilteringTable->global = false;
-			m_pFilteringTable->ip = IPA_IP_v6;
-			m_pFilteringTable->num_rules = (uint8_t)1;
+		memcpy(&firewall_installed_v6, &firewall_config, sizeof(IPACM_firewall_conf_t));
+		firewall_installed_valid_v6 = true;
+	}
+}
 
-			/* Construct ICMP rule */
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-			flt_rule_entry.at_rear = true;
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-			flt_rule_entry.rule.retain_hdr = 1;
-			flt_rule_entry.rule.eq_attrib_type = 0;
-			flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.rule.hashable = true;
-#endif
-			memcpy(&flt_rule_entry.rule.attrib,
-					 &rx_prop->rx[0].attrib,
-					 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_NEXT_HDR;
-			flt_rule_entry.rule.attrib.u.v6.next_hdr = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP6;
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+/* for STA mode: bring the installed firewall rules in line with
+   firewall_config. The handles follow the entry order of the config
+   recorded at install time. Rules whose entry is gone are deleted, new
+   entries are added at rear followed by a fresh copy of the default
+   rules, and the old default rules are only removed once the new ones
+   are in. All firewall rules share one action, so their relative order
+   does not matter. Any change to that action, or a missing record,
+   falls back to a full reinstall */
+int IPACM_Wan::update_dft_firewall_rules(ipa_ip_type iptype)
+{
+	firewall_ip_version_enum ip_vsn = (iptype == IPA_IP_v4) ? IP_V4 : IP_V6;
+	IPACM_firewall_conf_t *old_config = (iptype == IPA_IP_v4) ? &firewall_installed_v4 : &firewall_installed_v6;
+	bool old_config_valid = (iptype == IPA_IP_v4) ? firewall_installed_valid_v4 : firewall_installed_valid_v6;
+	uint32_t *firewall_hdl = (iptype == IPA_IP_v4) ? firewall_hdl_v4 : firewall_hdl_v6;
+	int *num_firewall = (iptype == IPA_IP_v4) ? &num_firewall_v4 : &num_firewall_v6;
+	uint32_t entry_hdl[IPACM_MAX_FIREWALL_ENTRIES][2];
+	int entry_num_hdl[IPACM_MAX_FIREWALL_ENTRIES];
+	bool matched[IPACM_MAX_FIREWALL_ENTRIES];
+	uint32_t del_hdl[IPACM_MAX_FIREWALL_ENTRIES], tail_hdl[2];
+	IPACM_extd_firewall_entry_conf_t *entry;
+	int i, j, k, cnt, pos = 0, num_del = 0, num_add = 0, num_hdls = 0;
+	int res = IPACM_SUCCESS;
 
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-			{
-				IPACMERR("Error Adding Filtering rules, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
-			}
-			else
-			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
-			}
-			/* copy filter hdls */
-			dft_wan_fl_hdl[2] = m_pFilteringTable->rules[0].flt_rule_hdl;
+	if (rx_prop == NULL)
+	{
+		IPACMDBG_H("No rx properties registered for iface %s\n", dev_name);
+		return IPACM_SUCCESS;
+	}
 
-			/* End of construct ICMP rule */
+	if (old_config_valid == false)
+	{
+		IPACMDBG_H("No complete install recorded, reinstall ip-family %d rules\n", iptype);
+		goto reinstall;
+	}
 
-			/* v6 default route */
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-			if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_wan_v6)) //rt_tbl_wan_v6 rt_tbl_v6
-			{
-				IPACMERR("m_routing.GetRoutingTable(rt_tbl_wan_v6) Failed.\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
-			}
+	if (old_config->firewall_enable == false || firewall_config.firewall_enable == false ||
+			old_config->rule_action_accept != firewall_config.rule_action_accept ||
+			(iptype == IPA_IP_v6 &&
+			 check_dft_firewall_rules_attr_mask(old_config) != check_dft_firewall_rules_attr_mask(&firewall_config)))
+	{
+		IPACMDBG_H("Firewall mode changed, reinstall ip-family %d rules\n", iptype);
+		goto reinstall;
+	}
 
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-			flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.hdl;
+	memset(matched, 0, sizeof(matched));
+	memset(entry_num_hdl, 0, sizeof(entry_num_hdl));
 
-			/* firewall disable, all traffic are allowed */
-                        if(firewall_config.firewall_enable == true)
-			{
-			   flt_rule_entry.at_rear = true;
+	/* installed handles follow the order of the entries in old_config */
+	for (i = 0; i < old_config->num_extd_firewall_entries; i++)
+	{
+		entry = &old_config->extd_firewall_entries[i];
+		if (entry->ip_vsn != ip_vsn)
+		{
+			continue;
+		}
+		cnt = firewall_entry_rule_cnt(entry);
+		if (pos + cnt > *num_firewall)
+		{
+			IPACMERR("Firewall handles out of sync with the config, reinstall ip-family %d rules\n", iptype);
+			goto reinstall;
+		}
 
-			   /* default action for v6 is PASS_TO_ROUTE unless user set to exception*/
-                           if(firewall_config.rule_action_accept == true)
-			   {
-			       flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-			   }
-			   else
-			   {
-			       flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-                           }
-		        }
-			else
+		for (j = 0; j < firewall_config.num_extd_firewall_entries; j++)
+		{
+			if (!matched[j] && firewall_config.extd_firewall_entries[j].ip_vsn == ip_vsn &&
+					memcmp(&firewall_config.extd_firewall_entries[j].attrib, &entry->attrib, sizeof(struct ipa_rule_attrib)) == 0)
 			{
-			  flt_rule_entry.at_rear = true;
-			  flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-                        }
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.rule.hashable = true;
-#endif
-			memcpy(&flt_rule_entry.rule.attrib,
-						 &rx_prop->rx[0].attrib,
-						 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[0] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[1] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[2] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[3] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[0] = 0X00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[1] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[2] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[3] = 0X00000000;
-
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-			{
-				IPACMERR("Error Adding Filtering rules, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				break;
 			}
-			else
+		}
+
+		if (j < firewall_config.num_extd_firewall_entries)
+		{
+			matched[j] = true;
+			entry_num_hdl[j] = cnt;
+			for (k = 0; k < cnt; k++)
 			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+				entry_hdl[j][k] = firewall_hdl[pos + k];
 			}
-
-			/* copy filter hdls */
-			dft_wan_fl_hdl[1] = m_pFilteringTable->rules[0].flt_rule_hdl;
 		}
 		else
 		{
-			memset(m_pFilteringTable, 0, len);
-
-			m_pFilteringTable->commit = 1;
-			m_pFilteringTable->ep = rx_prop->rx[0].src_pipe;
-			m_pFilteringTable->global = false;
-			m_pFilteringTable->ip = IPA_IP_v6;
-			m_pFilteringTable->num_rules = (uint8_t)1;
-
-			if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_wan_v6))
+			for (k = 0; k < cnt; k++)
 			{
-				IPACMERR("m_routing.GetRoutingTable(rt_tbl_wan_v6) Failed.\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				del_hdl[num_del++] = firewall_hdl[pos + k];
 			}
+		}
+		pos += cnt;
+	}
+	if (pos != *num_firewall)
+	{
+		IPACMERR("Firewall handles out of sync with the config, reinstall ip-family %d rules\n", iptype);
+		goto reinstall;
+	}
 
-            if(firewall_config.firewall_enable == true)
-            {
-			rule_v6 = 0;
-			for (i = 0; i < firewall_config.num_extd_firewall_entries; i++)
-			{
-				if (firewall_config.extd_firewall_entries[i].ip_vsn == 6)
-				{
-					memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-
-		    			flt_rule_entry.at_rear = true;
-					flt_rule_entry.flt_rule_hdl = -1;
-					flt_rule_entry.status = -1;
-
-				    /* matched rules for v6 go PASS_TO_ROUTE */
-                                    if(firewall_config.rule_action_accept == true)
-			            {
-			                flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-			            }
-			            else
-			            {
-					flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-                                    }
-#ifdef FEATURE_IPA_V3
-					flt_rule_entry.rule.hashable = true;
-#endif
-		    			flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.hdl;
-					memcpy(&flt_rule_entry.rule.attrib,
-								 &firewall_config.extd_firewall_entries[i].attrib,
-								 sizeof(struct ipa_rule_attrib));
-					flt_rule_entry.rule.attrib.attrib_mask |= rx_prop->rx[0].attrib.attrib_mask;
-					flt_rule_entry.rule.attrib.meta_data_mask = rx_prop->rx[0].attrib.meta_data_mask;
-					flt_rule_entry.rule.attrib.meta_data = rx_prop->rx[0].attrib.meta_data;
-
-					/* check if the rule is define as TCP/UDP */
-					if (firewall_config.extd_firewall_entries[i].attrib.u.v6.next_hdr == IPACM_FIREWALL_IPPROTO_TCP_UDP)
-					{
-						/* insert TCP rule*/
-						flt_rule_entry.rule.attrib.u.v6.next_hdr = IPACM_FIREWALL_IPPROTO_TCP;
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding Filtering rules, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-							/* save v4 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
-							firewall_hdl_v6[rule_v6] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v6++;
-							rule_v6++;
-						}
+	if (num_del > 0)
+	{
+		if (m_filtering.DeleteFilteringHdls(del_hdl, iptype, num_del) == false)
+		{
+			IPACMERR("Error Deleting Filtering rules, aborting...\n");
+			return IPACM_FAILURE;
+		}
+		IPACM_Iface::ipacmcfg->decreaseFltRuleCount(rx_prop->rx[0].src_pipe, iptype, num_del);
+	}
+	num_hdls = pos - num_del;
 
-						/* insert UDP rule*/
-						flt_rule_entry.rule.attrib.u.v6.next_hdr = IPACM_FIREWALL_IPPROTO_UDP;
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding Filtering rules, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-							/* save v6 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
-							firewall_hdl_v6[rule_v6] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v6++;
-							rule_v6++;
-						}
-					}
-					else
-					{
-						memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-						if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-						{
-							IPACMERR("Error Adding Filtering rules, aborting...\n");
-							free(m_pFilteringTable);
-							return IPACM_FAILURE;
-						}
-						else
-						{
-							IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-							/* save v6 firewall filter rule handler */
-							IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
-							firewall_hdl_v6[rule_v6] = m_pFilteringTable->rules[0].flt_rule_hdl;
-							num_firewall_v6++;
-							rule_v6++;
-						}
-					}
-				}
-			} /* end of firewall ipv6 filter rule add for loop*/
-            }
+	if (iptype == IPA_IP_v4)
+	{
+		if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_lan_v4))
+		{
+			IPACMERR("m_routing.GetRoutingTable(&rt_tbl_lan_v4=0x%p) Failed.\n", &IPACM_Iface::ipacmcfg->rt_tbl_lan_v4);
+			res = IPACM_FAILURE;
+			goto done;
+		}
+	}
+	else
+	{
+		if (false == m_routing.GetRoutingTable(&IPACM_Iface::ipacmcfg->rt_tbl_wan_v6))
+		{
+			IPACMERR("m_routing.GetRoutingTable(rt_tbl_wan_v6) Failed.\n");
+			res = IPACM_FAILURE;
+			goto done;
+		}
+	}
 
-			/* Construct ICMP rule */
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
-			flt_rule_entry.at_rear = true;
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-			flt_rule_entry.rule.retain_hdr = 1;
-			flt_rule_entry.rule.eq_attrib_type = 0;
-			flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.rule.hashable = true;
-#endif
-			memcpy(&flt_rule_entry.rule.attrib,
-					 &rx_prop->rx[0].attrib,
-					 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_NEXT_HDR;
-			flt_rule_entry.rule.attrib.u.v6.next_hdr = (uint8_t)IPACM_FIREWALL_IPPROTO_ICMP6;
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
+	for (j = 0; j < firewall_config.num_extd_firewall_entries; j++)
+	{
+		entry = &firewall_config.extd_firewall_entries[j];
+		if (matched[j] || entry->ip_vsn != ip_vsn)
+		{
+			continue;
+		}
+		if (num_hdls + firewall_entry_rule_cnt(entry) > IPACM_MAX_FIREWALL_ENTRIES)
+		{
+			IPACMERR("the number of firewall entries overflow, aborting...\n");
+			res = IPACM_FAILURE;
+			break;
+		}
+		if (add_dft_firewall_entry(entry, iptype, entry_hdl[j], &entry_num_hdl[j]) != IPACM_SUCCESS)
+		{
+			res = IPACM_FAILURE;
+		}
+		num_hdls += entry_num_hdl[j];
+		num_add += entry_num_hdl[j];
+		if (res != IPACM_SUCCESS)
+		{
+			break;
+		}
+	}
 
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
+	/* new rules landed behind the default rules, move those to the rear again */
+	if (num_add > 0)
+	{
+		tail_hdl[0] = (iptype == IPA_IP_v4) ? dft_wan_fl_hdl[0] : dft_wan_fl_hdl[1];
+		tail_hdl[1] = dft_wan_fl_hdl[2];
+		if (add_dft_firewall_tail(iptype) != IPACM_SUCCESS)
+		{
+			res = IPACM_FAILURE;
+		}
+		else
+		{
+			cnt = (iptype == IPA_IP_v4) ? 1 : 2;
+			if (m_filtering.DeleteFilteringHdls(tail_hdl, iptype, cnt) == false)
 			{
-				IPACMERR("Error Adding Filtering rules, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				IPACMERR("Error Deleting Filtering rules, aborting...\n");
+				res = IPACM_FAILURE;
 			}
 			else
 			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+				IPACM_Iface::ipacmcfg->decreaseFltRuleCount(rx_prop->rx[0].src_pipe, iptype, cnt);
 			}
-			/* copy filter hdls */
-			dft_wan_fl_hdl[2] = m_pFilteringTable->rules[0].flt_rule_hdl;
-			/* End of construct ICMP rule */
+		}
+	}
+	IPACMDBG_H("ip-family %d firewall update: deleted %d rules, added %d rules\n", iptype, num_del, num_add);
 
-			/* setup default wan filter rule */
-			memset(&flt_rule_entry, 0, sizeof(struct ipa_flt_rule_add));
+done:
+	/* keep the handles in the order of the entries in firewall_config */
+	*num_firewall = 0;
+	for (j = 0; j < firewall_config.num_extd_firewall_entries; j++)
+	{
+		if (firewall_config.extd_firewall_entries[j].ip_vsn != ip_vsn)
+		{
+			continue;
+		}
+		for (k = 0; k < entry_num_hdl[j]; k++)
+		{
+			firewall_hdl[(*num_firewall)++] = entry_hdl[j][k];
+		}
+	}
+	if (res == IPACM_SUCCESS)
+	{
+		save_firewall_installed(iptype);
+	}
+	else if (iptype == IPA_IP_v4)
+	{
+		firewall_installed_valid_v4 = false;
+	}
+	else
+	{
+		firewall_installed_valid_v6 = false;
+	}
+	return res;
 
-			flt_rule_entry.flt_rule_hdl = -1;
-			flt_rule_entry.status = -1;
-			flt_rule_entry.rule.rt_tbl_hdl = IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.hdl;
+reinstall:
+	del_dft_firewall_rules(iptype);
+	return config_dft_firewall_rules(iptype);
+}
 
-			/* firewall disable, all traffic are allowed */
-                        if(firewall_config.firewall_enable == true)
-			{
-			   flt_rule_entry.at_rear = true;
+/* reload the firewall xml and only touch the ip families whose rules changed */
+int IPACM_Wan::handle_firewall_change_evt()
+{
+	bool update_v4, update_v6;
+	int res = IPACM_SUCCESS;
 
-			   /* default action for v6 is PASS_TO_ROUTE unless user set to exception*/
-               if(firewall_config.rule_action_accept == true)
-			   {
-			        flt_rule_entry.rule.action = IPA_PASS_TO_EXCEPTION;
-			   }
-			   else
-			   {
-			flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-                           }
-		        }
-			else
+	if(m_is_sta_mode == Q6_WAN && is_default_gateway == false)
+	{
+		IPACMDBG_H("Interface %s is not default gw, return.\n", dev_name);
+		/* read the new file when the rules get installed */
+		firewall_config_valid = false;
+		return IPACM_SUCCESS;
+	}
+
+	read_firewall_config(&firewall_config);
+	firewall_config_valid = true;
+
+	/* diff against what each ip family was installed from, not the last parsed file */
+	update_v4 = !firewall_installed_valid_v4 || !firewall_rules_equal(&firewall_installed_v4, &firewall_config, IPA_IP_v4);
+	update_v6 = !firewall_installed_valid_v6 || !firewall_rules_equal(&firewall_installed_v6, &firewall_config, IPA_IP_v6);
+	IPACMDBG_H("Firewall rules changed v4:%d v6:%d\n", update_v4, update_v6);
+
+	if(m_is_sta_mode == Q6_WAN)
+	{
+		/* the modem takes the whole DL table in one request, rebuild only the changed families */
+		if(ip_type == IPA_IP_v4)
+		{
+			update_v6 = false;
+		}
+		else if(ip_type == IPA_IP_v6)
+		{
+			update_v4 = false;
+		}
+		else if(ip_type != IPA_IP_MAX)
+		{
+			IPACMERR("IP type is not expected.\n");
+			update_v4 = false;
+			update_v6 = false;
+		}
+
+		if(update_v4)
+		{
+			del_wan_firewall_rule(IPA_IP_v4);
+			config_wan_firewall_rule(IPA_IP_v4);
+		}
+		if(update_v6)
+		{
+			del_wan_firewall_rule(IPA_IP_v6);
+			config_wan_firewall_rule(IPA_IP_v6);
+		}
+		if(update_v4 || update_v6)
+		{
+			res = install_wan_filtering_rule(false);
+		}
+	}
+	else
+	{
+		if(active_v4 && update_v4)
+		{
+			if(update_dft_firewall_rules(IPA_IP_v4) != IPACM_SUCCESS)
 			{
-			  flt_rule_entry.at_rear = true;
-			  flt_rule_entry.rule.action = IPA_PASS_TO_ROUTING;
-                        }
-#ifdef FEATURE_IPA_V3
-			flt_rule_entry.rule.hashable = true;
-#endif
-			memcpy(&flt_rule_entry.rule.attrib,
-						 &rx_prop->rx[0].attrib,
-						 sizeof(struct ipa_rule_attrib));
-			flt_rule_entry.rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[0] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[1] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[2] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr_mask[3] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[0] = 0X00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[1] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[2] = 0x00000000;
-			flt_rule_entry.rule.attrib.u.v6.dst_addr[3] = 0X00000000;
-
-			memcpy(&(m_pFilteringTable->rules[0]), &flt_rule_entry, sizeof(struct ipa_flt_rule_add));
-
-			if (false == m_filtering.AddFilteringRule(m_pFilteringTable))
-			{
-				IPACMERR("Error Adding Filtering rules, aborting...\n");
-				free(m_pFilteringTable);
-				return IPACM_FAILURE;
+				res = IPACM_FAILURE;
 			}
-			else
+		}
+		if(active_v6 && update_v6)
+		{
+			if(update_dft_firewall_rules(IPA_IP_v6) != IPACM_SUCCESS)
 			{
-				IPACM_Iface::ipacmcfg->increaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
-				IPACMDBG_H("flt rule hdl0=0x%x, status=0x%x\n", m_pFilteringTable->rules[0].flt_rule_hdl, m_pFilteringTable->rules[0].status);
+				res = IPACM_FAILURE;
 			}
-			/* copy filter hdls*/
-			dft_wan_fl_hdl[1] = m_pFilteringTable->rules[0].flt_rule_hdl;
 		}
 	}
 
-	if(m_pFilteringTable != NULL)
-	{
-		free(m_pFilteringTable);
-	}
-	return IPACM_SUCCESS;
+	return res;
 }
 
 /* configure the initial firewall filter rules */
@@ -2645,18 +2659,19 @@ int IPACM_Wan::config_dft_firewall_rules_ex(struct ipa_flt_rule_add *rules, int
 		return IPACM_FAILURE;
 	}
 
-	/* default firewall is disable and the rule action is drop */
-	memset(&firewall_config, 0, sizeof(firewall_config));
-	strlcpy(firewall_config.firewall_config_file, "/etc/mobileap_firewall.xml", sizeof(firewall_config.firewall_config_file));
-
-	IPACMDBG_H("Firewall XML file is %s \n", firewall_config.firewall_config_file);
-	if (IPACM_SUCCESS == IPACM_read_firewall_xml(firewall_config.firewall_config_file, &firewall_config))
+	if (firewall_config_valid == false)
 	{
-		IPACMDBG_H("QCMAP Firewall XML read OK \n");
+		read_firewall_config(&firewall_config);
+		firewall_config_valid = true;
+	}
+	/* only record the config once every rule of it is in */
+	if (iptype == IPA_IP_v4)
+	{
+		firewall_installed_valid_v4 = false;
 	}
 	else
 	{
-		IPACMERR("QCMAP Firewall XML read failed, no that file, use default configuration \n");
+		firewall_installed_valid_v6 = false;
 	}
 
 	/* add IPv6 frag rule when firewall is enabled*/
@@ -3136,6 +3151,7 @@ int IPACM_Wan::config_dft_firewall_rules_ex(struct ipa_flt_rule_add *rules, int
 		num_rules = IPACM_Wan::num_v6_flt_rule - original_num_rules - 1;
 	}
 	IPACMDBG_H("Constructed %d firewall rules for ip type %d\n", num_rules, iptype);
+	save_firewall_installed(iptype);
 	return IPACM_SUCCESS;
 }
 
@@ -3869,8 +3885,7 @@ int IPACM_Wan::del_dft_firewall_rules(ipa_ip_type iptype)
 		}
 		IPACM_Iface::ipacmcfg->decreaseFltRuleCount(rx_prop->rx[0].src_pipe, IPA_IP_v6, 1);
 
-		if (is_ipv6_frag_firewall_flt_rule_installed &&
-			check_dft_firewall_rules_attr_mask(&firewall_config))
+		if (is_ipv6_frag_firewall_flt_rule_installed)
 		{
 			if (m_filtering.DeleteFilteringHdls(&ipv6_frag_firewall_flt_rule_hdl, IPA_IP_v6, 1) == false)
 			{
@@ -5339,6 +5354,7 @@ int IPACM_Wan::handle_wan_hdr_init(uint8_t *mac_addr)
 		get_client_memptr(wan_client, num_wan_client)->route_rule_set_v6 = 0;
 		get_client_memptr(wan_client, num_wan_client)->ipv4_set = false;
 		get_client_memptr(wan_client, num_wan_client)->ipv6_set = 0;
+		wan_client_idx.add(get_client_memptr(wan_client, num_wan_client)->mac, num_wan_client);
 		num_wan_client++;
 		header_name_count++; //keep increasing header_name_count
 		res = IPACM_SUCCESS;
@@ -5387,6 +5403,7 @@ int IPACM_Wan::handle_wan_client_ipaddr(ipacm_event_data_all *data)
 			{
 				get_client_memptr(wan_client, clnt_indx)->v4_addr = data->ipv4_addr;
 				get_client_memptr(wan_client, clnt_indx)->ipv4_set = true;
+				wan_client_idx.set_ipv4(clnt_indx, data->ipv4_addr);
 				/* Add NAT rules after ipv4 RT rules are set */
 				CtList->HandleSTAClientAddEvt(data->ipv4_addr);
 			}
@@ -5406,6 +5423,7 @@ int IPACM_Wan::handle_wan_client_ipaddr(ipacm_event_data_all *data)
 					delete_wan_rtrules(clnt_indx,IPA_IP_v4);
 					get_client_memptr(wan_client, clnt_indx)->route_rule_set_v4 = false;
 					get_client_memptr(wan_client, clnt_indx)->v4_addr = data->ipv4_addr;
+					wan_client_idx.set_ipv4(clnt_indx, data->ipv4_addr);
 					/* Add NAT rules after ipv4 RT rules are set */
 					CtList->HandleSTAClientAddEvt(data->ipv4_addr);
 				}
@@ -5970,8 +5988,6 @@ void IPACM_Wan::handle_wan_client_SCC_MCC_switch(bool isSCCMode, ipa_ip_type ipt
 /*handle eth client */
 int IPACM_Wan::handle_network_stats_update(ipa_get_apn_data_stats_resp_msg_v01 *data)
 {
-	FILE *fp = NULL;
-
 	for (int apn_index =0; apn_index < data->apn_data_stats_list_len; apn_index++)
 	{
 		if(data->apn_data_stats_list[apn_index].mux_id == ext_prop->ext[0].mux_id)
@@ -5982,21 +5998,12 @@ int IPACM_Wan::handle_network_stats_update(ipa_get_apn_data_stats_resp_msg_v01 *
 						data->apn_data_stats_list[apn_index].num_ul_bytes,
 							data->apn_data_stats_list[apn_index].num_dl_packets,
 								data->apn_data_stats_list[apn_index].num_dl_bytes);
-			fp = fopen(IPA_NETWORK_STATS_FILE_NAME, "w");
-			if ( fp == NULL )
-			{
-				IPACMERR("Failed to write pipe stats to %s, error is %d - %s\n",
-						IPA_NETWORK_STATS_FILE_NAME, errno, strerror(errno));
-				return IPACM_FAILURE;
-			}
-
-			fprintf(fp, NETWORK_STATS,
-				dev_name,
+			IPACM_Stats::GetInstance()->update(IPACM_STATS_TYPE_APN,
+					dev_name, NULL, data->apn_data_stats_list[apn_index].mux_id,
+					data->apn_data_stats_list[apn_index].num_ul_bytes,
 					data->apn_data_stats_list[apn_index].num_ul_packets,
-						data->apn_data_stats_list[apn_index].num_ul_bytes,
-							data->apn_data_stats_list[apn_index].num_dl_packets,
-								data->apn_data_stats_list[apn_index].num_dl_bytes);
-			fclose(fp);
+					data->apn_data_stats_list[apn_index].num_dl_bytes,
+					data->apn_data_stats_list[apn_index].num_dl_packets);
 			break;
 		};
 	}
@@ -59,6 +59,7 @@ int IPACM_Wlan::num_wlan_ap_iface = 0;
 IPACM_Wlan::IPACM_Wlan(int iface_index) : IPACM_Lan(iface_index)
 {
 #define WLAN_AMPDU_DEFAULT_FILTER_RULES 3
+	int max_clients;
 
 	wlan_ap_index = IPACM_Wlan::num_wlan_ap_iface;
 	if(wlan_ap_index < 0 || wlan_ap_index > 1)
@@ -87,12 +88,21 @@ IPACM_Wlan::IPACM_Wlan(int iface_index) : IPACM_Lan(iface_index)
 	if(iface_query != NULL)
 	{
 		wlan_client_len = (sizeof(ipa_wlan_client)) + (iface_query->num_tx_props * sizeof(wlan_client_rt_hdl));
-		wlan_client = (ipa_wlan_client *)calloc(IPA_MAX_NUM_WIFI_CLIENTS, wlan_client_len);
+		max_clients = IPACM_Iface::ipacmcfg->GetMaxWlanClients();
+		wlan_client = (ipa_wlan_client *)calloc(max_clients, wlan_client_len);
 		if (wlan_client == NULL)
 		{
 			IPACMERR("unable to allocate memory\n");
 			return;
 		}
+		/* wlan_client and its index are sized once, the limit in the config may change later */
+		if (wlan_client_idx.init(max_clients, false) != IPACM_SUCCESS)
+		{
+			IPACMERR("unable to allocate wlan client index\n");
+			free(wlan_client);
+			wlan_client = NULL;
+			return;
+		}
 		IPACMDBG_H("index:%d constructor: Tx properties:%d\n", iface_index, iface_query->num_tx_props);
 	}
 	Nat_App = NatApp::GetInstance();
@@ -760,13 +770,24 @@ int IPACM_Wlan::handle_wlan_client_init_ex(ipacm_event_data_wlan_ex *data)
 	IPACMDBG_H("Wifi client number for this iface: %d & total number of wlan clients: %d\n",
                  num_wifi_client,IPACM_Wlan::total_num_wifi_clients);
 
-	if ((num_wifi_client >= IPA_MAX_NUM_WIFI_CLIENTS) ||
-			(IPACM_Wlan::total_num_wifi_clients >= IPA_MAX_NUM_WIFI_CLIENTS))
+	if ((num_wifi_client >= wlan_client_idx.get_capacity()) ||
+			(IPACM_Wlan::total_num_wifi_clients >= IPACM_Iface::ipacmcfg->GetMaxWlanClients()))
 	{
 		IPACMERR("Reached maximum number of wlan clients\n");
 		return IPACM_FAILURE;
 	}
 
+	/* a MAC is indexed once, same as the lan/wan clients */
+	for (i = 0; i < data->num_of_attribs; i++)
+	{
+		if (data->attribs[i].attrib_type == WLAN_HDR_ATTRIB_MAC_ADDR &&
+				get_wlan_client_index(data->attribs[i].u.mac_addr) != IPACM_INVALID_INDEX)
+		{
+			IPACMERR("wlan client is found/attached already\n");
+			return IPACM_FAILURE;
+		}
+	}
+
 	IPACMDBG_H("Wifi client number: %d\n", num_wifi_client);
 
 	/* add header to IPA */
@@ -1020,6 +1041,7 @@ int IPACM_Wlan::handle_wlan_client_init_ex(ipacm_event_data_wlan_ex *data)
 		get_client_memptr(wlan_client, num_wifi_client)->ipv4_set = false;
 		get_client_memptr(wlan_client, num_wifi_client)->ipv6_set = 0;
 		get_client_memptr(wlan_client, num_wifi_client)->power_save_set=false;
+		wlan_client_idx.add(get_client_memptr(wlan_client, num_wifi_client)->mac, num_wifi_client);
 		num_wifi_client++;
 		header_name_count++; //keep increasing header_name_count
 		IPACM_Wlan::total_num_wifi_clients++;
@@ -1147,11 +1169,11 @@ int IPACM_Wlan::handle_wlan_client_ipaddr(ipacm_event_data_all *data)
 /*handle wifi client routing rule*/
 int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type iptype)
 {
-	struct ipa_ioc_add_rt_rule *rt_rule;
+	IPACM_RtRuleBatch *lan_batch = NULL, *wan_batch = NULL;
 	struct ipa_rt_rule_add *rt_rule_entry;
 	uint32_t tx_index;
-	int wlan_index,v6_num;
-	const int NUM = 1;
+	int wlan_index, v6_num, num_addr, cnt;
+	int res = IPACM_SUCCESS;
 
 	if(tx_prop == NULL)
 	{
@@ -1199,20 +1221,39 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 				&& get_client_memptr(wlan_client, wlan_index)->route_rule_set_v6 < get_client_memptr(wlan_client, wlan_index)->ipv6_set
 			   ))
 	{
-		rt_rule = (struct ipa_ioc_add_rt_rule *)
-			calloc(1, sizeof(struct ipa_ioc_add_rt_rule) +
-					NUM * sizeof(struct ipa_rt_rule_add));
+		/* one rule per tx prop and address, installed in one ioctl per table */
+		num_addr = (iptype == IPA_IP_v4) ? 1 :
+			get_client_memptr(wlan_client, wlan_index)->ipv6_set - get_client_memptr(wlan_client, wlan_index)->route_rule_set_v6;
 
-		if (rt_rule == NULL)
+		lan_batch = m_routing.GetBatch(iface_query->num_tx_props * num_addr);
+		if (lan_batch == NULL)
 		{
 			PERROR("Error Locate ipa_ioc_add_rt_rule memory...\n");
 			return IPACM_FAILURE;
 		}
+		lan_batch->table()->commit = 1;
+		lan_batch->table()->ip = iptype;
+		strlcpy(lan_batch->table()->rt_tbl_name,
+				(iptype == IPA_IP_v4) ? IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name : IPACM_Iface::ipacmcfg->rt_tbl_v6.name,
+				sizeof(lan_batch->table()->rt_tbl_name));
+		lan_batch->table()->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
 
-		rt_rule->commit = 1;
-		rt_rule->num_rules = (uint8_t)NUM;
-		rt_rule->ip = iptype;
-
+		if (iptype == IPA_IP_v6)
+		{
+			wan_batch = m_routing.GetBatch(iface_query->num_tx_props * num_addr);
+			if (wan_batch == NULL)
+			{
+				PERROR("Error Locate ipa_ioc_add_rt_rule memory...\n");
+				res = IPACM_FAILURE;
+				goto fail;
+			}
+			wan_batch->table()->commit = 1;
+			wan_batch->table()->ip = iptype;
+			strlcpy(wan_batch->table()->rt_tbl_name,
+					IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.name,
+					sizeof(wan_batch->table()->rt_tbl_name));
+			wan_batch->table()->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
+		}
 
 		for (tx_index = 0; tx_index < iface_query->num_tx_props; tx_index++)
 		{
@@ -1224,9 +1265,6 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 				continue;
 			}
 
-			rt_rule_entry = &rt_rule->rules[0];
-			rt_rule_entry->at_rear = 0;
-
 			if (iptype == IPA_IP_v4)
 			{
 				IPACMDBG_H("client index(%d):ipv4 address: 0x%x\n", wlan_index,
@@ -1235,10 +1273,14 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 				IPACMDBG_H("client(%d): v4 header handle:(0x%x)\n",
 						wlan_index,
 						get_client_memptr(wlan_client, wlan_index)->hdr_hdl_v4);
-				strlcpy(rt_rule->rt_tbl_name,
-						IPACM_Iface::ipacmcfg->rt_tbl_lan_v4.name,
-						sizeof(rt_rule->rt_tbl_name));
-				rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
+
+				rt_rule_entry = lan_batch->add();
+				if (rt_rule_entry == NULL)
+				{
+					IPACMERR("Routing rule batch is full\n");
+					res = IPACM_FAILURE;
+					goto fail;
+				}
 
 				if(IPACM_Iface::ipacmcfg->isMCC_Mode)
 				{
@@ -1261,18 +1303,6 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 #ifdef FEATURE_IPA_V3
 				rt_rule_entry->rule.hashable = true;
 #endif
-				if (false == m_routing.AddRoutingRule(rt_rule))
-				{
-					IPACMERR("Routing rule addition failed!\n");
-					free(rt_rule);
-					return IPACM_FAILURE;
-				}
-
-				/* copy ipv4 RT hdl */
-				get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v4 =
-					rt_rule->rules[0].rt_rule_hdl;
-				IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-						get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v4, iptype);
 			}
 			else
 			{
@@ -1283,13 +1313,15 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 							get_client_memptr(wlan_client, wlan_index)->hdr_hdl_v6);
 
 					/* v6 LAN_RT_TBL */
-					strlcpy(rt_rule->rt_tbl_name,
-							IPACM_Iface::ipacmcfg->rt_tbl_v6.name,
-							sizeof(rt_rule->rt_tbl_name));
-					rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
+					rt_rule_entry = lan_batch->add();
+					if (rt_rule_entry == NULL)
+					{
+						IPACMERR("Routing rule batch is full\n");
+						res = IPACM_FAILURE;
+						goto fail;
+					}
 					/* Support QCMAP LAN traffic feature, send to A5 */
 					rt_rule_entry->rule.dst = iface_query->excp_pipe;
-					memset(&rt_rule_entry->rule.attrib, 0, sizeof(rt_rule_entry->rule.attrib));
 					rt_rule_entry->rule.hdr_hdl = 0;
 					rt_rule_entry->rule.attrib.attrib_mask |= IPA_FLT_DST_ADDR;
 					rt_rule_entry->rule.attrib.u.v6.dst_addr[0] = get_client_memptr(wlan_client, wlan_index)->v6_addr[v6_num][0];
@@ -1303,22 +1335,15 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 #ifdef FEATURE_IPA_V3
 					rt_rule_entry->rule.hashable = true;
 #endif
-					if (false == m_routing.AddRoutingRule(rt_rule))
-					{
-						IPACMERR("Routing rule addition failed!\n");
-						free(rt_rule);
-						return IPACM_FAILURE;
-					}
-
-					get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6[v6_num] = rt_rule->rules[0].rt_rule_hdl;
-					IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-							get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6[v6_num], iptype);
 
 					/*Copy same rule to v6 WAN RT TBL*/
-					strlcpy(rt_rule->rt_tbl_name,
-							IPACM_Iface::ipacmcfg->rt_tbl_wan_v6.name,
-							sizeof(rt_rule->rt_tbl_name));
-					rt_rule->rt_tbl_name[IPA_RESOURCE_NAME_MAX-1] = '\0';
+					rt_rule_entry = wan_batch->add();
+					if (rt_rule_entry == NULL)
+					{
+						IPACMERR("Routing rule batch is full\n");
+						res = IPACM_FAILURE;
+						goto fail;
+					}
 					/* Downlink traffic from Wan iface, directly through IPA */
 					if(IPACM_Iface::ipacmcfg->isMCC_Mode)
 					{
@@ -1346,23 +1371,58 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 #ifdef FEATURE_IPA_V3
 					rt_rule_entry->rule.hashable = true;
 #endif
-					if (false == m_routing.AddRoutingRule(rt_rule))
-					{
-						IPACMERR("Routing rule addition failed!\n");
-						free(rt_rule);
-						return IPACM_FAILURE;
-					}
-
-					get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6_wan[v6_num] = rt_rule->rules[0].rt_rule_hdl;
-
-					IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
-							get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6_wan[v6_num], iptype);
 				}
 			}
 
 		} /* end of for loop */
 
-		free(rt_rule);
+		if (false == m_routing.AddRoutingRule(lan_batch))
+		{
+			IPACMERR("Routing rule addition failed!\n");
+			res = IPACM_FAILURE;
+			goto fail;
+		}
+		if (wan_batch != NULL && false == m_routing.AddRoutingRule(wan_batch))
+		{
+			IPACMERR("Routing rule addition failed!\n");
+			for (cnt = 0; cnt < lan_batch->count(); cnt++)
+			{
+				m_routing.DeleteRoutingHdl(lan_batch->rule(cnt)->rt_rule_hdl, iptype);
+			}
+			res = IPACM_FAILURE;
+			goto fail;
+		}
+
+		/* hand out the handles in the order the rules were built */
+		cnt = 0;
+		for (tx_index = 0; tx_index < iface_query->num_tx_props; tx_index++)
+		{
+			if(iptype != tx_prop->tx[tx_index].ip)
+			{
+				continue;
+			}
+
+			if (iptype == IPA_IP_v4)
+			{
+				/* copy ipv4 RT hdl */
+				get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v4 =
+					lan_batch->rule(cnt++)->rt_rule_hdl;
+				IPACMDBG_H("tx:%d, rt rule hdl=%x ip-type: %d\n", tx_index,
+						get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v4, iptype);
+			}
+			else
+			{
+				for(v6_num = get_client_memptr(wlan_client, wlan_index)->route_rule_set_v6;v6_num < get_client_memptr(wlan_client, wlan_index)->ipv6_set;v6_num++)
+				{
+					get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6[v6_num] = lan_batch->rule(cnt)->rt_rule_hdl;
+					get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6_wan[v6_num] = wan_batch->rule(cnt)->rt_rule_hdl;
+					cnt++;
+					IPACMDBG_H("tx:%d, rt rule hdl=%x wan hdl=%x ip-type: %d\n", tx_index,
+							get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6[v6_num],
+							get_client_memptr(wlan_client, wlan_index)->wifi_rt_hdl[tx_index].wifi_rt_rule_hdl_v6_wan[v6_num], iptype);
+				}
+			}
+		}
 
 		if (iptype == IPA_IP_v4)
 		{
@@ -1374,7 +1434,10 @@ int IPACM_Wlan::handle_wlan_client_route_rule(uint8_t *mac_addr, ipa_ip_type ipt
 		}
 	}
 
-	return IPACM_SUCCESS;
+fail:
+	m_routing.PutBatch(lan_batch);
+	m_routing.PutBatch(wan_batch);
+	return res;
 }
 
 /*handle wifi client power-save mode*/
@@ -1477,6 +1540,8 @@ int IPACM_Wlan::handle_wlan_client_down_evt(uint8_t *mac_addr)
 	get_client_memptr(wlan_client, clt_indx)->route_rule_set_v6 = 0;
 	free(get_client_memptr(wlan_client, clt_indx)->p_hdr_info);
 
+	/* the entries behind clt_indx move down by one */
+	wlan_client_idx.remove(mac_addr, clt_indx, num_wifi_client_tmp);
 	for (; clt_indx < num_wifi_client_tmp - 1; clt_indx++)
 	{
 		get_client_memptr(wlan_client, clt_indx)->p_hdr_info = get_client_memptr(wlan_client, (clt_indx + 1))->p_hdr_info;
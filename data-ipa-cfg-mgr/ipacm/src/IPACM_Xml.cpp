@@ -40,6 +40,11 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libxml/xmlreader.h>
 
 #include "IPACM_Xml.h"
 #include "IPACM_Log.h"
@@ -56,12 +61,6 @@ static int32_t IPACM_util_icmp_string
 	 const char* str
 );
 
-static int ipacm_cfg_xml_parse_tree
-(
-	 xmlNode* xml_node,
-	 IPACM_conf_t *config
-);
-
 static int IPACM_firewall_xml_parse_tree
 (
 	 xmlNode* xml_node,
@@ -111,345 +110,578 @@ static int32_t IPACM_util_icmp_string
 	return ret;
 }
 
-/* This function read IPACM XML and populate the IPA CM Cfg */
-int ipacm_read_cfg_xml(char *xml_file, IPACM_conf_t *config)
+/* This function stores the content of one leaf element */
+static int ipacm_cfg_xml_parse_leaf
+(
+	 const char* name,
+	 const char* content,
+	 IPACM_conf_t *config
+)
 {
-	xmlDocPtr doc = NULL;
-	xmlNode* root = NULL;
-	int ret_val = IPACM_SUCCESS;
+	int str_size;
+	char content_buf[MAX_XML_STR_LEN];
 
-	/* Invoke the XML parser and obtain the parse tree */
-	doc = xmlReadFile(xml_file, "UTF-8", XML_PARSE_NOBLANKS);
-	if (doc == NULL) {
-		IPACMDBG_H("IPACM_xml_parse: libxml returned parse error!\n");
-		return IPACM_FAILURE;
+	if (IPACM_util_icmp_string(name, IP_PassthroughMode_TAG) == 0)
+	{
+		IPACMDBG_H("inside IP Passthrough\n");
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			if (atoi(content_buf))
+			{
+				config->ip_passthrough_mode = true;
+				IPACMDBG_H("Passthrough enable %d buf(%d)\n", config->ip_passthrough_mode, atoi(content_buf));
+			}
+			else
+			{
+				config->ip_passthrough_mode = false;
+				IPACMDBG_H("Passthrough enable %d buf(%d)\n", config->ip_passthrough_mode, atoi(content_buf));
+			}
+		}
 	}
+	else if (IPACM_util_icmp_string(name, ODUMODE_TAG) == 0)
+	{
+		IPACMDBG_H("inside ODU-XML\n");
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			if (0 == strncasecmp(content_buf, ODU_ROUTER_TAG, str_size))
+			{
+				config->router_mode_enable = true;
+				IPACMDBG_H("router-mode enable %d\n", config->router_mode_enable);
+			}
+			else if (0 == strncasecmp(content_buf, ODU_BRIDGE_TAG, str_size))
+			{
+				config->router_mode_enable = false;
+				IPACMDBG_H("router-mode enable %d\n", config->router_mode_enable);
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, ODUEMBMS_OFFLOAD_TAG) == 0)
+	{
+		IPACMDBG_H("inside ODU-XML\n");
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			if (atoi(content_buf))
+			{
+				config->odu_embms_enable = true;
+				IPACMDBG_H("router-mode enable %d buf(%d)\n", config->odu_embms_enable, atoi(content_buf));
+			}
+			else
+			{
+				config->odu_embms_enable = false;
+				IPACMDBG_H("router-mode enable %d buf(%d)\n", config->odu_embms_enable, atoi(content_buf));
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, NAME_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			strlcpy(content_buf, content, MAX_XML_STR_LEN);
+			strlcpy(config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].iface_name, content_buf, IPA_IFACE_NAME_LEN);
+			IPACMDBG_H("Name %s\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].iface_name);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, CATEGORY_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			if (0 == strncasecmp(content_buf, WANIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = WAN_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else if (0 == strncasecmp(content_buf, LANIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = LAN_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else if (0 == strncasecmp(content_buf, WLANIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = WLAN_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else  if (0 == strncasecmp(content_buf, VIRTUALIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = VIRTUAL_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else  if (0 == strncasecmp(content_buf, UNKNOWNIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = UNKNOWN_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else  if (0 == strncasecmp(content_buf, ETHIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = ETH_IF;
+				IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+			else  if (0 == strncasecmp(content_buf, ODUIF_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = ODU_IF;
+				IPACMDBG("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, MODE_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			if (0 == strncasecmp(content_buf, IFACE_ROUTER_MODE_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode = ROUTER;
+				IPACMDBG_H("Iface mode %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode);
+			}
+			else  if (0 == strncasecmp(content_buf, IFACE_BRIDGE_MODE_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode = BRIDGE;
+				IPACMDBG_H("Iface mode %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode);
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, WLAN_MODE_TAG) == 0)
+	{
+		IPACMDBG_H("Inside WLAN-XML\n");
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
 
-	/*Get the root of the tree*/
-	root = xmlDocGetRootElement(doc);
-
-	memset(config, 0, sizeof(IPACM_conf_t));
-
-	/* parse the xml tree returned by libxml */
-	ret_val = ipacm_cfg_xml_parse_tree(root, config);
+			if (0 == strncasecmp(content_buf, WLAN_FULL_MODE_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode = FULL;
+				IPACMDBG_H("Wlan-mode full(%d)\n",
+						config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode);
+			}
+			else  if (0 == strncasecmp(content_buf, WLAN_INTERNET_MODE_TAG, str_size))
+			{
+				config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode = INTERNET;
+				config->num_wlan_guest_ap++;
+				IPACMDBG_H("Wlan-mode internet(%d)\n",
+						config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode);
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, SUBNETADDRESS_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			content_buf[MAX_XML_STR_LEN-1] = '\0';
+			config->private_subnet_config.private_subnet_entries[config->private_subnet_config.num_subnet_entries - 1].subnet_addr
+				 = ntohl(inet_addr(content_buf));
+			IPACMDBG_H("subnet_addr: %s \n", content_buf);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, SUBNETMASK_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			content_buf[MAX_XML_STR_LEN-1] = '\0';
+			config->private_subnet_config.private_subnet_entries[config->private_subnet_config.num_subnet_entries - 1].subnet_mask
+				 = ntohl(inet_addr(content_buf));
+			IPACMDBG_H("subnet_mask: %s \n", content_buf);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, Protocol_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			content_buf[MAX_XML_STR_LEN-1] = '\0';
 
-	if (ret_val != IPACM_SUCCESS)
+			if (0 == strncasecmp(content_buf, TCP_PROTOCOL_TAG, str_size))
+			{
+				config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol = IPPROTO_TCP;
+				IPACMDBG_H("Protocol %s: %d\n",
+						content_buf, config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol);
+			}
+			else if (0 == strncasecmp(content_buf, UDP_PROTOCOL_TAG, str_size))
+			{
+				config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol = IPPROTO_UDP;
+				IPACMDBG_H("Protocol %s: %d\n",
+						content_buf, config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol);
+			}
+		}
+	}
+	else if (IPACM_util_icmp_string(name, Port_TAG) == 0)
 	{
-		IPACMDBG_H("IPACM_xml_parse: ipacm_cfg_xml_parse_tree returned parse error!\n");
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].port
+				 = atoi(content_buf);
+			IPACMDBG_H("port %d\n", config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].port);
+		}
 	}
+	else if (IPACM_util_icmp_string(name, NAT_MaxEntries_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->nat_max_entries = atoi(content_buf);
+			IPACMDBG_H("Nat Table Max Entries %d\n", config->nat_max_entries);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, MaxWlanClients_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->max_wlan_clients = atoi(content_buf);
+			IPACMDBG_H("Max wlan clients %d\n", config->max_wlan_clients);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, MaxEthClients_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->max_eth_clients = atoi(content_buf);
+			IPACMDBG_H("Max eth clients %d\n", config->max_eth_clients);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, MaxNeighborClients_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->max_neighbor_clients = atoi(content_buf);
+			IPACMDBG_H("Max neighbor clients %d\n", config->max_neighbor_clients);
+		}
+	}
+	else if (IPACM_util_icmp_string(name, CfgDebounceMs_TAG) == 0)
+	{
+		if (content)
+		{
+			str_size = strlen(content);
+			memset(content_buf, 0, sizeof(content_buf));
+			memcpy(content_buf, (void *)content, str_size);
+			config->cfg_debounce_ms = atoi(content_buf);
+			IPACMDBG_H("Config debounce %d ms\n", config->cfg_debounce_ms);
+		}
+	}
+	return IPACM_SUCCESS;
+}
 
-	/* Free up the libxml's parse tree */
-	xmlFreeDoc(doc);
+/* Element names that only group other elements */
+static bool ipacm_cfg_xml_container
+(
+	 const char* name,
+	 IPACM_conf_t *config
+)
+{
+	if (IPACM_util_icmp_string(name, system_TAG) == 0 ||
+			IPACM_util_icmp_string(name, ODU_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMCFG_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMIFACECFG_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IFACE_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMPRIVATESUBNETCFG_TAG) == 0 ||
+			IPACM_util_icmp_string(name, SUBNET_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMALG_TAG) == 0 ||
+			IPACM_util_icmp_string(name, ALG_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMNat_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IPACMClients_TAG) == 0 ||
+			IPACM_util_icmp_string(name, IP_PassthroughFlag_TAG) == 0)
+	{
+		if (0 == IPACM_util_icmp_string(name, IFACE_TAG))
+		{
+			/* increase iface entry number */
+			if (config->iface_config.num_iface_entries >= IPA_MAX_IFACE_ENTRIES)
+				return false;
+			config->iface_config.num_iface_entries++;
+		}
 
-	return ret_val;
+		if (0 == IPACM_util_icmp_string(name, SUBNET_TAG))
+		{
+			/* increase iface entry number */
+			if (config->private_subnet_config.num_subnet_entries >= IPA_MAX_PRIVATE_SUBNET_ENTRIES)
+				return false;
+			config->private_subnet_config.num_subnet_entries++;
+		}
+
+		if (0 == IPACM_util_icmp_string(name, ALG_TAG))
+		{
+			/* increase iface entry number */
+			if (config->alg_config.num_alg_entries >= IPA_MAX_ALG_ENTRIES)
+				return false;
+			config->alg_config.num_alg_entries++;
+		}
+		return true;
+	}
+	return false;
 }
 
-/* This function traverses the xml tree*/
-static int ipacm_cfg_xml_parse_tree
+/* Streaming parse of the config file. As with the tree walk it replaces,
+   an element is only looked at when all its ancestors are containers */
+static int ipacm_cfg_xml_parse_stream
 (
-	 xmlNode* xml_node,
+	 const char *xml_file,
 	 IPACM_conf_t *config
 )
 {
-	int32_t ret_val = IPACM_SUCCESS;
-	int str_size;
-	char* content;
-	char content_buf[MAX_XML_STR_LEN];
+	xmlTextReaderPtr reader;
+	const char *name;
+	xmlChar *content;
+	int depth, visit_depth = 0;
+	int ret;
 
-	if (NULL == xml_node)
-		return ret_val;
-	while ( xml_node != NULL &&
-				 ret_val == IPACM_SUCCESS)
+	reader = xmlReaderForFile(xml_file, "UTF-8", XML_PARSE_NOBLANKS);
+	if (reader == NULL)
 	{
-		switch (xml_node->type)
+		IPACMDBG_H("IPACM_xml_parse: libxml failed to open %s\n", xml_file);
+		return IPACM_FAILURE;
+	}
+
+	memset(config, 0, sizeof(IPACM_conf_t));
+
+	while ((ret = xmlTextReaderRead(reader)) == 1)
+	{
+		depth = xmlTextReaderDepth(reader);
+		switch (xmlTextReaderNodeType(reader))
 		{
-		case XML_ELEMENT_NODE:
+		case XML_READER_TYPE_ELEMENT:
+			if (depth != visit_depth)
+			{
+				break;
+			}
+			name = (const char *)xmlTextReaderConstName(reader);
+			if (ipacm_cfg_xml_container(name, config))
 			{
-				if (IPACM_util_icmp_string((char*)xml_node->name, system_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, ODU_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IPACMCFG_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IPACMIFACECFG_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IFACE_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IPACMPRIVATESUBNETCFG_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, SUBNET_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IPACMALG_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, ALG_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IPACMNat_TAG) == 0 ||
-						IPACM_util_icmp_string((char*)xml_node->name, IP_PassthroughFlag_TAG) == 0)
+				if (!xmlTextReaderIsEmptyElement(reader))
 				{
-					if (0 == IPACM_util_icmp_string((char*)xml_node->name, IFACE_TAG))
-					{
-						/* increase iface entry number */
-						config->iface_config.num_iface_entries++;
-					}
-
-					if (0 == IPACM_util_icmp_string((char*)xml_node->name, SUBNET_TAG))
-					{
-						/* increase iface entry number */
-						config->private_subnet_config.num_subnet_entries++;
-					}
-
-					if (0 == IPACM_util_icmp_string((char*)xml_node->name, ALG_TAG))
-					{
-						/* increase iface entry number */
-						config->alg_config.num_alg_entries++;
-					}
 					/* go to child */
-					ret_val = ipacm_cfg_xml_parse_tree(xml_node->children, config);
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, IP_PassthroughMode_TAG) == 0)
-				{
-					IPACMDBG_H("inside IP Passthrough\n");
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						if (atoi(content_buf))
-						{
-							config->ip_passthrough_mode = true;
-							IPACMDBG_H("Passthrough enable %d buf(%d)\n", config->ip_passthrough_mode, atoi(content_buf));
-						}
-						else
-						{
-							config->ip_passthrough_mode = false;
-							IPACMDBG_H("Passthrough enable %d buf(%d)\n", config->ip_passthrough_mode, atoi(content_buf));
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, ODUMODE_TAG) == 0)
-				{
-					IPACMDBG_H("inside ODU-XML\n");
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						if (0 == strncasecmp(content_buf, ODU_ROUTER_TAG, str_size))
-						{
-							config->router_mode_enable = true;
-							IPACMDBG_H("router-mode enable %d\n", config->router_mode_enable);
-						}
-						else if (0 == strncasecmp(content_buf, ODU_BRIDGE_TAG, str_size))
-						{
-							config->router_mode_enable = false;
-							IPACMDBG_H("router-mode enable %d\n", config->router_mode_enable);
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, ODUEMBMS_OFFLOAD_TAG) == 0)
-				{
-					IPACMDBG_H("inside ODU-XML\n");
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						if (atoi(content_buf))
-						{
-							config->odu_embms_enable = true;
-							IPACMDBG_H("router-mode enable %d buf(%d)\n", config->odu_embms_enable, atoi(content_buf));
-						}
-						else
-						{
-							config->odu_embms_enable = false;
-							IPACMDBG_H("router-mode enable %d buf(%d)\n", config->odu_embms_enable, atoi(content_buf));
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, NAME_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						strlcpy(content_buf, content, MAX_XML_STR_LEN);
-						strlcpy(config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].iface_name, content_buf, IPA_IFACE_NAME_LEN);
-						IPACMDBG_H("Name %s\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].iface_name);
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, CATEGORY_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						if (0 == strncasecmp(content_buf, WANIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = WAN_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else if (0 == strncasecmp(content_buf, LANIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = LAN_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else if (0 == strncasecmp(content_buf, WLANIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = WLAN_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else  if (0 == strncasecmp(content_buf, VIRTUALIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = VIRTUAL_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else  if (0 == strncasecmp(content_buf, UNKNOWNIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = UNKNOWN_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else  if (0 == strncasecmp(content_buf, ETHIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = ETH_IF;
-							IPACMDBG_H("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-						else  if (0 == strncasecmp(content_buf, ODUIF_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat = ODU_IF;
-							IPACMDBG("Category %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_cat);
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, MODE_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						if (0 == strncasecmp(content_buf, IFACE_ROUTER_MODE_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode = ROUTER;
-							IPACMDBG_H("Iface mode %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode);
-						}
-						else  if (0 == strncasecmp(content_buf, IFACE_BRIDGE_MODE_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode = BRIDGE;
-							IPACMDBG_H("Iface mode %d\n", config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].if_mode);
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, WLAN_MODE_TAG) == 0)
-				{
-					IPACMDBG_H("Inside WLAN-XML\n");
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-
-						if (0 == strncasecmp(content_buf, WLAN_FULL_MODE_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode = FULL;
-							IPACMDBG_H("Wlan-mode full(%d)\n",
-									config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode);
-						}
-						else  if (0 == strncasecmp(content_buf, WLAN_INTERNET_MODE_TAG, str_size))
-						{
-							config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode = INTERNET;
-							config->num_wlan_guest_ap++;
-							IPACMDBG_H("Wlan-mode internet(%d)\n",
-									config->iface_config.iface_entries[config->iface_config.num_iface_entries - 1].wlan_mode);
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, SUBNETADDRESS_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						content_buf[MAX_XML_STR_LEN-1] = '\0';
-						config->private_subnet_config.private_subnet_entries[config->private_subnet_config.num_subnet_entries - 1].subnet_addr
-							 = ntohl(inet_addr(content_buf));
-						IPACMDBG_H("subnet_addr: %s \n", content_buf);
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, SUBNETMASK_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						content_buf[MAX_XML_STR_LEN-1] = '\0';
-						config->private_subnet_config.private_subnet_entries[config->private_subnet_config.num_subnet_entries - 1].subnet_mask
-							 = ntohl(inet_addr(content_buf));
-						IPACMDBG_H("subnet_mask: %s \n", content_buf);
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, Protocol_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						content_buf[MAX_XML_STR_LEN-1] = '\0';
-
-						if (0 == strncasecmp(content_buf, TCP_PROTOCOL_TAG, str_size))
-						{
-							config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol = IPPROTO_TCP;
-							IPACMDBG_H("Protocol %s: %d\n",
-									content_buf, config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol);
-						}
-						else if (0 == strncasecmp(content_buf, UDP_PROTOCOL_TAG, str_size))
-						{
-							config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol = IPPROTO_UDP;
-							IPACMDBG_H("Protocol %s: %d\n",
-									content_buf, config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].protocol);
-						}
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, Port_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].port
-							 = atoi(content_buf);
-						IPACMDBG_H("port %d\n", config->alg_config.alg_entries[config->alg_config.num_alg_entries - 1].port);
-					}
-				}
-				else if (IPACM_util_icmp_string((char*)xml_node->name, NAT_MaxEntries_TAG) == 0)
-				{
-					content = IPACM_read_content_element(xml_node);
-					if (content)
-					{
-						str_size = strlen(content);
-						memset(content_buf, 0, sizeof(content_buf));
-						memcpy(content_buf, (void *)content, str_size);
-						config->nat_max_entries = atoi(content_buf);
-						IPACMDBG_H("Nat Table Max Entries %d\n", config->nat_max_entries);
-					}
+					visit_depth = depth + 1;
 				}
 			}
+			else
+			{
+				content = xmlTextReaderReadString(reader);
+				ipacm_cfg_xml_parse_leaf(name, (const char *)content, config);
+				xmlFree(content);
+			}
+			break;
+		case XML_READER_TYPE_END_ELEMENT:
+			if (depth + 1 == visit_depth)
+			{
+				visit_depth = depth;
+			}
 			break;
 		default:
 			break;
 		}
-		/* go to sibling */
-		xml_node = xml_node->next;
-	} /* end while */
+	}
+	xmlFreeTextReader(reader);
+
+	if (ret != 0)
+	{
+		IPACMDBG_H("IPACM_xml_parse: libxml returned parse error!\n");
+		return IPACM_FAILURE;
+	}
+	return IPACM_SUCCESS;
+}
+
+int ipacm_hash_fd
+(
+	 int fd,
+	 uint64_t *hash
+)
+{
+	char buf[1024];
+	uint64_t h = 14695981039346656037ULL;
+	ssize_t len, i;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+	{
+		for (i = 0; i < len; i++)
+		{
+			h = (h ^ (uint8_t)buf[i]) * 1099511628211ULL;
+		}
+	}
+	if (len < 0)
+	{
+		return IPACM_FAILURE;
+	}
+	*hash = h;
+	return IPACM_SUCCESS;
+}
+
+/* hash of the file content, size and mtime come from the same fd */
+static int ipacm_cfg_source_stat
+(
+	 const char *xml_file,
+	 ipacm_cfg_cache_hdr_t *hdr
+)
+{
+	struct stat st;
+	uint64_t h;
+	int fd, ret;
+
+	fd = open(xml_file, O_RDONLY);
+	if (fd < 0)
+	{
+		return IPACM_FAILURE;
+	}
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return IPACM_FAILURE;
+	}
+	ret = ipacm_hash_fd(fd, &h);
+	close(fd);
+	if (ret != IPACM_SUCCESS)
+	{
+		return IPACM_FAILURE;
+	}
+
+	memset(hdr, 0, sizeof(ipacm_cfg_cache_hdr_t));
+	hdr->magic = IPACM_CFG_CACHE_MAGIC;
+	hdr->version = IPACM_CFG_CACHE_VERSION;
+	hdr->conf_size = sizeof(IPACM_conf_t);
+	hdr->src_mtime_sec = st.st_mtim.tv_sec;
+	hdr->src_mtime_nsec = st.st_mtim.tv_nsec;
+	hdr->src_size = st.st_size;
+	hdr->src_hash = h;
+	return IPACM_SUCCESS;
+}
+
+/* Use the cached config when it was built from this very source */
+static int ipacm_cfg_cache_load
+(
+	 const ipacm_cfg_cache_hdr_t *src,
+	 IPACM_conf_t *config
+)
+{
+	const ipacm_cfg_cache_hdr_t *hdr;
+	size_t len = sizeof(ipacm_cfg_cache_hdr_t) + sizeof(IPACM_conf_t);
+	struct stat st;
+	void *ptr;
+	int fd, ret = IPACM_FAILURE;
+
+	fd = open(IPACM_CFG_CACHE_FILE, O_RDONLY);
+	if (fd < 0)
+	{
+		return IPACM_FAILURE;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size != len)
+	{
+		close(fd);
+		return IPACM_FAILURE;
+	}
+	ptr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED)
+	{
+		return IPACM_FAILURE;
+	}
+
+	hdr = (const ipacm_cfg_cache_hdr_t *)ptr;
+	if (memcmp(hdr, src, sizeof(ipacm_cfg_cache_hdr_t)) == 0)
+	{
+		memcpy(config, (const char *)ptr + sizeof(ipacm_cfg_cache_hdr_t), sizeof(IPACM_conf_t));
+		ret = IPACM_SUCCESS;
+	}
+	munmap(ptr, len);
+	return ret;
+}
+
+/* Write to a temporary file and rename, a reader never sees half a cache */
+static void ipacm_cfg_cache_store
+(
+	 const ipacm_cfg_cache_hdr_t *hdr,
+	 const IPACM_conf_t *config
+)
+{
+	char tmp_file[IPA_MAX_FILE_LEN];
+	int fd;
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", IPACM_CFG_CACHE_FILE);
+	fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+	{
+		IPACMDBG_H("unable to create %s\n", tmp_file);
+		return;
+	}
+	if (write(fd, hdr, sizeof(ipacm_cfg_cache_hdr_t)) != (ssize_t)sizeof(ipacm_cfg_cache_hdr_t) ||
+			write(fd, config, sizeof(IPACM_conf_t)) != (ssize_t)sizeof(IPACM_conf_t))
+	{
+		IPACMERR("unable to write %s\n", tmp_file);
+		close(fd);
+		unlink(tmp_file);
+		return;
+	}
+	close(fd);
+	if (rename(tmp_file, IPACM_CFG_CACHE_FILE) < 0)
+	{
+		IPACMERR("unable to rename %s\n", tmp_file);
+		unlink(tmp_file);
+	}
+}
+
+/* This function read IPACM XML and populate the IPA CM Cfg */
+int ipacm_read_cfg_xml(char *xml_file, IPACM_conf_t *config)
+{
+	ipacm_cfg_cache_hdr_t hdr;
+	int ret_val;
+
+	if (ipacm_cfg_source_stat(xml_file, &hdr) != IPACM_SUCCESS)
+	{
+		IPACMDBG_H("IPACM_xml_parse: unable to read %s\n", xml_file);
+		return IPACM_FAILURE;
+	}
+
+	if (ipacm_cfg_cache_load(&hdr, config) == IPACM_SUCCESS)
+	{
+		IPACMDBG_H("IPACM_xml_parse: using cached config %s\n", IPACM_CFG_CACHE_FILE);
+		return IPACM_SUCCESS;
+	}
+
+	ret_val = ipacm_cfg_xml_parse_stream(xml_file, config);
+	if (ret_val != IPACM_SUCCESS)
+	{
+		IPACMDBG_H("IPACM_xml_parse: ipacm_cfg_xml_parse_stream returned parse error!\n");
+		return ret_val;
+	}
+
+	ipacm_cfg_cache_store(&hdr, config);
 	return ret_val;
 }
 
+
 /* This function read QCMAP CM Firewall XML and populate the QCMAP CM Cfg */
 int IPACM_read_firewall_xml(char *xml_file, IPACM_firewall_conf_t *config)
 {
@@ -48,6 +48,16 @@ typedef struct {
 	uint8_t  protocol;
 } ipa_nat_ipv4_rule;
 
+/**
+ * struct ipa_nat_rule_ts - To hold time stamp of a nat rule
+ * @rule_hdl: handle of the nat rule
+ * @time_stamp: time stamp of the rule
+ */
+typedef struct {
+	uint32_t rule_hdl;
+	uint32_t time_stamp;
+} ipa_nat_rule_ts;
+
 /**
  * ipa_nat_add_ipv4_tbl() - create ipv4 nat table
  * @public_ip_addr: [in] public ipv4 address
@@ -98,6 +108,41 @@ int ipa_nat_add_ipv4_rule(uint32_t table_handle,
 int ipa_nat_del_ipv4_rule(uint32_t table_handle,
 				uint32_t rule_handle);
 
+/**
+ * ipa_nat_add_ipv4_rules() - to insert a batch of ipv4 rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rules: [in] array of new rules
+ * @num_rules: [in] number of rules in the array
+ * @rule_handles: [out] Return the handle of each rule
+ *
+ * To insert several ipv4 nat rules into ipv4 nat table.
+ * All the rules are written first and enabled with a single
+ * dma command. A rule which could not be added gets a 0 handle,
+ * the remaining rules are still added.
+ *
+ * Returns:	0  On Success, negative if any rule failed
+ */
+int ipa_nat_add_ipv4_rules(uint32_t table_handle,
+				const ipa_nat_ipv4_rule *rules,
+				uint16_t num_rules,
+				uint32_t *rule_handles);
+
+/**
+ * ipa_nat_del_ipv4_rules() - to delete a batch of ipv4 nat rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ *
+ * To delete several ipv4 nat rules from ipv4 nat table.
+ * Rules without collisions are disabled with a single
+ * dma command, 0 handles are skipped.
+ *
+ * Returns:	0  On Success, negative if any rule failed
+ */
+int ipa_nat_del_ipv4_rules(uint32_t table_handle,
+				const uint32_t *rule_handles,
+				uint16_t num_rules);
+
 
 /**
  * ipa_nat_query_timestamp() - to query timestamp
@@ -114,3 +159,21 @@ int ipa_nat_query_timestamp(uint32_t  table_handle,
 				uint32_t  rule_handle,
 				uint32_t  *time_stamp);
 
+/**
+ * ipa_nat_query_timestamps() - to query timestamp of all rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_ts: [out] rule handle and time stamp pairs
+ * @max_rules: [in] number of elements in rule_ts
+ * @num_rules: [out] number of pairs filled
+ *
+ * To retrieve the timestamp of every enabled nat rule
+ * with one walk over the nat table. Pairs are returned
+ * in rule handle order, at most max_rules of them
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_query_timestamps(uint32_t table_handle,
+				ipa_nat_rule_ts *rule_ts,
+				uint16_t max_rules,
+				uint16_t *num_rules);
+
@@ -85,6 +85,9 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPA_NAT_INVALID_INDEX 0xFF
 #define IPA_NAT_INVALID_NAT_ENTRY 0x0
 
+/* Max dma entries posted at once by the batch add/delete calls */
+#define IPA_NAT_MAX_DMA_BATCH_ENTRIES 128
+
 #define INDX_TBL_ENTRY_SIZE_IN_BITS  16
 
 /* ----------- Rule id -----------------------
@@ -314,6 +317,13 @@ struct ipa_nat_ip4_table_cache {
 	struct ipa_nat_indx_tbl_meta_info *index_expn_table_meta;
 
 	uint16_t *rule_id_array;
+
+	/* Stacks of free expansion/index expansion entries; entry 0 is
+		 never handed out as it denotes an invalid next index */
+	uint16_t *expn_free_list;
+	uint16_t expn_free_cnt;
+	uint16_t *index_expn_free_list;
+	uint16_t index_expn_free_cnt;
 #ifdef IPA_ON_R3PC
 	uint32_t mmap_offset;
 #endif
@@ -402,10 +412,24 @@ int ipa_nati_query_timestamp(uint32_t  tbl_hdl,
 				uint32_t  rule_hdl,
 				uint32_t  *time_stamp);
 
+int ipa_nati_query_timestamps(uint32_t tbl_hdl,
+				ipa_nat_rule_ts *rule_ts,
+				uint16_t max_rules,
+				uint16_t *num_rules);
+
 int ipa_nati_add_ipv4_rule(uint32_t tbl_hdl,
 				const ipa_nat_ipv4_rule *clnt_rule,
 				uint32_t *rule_hdl);
 
+int ipa_nati_add_ipv4_rules(uint32_t tbl_hdl,
+				const ipa_nat_ipv4_rule *clnt_rules,
+				uint16_t num_rules,
+				uint32_t *rule_hdls);
+
+int ipa_nati_del_ipv4_rules(uint32_t tbl_hdl,
+				const uint32_t *rule_hdls,
+				uint16_t num_rules);
+
 int ipa_nati_generate_rule(uint32_t tbl_hdl,
 				const ipa_nat_ipv4_rule *clnt_rule,
 				struct ipa_nat_sw_rule *rule,
@@ -413,8 +437,10 @@ int ipa_nati_generate_rule(uint32_t tbl_hdl,
 				uint16_t *tbl_entry,
 				uint16_t *indx_tbl_entry);
 
-uint16_t ipa_nati_expn_tbl_free_entry(struct ipa_nat_rule *expn_tbl,
-				uint16_t size);
+uint16_t ipa_nati_expn_tbl_free_entry(struct ipa_nat_ip4_table_cache *tbl_ptr);
+
+void ipa_nati_expn_tbl_release_entry(struct ipa_nat_ip4_table_cache *tbl_ptr,
+				uint16_t entry);
 
 uint16_t ipa_nati_generate_tbl_rule(const ipa_nat_ipv4_rule *clnt_rule,
 				struct ipa_nat_sw_rule *sw_rule,
@@ -424,8 +450,14 @@ uint16_t ipa_nati_generate_index_rule(const ipa_nat_ipv4_rule *clnt_rule,
 				struct ipa_nat_indx_tbl_sw_rule *sw_rule,
 				struct ipa_nat_ip4_table_cache *tbl_ptr);
 
-uint16_t ipa_nati_index_expn_get_free_entry(struct ipa_nat_indx_tbl_rule *tbl,
-				uint16_t size);
+uint16_t ipa_nati_index_expn_get_free_entry(
+				struct ipa_nat_ip4_table_cache *tbl_ptr);
+
+void ipa_nati_index_expn_release_entry(
+				struct ipa_nat_ip4_table_cache *tbl_ptr,
+				uint16_t entry);
+
+void ipa_nati_reset_free_lists(struct ipa_nat_ip4_table_cache *tbl_ptr);
 
 void ipa_nati_copy_ipv4_rule_to_hw(
 				struct ipa_nat_ip4_table_cache *ipv4_cache,
@@ -437,7 +469,7 @@ void ipa_nati_copy_ipv4_index_rule_to_hw(
 				struct ipa_nat_indx_tbl_sw_rule *indx_sw_rule,
 				uint16_t entry, uint8_t tbl_index);
 
-void ipa_nati_write_next_index(uint8_t tbl_indx,
+int ipa_nati_write_next_index(uint8_t tbl_indx,
 				nat_table_type tbl_type,
 				uint16_t value,
 				uint32_t offset);
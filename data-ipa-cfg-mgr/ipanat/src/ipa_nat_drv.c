@@ -146,6 +146,66 @@ int ipa_nat_del_ipv4_rule(uint32_t tbl_hdl,
   return 0;
 }
 
+/**
+ * ipa_nat_add_ipv4_rules() - to insert a batch of ipv4 rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rules: [in] array of new rules
+ * @num_rules: [in] number of rules in the array
+ * @rule_handles: [out] Return the handle of each rule
+ *
+ * To insert several ipv4 nat rules into ipv4 nat table
+ * with a single dma command
+ *
+ * Returns:	0  On Success, negative if any rule failed
+ */
+int ipa_nat_add_ipv4_rules(uint32_t tbl_hdl,
+		const ipa_nat_ipv4_rule *clnt_rules,
+		uint16_t num_rules,
+		uint32_t *rule_hdls)
+{
+  if (IPA_NAT_INVALID_NAT_ENTRY == tbl_hdl ||
+      tbl_hdl > IPA_NAT_MAX_IP4_TBLS || NULL == rule_hdls ||
+      NULL == clnt_rules) {
+    IPAERR("invalide table handle passed \n");
+    return -EINVAL;
+  }
+  IPADBG("Passed Table handle: 0x%x, rules: %d\n", tbl_hdl, num_rules);
+
+  return ipa_nati_add_ipv4_rules(tbl_hdl, clnt_rules, num_rules, rule_hdls);
+}
+
+/**
+ * ipa_nat_del_ipv4_rules() - to delete a batch of ipv4 nat rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_handles: [in] array of ipv4 nat rule handles
+ * @num_rules: [in] number of handles in the array
+ *
+ * To delete several ipv4 nat rules from ipv4 nat table
+ *
+ * Returns:	0  On Success, negative if any rule failed
+ */
+int ipa_nat_del_ipv4_rules(uint32_t tbl_hdl,
+		const uint32_t *rule_hdls,
+		uint16_t num_rules)
+{
+  int result;
+
+  if (IPA_NAT_INVALID_NAT_ENTRY == tbl_hdl ||
+      tbl_hdl > IPA_NAT_MAX_IP4_TBLS || NULL == rule_hdls) {
+    IPAERR("invalide parameters\n");
+    return -EINVAL;
+  }
+  IPADBG("Passed Table: 0x%x and %d rule handles\n", tbl_hdl, num_rules);
+
+  result = ipa_nati_del_ipv4_rules(tbl_hdl, rule_hdls, num_rules);
+  if (result) {
+    IPAERR("unable to delete rules from hw \n");
+    return result;
+  }
+
+  return 0;
+}
+
 /**
  * ipa_nat_query_timestamp() - to query timestamp
  * @table_handle: [in] handle of ipv4 nat table
@@ -173,3 +233,31 @@ int ipa_nat_query_timestamp(uint32_t  tbl_hdl,
 }
 
 
+
+/**
+ * ipa_nat_query_timestamps() - to query timestamp of all rules
+ * @table_handle: [in] handle of ipv4 nat table
+ * @rule_ts: [out] rule handle and time stamp pairs
+ * @max_rules: [in] number of elements in rule_ts
+ * @num_rules: [out] number of pairs filled
+ *
+ * To retrieve the timestamp of every enabled nat rule
+ * with one walk over the nat table
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_query_timestamps(uint32_t tbl_hdl,
+		ipa_nat_rule_ts *rule_ts,
+		uint16_t max_rules,
+		uint16_t *num_rules)
+{
+
+  if (0 == tbl_hdl || tbl_hdl > IPA_NAT_MAX_IP4_TBLS ||
+      NULL == rule_ts || NULL == num_rules) {
+    IPAERR("invalid parameters passed \n");
+    return -EINVAL;
+  }
+  IPADBG("Passed Table: 0x%x, max rules %d\n", tbl_hdl, max_rules);
+
+  return ipa_nati_query_timestamps(tbl_hdl, rule_ts, max_rules, num_rules);
+}
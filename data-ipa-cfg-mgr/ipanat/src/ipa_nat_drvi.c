@@ -634,6 +634,9 @@ void ipa_nati_reset_tbl(uint8_t tbl_indx)
 				 0,
 				 IPA_NAT_INDEX_TABLE_ENTRY_SIZE * expn_table_entries);
 
+	/* All expansion entries are free again */
+	ipa_nati_reset_free_lists(&ipv4_nat_cache.ip4_tbl[tbl_indx]);
+
 	IPADBG("returning from ipa_nati_reset_tbl()\n");
 	return;
 }
@@ -751,8 +754,10 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 	int flags = MAP_SHARED;
 	int prot = PROT_READ | PROT_WRITE;
 	off_t offset = 0;
-#ifdef IPA_ON_R3PC
 	int ret = 0;
+	/* tables allocated by this call, freed again on failure */
+	int new_meta = 0, new_rule_ids = 0, new_expn_free = 0, new_index_expn_free = 0;
+#ifdef IPA_ON_R3PC
 	uint32_t nat_mem_offset = 0;
 #endif
 
@@ -774,8 +779,10 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 
 		if (NULL == ipv4_nat_cache.ip4_tbl[index].index_expn_table_meta) {
 			IPAERR("Fail to allocate ipv4 index expansion table meta\n");
-			return 0;
+			ret = -ENOMEM;
+			goto fail;
 		}
+		new_meta = 1;
 
 		memset(ipv4_nat_cache.ip4_tbl[index].index_expn_table_meta,
 					 0,
@@ -789,14 +796,40 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 
 		if (NULL == ipv4_nat_cache.ip4_tbl[index].rule_id_array) {
 			IPAERR("Fail to allocate rule id array\n");
-			return 0;
+			ret = -ENOMEM;
+			goto fail;
 		}
+		new_rule_ids = 1;
 
 		memset(ipv4_nat_cache.ip4_tbl[index].rule_id_array,
 					 0,
 					 sizeof(uint16_t) * (tbl_entries + expn_tbl_entries));
 	}
 
+	/* Allocate memory for expansion table free lists */
+	if (NULL == ipv4_nat_cache.ip4_tbl[index].expn_free_list) {
+		ipv4_nat_cache.ip4_tbl[index].expn_free_list =
+			 malloc(sizeof(uint16_t) * expn_tbl_entries);
+
+		if (NULL == ipv4_nat_cache.ip4_tbl[index].expn_free_list) {
+			IPAERR("Fail to allocate expansion table free list\n");
+			ret = -ENOMEM;
+			goto fail;
+		}
+		new_expn_free = 1;
+	}
+
+	if (NULL == ipv4_nat_cache.ip4_tbl[index].index_expn_free_list) {
+		ipv4_nat_cache.ip4_tbl[index].index_expn_free_list =
+			 malloc(sizeof(uint16_t) * expn_tbl_entries);
+
+		if (NULL == ipv4_nat_cache.ip4_tbl[index].index_expn_free_list) {
+			IPAERR("Fail to allocate index expansion table free list\n");
+			ret = -ENOMEM;
+			goto fail;
+		}
+		new_index_expn_free = 1;
+	}
 
 	/* open the nat table */
 	strlcpy(mem->dev_name, NAT_DEV_FULL_NAME, IPA_RESOURCE_NAME_MAX);
@@ -804,7 +837,8 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 	if (fd < 0) {
 		perror("ipa_nati_update_cache(): open error value:");
 		IPAERR("unable to open nat device. Error:%d\n", fd);
-		return -EIO;
+		ret = -EIO;
+		goto fail;
 	}
 
 	/* copy the nat table name */
@@ -826,7 +860,10 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 #endif
 	if (MAP_FAILED  == ipv4_rules_addr) {
 		perror("unable to mmap the memory\n");
-		return -EINVAL;
+		close(fd);
+		ipv4_nat_cache.ip4_tbl[index].nat_fd = 0;
+		ret = -EINVAL;
+		goto fail;
 	}
 
 #ifdef IPA_ON_R3PC
@@ -835,7 +872,11 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 		perror("ipa_nati_post_ipv4_init_cmd(): ioctl error value");
 		IPAERR("unable to post ant offset cmd Error: %d\n", ret);
 		IPADBG("ipa fd %d\n", ipv4_nat_cache.ipa_fd);
-		return -EIO;
+		munmap(ipv4_rules_addr, NAT_MMAP_MEM_SIZE);
+		close(fd);
+		ipv4_nat_cache.ip4_tbl[index].nat_fd = 0;
+		ret = -EIO;
+		goto fail;
 	}
 	ipv4_rules_addr += nat_mem_offset;
 	ipv4_nat_cache.ip4_tbl[index].mmap_offset = nat_mem_offset;
@@ -857,6 +898,25 @@ int ipa_nati_update_cache(struct ipa_ioc_nat_alloc_mem *mem,
 	(IPA_NAT_INDEX_TABLE_ENTRY_SIZE * tbl_entries);
 
 	return 0;
+
+fail:
+	if (new_meta) {
+		free(ipv4_nat_cache.ip4_tbl[index].index_expn_table_meta);
+		ipv4_nat_cache.ip4_tbl[index].index_expn_table_meta = NULL;
+	}
+	if (new_rule_ids) {
+		free(ipv4_nat_cache.ip4_tbl[index].rule_id_array);
+		ipv4_nat_cache.ip4_tbl[index].rule_id_array = NULL;
+	}
+	if (new_expn_free) {
+		free(ipv4_nat_cache.ip4_tbl[index].expn_free_list);
+		ipv4_nat_cache.ip4_tbl[index].expn_free_list = NULL;
+	}
+	if (new_index_expn_free) {
+		free(ipv4_nat_cache.ip4_tbl[index].index_expn_free_list);
+		ipv4_nat_cache.ip4_tbl[index].index_expn_free_list = NULL;
+	}
+	return ret;
 }
 
 /* comment: check the implementation once
@@ -947,6 +1007,8 @@ int ipa_nati_del_ipv4_table(uint32_t tbl_hdl)
 
 	free(ipv4_nat_cache.ip4_tbl[index].index_expn_table_meta);
 	free(ipv4_nat_cache.ip4_tbl[index].rule_id_array);
+	free(ipv4_nat_cache.ip4_tbl[index].expn_free_list);
+	free(ipv4_nat_cache.ip4_tbl[index].index_expn_free_list);
 
 	memset(&ipv4_nat_cache.ip4_tbl[index],
 				 0,
@@ -1014,6 +1076,152 @@ int ipa_nati_query_timestamp(uint32_t  tbl_hdl,
 	return 0;
 }
 
+int ipa_nati_query_timestamps(uint32_t tbl_hdl,
+				ipa_nat_rule_ts *rule_ts,
+				uint16_t max_rules,
+				uint16_t *num_rules)
+{
+	uint8_t tbl_index = (uint8_t)(tbl_hdl - 1);
+	struct ipa_nat_ip4_table_cache *cache_ptr;
+	struct ipa_nat_rule *tbl_ptr, *expn_tbl_ptr, *rule;
+	uint16_t rule_id, tbl_entry;
+	uint16_t filled = 0;
+	int cnt;
+
+	*num_rules = 0;
+	cache_ptr = &ipv4_nat_cache.ip4_tbl[tbl_index];
+	if (!cache_ptr->valid) {
+		IPAERR("invalid table handle\n");
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex) != 0) {
+		IPAERR("unable to lock the nat mutex\n");
+		return -1;
+	}
+
+	tbl_ptr = (struct ipa_nat_rule *)cache_ptr->ipv4_rules_addr;
+	expn_tbl_ptr = (struct ipa_nat_rule *)cache_ptr->ipv4_expn_rules_addr;
+
+	/* rule handle is the index into rule_id_array plus one */
+	for (cnt = 0;
+			 cnt < (cache_ptr->table_entries + cache_ptr->expn_table_entries) &&
+			 filled < max_rules;
+			 cnt++) {
+		rule_id = cache_ptr->rule_id_array[cnt];
+		if (IPA_NAT_INVALID_NAT_ENTRY == rule_id) {
+			continue;
+		}
+
+		tbl_entry = (rule_id >> IPA_NAT_RULE_HDL_TBL_TYPE_BITS);
+		if (rule_id & IPA_NAT_RULE_HDL_TBL_TYPE_MASK) {
+			rule = &expn_tbl_ptr[tbl_entry];
+		} else {
+			rule = &tbl_ptr[tbl_entry];
+		}
+
+		if (!Read16BitFieldValue(rule->ip_cksm_enbl, ENABLE_FIELD)) {
+			continue;
+		}
+
+		rule_ts[filled].rule_hdl = cnt + 1;
+		rule_ts[filled].time_stamp = Read32BitFieldValue(rule->ts_proto,
+					TIME_STAMP_FIELD);
+		filled++;
+	}
+
+	*num_rules = filled;
+
+	if (pthread_mutex_unlock(&nat_mutex) != 0) {
+		IPAERR("unable to unlock the nat mutex\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Take back a rule whose enable dma failed. Its entries are already
+	 linked at the tail of their rule and index table chains, so the
+	 previous entries are pointed back at the end of the chain before the
+	 entries are freed. If that dma fails as well the entry stays reserved,
+	 since the chain still leads through it */
+static void ipa_nati_undo_add(uint8_t tbl_indx,
+				uint16_t entry)
+{
+	struct ipa_nat_ip4_table_cache *tbl_ptr = &ipv4_nat_cache.ip4_tbl[tbl_indx];
+	struct ipa_nat_rule *rule;
+	struct ipa_nat_indx_tbl_rule *indx_rule;
+	nat_table_type tbl_type;
+	uint16_t prev, indx_entry;
+	uint32_t offset;
+
+	if (entry < tbl_ptr->table_entries) {
+		rule = &((struct ipa_nat_rule *)tbl_ptr->ipv4_rules_addr)[entry];
+	} else {
+		rule = &((struct ipa_nat_rule *)
+			tbl_ptr->ipv4_expn_rules_addr)[entry - tbl_ptr->table_entries];
+	}
+	prev = Read16BitFieldValue(rule->sw_spec_params,
+														 SW_SPEC_PARAM_PREV_INDEX_FIELD);
+	indx_entry = Read16BitFieldValue(rule->sw_spec_params,
+																	 SW_SPEC_PARAM_INDX_TBL_ENTRY_FIELD);
+
+	/* index table entry */
+	if (indx_entry < tbl_ptr->table_entries) {
+		indx_rule = &((struct ipa_nat_indx_tbl_rule *)
+			tbl_ptr->index_table_addr)[indx_entry];
+		memset(indx_rule, 0, sizeof(*indx_rule));
+	} else {
+		indx_entry -= tbl_ptr->table_entries;
+		indx_rule = &((struct ipa_nat_indx_tbl_rule *)
+			tbl_ptr->index_table_expn_addr)[indx_entry];
+
+		tbl_type = IPA_NAT_INDX_TBL;
+		prev = tbl_ptr->index_expn_table_meta[indx_entry].prev_index;
+		if (prev >= tbl_ptr->table_entries) {
+			tbl_type = IPA_NAT_INDEX_EXPN_TBL;
+			prev -= tbl_ptr->table_entries;
+		}
+		offset = ipa_nati_get_index_entry_offset(tbl_ptr, tbl_type, prev);
+		offset += IPA_NAT_INDEX_RULE_NEXT_FIELD_OFFSET;
+
+		if (ipa_nati_write_next_index(tbl_indx, tbl_type,
+					IPA_NAT_INVALID_NAT_ENTRY, offset)) {
+			IPAERR("index expansion entry %d stays reserved\n", indx_entry);
+		} else {
+			memset(indx_rule, 0, sizeof(*indx_rule));
+			tbl_ptr->index_expn_table_meta[indx_entry].prev_index = 0;
+			ipa_nati_index_expn_release_entry(tbl_ptr, indx_entry);
+		}
+	}
+
+	/* rule table entry */
+	prev = Read16BitFieldValue(rule->sw_spec_params,
+														 SW_SPEC_PARAM_PREV_INDEX_FIELD);
+	if (entry < tbl_ptr->table_entries) {
+		/* head of its chain, nothing links to it */
+		memset(rule, 0, sizeof(*rule));
+		return;
+	}
+
+	tbl_type = IPA_NAT_BASE_TBL;
+	if (prev >= tbl_ptr->table_entries) {
+		tbl_type = IPA_NAT_EXPN_TBL;
+		prev -= tbl_ptr->table_entries;
+	}
+	offset = ipa_nati_get_entry_offset(tbl_ptr, tbl_type, prev);
+	offset += IPA_NAT_RULE_NEXT_FIELD_OFFSET;
+
+	if (ipa_nati_write_next_index(tbl_indx, tbl_type,
+				IPA_NAT_INVALID_NAT_ENTRY, offset)) {
+		IPAERR("expansion entry %d stays reserved\n",
+			entry - tbl_ptr->table_entries);
+		return;
+	}
+	memset(rule, 0, sizeof(*rule));
+	ipa_nati_expn_tbl_release_entry(tbl_ptr, entry - tbl_ptr->table_entries);
+}
+
 int ipa_nati_add_ipv4_rule(uint32_t tbl_hdl,
 				const ipa_nat_ipv4_rule *clnt_rule,
 				uint32_t *rule_hdl)
@@ -1022,16 +1230,25 @@ int ipa_nati_add_ipv4_rule(uint32_t tbl_hdl,
 	struct ipa_nat_sw_rule sw_rule;
 	struct ipa_nat_indx_tbl_sw_rule index_sw_rule;
 	uint16_t new_entry, new_index_tbl_entry;
+	int ret = 0;
 
 	memset(&sw_rule, 0, sizeof(sw_rule));
 	memset(&index_sw_rule, 0, sizeof(index_sw_rule));
 
+	/* Rules may be added from several threads, the table walk
+		 and the dma must not interleave with other updates */
+	if (pthread_mutex_lock(&nat_mutex) != 0) {
+		IPAERR("unable to lock the nat mutex\n");
+		return -1;
+	}
+
 	/* Generate rule from client input */
 	if (ipa_nati_generate_rule(tbl_hdl, clnt_rule,
 					&sw_rule, &index_sw_rule,
 					&new_entry, &new_index_tbl_entry)) {
 		IPAERR("unable to generate rule\n");
-		return -EINVAL;
+		ret = -EINVAL;
+		goto unlock;
 	}
 
 	tbl_ptr = &ipv4_nat_cache.ip4_tbl[tbl_hdl-1];
@@ -1044,21 +1261,30 @@ int ipa_nati_add_ipv4_rule(uint32_t tbl_hdl,
 	IPADBG("new entry:%d, new index entry: %d\n", new_entry, new_index_tbl_entry);
 	if (ipa_nati_post_ipv4_dma_cmd((uint8_t)(tbl_hdl - 1), new_entry)) {
 		IPAERR("unable to post dma command\n");
-		return -EIO;
+		ipa_nati_undo_add((uint8_t)(tbl_hdl - 1), new_entry);
+		ret = -EIO;
+		goto unlock;
 	}
 
 	/* Generate rule handle */
 	*rule_hdl  = ipa_nati_make_rule_hdl((uint16_t)tbl_hdl, new_entry);
 	if (!(*rule_hdl)) {
 		IPAERR("unable to generate rule handle\n");
-		return -EINVAL;
+		ret = -EINVAL;
+		goto unlock;
 	}
 
 #ifdef NAT_DUMP
 	ipa_nat_dump_ipv4_table(tbl_hdl);
 #endif
 
-	return 0;
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex) != 0) {
+		IPAERR("unable to unlock the nat mutex\n");
+		return -1;
+	}
+
+	return ret;
 }
 
 int ipa_nati_generate_rule(uint32_t tbl_hdl,
@@ -1094,6 +1320,11 @@ int ipa_nati_generate_rule(uint32_t tbl_hdl,
 																								 tbl_ptr);
 	if (IPA_NAT_INVALID_NAT_ENTRY == *indx_tbl_entry) {
 		IPAERR("unable to generate index table entry\n");
+		/* Give back the expansion entry taken for the rule */
+		if (*tbl_entry >= tbl_ptr->table_entries) {
+			ipa_nati_expn_tbl_release_entry(tbl_ptr,
+				*tbl_entry - tbl_ptr->table_entries);
+		}
 		return -EINVAL;
 	}
 
@@ -1197,8 +1428,7 @@ uint16_t ipa_nati_generate_tbl_rule(const ipa_nat_ipv4_rule *clnt_rule,
 	}
 
 	/* On collision check for the free entry in expansion table */
-	new_entry = ipa_nati_expn_tbl_free_entry(expn_tbl,
-					tbl_ptr->expn_table_entries);
+	new_entry = ipa_nati_expn_tbl_free_entry(tbl_ptr);
 
 	if (IPA_NAT_INVALID_NAT_ENTRY == new_entry) {
 		/* Expansion table is full return*/
@@ -1213,22 +1443,46 @@ uint16_t ipa_nati_generate_tbl_rule(const ipa_nat_ipv4_rule *clnt_rule,
 	return new_entry;
 }
 
+void ipa_nati_reset_free_lists(struct ipa_nat_ip4_table_cache *tbl_ptr)
+{
+	uint16_t cnt;
+
+	tbl_ptr->expn_free_cnt = 0;
+	tbl_ptr->index_expn_free_cnt = 0;
+
+	/* Push in reverse order so that the lowest entry is popped first */
+	for (cnt = tbl_ptr->expn_table_entries; cnt > 1; cnt--) {
+		tbl_ptr->expn_free_list[tbl_ptr->expn_free_cnt++] = cnt - 1;
+		tbl_ptr->index_expn_free_list[tbl_ptr->index_expn_free_cnt++] = cnt - 1;
+	}
+}
+
 /* returns expn table entry index */
-uint16_t ipa_nati_expn_tbl_free_entry(struct ipa_nat_rule *expn_tbl,
-						uint16_t size)
+uint16_t ipa_nati_expn_tbl_free_entry(struct ipa_nat_ip4_table_cache *tbl_ptr)
 {
-	int cnt;
+	uint16_t entry;
 
-	for (cnt = 1; cnt < size; cnt++) {
-		if (!Read16BitFieldValue(expn_tbl[cnt].ip_cksm_enbl,
-														 ENABLE_FIELD)) {
-			IPADBG("new expansion table entry index %d\n", cnt);
-			return cnt;
-		}
+	if (0 == tbl_ptr->expn_free_cnt) {
+		IPAERR("nat expansion table is full\n");
+		return 0;
 	}
 
-	IPAERR("nat expansion table is full\n");
-	return 0;
+	entry = tbl_ptr->expn_free_list[--tbl_ptr->expn_free_cnt];
+	IPADBG("new expansion table entry index %d\n", entry);
+	return entry;
+}
+
+void ipa_nati_expn_tbl_release_entry(struct ipa_nat_ip4_table_cache *tbl_ptr,
+						uint16_t entry)
+{
+	if (IPA_NAT_INVALID_NAT_ENTRY == entry ||
+			entry >= tbl_ptr->expn_table_entries ||
+			tbl_ptr->expn_free_cnt >= tbl_ptr->expn_table_entries - 1) {
+		IPAERR("invalid expansion table entry %d to release\n", entry);
+		return;
+	}
+
+	tbl_ptr->expn_free_list[tbl_ptr->expn_free_cnt++] = entry;
 }
 
 uint16_t ipa_nati_generate_index_rule(const ipa_nat_ipv4_rule *clnt_rule,
@@ -1287,8 +1541,7 @@ uint16_t ipa_nati_generate_index_rule(const ipa_nat_ipv4_rule *clnt_rule,
 	}
 
 	/* On collision check for the free entry in expansion table */
-	new_entry = ipa_nati_index_expn_get_free_entry(indx_expn_tbl,
-					tbl_ptr->expn_table_entries);
+	new_entry = ipa_nati_index_expn_get_free_entry(tbl_ptr);
 
 	if (IPA_NAT_INVALID_NAT_ENTRY == new_entry) {
 		/* Expansion table is full return*/
@@ -1313,27 +1566,37 @@ uint16_t ipa_nati_generate_index_rule(const ipa_nat_ipv4_rule *clnt_rule,
 
 /* returns index expn table entry index */
 uint16_t ipa_nati_index_expn_get_free_entry(
-						struct ipa_nat_indx_tbl_rule *indx_tbl,
-						uint16_t size)
+						struct ipa_nat_ip4_table_cache *tbl_ptr)
 {
-	int cnt;
-	for (cnt = 1; cnt < size; cnt++) {
-		if (!Read16BitFieldValue(indx_tbl[cnt].tbl_entry_nxt_indx,
-														 INDX_TBL_TBL_ENTRY_FIELD)) {
-			return cnt;
-		}
+	if (0 == tbl_ptr->index_expn_free_cnt) {
+		IPAERR("nat index expansion table is full\n");
+		return 0;
 	}
 
-	IPAERR("nat index expansion table is full\n");
-	return 0;
+	return tbl_ptr->index_expn_free_list[--tbl_ptr->index_expn_free_cnt];
 }
 
-void ipa_nati_write_next_index(uint8_t tbl_indx,
+void ipa_nati_index_expn_release_entry(
+						struct ipa_nat_ip4_table_cache *tbl_ptr,
+						uint16_t entry)
+{
+	if (IPA_NAT_INVALID_NAT_ENTRY == entry ||
+			entry >= tbl_ptr->expn_table_entries ||
+			tbl_ptr->index_expn_free_cnt >= tbl_ptr->expn_table_entries - 1) {
+		IPAERR("invalid index expansion table entry %d to release\n", entry);
+		return;
+	}
+
+	tbl_ptr->index_expn_free_list[tbl_ptr->index_expn_free_cnt++] = entry;
+}
+
+int ipa_nati_write_next_index(uint8_t tbl_indx,
 				nat_table_type tbl_type,
 				uint16_t value,
 				uint32_t offset)
 {
 	struct ipa_ioc_nat_dma_cmd *cmd;
+	int ret = 0;
 
 	IPADBG("Updating next index field of table %d on collosion using dma\n", tbl_type);
 	IPADBG("table index: %d, value: %d offset;%d\n", tbl_indx, value, offset);
@@ -1343,7 +1606,7 @@ void ipa_nati_write_next_index(uint8_t tbl_indx,
 				 sizeof(struct ipa_ioc_nat_dma_one));
 	if (NULL == cmd) {
 		IPAERR("unable to allocate memory\n");
-		return;
+		return -ENOMEM;
 	}
 
 	cmd->dma[0].table_index = tbl_indx;
@@ -1356,13 +1619,14 @@ void ipa_nati_write_next_index(uint8_t tbl_indx,
 		perror("ipa_nati_post_ipv4_dma_cmd(): ioctl error value");
 		IPAERR("unable to call dma icotl to update next index\n");
 		IPAERR("ipa fd %d\n", ipv4_nat_cache.ipa_fd);
+		ret = -EIO;
 		goto fail;
 	}
 
 fail:
 	free(cmd);
 
-	return;
+	return ret;
 }
 
 void ipa_nati_copy_ipv4_rule_to_hw(
@@ -1461,45 +1725,54 @@ void ipa_nati_copy_ipv4_index_rule_to_hw(
 	return;
 }
 
-int ipa_nati_post_ipv4_dma_cmd(uint8_t tbl_indx,
-				uint16_t entry)
+/* Fill the dma command which sets the enable bit of a rule */
+static void ipa_nati_fill_enable_dma_cmd(uint8_t tbl_indx,
+				uint16_t entry,
+				struct ipa_ioc_nat_dma_one *dma)
 {
-	struct ipa_ioc_nat_dma_cmd *cmd;
 	struct ipa_nat_rule *tbl_ptr;
 	uint32_t offset = ipv4_nat_cache.ip4_tbl[tbl_indx].tbl_addr_offset;
-	int ret = 0;
-
-	cmd = (struct ipa_ioc_nat_dma_cmd *)
-	malloc(sizeof(struct ipa_ioc_nat_dma_cmd)+
-				 sizeof(struct ipa_ioc_nat_dma_one));
-	if (NULL == cmd) {
-		IPAERR("unable to allocate memory\n");
-		return -ENOMEM;
-	}
 
 	if (entry < ipv4_nat_cache.ip4_tbl[tbl_indx].table_entries) {
 		tbl_ptr =
 			 (struct ipa_nat_rule *)ipv4_nat_cache.ip4_tbl[tbl_indx].ipv4_rules_addr;
 
-		cmd->dma[0].table_index = tbl_indx;
-		cmd->dma[0].base_addr = IPA_NAT_BASE_TBL;
-		cmd->dma[0].data = IPA_NAT_FLAG_ENABLE_BIT_MASK;
+		dma->table_index = tbl_indx;
+		dma->base_addr = IPA_NAT_BASE_TBL;
+		dma->data = IPA_NAT_FLAG_ENABLE_BIT_MASK;
 
-		cmd->dma[0].offset = (char *)&tbl_ptr[entry] - (char *)tbl_ptr;
-		cmd->dma[0].offset += IPA_NAT_RULE_FLAG_FIELD_OFFSET;
+		dma->offset = (char *)&tbl_ptr[entry] - (char *)tbl_ptr;
+		dma->offset += IPA_NAT_RULE_FLAG_FIELD_OFFSET;
 	} else {
 		tbl_ptr =
 			 (struct ipa_nat_rule *)ipv4_nat_cache.ip4_tbl[tbl_indx].ipv4_expn_rules_addr;
 		entry = entry - ipv4_nat_cache.ip4_tbl[tbl_indx].table_entries;
 
-		cmd->dma[0].table_index = tbl_indx;
-		cmd->dma[0].base_addr = IPA_NAT_EXPN_TBL;
-		cmd->dma[0].data = IPA_NAT_FLAG_ENABLE_BIT_MASK;
+		dma->table_index = tbl_indx;
+		dma->base_addr = IPA_NAT_EXPN_TBL;
+		dma->data = IPA_NAT_FLAG_ENABLE_BIT_MASK;
 
-		cmd->dma[0].offset = (char *)&tbl_ptr[entry] - (char *)tbl_ptr;
-		cmd->dma[0].offset += IPA_NAT_RULE_FLAG_FIELD_OFFSET;
-		cmd->dma[0].offset += offset;
+		dma->offset = (char *)&tbl_ptr[entry] - (char *)tbl_ptr;
+		dma->offset += IPA_NAT_RULE_FLAG_FIELD_OFFSET;
+		dma->offset += offset;
 	}
+}
+
+int ipa_nati_post_ipv4_dma_cmd(uint8_t tbl_indx,
+				uint16_t entry)
+{
+	struct ipa_ioc_nat_dma_cmd *cmd;
+	int ret = 0;
+
+	cmd = (struct ipa_ioc_nat_dma_cmd *)
+	malloc(sizeof(struct ipa_ioc_nat_dma_cmd)+
+				 sizeof(struct ipa_ioc_nat_dma_one));
+	if (NULL == cmd) {
+		IPAERR("unable to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	ipa_nati_fill_enable_dma_cmd(tbl_indx, entry, &cmd->dma[0]);
 
 	cmd->entries = 1;
 	if (ioctl(ipv4_nat_cache.ipa_fd, IPA_IOC_NAT_DMA, cmd)) {
@@ -1518,6 +1791,159 @@ fail:
 	return ret;
 }
 
+static int ipa_nati_batch_has_entry(const uint16_t *entries,
+				int cnt,
+				uint16_t entry)
+{
+	int indx;
+
+	for (indx = 0; indx < cnt; indx++) {
+		if (entries[indx] == entry) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Enable the written rules of a batch with one dma command
+	 and hand out their rule handles */
+static int ipa_nati_post_add_batch(uint32_t tbl_hdl,
+				struct ipa_ioc_nat_dma_cmd *cmd,
+				const uint16_t *entries,
+				const uint16_t *pos,
+				int cnt,
+				uint32_t *rule_hdls)
+{
+	uint8_t tbl_indx = (uint8_t)(tbl_hdl - 1);
+	int indx, ret = 0;
+
+	for (indx = 0; indx < cnt; indx++) {
+		ipa_nati_fill_enable_dma_cmd(tbl_indx, entries[indx], &cmd->dma[indx]);
+	}
+
+	cmd->entries = cnt;
+	if (ioctl(ipv4_nat_cache.ipa_fd, IPA_IOC_NAT_DMA, cmd)) {
+		perror("ipa_nati_post_add_batch(): ioctl error value");
+		IPAERR("unable to post dma command for %d rules\n", cnt);
+		IPADBG("ipa fd %d\n", ipv4_nat_cache.ipa_fd);
+
+		/* A rule may be linked behind an earlier one of the batch */
+		for (indx = cnt - 1; indx >= 0; indx--) {
+			ipa_nati_undo_add(tbl_indx, entries[indx]);
+		}
+		return -EIO;
+	}
+	IPADBG("posted IPA_IOC_NAT_DMA for %d rules during batch add\n", cnt);
+
+	for (indx = 0; indx < cnt; indx++) {
+		rule_hdls[pos[indx]] =
+			ipa_nati_make_rule_hdl((uint16_t)tbl_hdl, entries[indx]);
+		if (!rule_hdls[pos[indx]]) {
+			IPAERR("unable to generate rule handle\n");
+			ret = -EINVAL;
+		}
+	}
+
+	return ret;
+}
+
+int ipa_nati_add_ipv4_rules(uint32_t tbl_hdl,
+				const ipa_nat_ipv4_rule *clnt_rules,
+				uint16_t num_rules,
+				uint32_t *rule_hdls)
+{
+	struct ipa_nat_ip4_table_cache *tbl_ptr;
+	struct ipa_nat_sw_rule sw_rule;
+	struct ipa_nat_indx_tbl_sw_rule index_sw_rule;
+	struct ipa_ioc_nat_dma_cmd *cmd;
+	uint16_t new_entry, new_index_tbl_entry, base_entry;
+	uint16_t entries[IPA_NAT_MAX_DMA_BATCH_ENTRIES];
+	uint16_t pos[IPA_NAT_MAX_DMA_BATCH_ENTRIES];
+	int cnt, pending = 0, ret = 0;
+
+	tbl_ptr = &ipv4_nat_cache.ip4_tbl[tbl_hdl-1];
+	if (!tbl_ptr->valid) {
+		IPAERR("invalid table handle\n");
+		return -EINVAL;
+	}
+
+	cmd = (struct ipa_ioc_nat_dma_cmd *)
+	malloc(sizeof(struct ipa_ioc_nat_dma_cmd)+
+				 (IPA_NAT_MAX_DMA_BATCH_ENTRIES * sizeof(struct ipa_ioc_nat_dma_one)));
+	if (NULL == cmd) {
+		IPAERR("unable to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex) != 0) {
+		IPAERR("unable to lock the nat mutex\n");
+		free(cmd);
+		return -1;
+	}
+
+	for (cnt = 0; cnt < num_rules; cnt++) {
+		rule_hdls[cnt] = IPA_NAT_INVALID_NAT_ENTRY;
+
+		/* A base table rule written in this batch is not enabled yet
+			 and would not be seen as a collision, so post the batch first */
+		base_entry = dst_hash(clnt_rules[cnt].target_ip,
+													clnt_rules[cnt].target_port,
+													clnt_rules[cnt].public_port,
+													clnt_rules[cnt].protocol,
+													tbl_ptr->table_entries-1);
+		if (IPA_NAT_MAX_DMA_BATCH_ENTRIES == pending ||
+				ipa_nati_batch_has_entry(entries, pending, base_entry)) {
+			if (ipa_nati_post_add_batch(tbl_hdl, cmd, entries, pos,
+						pending, rule_hdls)) {
+				ret = -EIO;
+			}
+			pending = 0;
+		}
+
+		memset(&sw_rule, 0, sizeof(sw_rule));
+		memset(&index_sw_rule, 0, sizeof(index_sw_rule));
+
+		if (ipa_nati_generate_rule(tbl_hdl, &clnt_rules[cnt],
+						&sw_rule, &index_sw_rule,
+						&new_entry, &new_index_tbl_entry)) {
+			IPAERR("unable to generate rule %d\n", cnt);
+			ret = -EINVAL;
+			continue;
+		}
+
+		ipa_nati_copy_ipv4_rule_to_hw(tbl_ptr, &sw_rule, new_entry,
+																	(uint8_t)(tbl_hdl-1));
+		ipa_nati_copy_ipv4_index_rule_to_hw(tbl_ptr,
+																				&index_sw_rule,
+																				new_index_tbl_entry,
+																				(uint8_t)(tbl_hdl-1));
+
+		IPADBG("new entry:%d, new index entry: %d\n", new_entry, new_index_tbl_entry);
+		entries[pending] = new_entry;
+		pos[pending] = cnt;
+		pending++;
+	}
+
+	if (pending &&
+			ipa_nati_post_add_batch(tbl_hdl, cmd, entries, pos,
+				pending, rule_hdls)) {
+		ret = -EIO;
+	}
+
+#ifdef NAT_DUMP
+	ipa_nat_dump_ipv4_table(tbl_hdl);
+#endif
+
+	if (pthread_mutex_unlock(&nat_mutex) != 0) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = -1;
+	}
+
+	free(cmd);
+	return ret;
+}
+
 
 int ipa_nati_del_ipv4_rule(uint32_t tbl_hdl,
 				uint32_t rule_hdl)
@@ -1596,6 +2022,190 @@ fail:
 	return ret;
 }
 
+/* Disable the queued stand alone rules of a batch with one dma command */
+static int ipa_nati_post_del_batch(uint8_t tbl_indx,
+				struct ipa_ioc_nat_dma_cmd *cmd,
+				const uint16_t *entries,
+				const uint16_t *indx_entries,
+				const uint16_t *pos,
+				int cnt,
+				const uint32_t *rule_hdls)
+{
+	struct ipa_nat_ip4_table_cache *cache_ptr;
+	struct ipa_nat_rule *tbl_ptr;
+	struct ipa_nat_indx_tbl_rule *indx_tbl_ptr;
+	int indx;
+
+	cache_ptr = &ipv4_nat_cache.ip4_tbl[tbl_indx];
+	tbl_ptr = (struct ipa_nat_rule *)cache_ptr->ipv4_rules_addr;
+	indx_tbl_ptr = (struct ipa_nat_indx_tbl_rule *)cache_ptr->index_table_addr;
+
+	/* Index table commands go first, as ReorderCmds() does for one rule */
+	for (indx = 0; indx < cnt; indx++) {
+		cmd->dma[indx].table_index = tbl_indx;
+		cmd->dma[indx].base_addr = IPA_NAT_INDX_TBL;
+		cmd->dma[indx].data = IPA_NAT_INVALID_NAT_ENTRY;
+
+		cmd->dma[indx].offset =
+			ipa_nati_get_index_entry_offset(cache_ptr,
+				IPA_NAT_INDX_TBL, indx_entries[indx]);
+		cmd->dma[indx].offset += IPA_NAT_INDEX_RULE_NAT_INDEX_FIELD_OFFSET;
+
+		cmd->dma[cnt + indx].table_index = tbl_indx;
+		cmd->dma[cnt + indx].base_addr = IPA_NAT_BASE_TBL;
+		cmd->dma[cnt + indx].data = IPA_NAT_FLAG_DISABLE_BIT_MASK;
+
+		cmd->dma[cnt + indx].offset =
+			ipa_nati_get_entry_offset(cache_ptr,
+				IPA_NAT_BASE_TBL, entries[indx]);
+		cmd->dma[cnt + indx].offset += IPA_NAT_RULE_FLAG_FIELD_OFFSET;
+	}
+
+	cmd->entries = 2 * cnt;
+	if (ioctl(ipv4_nat_cache.ipa_fd, IPA_IOC_NAT_DMA, cmd)) {
+		perror("ipa_nati_post_del_batch(): ioctl error value");
+		IPAERR("unable to post dma command for %d rules\n", cnt);
+		IPADBG("ipa fd %d\n", ipv4_nat_cache.ipa_fd);
+		return -EIO;
+	}
+	IPADBG("posted IPA_IOC_NAT_DMA for %d rules during batch delete\n", cnt);
+
+	for (indx = 0; indx < cnt; indx++) {
+		memset(&tbl_ptr[entries[indx]], 0, sizeof(struct ipa_nat_rule));
+		indx_tbl_ptr[indx_entries[indx]].tbl_entry_nxt_indx = 0;
+		cache_ptr->rule_id_array[rule_hdls[pos[indx]]-1] =
+			IPA_NAT_INVALID_NAT_ENTRY;
+	}
+
+	return 0;
+}
+
+int ipa_nati_del_ipv4_rules(uint32_t tbl_hdl,
+				const uint32_t *rule_hdls,
+				uint16_t num_rules)
+{
+#define MAX_DEL_BATCH_RULES (IPA_NAT_MAX_DMA_BATCH_ENTRIES / 2)
+
+	struct ipa_nat_ip4_table_cache *cache_ptr;
+	struct ipa_nat_rule *tbl_ptr;
+	struct ipa_ioc_nat_dma_cmd *cmd;
+	uint8_t tbl_indx = (uint8_t)(tbl_hdl - 1);
+	uint8_t expn_tbl;
+	uint16_t tbl_entry, indx_tbl_entry;
+	uint16_t entries[MAX_DEL_BATCH_RULES];
+	uint16_t indx_entries[MAX_DEL_BATCH_RULES];
+	uint16_t pos[MAX_DEL_BATCH_RULES];
+	del_type rule_pos, indx_rule_pos;
+	int cnt, pending = 0, ret = 0;
+
+	cmd = (struct ipa_ioc_nat_dma_cmd *)
+	malloc(sizeof(struct ipa_ioc_nat_dma_cmd)+
+				 (IPA_NAT_MAX_DMA_BATCH_ENTRIES * sizeof(struct ipa_ioc_nat_dma_one)));
+	if (NULL == cmd) {
+		IPAERR("unable to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex) != 0) {
+		IPAERR("unable to lock the nat mutex\n");
+		free(cmd);
+		return -1;
+	}
+
+	cache_ptr = &ipv4_nat_cache.ip4_tbl[tbl_indx];
+	if (!cache_ptr->valid) {
+		IPAERR("invalid table handle\n");
+		ret = -EINVAL;
+		goto unlock;
+	}
+	tbl_ptr = (struct ipa_nat_rule *)cache_ptr->ipv4_rules_addr;
+
+	for (cnt = 0; cnt < num_rules; cnt++) {
+		if (IPA_NAT_INVALID_NAT_ENTRY == rule_hdls[cnt]) {
+			continue;
+		}
+
+		ipa_nati_parse_ipv4_rule_hdl(tbl_indx, (uint16_t)rule_hdls[cnt],
+																 &expn_tbl, &tbl_entry);
+		if (IPA_NAT_INVALID_NAT_ENTRY == tbl_entry) {
+			IPAERR("Invalid Rule Entry\n");
+			ret = -EINVAL;
+			continue;
+		}
+
+		ipa_nati_find_rule_pos(cache_ptr, expn_tbl,
+													 tbl_entry, &rule_pos);
+
+		/* A rule which is alone in both base and index table is
+			 not linked with any other rule, it only needs its
+			 enable bit and index entry reset, which can be batched */
+		indx_rule_pos = IPA_NAT_DEL_TYPE_HEAD;
+		if (IPA_NAT_DEL_TYPE_ONLY_ONE == rule_pos &&
+				Read16BitFieldValue(tbl_ptr[tbl_entry].ip_cksm_enbl,
+					ENABLE_FIELD)) {
+			indx_tbl_entry =
+				Read16BitFieldValue(tbl_ptr[tbl_entry].sw_spec_params,
+					SW_SPEC_PARAM_INDX_TBL_ENTRY_FIELD);
+			ipa_nati_find_index_rule_pos(cache_ptr, indx_tbl_entry,
+																	 &indx_rule_pos);
+		}
+
+		if (IPA_NAT_DEL_TYPE_ONLY_ONE == indx_rule_pos) {
+			if (ipa_nati_batch_has_entry(entries, pending, tbl_entry)) {
+				IPAERR("rule handle 0x%x passed twice\n", rule_hdls[cnt]);
+				ret = -EINVAL;
+				continue;
+			}
+
+			if (MAX_DEL_BATCH_RULES == pending) {
+				if (ipa_nati_post_del_batch(tbl_indx, cmd, entries, indx_entries,
+							pos, pending, rule_hdls)) {
+					ret = -EIO;
+				}
+				pending = 0;
+			}
+
+			entries[pending] = tbl_entry;
+			indx_entries[pending] = indx_tbl_entry;
+			pos[pending] = cnt;
+			pending++;
+			continue;
+		}
+
+		IPADBG("rule_pos:%d\n", rule_pos);
+		if (ipa_nati_post_del_dma_cmd(tbl_indx, tbl_entry,
+						expn_tbl, rule_pos)) {
+			ret = -EINVAL;
+			continue;
+		}
+
+		cache_ptr->rule_id_array[rule_hdls[cnt]-1] =
+			IPA_NAT_INVALID_NAT_ENTRY;
+	}
+
+	if (pending &&
+			ipa_nati_post_del_batch(tbl_indx, cmd, entries, indx_entries,
+				pos, pending, rule_hdls)) {
+		ret = -EIO;
+	}
+
+	ipa_nati_del_dead_ipv4_head_nodes(tbl_indx);
+
+#ifdef NAT_DUMP
+	IPADBG("Dumping Table after deleting rules\n");
+	ipa_nat_dump_ipv4_table(tbl_hdl);
+#endif
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex) != 0) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = -1;
+	}
+
+	free(cmd);
+	return ret;
+}
+
 void ReorderCmds(struct ipa_ioc_nat_dma_cmd *cmd, int size)
 {
 	int indx_tbl_start = 0, cnt, cnt1;
@@ -1958,6 +2568,9 @@ int ipa_nati_post_del_dma_cmd(uint8_t tbl_indx,
 			 In case of IPA_NAT_DEL_TYPE_HEAD, don't reset */
 	if (IPA_NAT_DEL_TYPE_HEAD != rule_pos) {
 		memset(&tbl_ptr[cur_tbl_entry], 0, sizeof(struct ipa_nat_rule));
+		if (expn_tbl) {
+			ipa_nati_expn_tbl_release_entry(cache_ptr, cur_tbl_entry);
+		}
 	}
 
 	if (indx_rule_pos == IPA_NAT_DEL_TYPE_HEAD) {
@@ -1988,6 +2601,7 @@ int ipa_nati_post_del_dma_cmd(uint8_t tbl_indx,
 
     /* This resets both table entry and next index values */
 		indx_tbl_ptr[indx_next_entry].tbl_entry_nxt_indx = 0;
+		ipa_nati_index_expn_release_entry(cache_ptr, indx_next_entry);
 
 		/*
 				 In case of IPA_NAT_DEL_TYPE_HEAD, update the sw specific parameters
@@ -2034,7 +2648,9 @@ int ipa_nati_post_del_dma_cmd(uint8_t tbl_indx,
 					 &indx_tbl_ptr[indx_tbl_entry].tbl_entry_nxt_indx);
 
 		indx_tbl_ptr[indx_tbl_entry].tbl_entry_nxt_indx = 0;
-
+		if (IPA_NAT_DEL_TYPE_ONLY_ONE != indx_rule_pos) {
+			ipa_nati_index_expn_release_entry(cache_ptr, indx_tbl_entry);
+		}
 	}
 
 fail:
@@ -102,3 +102,6 @@ int ipa_nat_test019(int, u32, u8);
 int ipa_nat_test020(int, u32, u8);
 int ipa_nat_test021(int, int);
 int ipa_nat_test022(int, u32, u8);
+int ipa_nat_test023(int, u32, u8);
+int ipa_nat_test024(int, u32, u8);
+int ipa_nat_test025(int, u32, u8);
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test025.c
+
+	@brief
+	Verify the following scenario:
+	1. Add ipv4 table
+	2. Add 2 same and 1 different ipv4 rules
+	3. Query time stamps of all rules, check all handles are returned
+	4. Delete the first rule
+	5. Query time stamps of all rules, check deleted handle is not returned
+	6. Delete the other rules
+	7. Delete ipv4 table
+*/
+/*=========================================================================*/
+
+#include <stdlib.h>
+#include "ipa_nat_test.h"
+#include "ipa_nat_drv.h"
+
+/* Rules of earlier tests may still be in the table when not run separately */
+static int ipa_nat_test025_chk(int total_entries, u32 tbl_hdl, u32 *rule_hdl, int num)
+{
+	ipa_nat_rule_ts *rule_ts;
+	uint16_t cnt = 0;
+	int ret, indx, found = 0;
+
+	rule_ts = (ipa_nat_rule_ts *)malloc(sizeof(ipa_nat_rule_ts) * total_entries);
+	if (NULL == rule_ts)
+	{
+		IPAERR("unable to allocate memory\n");
+		return -1;
+	}
+
+	ret = ipa_nat_query_timestamps(tbl_hdl, rule_ts, total_entries, &cnt);
+	if (ret || cnt < num)
+	{
+		IPAERR("query returned %d with %d rules, expected %d\n", ret, cnt, num);
+		free(rule_ts);
+		return -1;
+	}
+
+	for (indx = 0; indx < cnt; indx++)
+	{
+		if ((rule_hdl[0] && rule_ts[indx].rule_hdl == rule_hdl[0]) ||
+			rule_ts[indx].rule_hdl == rule_hdl[1] ||
+			rule_ts[indx].rule_hdl == rule_hdl[2])
+		{
+			found++;
+		}
+	}
+
+	free(rule_ts);
+	return (found == num) ? 0 : -1;
+}
+
+int ipa_nat_test025(int total_entries, u32 tbl_hdl, u8 sep)
+{
+	int ret;
+	u32 rule_hdl[3];
+	ipa_nat_ipv4_rule ipv4_rule, ipv4_rule2;
+
+	u32 pub_ip_add = 0x011617c0;   /* "192.23.22.1" */
+
+	ipv4_rule.target_ip = 0xC1171601; /* 193.23.22.1 */
+	ipv4_rule.target_port = 1234;
+	ipv4_rule.private_ip = 0xC2171601; /* 194.23.22.1 */
+	ipv4_rule.private_port = 5678;
+	ipv4_rule.protocol = IPPROTO_TCP;
+	ipv4_rule.public_port = 9050;
+
+	ipv4_rule2.target_ip = 0xC1171604; /* 193.23.22.4 */
+	ipv4_rule2.target_port = 1234;
+	ipv4_rule2.private_ip = 0xC2171603; /* 194.23.22.3 */
+	ipv4_rule2.private_port = 5680;
+	ipv4_rule2.protocol = IPPROTO_UDP;
+	ipv4_rule2.public_port = 9066;
+
+	IPADBG("%s():\n",__FUNCTION__);
+
+	if(sep)
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, total_entries, &tbl_hdl);
+		CHECK_ERR1(ret, tbl_hdl);
+	}
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdl[0]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdl[1]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule2, &rule_hdl[2]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_test025_chk(total_entries, tbl_hdl, rule_hdl, 3);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdl[0]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	rule_hdl[0] = 0;
+	ret = ipa_nat_test025_chk(total_entries, tbl_hdl, rule_hdl, 2);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdl[1]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdl[2]);
+	CHECK_ERR1(ret, tbl_hdl);
+
+	if(sep)
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		CHECK_ERR(ret);
+	}
+
+	return 0;
+}
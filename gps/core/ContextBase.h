@@ -63,6 +63,7 @@ typedef struct loc_gps_cfg_s
     uint32_t       LPPE_CP_TECHNOLOGY;
     uint32_t       LPPE_UP_TECHNOLOGY;
     uint32_t       EXTERNAL_DR_ENABLED;
+    uint32_t       TIMER_SLACK_MS;
 } loc_gps_cfg_s_type;
 
 /* NOTE: the implementaiton of the parser casts number
@@ -56,6 +56,7 @@
 #include <loc_eng_msg.h>
 #include <loc_eng_nmea.h>
 #include <msg_q.h>
+#include <LocTimer.h>
 #include <loc.h>
 #include <platform_lib_includes.h>
 #include "loc_core_log.h"
@@ -102,6 +103,7 @@ static const loc_param_s_type gps_conf_table[] =
   {"USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL",  &gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL,          NULL, 'n'},
   {"AGPS_CONFIG_INJECT",             &gps_conf.AGPS_CONFIG_INJECT,             NULL, 'n'},
   {"EXTERNAL_DR_ENABLED",            &gps_conf.EXTERNAL_DR_ENABLED,                  NULL, 'n'},
+  {"TIMER_SLACK_MS",                 &gps_conf.TIMER_SLACK_MS,                 NULL, 'n'},
 };
 
 static const loc_param_s_type sap_conf_table[] =
@@ -148,6 +150,8 @@ static void loc_default_parameters(void)
    gps_conf.LPPE_CP_TECHNOLOGY = 0;
    /* By default no LPPe UP technology is enabled*/
    gps_conf.LPPE_UP_TECHNOLOGY = 0;
+   /* Timers expire precisely by default*/
+   gps_conf.TIMER_SLACK_MS = 0;
 
    /*Defaults for sap.conf*/
    sap_conf.GYRO_BIAS_RANDOM_WALK = 0;
@@ -758,6 +762,9 @@ struct LocEngSensorPerfControlConfig : public LocMsg {
 };
 
 //        case LOC_ENG_MSG_REPORT_POSITION:
+LocMsgPool LocEngReportPosition::sPool(sizeof(LocEngReportPosition),
+                                       "LocEngReportPosition");
+
 LocEngReportPosition::LocEngReportPosition(LocAdapterBase* adapter,
                                            UlpLocation &loc,
                                            GpsLocationExtended &locExtended,
@@ -862,6 +869,8 @@ void LocEngReportPosition::send() const {
 
 
 //        case LOC_ENG_MSG_REPORT_SV:
+LocMsgPool LocEngReportSv::sPool(sizeof(LocEngReportSv), "LocEngReportSv");
+
 LocEngReportSv::LocEngReportSv(LocAdapterBase* adapter,
                                GnssSvStatus &sv,
                                GpsLocationExtended &locExtended,
@@ -2952,6 +2961,7 @@ int loc_eng_read_config(void)
       // In fact one day the conf file should go into context.
       UTIL_READ_CONF(GPS_CONF_FILE, gps_conf_table);
       UTIL_READ_CONF(SAP_CONF_FILE, sap_conf_table);
+      LocTimer::setSlack(gps_conf.TIMER_SLACK_MS);
       configAlreadyRead = true;
     } else {
       LOC_LOGV("GPS Config file has already been read\n");
@@ -37,6 +37,7 @@
 #include <loc_eng_log.h>
 #include <loc_eng.h>
 #include <MsgTask.h>
+#include <LocMsgPool.h>
 #include <LocEngAdapter.h>
 #include <platform_lib_includes.h>
 
@@ -97,6 +98,16 @@ struct LocEngReportPosition : public LocMsg {
                          void* locExt,
                          enum loc_sess_status st,
                          LocPosTechMask technology);
+    // one per fix, recycled instead of going through the heap. The
+    // pool returns NULL when out of memory, so operator new must not
+    // throw; sendMsg() drops the resulting NULL msg.
+    static LocMsgPool sPool;
+    inline static void* operator new(size_t size) throw() {
+        return sPool.alloc(size);
+    }
+    inline static void operator delete(void* p, size_t size) {
+        sPool.release(p, size);
+    }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -112,6 +123,15 @@ struct LocEngReportSv : public LocMsg {
                    GnssSvStatus &sv,
                    GpsLocationExtended &locExtended,
                    void* svExtended);
+    // one per SV report, recycled instead of going through the heap,
+    // NULL when out of memory as with LocEngReportPosition
+    static LocMsgPool sPool;
+    inline static void* operator new(size_t size) throw() {
+        return sPool.alloc(size);
+    }
+    inline static void operator delete(void* p, size_t size) {
+        sPool.release(p, size);
+    }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -86,10 +86,10 @@ enum
   eLOC_CLIENT_INSTANCE_ID_GSS_AUTO = 0
 };
 
-/* Table to relate eventId, size and mask value used to enable the event*/
+/* Table to relate eventId, size and mask value used to enable the event.
+   It is indexed by eventId, IDs that are not events have a 0 eventSize */
 typedef struct
 {
-  uint32_t               eventId;
   size_t                 eventSize;
   locClientEventMaskType eventMask;
 }locClientEventIndTableStructT;
@@ -98,543 +98,538 @@ typedef struct
 static const locClientEventIndTableStructT locClientEventIndTable[]= {
 
   // position report ind
-  { QMI_LOC_EVENT_POSITION_REPORT_IND_V02,
+  [QMI_LOC_EVENT_POSITION_REPORT_IND_V02] = {
     sizeof(qmiLocEventPositionReportIndMsgT_v02),
     QMI_LOC_EVENT_MASK_POSITION_REPORT_V02 },
 
   // satellite report ind
-  { QMI_LOC_EVENT_GNSS_SV_INFO_IND_V02,
+  [QMI_LOC_EVENT_GNSS_SV_INFO_IND_V02] = {
     sizeof(qmiLocEventGnssSvInfoIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GNSS_SV_INFO_V02 },
 
   // NMEA report ind
-  { QMI_LOC_EVENT_NMEA_IND_V02,
+  [QMI_LOC_EVENT_NMEA_IND_V02] = {
     sizeof(qmiLocEventNmeaIndMsgT_v02),
     QMI_LOC_EVENT_MASK_NMEA_V02 },
 
   //NI event ind
-  { QMI_LOC_EVENT_NI_NOTIFY_VERIFY_REQ_IND_V02,
+  [QMI_LOC_EVENT_NI_NOTIFY_VERIFY_REQ_IND_V02] = {
     sizeof(qmiLocEventNiNotifyVerifyReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_NI_NOTIFY_VERIFY_REQ_V02 },
 
   //Time Injection Request Ind
-  { QMI_LOC_EVENT_INJECT_TIME_REQ_IND_V02,
+  [QMI_LOC_EVENT_INJECT_TIME_REQ_IND_V02] = {
     sizeof(qmiLocEventInjectTimeReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_INJECT_TIME_REQ_V02 },
 
   //Predicted Orbits Injection Request
-  { QMI_LOC_EVENT_INJECT_PREDICTED_ORBITS_REQ_IND_V02,
+  [QMI_LOC_EVENT_INJECT_PREDICTED_ORBITS_REQ_IND_V02] = {
     sizeof(qmiLocEventInjectPredictedOrbitsReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_INJECT_PREDICTED_ORBITS_REQ_V02 },
 
   //Position Injection Request Ind
-  { QMI_LOC_EVENT_INJECT_POSITION_REQ_IND_V02,
+  [QMI_LOC_EVENT_INJECT_POSITION_REQ_IND_V02] = {
     sizeof(qmiLocEventInjectPositionReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_INJECT_POSITION_REQ_V02 } ,
 
   //Engine State Report Ind
-  { QMI_LOC_EVENT_ENGINE_STATE_IND_V02,
+  [QMI_LOC_EVENT_ENGINE_STATE_IND_V02] = {
     sizeof(qmiLocEventEngineStateIndMsgT_v02),
     QMI_LOC_EVENT_MASK_ENGINE_STATE_V02 },
 
   //Fix Session State Report Ind
-  { QMI_LOC_EVENT_FIX_SESSION_STATE_IND_V02,
+  [QMI_LOC_EVENT_FIX_SESSION_STATE_IND_V02] = {
     sizeof(qmiLocEventFixSessionStateIndMsgT_v02),
     QMI_LOC_EVENT_MASK_FIX_SESSION_STATE_V02 },
 
   //Wifi Request Indication
-  { QMI_LOC_EVENT_WIFI_REQ_IND_V02,
+  [QMI_LOC_EVENT_WIFI_REQ_IND_V02] = {
     sizeof(qmiLocEventWifiReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_WIFI_REQ_V02 },
 
   //Sensor Streaming Ready Status Ind
-  { QMI_LOC_EVENT_SENSOR_STREAMING_READY_STATUS_IND_V02,
+  [QMI_LOC_EVENT_SENSOR_STREAMING_READY_STATUS_IND_V02] = {
     sizeof(qmiLocEventSensorStreamingReadyStatusIndMsgT_v02),
     QMI_LOC_EVENT_MASK_SENSOR_STREAMING_READY_STATUS_V02 },
 
   // Time Sync Request Indication
-  { QMI_LOC_EVENT_TIME_SYNC_REQ_IND_V02,
+  [QMI_LOC_EVENT_TIME_SYNC_REQ_IND_V02] = {
     sizeof(qmiLocEventTimeSyncReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_TIME_SYNC_REQ_V02 },
 
   //Set Spi Streaming Report Event
-  { QMI_LOC_EVENT_SET_SPI_STREAMING_REPORT_IND_V02,
+  [QMI_LOC_EVENT_SET_SPI_STREAMING_REPORT_IND_V02] = {
     sizeof(qmiLocEventSetSpiStreamingReportIndMsgT_v02),
     QMI_LOC_EVENT_MASK_SET_SPI_STREAMING_REPORT_V02 },
 
   //Location Server Connection Request event
-  { QMI_LOC_EVENT_LOCATION_SERVER_CONNECTION_REQ_IND_V02,
+  [QMI_LOC_EVENT_LOCATION_SERVER_CONNECTION_REQ_IND_V02] = {
     sizeof(qmiLocEventLocationServerConnectionReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_LOCATION_SERVER_CONNECTION_REQ_V02 },
 
   // NI Geofence Event
-  { QMI_LOC_EVENT_NI_GEOFENCE_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_NI_GEOFENCE_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventNiGeofenceNotificationIndMsgT_v02),
     QMI_LOC_EVENT_MASK_NI_GEOFENCE_NOTIFICATION_V02},
 
   // Geofence General Alert Event
-  { QMI_LOC_EVENT_GEOFENCE_GEN_ALERT_IND_V02,
+  [QMI_LOC_EVENT_GEOFENCE_GEN_ALERT_IND_V02] = {
     sizeof(qmiLocEventGeofenceGenAlertIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GEOFENCE_GEN_ALERT_V02},
 
   //Geofence Breach event
-  { QMI_LOC_EVENT_GEOFENCE_BREACH_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_GEOFENCE_BREACH_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventGeofenceBreachIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GEOFENCE_BREACH_NOTIFICATION_V02},
 
   //Geofence Batched Breach event
-  { QMI_LOC_EVENT_GEOFENCE_BATCHED_BREACH_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_GEOFENCE_BATCHED_BREACH_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventGeofenceBatchedBreachIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GEOFENCE_BATCH_BREACH_NOTIFICATION_V02},
 
   //Pedometer Control event
-  { QMI_LOC_EVENT_PEDOMETER_CONTROL_IND_V02,
+  [QMI_LOC_EVENT_PEDOMETER_CONTROL_IND_V02] = {
     sizeof(qmiLocEventPedometerControlIndMsgT_v02),
     QMI_LOC_EVENT_MASK_PEDOMETER_CONTROL_V02 },
 
   //Motion Data Control event
-  { QMI_LOC_EVENT_MOTION_DATA_CONTROL_IND_V02,
+  [QMI_LOC_EVENT_MOTION_DATA_CONTROL_IND_V02] = {
     sizeof(qmiLocEventMotionDataControlIndMsgT_v02),
     QMI_LOC_EVENT_MASK_MOTION_DATA_CONTROL_V02 },
 
   //Wifi AP data request event
-  { QMI_LOC_EVENT_INJECT_WIFI_AP_DATA_REQ_IND_V02,
+  [QMI_LOC_EVENT_INJECT_WIFI_AP_DATA_REQ_IND_V02] = {
     sizeof(qmiLocEventInjectWifiApDataReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_INJECT_WIFI_AP_DATA_REQ_V02 },
 
   //Get Batching On Fix Event
-  { QMI_LOC_EVENT_LIVE_BATCHED_POSITION_REPORT_IND_V02,
+  [QMI_LOC_EVENT_LIVE_BATCHED_POSITION_REPORT_IND_V02] = {
     sizeof(qmiLocEventLiveBatchedPositionReportIndMsgT_v02),
     QMI_LOC_EVENT_MASK_LIVE_BATCHED_POSITION_REPORT_V02 },
 
   //Get Batching On Full Event
-  { QMI_LOC_EVENT_BATCH_FULL_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_BATCH_FULL_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventBatchFullIndMsgT_v02),
     QMI_LOC_EVENT_MASK_BATCH_FULL_NOTIFICATION_V02 },
 
    //Vehicle Data Readiness event
-   { QMI_LOC_EVENT_VEHICLE_DATA_READY_STATUS_IND_V02,
+   [QMI_LOC_EVENT_VEHICLE_DATA_READY_STATUS_IND_V02] = {
      sizeof(qmiLocEventVehicleDataReadyIndMsgT_v02),
      QMI_LOC_EVENT_MASK_VEHICLE_DATA_READY_STATUS_V02 },
 
   //Geofence Proximity event
-  { QMI_LOC_EVENT_GEOFENCE_PROXIMITY_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_GEOFENCE_PROXIMITY_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventGeofenceProximityIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GEOFENCE_PROXIMITY_NOTIFICATION_V02},
 
     //GNSS Measurement Indication
-   { QMI_LOC_EVENT_GNSS_MEASUREMENT_REPORT_IND_V02,
+   [QMI_LOC_EVENT_GNSS_MEASUREMENT_REPORT_IND_V02] = {
      sizeof(qmiLocEventGnssSvMeasInfoIndMsgT_v02),
      QMI_LOC_EVENT_MASK_GNSS_MEASUREMENT_REPORT_V02 },
 
     //GNSS Measurement Indication
-   { QMI_LOC_EVENT_SV_POLYNOMIAL_REPORT_IND_V02,
+   [QMI_LOC_EVENT_SV_POLYNOMIAL_REPORT_IND_V02] = {
     sizeof(qmiLocEventGnssSvPolyIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GNSS_SV_POLYNOMIAL_REPORT_V02 },
 
   // for GDT
-  { QMI_LOC_EVENT_GDT_UPLOAD_BEGIN_STATUS_REQ_IND_V02,
+  [QMI_LOC_EVENT_GDT_UPLOAD_BEGIN_STATUS_REQ_IND_V02] = {
     sizeof(qmiLocEventGdtUploadBeginStatusReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GDT_UPLOAD_BEGIN_REQ_V02,
   },
 
-  { QMI_LOC_EVENT_GDT_UPLOAD_END_REQ_IND_V02,
+  [QMI_LOC_EVENT_GDT_UPLOAD_END_REQ_IND_V02] = {
     sizeof(qmiLocEventGdtUploadEndReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GDT_UPLOAD_END_REQ_V02,
   },
 
-   //GNSS measurement event
-  { QMI_LOC_EVENT_GNSS_MEASUREMENT_REPORT_IND_V02 ,
-    sizeof(qmiLocEventGnssSvMeasInfoIndMsgT_v02),
-    QMI_LOC_EVENT_MASK_GNSS_MEASUREMENT_REPORT_V02},
-
-  { QMI_LOC_EVENT_DBT_POSITION_REPORT_IND_V02,
+  [QMI_LOC_EVENT_DBT_POSITION_REPORT_IND_V02] = {
     sizeof(qmiLocEventDbtPositionReportIndMsgT_v02),
     0},
 
-  { QMI_LOC_EVENT_GEOFENCE_BATCHED_DWELL_NOTIFICATION_IND_V02,
+  [QMI_LOC_EVENT_GEOFENCE_BATCHED_DWELL_NOTIFICATION_IND_V02] = {
     sizeof(qmiLocEventGeofenceBatchedDwellIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GEOFENCE_BATCH_DWELL_NOTIFICATION_V02},
 
-  { QMI_LOC_EVENT_GET_TIME_ZONE_INFO_IND_V02,
+  [QMI_LOC_EVENT_GET_TIME_ZONE_INFO_IND_V02] = {
     sizeof(qmiLocEventGetTimeZoneReqIndMsgT_v02),
     QMI_LOC_EVENT_MASK_GET_TIME_ZONE_REQ_V02},
 
   // Batching Status event
-  { QMI_LOC_EVENT_BATCHING_STATUS_IND_V02,
+  [QMI_LOC_EVENT_BATCHING_STATUS_IND_V02] = {
     sizeof(qmiLocEventBatchingStatusIndMsgT_v02),
     QMI_LOC_EVENT_MASK_BATCHING_STATUS_V02},
 
   // TDP download
-  { QMI_LOC_EVENT_GDT_DOWNLOAD_BEGIN_REQ_IND_V02,
+  [QMI_LOC_EVENT_GDT_DOWNLOAD_BEGIN_REQ_IND_V02] = {
     sizeof(qmiLocEventGdtDownloadBeginReqIndMsgT_v02),
     0},
 
-  { QMI_LOC_EVENT_GDT_RECEIVE_DONE_IND_V02,
+  [QMI_LOC_EVENT_GDT_RECEIVE_DONE_IND_V02] = {
     sizeof(qmiLocEventGdtReceiveDoneIndMsgT_v02),
     0},
 
-  { QMI_LOC_EVENT_GDT_DOWNLOAD_END_REQ_IND_V02,
+  [QMI_LOC_EVENT_GDT_DOWNLOAD_END_REQ_IND_V02] = {
     sizeof(qmiLocEventGdtDownloadEndReqIndMsgT_v02),
     0}
 };
 
-/* table to relate the respInd Id with its size */
+/* table to relate the respInd Id with its size. It is indexed by
+   respIndId, IDs that are not response indications have a 0 respIndSize */
 typedef struct
 {
-  uint32_t respIndId;
   size_t   respIndSize;
 }locClientRespIndTableStructT;
 
 static const locClientRespIndTableStructT locClientRespIndTable[]= {
 
   // get service revision ind
-  { QMI_LOC_GET_SERVICE_REVISION_IND_V02,
+  [QMI_LOC_GET_SERVICE_REVISION_IND_V02] = {
     sizeof(qmiLocGetServiceRevisionIndMsgT_v02)},
 
   // Get Fix Criteria Resp Ind
-  { QMI_LOC_GET_FIX_CRITERIA_IND_V02,
+  [QMI_LOC_GET_FIX_CRITERIA_IND_V02] = {
      sizeof(qmiLocGetFixCriteriaIndMsgT_v02)},
 
   // NI User Resp In
-  { QMI_LOC_NI_USER_RESPONSE_IND_V02,
+  [QMI_LOC_NI_USER_RESPONSE_IND_V02] = {
     sizeof(qmiLocNiUserRespIndMsgT_v02)},
 
   //Inject Predicted Orbits Data Resp Ind
-  { QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02,
+  [QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02] = {
     sizeof(qmiLocInjectPredictedOrbitsDataIndMsgT_v02)},
 
   //Get Predicted Orbits Data Src Resp Ind
-  { QMI_LOC_GET_PREDICTED_ORBITS_DATA_SOURCE_IND_V02,
+  [QMI_LOC_GET_PREDICTED_ORBITS_DATA_SOURCE_IND_V02] = {
     sizeof(qmiLocGetPredictedOrbitsDataSourceIndMsgT_v02)},
 
   // Get Predicted Orbits Data Validity Resp Ind
-   { QMI_LOC_GET_PREDICTED_ORBITS_DATA_VALIDITY_IND_V02,
+   [QMI_LOC_GET_PREDICTED_ORBITS_DATA_VALIDITY_IND_V02] = {
      sizeof(qmiLocGetPredictedOrbitsDataValidityIndMsgT_v02)},
 
    // Inject UTC Time Resp Ind
-   { QMI_LOC_INJECT_UTC_TIME_IND_V02,
+   [QMI_LOC_INJECT_UTC_TIME_IND_V02] = {
      sizeof(qmiLocInjectUtcTimeIndMsgT_v02)},
 
    //Inject Position Resp Ind
-   { QMI_LOC_INJECT_POSITION_IND_V02,
+   [QMI_LOC_INJECT_POSITION_IND_V02] = {
      sizeof(qmiLocInjectPositionIndMsgT_v02)},
 
    //Set Engine Lock Resp Ind
-   { QMI_LOC_SET_ENGINE_LOCK_IND_V02,
+   [QMI_LOC_SET_ENGINE_LOCK_IND_V02] = {
      sizeof(qmiLocSetEngineLockIndMsgT_v02)},
 
    //Get Engine Lock Resp Ind
-   { QMI_LOC_GET_ENGINE_LOCK_IND_V02,
+   [QMI_LOC_GET_ENGINE_LOCK_IND_V02] = {
      sizeof(qmiLocGetEngineLockIndMsgT_v02)},
 
    //Set SBAS Config Resp Ind
-   { QMI_LOC_SET_SBAS_CONFIG_IND_V02,
+   [QMI_LOC_SET_SBAS_CONFIG_IND_V02] = {
      sizeof(qmiLocSetSbasConfigIndMsgT_v02)},
 
    //Get SBAS Config Resp Ind
-   { QMI_LOC_GET_SBAS_CONFIG_IND_V02,
+   [QMI_LOC_GET_SBAS_CONFIG_IND_V02] = {
      sizeof(qmiLocGetSbasConfigIndMsgT_v02)},
 
    //Set NMEA Types Resp Ind
-   { QMI_LOC_SET_NMEA_TYPES_IND_V02,
+   [QMI_LOC_SET_NMEA_TYPES_IND_V02] = {
      sizeof(qmiLocSetNmeaTypesIndMsgT_v02)},
 
    //Get NMEA Types Resp Ind
-   { QMI_LOC_GET_NMEA_TYPES_IND_V02,
+   [QMI_LOC_GET_NMEA_TYPES_IND_V02] = {
      sizeof(qmiLocGetNmeaTypesIndMsgT_v02)},
 
    //Set Low Power Mode Resp Ind
-   { QMI_LOC_SET_LOW_POWER_MODE_IND_V02,
+   [QMI_LOC_SET_LOW_POWER_MODE_IND_V02] = {
      sizeof(qmiLocSetLowPowerModeIndMsgT_v02)},
 
    //Get Low Power Mode Resp Ind
-   { QMI_LOC_GET_LOW_POWER_MODE_IND_V02,
+   [QMI_LOC_GET_LOW_POWER_MODE_IND_V02] = {
      sizeof(qmiLocGetLowPowerModeIndMsgT_v02)},
 
    //Set Server Resp Ind
-   { QMI_LOC_SET_SERVER_IND_V02,
+   [QMI_LOC_SET_SERVER_IND_V02] = {
      sizeof(qmiLocSetServerIndMsgT_v02)},
 
    //Get Server Resp Ind
-   { QMI_LOC_GET_SERVER_IND_V02,
+   [QMI_LOC_GET_SERVER_IND_V02] = {
      sizeof(qmiLocGetServerIndMsgT_v02)},
 
     //Delete Assist Data Resp Ind
-   { QMI_LOC_DELETE_ASSIST_DATA_IND_V02,
+   [QMI_LOC_DELETE_ASSIST_DATA_IND_V02] = {
      sizeof(qmiLocDeleteAssistDataIndMsgT_v02)},
 
    //Set AP cache injection Resp Ind
-   { QMI_LOC_INJECT_APCACHE_DATA_IND_V02,
+   [QMI_LOC_INJECT_APCACHE_DATA_IND_V02] = {
      sizeof(qmiLocInjectApCacheDataIndMsgT_v02)},
 
    //Set No AP cache injection Resp Ind
-   { QMI_LOC_INJECT_APDONOTCACHE_DATA_IND_V02,
+   [QMI_LOC_INJECT_APDONOTCACHE_DATA_IND_V02] = {
      sizeof(qmiLocInjectApDoNotCacheDataIndMsgT_v02)},
 
    //Set XTRA-T Session Control Resp Ind
-   { QMI_LOC_SET_XTRA_T_SESSION_CONTROL_IND_V02,
+   [QMI_LOC_SET_XTRA_T_SESSION_CONTROL_IND_V02] = {
      sizeof(qmiLocSetXtraTSessionControlIndMsgT_v02)},
 
    //Get XTRA-T Session Control Resp Ind
-   { QMI_LOC_GET_XTRA_T_SESSION_CONTROL_IND_V02,
+   [QMI_LOC_GET_XTRA_T_SESSION_CONTROL_IND_V02] = {
      sizeof(qmiLocGetXtraTSessionControlIndMsgT_v02)},
 
    //Inject Wifi Position Resp Ind
-   { QMI_LOC_INJECT_WIFI_POSITION_IND_V02,
+   [QMI_LOC_INJECT_WIFI_POSITION_IND_V02] = {
      sizeof(qmiLocInjectWifiPositionIndMsgT_v02)},
 
    //Notify Wifi Status Resp Ind
-   { QMI_LOC_NOTIFY_WIFI_STATUS_IND_V02,
+   [QMI_LOC_NOTIFY_WIFI_STATUS_IND_V02] = {
      sizeof(qmiLocNotifyWifiStatusIndMsgT_v02)},
 
    //Get Registered Events Resp Ind
-   { QMI_LOC_GET_REGISTERED_EVENTS_IND_V02,
+   [QMI_LOC_GET_REGISTERED_EVENTS_IND_V02] = {
      sizeof(qmiLocGetRegisteredEventsIndMsgT_v02)},
 
    //Set Operation Mode Resp Ind
-   { QMI_LOC_SET_OPERATION_MODE_IND_V02,
+   [QMI_LOC_SET_OPERATION_MODE_IND_V02] = {
      sizeof(qmiLocSetOperationModeIndMsgT_v02)},
 
    //Get Operation Mode Resp Ind
-   { QMI_LOC_GET_OPERATION_MODE_IND_V02,
+   [QMI_LOC_GET_OPERATION_MODE_IND_V02] = {
      sizeof(qmiLocGetOperationModeIndMsgT_v02)},
 
    //Set SPI Status Resp Ind
-   { QMI_LOC_SET_SPI_STATUS_IND_V02,
+   [QMI_LOC_SET_SPI_STATUS_IND_V02] = {
      sizeof(qmiLocSetSpiStatusIndMsgT_v02)},
 
    //Inject Sensor Data Resp Ind
-   { QMI_LOC_INJECT_SENSOR_DATA_IND_V02,
+   [QMI_LOC_INJECT_SENSOR_DATA_IND_V02] = {
      sizeof(qmiLocInjectSensorDataIndMsgT_v02)},
 
    //Inject Time Sync Data Resp Ind
-   { QMI_LOC_INJECT_TIME_SYNC_DATA_IND_V02,
+   [QMI_LOC_INJECT_TIME_SYNC_DATA_IND_V02] = {
      sizeof(qmiLocInjectTimeSyncDataIndMsgT_v02)},
 
    //Set Cradle Mount config Resp Ind
-   { QMI_LOC_SET_CRADLE_MOUNT_CONFIG_IND_V02,
+   [QMI_LOC_SET_CRADLE_MOUNT_CONFIG_IND_V02] = {
      sizeof(qmiLocSetCradleMountConfigIndMsgT_v02)},
 
    //Get Cradle Mount config Resp Ind
-   { QMI_LOC_GET_CRADLE_MOUNT_CONFIG_IND_V02,
+   [QMI_LOC_GET_CRADLE_MOUNT_CONFIG_IND_V02] = {
      sizeof(qmiLocGetCradleMountConfigIndMsgT_v02)},
 
    //Set External Power config Resp Ind
-   { QMI_LOC_SET_EXTERNAL_POWER_CONFIG_IND_V02,
+   [QMI_LOC_SET_EXTERNAL_POWER_CONFIG_IND_V02] = {
      sizeof(qmiLocSetExternalPowerConfigIndMsgT_v02)},
 
    //Get External Power config Resp Ind
-   { QMI_LOC_GET_EXTERNAL_POWER_CONFIG_IND_V02,
+   [QMI_LOC_GET_EXTERNAL_POWER_CONFIG_IND_V02] = {
      sizeof(qmiLocGetExternalPowerConfigIndMsgT_v02)},
 
    //Location server connection status
-   { QMI_LOC_INFORM_LOCATION_SERVER_CONN_STATUS_IND_V02,
+   [QMI_LOC_INFORM_LOCATION_SERVER_CONN_STATUS_IND_V02] = {
      sizeof(qmiLocInformLocationServerConnStatusIndMsgT_v02)},
 
    //Set Protocol Config Parameters
-   { QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+   [QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02] = {
      sizeof(qmiLocSetProtocolConfigParametersIndMsgT_v02)},
 
    //Get Protocol Config Parameters
-   { QMI_LOC_GET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+   [QMI_LOC_GET_PROTOCOL_CONFIG_PARAMETERS_IND_V02] = {
      sizeof(qmiLocGetProtocolConfigParametersIndMsgT_v02)},
 
    //Set Sensor Control Config
-   { QMI_LOC_SET_SENSOR_CONTROL_CONFIG_IND_V02,
+   [QMI_LOC_SET_SENSOR_CONTROL_CONFIG_IND_V02] = {
      sizeof(qmiLocSetSensorControlConfigIndMsgT_v02)},
 
    //Get Sensor Control Config
-   { QMI_LOC_GET_SENSOR_CONTROL_CONFIG_IND_V02,
+   [QMI_LOC_GET_SENSOR_CONTROL_CONFIG_IND_V02] = {
      sizeof(qmiLocGetSensorControlConfigIndMsgT_v02)},
 
    //Set Sensor Properties
-   { QMI_LOC_SET_SENSOR_PROPERTIES_IND_V02,
+   [QMI_LOC_SET_SENSOR_PROPERTIES_IND_V02] = {
      sizeof(qmiLocSetSensorPropertiesIndMsgT_v02)},
 
    //Get Sensor Properties
-   { QMI_LOC_GET_SENSOR_PROPERTIES_IND_V02,
+   [QMI_LOC_GET_SENSOR_PROPERTIES_IND_V02] = {
      sizeof(qmiLocGetSensorPropertiesIndMsgT_v02)},
 
    //Set Sensor Performance Control Config
-   { QMI_LOC_SET_SENSOR_PERFORMANCE_CONTROL_CONFIGURATION_IND_V02,
+   [QMI_LOC_SET_SENSOR_PERFORMANCE_CONTROL_CONFIGURATION_IND_V02] = {
      sizeof(qmiLocSetSensorPerformanceControlConfigIndMsgT_v02)},
 
    //Get Sensor Performance Control Config
-   { QMI_LOC_GET_SENSOR_PERFORMANCE_CONTROL_CONFIGURATION_IND_V02,
+   [QMI_LOC_GET_SENSOR_PERFORMANCE_CONTROL_CONFIGURATION_IND_V02] = {
      sizeof(qmiLocGetSensorPerformanceControlConfigIndMsgT_v02)},
    //Inject SUPL certificate
-   { QMI_LOC_INJECT_SUPL_CERTIFICATE_IND_V02,
+   [QMI_LOC_INJECT_SUPL_CERTIFICATE_IND_V02] = {
      sizeof(qmiLocInjectSuplCertificateIndMsgT_v02) },
 
    //Delete SUPL certificate
-   { QMI_LOC_DELETE_SUPL_CERTIFICATE_IND_V02,
+   [QMI_LOC_DELETE_SUPL_CERTIFICATE_IND_V02] = {
      sizeof(qmiLocDeleteSuplCertificateIndMsgT_v02) },
 
    // Set Position Engine Config
-   { QMI_LOC_SET_POSITION_ENGINE_CONFIG_PARAMETERS_IND_V02,
+   [QMI_LOC_SET_POSITION_ENGINE_CONFIG_PARAMETERS_IND_V02] = {
      sizeof(qmiLocSetPositionEngineConfigParametersIndMsgT_v02)},
 
    // Get Position Engine Config
-   { QMI_LOC_GET_POSITION_ENGINE_CONFIG_PARAMETERS_IND_V02,
+   [QMI_LOC_GET_POSITION_ENGINE_CONFIG_PARAMETERS_IND_V02] = {
      sizeof(qmiLocGetPositionEngineConfigParametersIndMsgT_v02)},
 
    //Add a Circular Geofence
-   { QMI_LOC_ADD_CIRCULAR_GEOFENCE_IND_V02,
+   [QMI_LOC_ADD_CIRCULAR_GEOFENCE_IND_V02] = {
      sizeof(qmiLocAddCircularGeofenceIndMsgT_v02)},
 
    //Delete a Geofence
-   { QMI_LOC_DELETE_GEOFENCE_IND_V02,
+   [QMI_LOC_DELETE_GEOFENCE_IND_V02] = {
      sizeof(qmiLocDeleteGeofenceIndMsgT_v02)} ,
 
    //Query a Geofence
-   { QMI_LOC_QUERY_GEOFENCE_IND_V02,
+   [QMI_LOC_QUERY_GEOFENCE_IND_V02] = {
      sizeof(qmiLocQueryGeofenceIndMsgT_v02)},
 
    //Edit a Geofence
-   { QMI_LOC_EDIT_GEOFENCE_IND_V02,
+   [QMI_LOC_EDIT_GEOFENCE_IND_V02] = {
      sizeof(qmiLocEditGeofenceIndMsgT_v02)},
 
    //Get best available position
-   { QMI_LOC_GET_BEST_AVAILABLE_POSITION_IND_V02,
+   [QMI_LOC_GET_BEST_AVAILABLE_POSITION_IND_V02] = {
      sizeof(qmiLocGetBestAvailablePositionIndMsgT_v02)},
 
    //Secure Get available position
-   { QMI_LOC_SECURE_GET_AVAILABLE_POSITION_IND_V02,
+   [QMI_LOC_SECURE_GET_AVAILABLE_POSITION_IND_V02] = {
      sizeof(qmiLocSecureGetAvailablePositionIndMsgT_v02)},
 
    //Inject motion data
-   { QMI_LOC_INJECT_MOTION_DATA_IND_V02,
+   [QMI_LOC_INJECT_MOTION_DATA_IND_V02] = {
      sizeof(qmiLocInjectMotionDataIndMsgT_v02)},
 
    //Get NI Geofence list
-   { QMI_LOC_GET_NI_GEOFENCE_ID_LIST_IND_V02,
+   [QMI_LOC_GET_NI_GEOFENCE_ID_LIST_IND_V02] = {
      sizeof(qmiLocGetNiGeofenceIdListIndMsgT_v02)},
 
    //Inject GSM Cell Info
-   { QMI_LOC_INJECT_GSM_CELL_INFO_IND_V02,
+   [QMI_LOC_INJECT_GSM_CELL_INFO_IND_V02] = {
      sizeof(qmiLocInjectGSMCellInfoIndMsgT_v02)},
 
    //Inject Network Initiated Message
-   { QMI_LOC_INJECT_NETWORK_INITIATED_MESSAGE_IND_V02,
+   [QMI_LOC_INJECT_NETWORK_INITIATED_MESSAGE_IND_V02] = {
      sizeof(qmiLocInjectNetworkInitiatedMessageIndMsgT_v02)},
 
    //WWAN Out of Service Notification
-   { QMI_LOC_WWAN_OUT_OF_SERVICE_NOTIFICATION_IND_V02,
+   [QMI_LOC_WWAN_OUT_OF_SERVICE_NOTIFICATION_IND_V02] = {
      sizeof(qmiLocWWANOutOfServiceNotificationIndMsgT_v02)},
 
    //Pedomete Report
-   { QMI_LOC_PEDOMETER_REPORT_IND_V02,
+   [QMI_LOC_PEDOMETER_REPORT_IND_V02] = {
      sizeof(qmiLocPedometerReportIndMsgT_v02)},
 
-   { QMI_LOC_INJECT_WCDMA_CELL_INFO_IND_V02,
+   [QMI_LOC_INJECT_WCDMA_CELL_INFO_IND_V02] = {
      sizeof(qmiLocInjectWCDMACellInfoIndMsgT_v02)},
 
-   { QMI_LOC_INJECT_TDSCDMA_CELL_INFO_IND_V02,
+   [QMI_LOC_INJECT_TDSCDMA_CELL_INFO_IND_V02] = {
      sizeof(qmiLocInjectTDSCDMACellInfoIndMsgT_v02)},
 
-   { QMI_LOC_INJECT_SUBSCRIBER_ID_IND_V02,
+   [QMI_LOC_INJECT_SUBSCRIBER_ID_IND_V02] = {
      sizeof(qmiLocInjectSubscriberIDIndMsgT_v02)},
 
    //Inject Wifi AP data Resp Ind
-   { QMI_LOC_INJECT_WIFI_AP_DATA_IND_V02,
+   [QMI_LOC_INJECT_WIFI_AP_DATA_IND_V02] = {
      sizeof(qmiLocInjectWifiApDataIndMsgT_v02)},
 
-   { QMI_LOC_START_BATCHING_IND_V02,
+   [QMI_LOC_START_BATCHING_IND_V02] = {
      sizeof(qmiLocStartBatchingIndMsgT_v02)},
 
-   { QMI_LOC_STOP_BATCHING_IND_V02,
+   [QMI_LOC_STOP_BATCHING_IND_V02] = {
      sizeof(qmiLocStopBatchingIndMsgT_v02)},
 
-   { QMI_LOC_GET_BATCH_SIZE_IND_V02,
+   [QMI_LOC_GET_BATCH_SIZE_IND_V02] = {
      sizeof(qmiLocGetBatchSizeIndMsgT_v02)},
 
-   { QMI_LOC_EVENT_LIVE_BATCHED_POSITION_REPORT_IND_V02,
+   [QMI_LOC_EVENT_LIVE_BATCHED_POSITION_REPORT_IND_V02] = {
      sizeof(qmiLocEventPositionReportIndMsgT_v02)},
 
-   { QMI_LOC_EVENT_BATCH_FULL_NOTIFICATION_IND_V02,
+   [QMI_LOC_EVENT_BATCH_FULL_NOTIFICATION_IND_V02] = {
      sizeof(qmiLocEventBatchFullIndMsgT_v02)},
 
-   { QMI_LOC_READ_FROM_BATCH_IND_V02,
+   [QMI_LOC_READ_FROM_BATCH_IND_V02] = {
      sizeof(qmiLocReadFromBatchIndMsgT_v02)},
 
-   { QMI_LOC_RELEASE_BATCH_IND_V02,
+   [QMI_LOC_RELEASE_BATCH_IND_V02] = {
      sizeof(qmiLocReleaseBatchIndMsgT_v02)},
 
-   { QMI_LOC_SET_XTRA_VERSION_CHECK_IND_V02,
+   [QMI_LOC_SET_XTRA_VERSION_CHECK_IND_V02] = {
      sizeof(qmiLocSetXtraVersionCheckIndMsgT_v02)},
 
     //Vehicle Sensor Data
-    { QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_IND_V02,
+    [QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_IND_V02] = {
       sizeof(qmiLocInjectVehicleSensorDataIndMsgT_v02)},
 
-   { QMI_LOC_NOTIFY_WIFI_ATTACHMENT_STATUS_IND_V02,
+   [QMI_LOC_NOTIFY_WIFI_ATTACHMENT_STATUS_IND_V02] = {
      sizeof(qmiLocNotifyWifiAttachmentStatusIndMsgT_v02)},
 
-   { QMI_LOC_NOTIFY_WIFI_ENABLED_STATUS_IND_V02,
+   [QMI_LOC_NOTIFY_WIFI_ENABLED_STATUS_IND_V02] = {
      sizeof(qmiLocNotifyWifiEnabledStatusIndMsgT_v02)},
 
-   { QMI_LOC_SET_PREMIUM_SERVICES_CONFIG_IND_V02,
+   [QMI_LOC_SET_PREMIUM_SERVICES_CONFIG_IND_V02] = {
      sizeof(qmiLocSetPremiumServicesCfgReqMsgT_v02)},
 
-   { QMI_LOC_GET_AVAILABLE_WWAN_POSITION_IND_V02,
+   [QMI_LOC_GET_AVAILABLE_WWAN_POSITION_IND_V02] = {
      sizeof(qmiLocGetAvailWwanPositionIndMsgT_v02)},
 
    // for TDP
-   { QMI_LOC_INJECT_GTP_CLIENT_DOWNLOADED_DATA_IND_V02,
+   [QMI_LOC_INJECT_GTP_CLIENT_DOWNLOADED_DATA_IND_V02] = {
      sizeof(qmiLocInjectGtpClientDownloadedDataIndMsgT_v02) },
 
    // for GDT
-   { QMI_LOC_GDT_UPLOAD_BEGIN_STATUS_IND_V02,
+   [QMI_LOC_GDT_UPLOAD_BEGIN_STATUS_IND_V02] = {
      sizeof(qmiLocGdtUploadBeginStatusIndMsgT_v02) },
 
-   { QMI_LOC_GDT_UPLOAD_END_IND_V02,
+   [QMI_LOC_GDT_UPLOAD_END_IND_V02] = {
      sizeof(qmiLocGdtUploadEndIndMsgT_v02) },
 
-   { QMI_LOC_SET_GNSS_CONSTELL_REPORT_CONFIG_IND_V02,
+   [QMI_LOC_SET_GNSS_CONSTELL_REPORT_CONFIG_IND_V02] = {
      sizeof(qmiLocSetGNSSConstRepConfigIndMsgT_v02)},
 
-   { QMI_LOC_START_DBT_IND_V02,
+   [QMI_LOC_START_DBT_IND_V02] = {
      sizeof(qmiLocStartDbtIndMsgT_v02)},
 
-   { QMI_LOC_STOP_DBT_IND_V02,
+   [QMI_LOC_STOP_DBT_IND_V02] = {
      sizeof(qmiLocStopDbtIndMsgT_v02)},
 
-   { QMI_LOC_INJECT_TIME_ZONE_INFO_IND_V02,
+   [QMI_LOC_INJECT_TIME_ZONE_INFO_IND_V02] = {
      sizeof(qmiLocInjectTimeZoneInfoIndMsgT_v02)},
 
-   { QMI_LOC_QUERY_AON_CONFIG_IND_V02,
+   [QMI_LOC_QUERY_AON_CONFIG_IND_V02] = {
      sizeof(qmiLocQueryAonConfigIndMsgT_v02)},
 
     // for GTP
-   { QMI_LOC_GTP_AP_STATUS_IND_V02,
+   [QMI_LOC_GTP_AP_STATUS_IND_V02] = {
      sizeof(qmiLocGtpApStatusIndMsgT_v02) },
 
     // for GDT
-   { QMI_LOC_GDT_DOWNLOAD_BEGIN_STATUS_IND_V02,
+   [QMI_LOC_GDT_DOWNLOAD_BEGIN_STATUS_IND_V02] = {
      sizeof(qmiLocGdtDownloadBeginStatusIndMsgT_v02) },
 
-   { QMI_LOC_GDT_DOWNLOAD_READY_STATUS_IND_V02,
+   [QMI_LOC_GDT_DOWNLOAD_READY_STATUS_IND_V02] = {
     sizeof(qmiLocGdtDownloadReadyStatusIndMsgT_v02) },
 
-   { QMI_LOC_GDT_RECEIVE_DONE_STATUS_IND_V02,
+   [QMI_LOC_GDT_RECEIVE_DONE_STATUS_IND_V02] = {
     sizeof(qmiLocGdtReceiveDoneStatusIndMsgT_v02) },
 
-   { QMI_LOC_GDT_DOWNLOAD_END_STATUS_IND_V02,
+   [QMI_LOC_GDT_DOWNLOAD_END_STATUS_IND_V02] = {
      sizeof(qmiLocGdtDownloadEndStatusIndMsgT_v02) },
 
-   { QMI_LOC_GET_SUPPORTED_FEATURE_IND_V02,
+   [QMI_LOC_GET_SUPPORTED_FEATURE_IND_V02] = {
      sizeof(qmiLocGetSupportedFeatureIndMsgT_v02) },
 
    //Delete Gnss Service Data Resp Ind
-   { QMI_LOC_DELETE_GNSS_SERVICE_DATA_IND_V02,
+   [QMI_LOC_DELETE_GNSS_SERVICE_DATA_IND_V02] = {
      sizeof(qmiLocDeleteGNSSServiceDataIndMsgT_v02) },
 
    // for XTRA Client 2.0
-   { QMI_LOC_INJECT_XTRA_DATA_IND_V02,
+   [QMI_LOC_INJECT_XTRA_DATA_IND_V02] = {
      sizeof(qmiLocInjectXtraDataIndMsgT_v02) },
 
-   { QMI_LOC_INJECT_XTRA_PCID_IND_V02,
+   [QMI_LOC_INJECT_XTRA_PCID_IND_V02] = {
      sizeof(qmiLocInjectXtraPcidIndMsgT_v02) }
 };
 
@@ -2236,7 +2231,7 @@ locClientStatusEnumType locClientSupportMsgCheck(
 
 bool locClientGetSizeByRespIndId(uint32_t respIndId, size_t *pRespIndSize)
 {
-  size_t idx = 0, respIndTableSize = 0;
+  size_t respIndTableSize = 0;
 
   // Validate input arguments
   if(pRespIndSize == NULL)
@@ -2246,17 +2241,15 @@ bool locClientGetSizeByRespIndId(uint32_t respIndId, size_t *pRespIndSize)
   }
 
   respIndTableSize = (sizeof(locClientRespIndTable)/sizeof(locClientRespIndTableStructT));
-  for(idx=0; idx<respIndTableSize; idx++ )
+  if(respIndId < respIndTableSize &&
+     0 != locClientRespIndTable[respIndId].respIndSize)
   {
-    if(respIndId == locClientRespIndTable[idx].respIndId)
-    {
-      // found
-      *pRespIndSize = locClientRespIndTable[idx].respIndSize;
+    // found
+    *pRespIndSize = locClientRespIndTable[respIndId].respIndSize;
 
-      LOC_LOGV("%s:%d]: resp ind Id %d size = %d\n", __func__, __LINE__,
-                    respIndId, (uint32_t)*pRespIndSize);
-      return true;
-    }
+    LOC_LOGV("%s:%d]: resp ind Id %d size = %d\n", __func__, __LINE__,
+                  respIndId, (uint32_t)*pRespIndSize);
+    return true;
   }
 
   //not found
@@ -2273,7 +2266,7 @@ bool locClientGetSizeByRespIndId(uint32_t respIndId, size_t *pRespIndSize)
 */
 bool locClientGetSizeByEventIndId(uint32_t eventIndId, size_t *pEventIndSize)
 {
-  size_t idx = 0, eventIndTableSize = 0;
+  size_t eventIndTableSize = 0;
 
   // Validate input arguments
   if(pEventIndSize == NULL)
@@ -2286,18 +2279,52 @@ bool locClientGetSizeByEventIndId(uint32_t eventIndId, size_t *pEventIndSize)
   eventIndTableSize =
     (sizeof(locClientEventIndTable)/sizeof(locClientEventIndTableStructT));
 
-  for(idx=0; idx<eventIndTableSize; idx++ )
+  if(eventIndId < eventIndTableSize &&
+     0 != locClientEventIndTable[eventIndId].eventSize)
   {
-    if(eventIndId == locClientEventIndTable[idx].eventId)
-    {
-      // found
-      *pEventIndSize = locClientEventIndTable[idx].eventSize;
+    // found
+    *pEventIndSize = locClientEventIndTable[eventIndId].eventSize;
 
-      LOC_LOGV("%s:%d]: event ind Id %d size = %d\n", __func__, __LINE__,
-                    eventIndId, (uint32_t)*pEventIndSize);
-      return true;
-    }
+    LOC_LOGV("%s:%d]: event ind Id %d size = %d\n", __func__, __LINE__,
+                  eventIndId, (uint32_t)*pEventIndSize);
+    return true;
   }
   // not found
   return false;
 }
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <time.h>
+
+/** micro-benchmark of the indication ID lookup. Every ID in the
+    QMI_LOC message ID space is looked up, so the time per lookup
+    covers hits in both tables as well as misses. */
+int main(int argc, char** argv)
+{
+  uint32_t rounds = (argc > 1) ? (uint32_t)atoi(argv[1]) : 100000;
+  uint32_t round, indId, found = 0;
+  size_t indSize = 0;
+  locClientIndEnumT indType;
+  struct timespec start, end;
+  double ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(round = 0; round < rounds; round++)
+  {
+    for(indId = 0; indId <= 0xFF; indId++)
+    {
+      found += locClientGetSizeAndTypeByIndId(indId, &indSize, &indType);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  ns = (double)(end.tv_sec - start.tv_sec) * 1000000000 +
+       (end.tv_nsec - start.tv_nsec);
+  printf("%u lookups, %u found, %.2f ns per lookup\n",
+         rounds * 0x100, found, ns / ((double)rounds * 0x100));
+  return 0;
+}
+
+#endif
@@ -24,6 +24,8 @@ LOCAL_SRC_FILES += \
     LocTimer.cpp \
     LocThread.cpp \
     MsgTask.cpp \
+    LocMpscQueue.cpp \
+    LocMsgPool.cpp \
     loc_misc_utils.cpp
 
 # Flag -std=c++11 is not accepted by compiler when LOCAL_CLANG is set to true
@@ -49,6 +51,8 @@ LOCAL_COPY_HEADERS:= \
    linked_list.h \
    msg_q.h \
    MsgTask.h \
+   LocMpscQueue.h \
+   LocMsgPool.h \
    LocHeap.h \
    LocThread.h \
    LocTimer.h \
@@ -26,6 +26,7 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <stdlib.h>
 #include <LocHeap.h>
 
 class LocHeapNode {
@@ -275,6 +276,101 @@ uint32_t LocHeap::getTreeSize() {
 }
 #endif
 
+LocIndexedHeap::~LocIndexedHeap() {
+    // nodes belong to the client, only forget where they were
+    for (int i = 0; i < mSize; i++) {
+        mArray[i]->mHeapIndex = -1;
+    }
+    free(mArray);
+}
+
+inline
+void LocIndexedHeap::place(int index, LocRankable* node) {
+    mArray[index] = node;
+    node->mHeapIndex = index;
+}
+
+// moves the node at index up while it outranks its parent
+void LocIndexedHeap::siftUp(int index) {
+    LocRankable* node = mArray[index];
+    while (index > 0) {
+        int parent = (index - 1) >> 1;
+        if (!node->outRanks(*mArray[parent])) {
+            break;
+        }
+        place(index, mArray[parent]);
+        index = parent;
+    }
+    place(index, node);
+}
+
+// moves the node at index down while a child outranks it
+void LocIndexedHeap::siftDown(int index) {
+    LocRankable* node = mArray[index];
+    for (int child = 2 * index + 1; child < mSize; child = 2 * index + 1) {
+        if (child + 1 < mSize && mArray[child + 1]->outRanks(*mArray[child])) {
+            child++;
+        }
+        if (!mArray[child]->outRanks(*node)) {
+            break;
+        }
+        place(index, mArray[child]);
+        index = child;
+    }
+    place(index, node);
+}
+
+bool LocIndexedHeap::push(LocRankable& node) {
+    if (mSize == mCapacity) {
+        int capacity = mCapacity ? 2 * mCapacity : 16;
+        LocRankable** array =
+            (LocRankable**)realloc(mArray, capacity * sizeof(LocRankable*));
+        if (NULL == array) {
+            return false;
+        }
+        mArray = array;
+        mCapacity = capacity;
+    }
+    place(mSize++, &node);
+    siftUp(mSize - 1);
+    return true;
+}
+
+LocRankable* LocIndexedHeap::pop() {
+    return mSize ? remove(*mArray[0]) : NULL;
+}
+
+LocRankable* LocIndexedHeap::remove(LocRankable& rankable) {
+    int index = rankable.mHeapIndex;
+    if (index < 0 || index >= mSize || mArray[index] != &rankable) {
+        return NULL;
+    }
+
+    rankable.mHeapIndex = -1;
+    if (index != --mSize) {
+        // the last node fills the hole and goes whichever way it must
+        place(index, mArray[mSize]);
+        if (index > 0 && mArray[index]->outRanks(*mArray[(index - 1) >> 1])) {
+            siftUp(index);
+        } else {
+            siftDown(index);
+        }
+    }
+    return &rankable;
+}
+
+#if defined(__LOC_UNIT_TEST__) || defined(__LOC_DEBUG__)
+bool LocIndexedHeap::checkTree() {
+    for (int i = 0; i < mSize; i++) {
+        if (mArray[i]->mHeapIndex != i ||
+            (i > 0 && mArray[i]->outRanks(*mArray[(i - 1) >> 1]))) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
 #ifdef __LOC_DEBUG__
 
 #include <stdio.h>
@@ -302,9 +398,30 @@ public:
     }
 };
 
+static long long nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// arms n timers, cancels every other one, then expires the rest
+template <typename Heap>
+static long long benchmark(LocHeapDebugData** data, int n) {
+    Heap heap;
+    long long start = nowUs();
+    for (int i = 0; i < n; i++) {
+        heap.push(*data[i]);
+    }
+    for (int i = 0; i < n; i += 2) {
+        heap.remove(*data[i]);
+    }
+    while (NULL != heap.pop());
+    return nowUs() - start;
+}
+
 // For Linux command line testing:
 // compilation: g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -I. -I../../../../vendor/qcom/proprietary/gps-internal/unit-tests/fakes_for_host -I../../../../system/core/include LocHeap.cpp
-// test: valgrind --leak-check=full ./a.out 100
+// test: valgrind --leak-check=full ./a.out 100 [benchmark size]
 int main(int argc, char** argv) {
     srand(time(NULL));
     int tries = atoi(argv[1]);
@@ -348,6 +465,47 @@ int main(int argc, char** argv) {
         delete data;
     }
 
+    // same random ops on LocIndexedHeap, with removes from the middle
+    LocIndexedHeap indexedHeap;
+    LocHeapDebugData** live = new LocHeapDebugData*[tries];
+    int liveCnt = 0;
+    for (int i = 0; i < tries; i++) {
+        int r = rand();
+        if (r & 1) {
+            live[liveCnt] = new LocHeapDebugData(r >> 2);
+            indexedHeap.push(*live[liveCnt++]);
+        } else if (liveCnt > 0) {
+            int victim = (r >> 1) % liveCnt;
+            LocRankable* removed = (r & 2) ? indexedHeap.remove(*live[victim]) :
+                                             indexedHeap.pop();
+            for (victim = 0; live[victim] != removed; victim++);
+            live[victim] = live[--liveCnt];
+            delete removed;
+        }
+        if ((int)indexedHeap.getSize() != liveCnt || !indexedHeap.checkTree()) {
+            printf("!!!!!!!!!!indexed heap check failed at %dth op!!!!!!!\n", i);
+            break;
+        }
+    }
+    printf("indexed heap %s\n", indexedHeap.checkTree() ? "success!" : "failed");
+    while (liveCnt > 0) {
+        LocRankable* removed = indexedHeap.remove(*live[--liveCnt]);
+        delete removed;
+    }
+    delete[] live;
+
+    int n = (argc > 2) ? atoi(argv[2]) : 10000;
+    LocHeapDebugData** data = new LocHeapDebugData*[n];
+    for (int i = 0; i < n; i++) {
+        data[i] = new LocHeapDebugData(rand());
+    }
+    printf("%d timers: LocHeap %lld us, LocIndexedHeap %lld us\n", n,
+           benchmark<LocHeap>(data, n), benchmark<LocIndexedHeap>(data, n));
+    for (int i = 0; i < n; i++) {
+        delete data[i];
+    }
+    delete[] data;
+
     return 0;
 }
 
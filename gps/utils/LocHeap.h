@@ -30,11 +30,16 @@
 #define __LOC_HEAP__
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 // abstract class to be implemented by client to provide a rankable class
 class LocRankable {
+    friend class LocIndexedHeap;
+    // slot in the LocIndexedHeap holding this obj, -1 if none
+    int mHeapIndex;
 public:
+    inline LocRankable() : mHeapIndex(-1) {}
     virtual inline ~LocRankable() {}
 
     // method to rank objects of such type for sorting purposes.
@@ -93,4 +98,42 @@ public:
 #endif
 };
 
+// a binary heap kept in an array, same interface as LocHeap. Every
+// LocRankable remembers its slot, so remove() is O(log n) instead of a
+// search of the tree, and push() does not allocate once the array has
+// grown to the working size. An obj can be in one such heap at a time.
+class LocIndexedHeap {
+protected:
+    LocRankable** mArray;
+    int mSize;
+    int mCapacity;
+
+    void place(int index, LocRankable* node);
+    void siftUp(int index);
+    void siftDown(int index);
+public:
+    inline LocIndexedHeap() : mArray(NULL), mSize(0), mCapacity(0) {}
+    ~LocIndexedHeap();
+
+    // node is managed by client, as with LocHeap::push()
+    // returns false, with node not inserted, if the array can not grow.
+    bool push(LocRankable& node);
+
+    // the highest ranking node, or NULL if the heap is empty
+    inline LocRankable* peek() { return mSize ? mArray[0] : NULL; }
+
+    // Return - pointer to the node popped out, or NULL if heap is already empty
+    LocRankable* pop();
+
+    // removes the given node from wherever it is in the heap.
+    // returns the pointer to the node removed; or NULL if it is not in here.
+    LocRankable* remove(LocRankable& rankable);
+
+    inline uint32_t getSize() { return mSize; }
+
+#if defined(__LOC_UNIT_TEST__) || defined(__LOC_DEBUG__)
+    bool checkTree();
+#endif
+};
+
 #endif //__LOC_HEAP__
@@ -0,0 +1,140 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <unistd.h>
+#include <sched.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <LocMpscQueue.h>
+
+static inline void futexWait(int* addr, int val) {
+    syscall(__NR_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void futexWake(int* addr, int count) {
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+LocMpscQueue::LocMpscQueue() :
+    mStub(), mHead(&mStub), mTail(&mStub),
+    mSignal(0), mWaiters(0), mUnblocked(0) {
+}
+
+void LocMpscQueue::wake(int count) {
+    __atomic_add_fetch(&mSignal, 1, __ATOMIC_SEQ_CST);
+    futexWake(&mSignal, count);
+}
+
+bool LocMpscQueue::push(const LocMpscNode* node) {
+    if (__atomic_load_n(&mUnblocked, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    node->mMpscNext = NULL;
+    const LocMpscNode* prev = __atomic_exchange_n(&mHead, node, __ATOMIC_ACQ_REL);
+    // until this store the consumer sees prev as the last node
+    __atomic_store_n(&prev->mMpscNext, node, __ATOMIC_RELEASE);
+
+    // pairs with the increment in pop(): either the consumer sees the
+    // node before it sleeps or we see it waiting
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mWaiters, __ATOMIC_RELAXED) > 0) {
+        wake(1);
+    }
+    return true;
+}
+
+const LocMpscNode* LocMpscQueue::tryPop() {
+    const LocMpscNode* tail = mTail;
+    const LocMpscNode* next = __atomic_load_n(&tail->mMpscNext, __ATOMIC_ACQUIRE);
+
+    if (tail == &mStub) {
+        if (NULL == next) {
+            return NULL;
+        }
+        mTail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->mMpscNext, __ATOMIC_ACQUIRE);
+    }
+
+    if (NULL != next) {
+        mTail = next;
+        return tail;
+    }
+
+    if (tail != __atomic_load_n(&mHead, __ATOMIC_ACQUIRE)) {
+        // a producer swapped mHead but has not linked its node yet
+        return NULL;
+    }
+
+    // tail is the only node; put the stub behind it so it can go
+    mStub.mMpscNext = NULL;
+    const LocMpscNode* prev = __atomic_exchange_n(&mHead, &mStub, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->mMpscNext, &mStub, __ATOMIC_RELEASE);
+
+    next = __atomic_load_n(&tail->mMpscNext, __ATOMIC_ACQUIRE);
+    if (NULL != next) {
+        mTail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+const LocMpscNode* LocMpscQueue::pop() {
+    const LocMpscNode* node = NULL;
+
+    while (!__atomic_load_n(&mUnblocked, __ATOMIC_ACQUIRE)) {
+        node = tryPop();
+        if (NULL != node) {
+            break;
+        }
+
+        int signal = __atomic_load_n(&mSignal, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&mWaiters, 1, __ATOMIC_SEQ_CST);
+        node = tryPop();
+        if (NULL == node && !__atomic_load_n(&mUnblocked, __ATOMIC_ACQUIRE)) {
+            if (__atomic_load_n(&mHead, __ATOMIC_ACQUIRE) != mTail) {
+                // a push is half way through, it will not take long
+                sched_yield();
+            } else {
+                futexWait(&mSignal, signal);
+            }
+        }
+        __atomic_sub_fetch(&mWaiters, 1, __ATOMIC_SEQ_CST);
+        if (NULL != node) {
+            break;
+        }
+    }
+    return node;
+}
+
+void LocMpscQueue::unblock() {
+    __atomic_store_n(&mUnblocked, 1, __ATOMIC_RELEASE);
+    wake(INT_MAX);
+}
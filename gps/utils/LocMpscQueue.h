@@ -0,0 +1,73 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_MPSC_QUEUE__
+#define __LOC_MPSC_QUEUE__
+
+#include <stddef.h>
+
+// link embedded in the queued object, so queueing it needs no allocation
+struct LocMpscNode {
+    mutable const LocMpscNode* mMpscNext;
+    inline LocMpscNode() : mMpscNext(NULL) {}
+};
+
+// Intrusive multi producer, single consumer FIFO. Producers link nodes in
+// with one atomic exchange; the consumer sleeps on a futex only when the
+// queue is empty, and producers make the wake syscall only when it does.
+class LocMpscQueue {
+    LocMpscNode mStub;
+    const LocMpscNode* mHead;   // last pushed, swapped by producers
+    const LocMpscNode* mTail;   // next to pop, owned by the consumer
+    int mSignal;                // futex word, bumped to wake the consumer
+    int mWaiters;
+    int mUnblocked;
+
+    void wake(int waiters);
+public:
+    LocMpscQueue();
+    inline ~LocMpscQueue() {}
+
+    // appends node; false if the queue has been unblocked, in which case
+    // the node is not queued and stays with the caller.
+    bool push(const LocMpscNode* node);
+
+    // removes the oldest node, waiting while the queue is empty.
+    // Returns NULL once the queue is unblocked. Consumer thread only.
+    const LocMpscNode* pop();
+
+    // same as pop() without waiting, NULL if nothing is queued.
+    // Consumer thread only, or once no consumer is left.
+    const LocMpscNode* tryPop();
+
+    // wakes the consumer and stops the queue for good, like msg_q_unblock().
+    // Nodes still queued can be drained with tryPop().
+    void unblock();
+};
+
+#endif //__LOC_MPSC_QUEUE__
@@ -0,0 +1,93 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_MsgPool"
+
+#include <stdlib.h>
+#include <new>
+#include <LocMsgPool.h>
+#include <platform_lib_includes.h>
+
+LocMsgPool::LocMsgPool(size_t blockSize, const char* name, uint32_t depth) :
+    mSize(blockSize),
+    mBlockSize(blockSize < sizeof(Block) ? sizeof(Block) : blockSize),
+    mDepth(depth), mName(name), mFree(NULL), mFreeCnt(0),
+    mAllocCnt(0), mRecycleCnt(0), mDropCnt(0) {
+    pthread_mutex_init(&mLock, NULL);
+}
+
+void* LocMsgPool::alloc(size_t size) {
+    if (size != mSize) {
+        return ::operator new(size, std::nothrow);
+    }
+
+    pthread_mutex_lock(&mLock);
+    Block* block = mFree;
+    if (NULL != block) {
+        mFree = block->mNext;
+        mFreeCnt--;
+        mRecycleCnt++;
+    } else {
+        mAllocCnt++;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    if (NULL == block) {
+        block = (Block*)malloc(mBlockSize);
+        LOC_LOGD("%s: %u blocks from heap, %u recycled, %u dropped",
+                 mName, mAllocCnt, mRecycleCnt, mDropCnt);
+    }
+    return block;
+}
+
+void LocMsgPool::release(void* p, size_t size) {
+    if (NULL == p) {
+        return;
+    }
+    if (size != mSize) {
+        ::operator delete(p);
+        return;
+    }
+
+    Block* block = (Block*)p;
+    pthread_mutex_lock(&mLock);
+    if (mFreeCnt < mDepth) {
+        block->mNext = mFree;
+        mFree = block;
+        mFreeCnt++;
+        block = NULL;
+    } else {
+        mDropCnt++;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    if (NULL != block) {
+        free(block);
+    }
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_MSG_POOL__
+#define __LOC_MSG_POOL__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// blocks kept on the free list of a pool by default
+#define LOC_MSG_POOL_DEPTH 16
+
+// Free list of fixed size blocks, meant to back the class specific
+// operator new/delete of a LocMsg type that is sent at fix rate.
+// Blocks of other sizes (e.g. a subclass) go straight to the heap.
+// Allocation and release may happen on different threads.
+class LocMsgPool {
+    struct Block {
+        Block* mNext;
+    };
+    const size_t mSize;       // size served from the pool
+    const size_t mBlockSize;
+    const uint32_t mDepth;
+    const char* const mName;
+    pthread_mutex_t mLock;
+    Block* mFree;
+    uint32_t mFreeCnt;
+    uint32_t mAllocCnt;    // blocks taken from the heap
+    uint32_t mRecycleCnt;  // allocations served from the free list
+    uint32_t mDropCnt;     // releases given back to the heap, list full
+public:
+    LocMsgPool(size_t blockSize, const char* name,
+               uint32_t depth = LOC_MSG_POOL_DEPTH);
+    // there is no destructor on purpose: a message may still be released
+    // while static objects are destroyed at exit
+
+    // NULL when out of memory; the operator new using it must be
+    // declared non-throwing
+    void* alloc(size_t size);
+    void release(void* p, size_t size);
+
+    inline uint32_t getAllocCnt() const { return mAllocCnt; }
+    inline uint32_t getRecycleCnt() const { return mRecycleCnt; }
+    inline uint32_t getDropCnt() const { return mDropCnt; }
+};
+
+#endif //__LOC_MSG_POOL__
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <errno.h>
+#include <unistd.h>
 #include <loc_timer.h>
 #include <sys/timerfd.h>
 #include <sys/epoll.h>
@@ -47,8 +48,9 @@
 #endif
 
 /*
-There are implementations of 5 classes in this file:
-LocTimer, LocTimerDelegate, LocTimerContainer, LocTimerPollTask, LocTimerWrapper
+There are implementations of 6 classes in this file:
+LocTimer, LocTimerDelegate, LocTimerContainer, LocTimerPollTask, LocTimerWheel,
+LocTimerWrapper
 
 LocTimer - client front end, interface for client to start / stop timers, also
            to provide a callback.
@@ -63,7 +65,7 @@ LocTimerDelegate - an internal timer entity, which also is a LocRankable obj.
                    heap, its ranks() implementation decides where it is placed
                    in the heap.
 LocTimerContainer - core of the timer service. It is a container (derived from
-                    LocHeap) for LocTimerDelegate (implements LocRankable) objs.
+                    LocIndexedHeap) for LocTimerDelegate (implements LocRankable) objs.
                     There are 2 of such containers, one for sw timers (or Linux
                     timers) one for hw timers (or Linux alarms). It adds one of
                     each (those that expire the soonest) to kernel via services
@@ -74,6 +76,11 @@ LocTimerPollTask - is a class that wraps timerfd and epoll POXIS APIs. It also
                    both implements LocRunnalbe with epoll_wait() in the run()
                    method. It is also a LocThread client, so as to loop the run
                    method.
+LocTimerWheel - replaces LocTimerContainer and LocTimerPollTask for the timers
+                started while a slack is configured. A hierarchical timing
+                wheel with its own timerfd and thread, which adds / removes
+                timers in the caller's context in constant time, and expires
+                the timers that are due within the same slack in one batch.
 LocTimerWrapper - a LocTimer client itself, to implement the existing C API with
                   APIs, loc_timer_start() and loc_timer_stop().
 
@@ -82,14 +89,14 @@ LocTimerWrapper - a LocTimer client itself, to implement the existing C API with
 class LocTimerPollTask;
 
 // This is a multi-functaional class that:
-// * extends the LocHeap class for the detection of head update upon add / remove
+// * extends the LocIndexedHeap class for the detection of head update upon add / remove
 //   events. When that happens, soonest time out changes, so timerfd needs update.
 // * contains the timers, and add / remove them into the heap
 // * provides and maps 2 of such containers, one for timers (or  mSwTimers), one
 //   for alarms (or mHwTimers);
 // * provides a polling thread;
 // * provides a MsgTask thread for synchronized add / remove / timer client callback.
-class LocTimerContainer : public LocHeap {
+class LocTimerContainer : public LocIndexedHeap {
     // mutex to synchronize getters of static members
     static pthread_mutex_t mMutex;
     // Container of timers
@@ -108,7 +115,7 @@ class LocTimerContainer : public LocHeap {
     ~LocTimerContainer();
     static MsgTask* getMsgTaskLocked();
     static LocTimerPollTask* getPollTaskLocked();
-    // extend LocHeap and pop if the top outRanks input
+    // extend LocIndexedHeap and pop if the top outRanks input
     LocTimerDelegate* popIfOutRanks(LocTimerDelegate& timer);
     // update the timer POSIX calls with updated soonest timer spec
     void updateSoonestTime(LocTimerDelegate* priorTop);
@@ -167,20 +174,101 @@ public:
     virtual bool run();
 };
 
+// This class is the alternative to LocTimerContainer when a non zero slack is
+// configured with LocTimer::setSlack(). It is a hierarchical timing wheel that
+// counts time in ticks of the slack. A timer's deadline is rounded up to a tick,
+// so timers falling into the same tick expire together in one pass, and a
+// timer may fire up to one tick late. Each of the WHEEL_LEVELS levels has
+// WHEEL_SLOTS slots, a level n slot covering WHEEL_SLOTS^n ticks. A timer is
+// hashed into the lowest level whose range covers its distance from mNow, and
+// cascaded down when the wheel turns onto its slot. add() / remove() run in the
+// caller's thread under mWheelMutex in constant time, without a MsgTask round
+// trip; the timerfd is only reprogrammed when the soonest tick changes. Expiry
+// runs in the wheel's own thread, blocked on the timerfd.
+class LocTimerWheel : public LocRunnable {
+    static const int WHEEL_BITS = 6;
+    static const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const int WHEEL_LEVELS = 4;
+    static const uint64_t WHEEL_DISARMED = ~(uint64_t)0;
+    // mutex to synchronize getters of static members
+    static pthread_mutex_t mMutex;
+    // wheel of timers
+    static LocTimerWheel* mSwWheel;
+    // wheel of alarms
+    static LocTimerWheel* mHwWheel;
+    // tick size of wheels created from now on, 0 to use LocTimerContainer
+    static uint32_t mSlackMs;
+    const uint32_t mTickMs;
+    // timer / alarm fd and the epoll fd it is polled on
+    int mDevFd;
+    const int mPollFd;
+    LocThread* mThread;
+    // guards everything below, and the wheel states of the timers
+    pthread_mutex_t mWheelMutex;
+    // the tick the wheel has turned to
+    uint64_t mNow;
+    // the tick the timerfd is armed for, or WHEEL_DISARMED
+    uint64_t mArmedTick;
+    // number of timers in the slots
+    uint32_t mCount;
+    // per level bitmap of non empty slots
+    uint64_t mOccupied[WHEEL_LEVELS];
+    LocTimerDelegate* mSlots[WHEEL_LEVELS][WHEEL_SLOTS];
+    friend class LocThreadDelegate;
+    // ctor
+    LocTimerWheel(bool wakeOnExpire, uint32_t tickMs);
+    // dtor
+    ~LocTimerWheel();
+    uint64_t getNowTick();
+    void insertLocked(LocTimerDelegate& timer);
+    void unlinkLocked(LocTimerDelegate& timer);
+    static uint64_t getSlotDistance(uint64_t occupied, int slot);
+    // the next tick at which a slot needs expiring or cascading
+    uint64_t getNextStopLocked();
+    // the soonest deadline in the wheel
+    uint64_t getSoonestTickLocked();
+    void armLocked(uint64_t tick);
+    // turn the wheel to now, returning the list of the expired timers
+    LocTimerDelegate* turnLocked(uint64_t now);
+
+public:
+    static void setSlack(uint32_t slackMs);
+    // factory method to control the creation of mSwWheel / mHwWheel.
+    // Returns NULL if no slack is configured.
+    static LocTimerWheel* get(bool wakeOnExpire);
+    // add a timer / alarm obj into the wheel
+    void add(LocTimerDelegate& timer);
+    // remove a timer / alarm obj from the wheel, and delete it
+    void remove(LocTimerDelegate& timer);
+    // The wheel thread context will call this method. It blocks until the
+    // timerfd fires, then expires all the due timers.
+    virtual bool run();
+};
+
 // Internal class of timer obj. It gets born when client calls LocTimer::start();
 // and gets deleted when client calls LocTimer::stop() or when the it expire()'s.
 // This class implements LocRankable::ranks() so that when an obj is added into
-// the container (of LocHeap), it gets placed in sorted order.
+// the container (of LocIndexedHeap), it gets placed in sorted order.
 class LocTimerDelegate : public LocRankable {
     friend class LocTimerContainer;
+    friend class LocTimerWheel;
     friend class LocTimer;
     LocTimer* mClient;
     LocSharedLock* mLock;
     struct timespec mFutureTime;
     LocTimerContainer* mContainer;
+    LocTimerWheel* mWheel;
+    // wheel bookkeeping, guarded by the wheel's mutex
+    enum { WHEEL_LINKED, WHEEL_FIRING, WHEEL_STOPPED, WHEEL_FIRED } mWheelState;
+    uint64_t mTick;
+    LocTimerDelegate** mSlot;
+    LocTimerDelegate* mPrev;
+    LocTimerDelegate* mNext;
     // not a complete obj, just ctor for LocRankable comparisons
     inline LocTimerDelegate(struct timespec& delay)
-        : mClient(NULL), mLock(NULL), mFutureTime(delay), mContainer(NULL) {}
+        : mClient(NULL), mLock(NULL), mFutureTime(delay), mContainer(NULL),
+          mWheel(NULL), mWheelState(WHEEL_FIRED), mTick(0), mSlot(NULL),
+          mPrev(NULL), mNext(NULL) {}
     inline ~LocTimerDelegate() { if (mLock) { mLock->drop(); mLock = NULL; } }
 public:
     LocTimerDelegate(LocTimer& client, struct timespec& futureTime, bool wakeOnExpire);
@@ -310,13 +398,18 @@ inline
 void LocTimerContainer::add(LocTimerDelegate& timer) {
     struct MsgTimerPush : public LocMsg {
         LocTimerContainer* mTimerContainer;
-        LocHeapNode* mTree;
         LocTimerDelegate* mTimer;
         inline MsgTimerPush(LocTimerContainer& container, LocTimerDelegate& timer) :
             LocMsg(), mTimerContainer(&container), mTimer(&timer) {}
         inline virtual void proc() const {
             LocTimerDelegate* priorTop = mTimerContainer->getSoonestTimer();
-            mTimerContainer->push((LocRankable&)(*mTimer));
+            if (!mTimerContainer->push((LocRankable&)(*mTimer))) {
+                // no room to wait in, so the timer fires now rather than
+                // never. The delegate gets deleted through remove() as usual.
+                LOC_LOGE("%s: timer heap full, expiring timer %p now", __FUNCTION__, mTimer);
+                mTimer->expire();
+                return;
+            }
             mTimerContainer->updateSoonestTime(priorTop);
         }
     };
@@ -336,7 +429,7 @@ void LocTimerContainer::remove(LocTimerDelegate& timer) {
 
             // update soonest timer only if mTimer is actually removed from
             // mTimerContainer AND mTimer is not priorTop.
-            if (priorTop == ((LocHeap*)mTimerContainer)->remove((LocRankable&)*mTimer)) {
+            if (priorTop == ((LocIndexedHeap*)mTimerContainer)->remove((LocRankable&)*mTimer)) {
                 // if passing in NULL, we tell updateSoonestTime to update
                 // kernel with the current top timer interval.
                 mTimerContainer->updateSoonestTime(NULL);
@@ -382,7 +475,7 @@ void LocTimerContainer::expire() {
 
 LocTimerDelegate* LocTimerContainer::popIfOutRanks(LocTimerDelegate& timer) {
     LocTimerDelegate* poppedNode = NULL;
-    if (mTree && !timer.outRanks(*peek())) {
+    if (mSize && !timer.outRanks(*peek())) {
         poppedNode = (LocTimerDelegate*)(pop());
     }
 
@@ -469,6 +562,362 @@ bool LocTimerPollTask::run() {
     return rerun;
 }
 
+/***************************LocTimerWheel methods***************************/
+
+// Same as the containers, the wheels are created on demand and never destroyed.
+pthread_mutex_t LocTimerWheel::mMutex = PTHREAD_MUTEX_INITIALIZER;
+LocTimerWheel* LocTimerWheel::mSwWheel = NULL;
+LocTimerWheel* LocTimerWheel::mHwWheel = NULL;
+uint32_t LocTimerWheel::mSlackMs = 0;
+
+LocTimerWheel::LocTimerWheel(bool wakeOnExpire, uint32_t tickMs) :
+    mTickMs(tickMs),
+    mDevFd(timerfd_create(wakeOnExpire ? CLOCK_BOOTTIME_ALARM : CLOCK_BOOTTIME,
+                          TFD_NONBLOCK)),
+    mPollFd(epoll_create(1)), mThread(NULL),
+    mNow(0), mArmedTick(WHEEL_DISARMED), mCount(0) {
+
+    if ((-1 == mDevFd) && (errno == EINVAL)) {
+        LOC_LOGW("%s: timerfd_create failure, fallback to CLOCK_MONOTONIC - %s",
+            __FUNCTION__, strerror(errno));
+        mDevFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    }
+
+    pthread_mutex_init(&mWheelMutex, NULL);
+    memset(mOccupied, 0, sizeof(mOccupied));
+    memset(mSlots, 0, sizeof(mSlots));
+    mNow = getNowTick();
+
+    if (-1 != mDevFd && -1 != mPollFd) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLWAKEUP;
+        ev.data.fd = mDevFd;
+        epoll_ctl(mPollFd, EPOLL_CTL_ADD, mDevFd, &ev);
+
+        mThread = new LocThread();
+        if (!mThread->start("LocTimerWheel", this)) {
+            delete mThread;
+            mThread = NULL;
+        }
+    } else {
+        LOC_LOGE("%s: timerfd_create / epoll_create failure - %s",
+                 __FUNCTION__, strerror(errno));
+    }
+}
+
+// dtor
+// only ever called if the wheel could not get its thread started
+inline
+LocTimerWheel::~LocTimerWheel() {
+    if (-1 != mDevFd) {
+        close(mDevFd);
+    }
+    if (-1 != mPollFd) {
+        close(mPollFd);
+    }
+    pthread_mutex_destroy(&mWheelMutex);
+}
+
+void LocTimerWheel::setSlack(uint32_t slackMs) {
+    pthread_mutex_lock(&mMutex);
+    mSlackMs = slackMs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+LocTimerWheel* LocTimerWheel::get(bool wakeOnExpire) {
+    LocTimerWheel* wheel = NULL;
+    pthread_mutex_lock(&mMutex);
+    // with no slack timers go to LocTimerContainer. A wheel keeps the tick
+    // size it was created with, so changing slack afterwards only switches
+    // between the wheel and the container.
+    if (mSlackMs) {
+        LocTimerWheel*& theWheel = wakeOnExpire ? mHwWheel : mSwWheel;
+        if (!theWheel) {
+            theWheel = new LocTimerWheel(wakeOnExpire, mSlackMs);
+            // timerfd / thread failure, the ownership of the obj
+            // stays with us only if the thread was not started.
+            if (!theWheel->mThread) {
+                delete theWheel;
+                theWheel = NULL;
+            }
+        }
+        wheel = theWheel;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return wheel;
+}
+
+inline
+uint64_t LocTimerWheel::getNowTick() {
+    struct timespec now;
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return ((uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000) / mTickMs;
+}
+
+void LocTimerWheel::insertLocked(LocTimerDelegate& timer) {
+    // timers further out than the top level covers are parked at its far
+    // end, and get cascaded back into it when the wheel gets there.
+    uint64_t tick = timer.mTick;
+    uint64_t maxTick = mNow + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    if (tick > maxTick) {
+        tick = maxTick;
+    }
+
+    // a timer due at mNow can only come from a cascade at mNow, and goes
+    // to the level 0 slot that is about to be expired.
+    int level = 0;
+    uint64_t delta = tick - mNow;
+    while (level < WHEEL_LEVELS - 1 && delta >> (WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    int slot = (tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+
+    LocTimerDelegate*& head = mSlots[level][slot];
+    timer.mSlot = &head;
+    timer.mPrev = NULL;
+    timer.mNext = head;
+    if (head) {
+        head->mPrev = &timer;
+    }
+    head = &timer;
+    mOccupied[level] |= 1ULL << slot;
+    timer.mWheelState = LocTimerDelegate::WHEEL_LINKED;
+}
+
+void LocTimerWheel::unlinkLocked(LocTimerDelegate& timer) {
+    if (timer.mNext) {
+        timer.mNext->mPrev = timer.mPrev;
+    }
+    if (timer.mPrev) {
+        timer.mPrev->mNext = timer.mNext;
+    } else {
+        *timer.mSlot = timer.mNext;
+        if (!timer.mNext) {
+            int index = timer.mSlot - &mSlots[0][0];
+            mOccupied[index / WHEEL_SLOTS] &= ~(1ULL << (index % WHEEL_SLOTS));
+        }
+    }
+    timer.mSlot = NULL;
+    timer.mPrev = NULL;
+    timer.mNext = NULL;
+}
+
+// distance, 1 to WHEEL_SLOTS, from slot to the next non empty slot in the
+// bitmap, or 0 if the bitmap is empty.
+inline
+uint64_t LocTimerWheel::getSlotDistance(uint64_t occupied, int slot) {
+    uint64_t later = (slot + 1 < WHEEL_SLOTS) ? occupied >> (slot + 1) : 0;
+    if (later) {
+        return __builtin_ctzll(later) + 1;
+    } else if (occupied) {
+        // wrap around
+        return __builtin_ctzll(occupied) + WHEEL_SLOTS - slot;
+    }
+    return 0;
+}
+
+uint64_t LocTimerWheel::getNextStopLocked() {
+    uint64_t stop = WHEEL_DISARMED;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        uint64_t distance = getSlotDistance(mOccupied[level],
+                                             (mNow >> shift) & (WHEEL_SLOTS - 1));
+        if (distance) {
+            // level 0 slots are expired at their tick, upper level slots are
+            // cascaded at the first tick they cover.
+            uint64_t tick = ((mNow >> shift) + distance) << shift;
+            if (tick < stop) {
+                stop = tick;
+            }
+        }
+    }
+    return stop;
+}
+
+uint64_t LocTimerWheel::getSoonestTickLocked() {
+    uint64_t soonest = WHEEL_DISARMED;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        int slot = (mNow >> shift) & (WHEEL_SLOTS - 1);
+        uint64_t distance = getSlotDistance(mOccupied[level], slot);
+        if (distance) {
+            // the nearest non empty slot of a level holds its soonest timers
+            slot = (slot + distance) & (WHEEL_SLOTS - 1);
+            for (LocTimerDelegate* timer = mSlots[level][slot];
+                 NULL != timer; timer = timer->mNext) {
+                if (timer->mTick < soonest) {
+                    soonest = timer->mTick;
+                }
+            }
+        }
+    }
+    return soonest;
+}
+
+void LocTimerWheel::armLocked(uint64_t tick) {
+    if (tick != mArmedTick) {
+        struct itimerspec delay;
+        memset(&delay, 0, sizeof(delay));
+        if (WHEEL_DISARMED != tick) {
+            // armed relative to now, as the fd may have fallen back to a clock
+            // other than CLOCK_BOOTTIME; a due tick still needs a non 0 value.
+            struct timespec now;
+            clock_gettime(CLOCK_BOOTTIME, &now);
+            int64_t delayNs = (int64_t)(tick * mTickMs) * 1000000 -
+                ((int64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+            if (delayNs <= 0) {
+                delayNs = 1;
+            }
+            delay.it_value.tv_sec = delayNs / 1000000000;
+            delay.it_value.tv_nsec = delayNs % 1000000000;
+        }
+        timerfd_settime(mDevFd, 0, &delay, NULL);
+        mArmedTick = tick;
+    }
+}
+
+LocTimerDelegate* LocTimerWheel::turnLocked(uint64_t now) {
+    LocTimerDelegate* expired = NULL;
+
+    // only stop at the ticks that have slots to cascade or expire, instead
+    // of going through every tick. Any timer is in the slots of ticks later
+    // than now when this loop ends.
+    for (uint64_t stop = getNextStopLocked(); stop <= now; stop = getNextStopLocked()) {
+        mNow = stop;
+        for (int level = WHEEL_LEVELS - 1; level >= 0; level--) {
+            int shift = WHEEL_BITS * level;
+            if (stop & ((1ULL << shift) - 1)) {
+                continue;
+            }
+            int slot = (stop >> shift) & (WHEEL_SLOTS - 1);
+            LocTimerDelegate* timer = mSlots[level][slot];
+            mSlots[level][slot] = NULL;
+            mOccupied[level] &= ~(1ULL << slot);
+            while (timer) {
+                LocTimerDelegate* next = timer->mNext;
+                if (level) {
+                    // cascade into a lower level, or back to the top
+                    // level if the timer was parked
+                    insertLocked(*timer);
+                } else {
+                    timer->mSlot = NULL;
+                    timer->mPrev = NULL;
+                    timer->mNext = expired;
+                    timer->mWheelState = LocTimerDelegate::WHEEL_FIRING;
+                    expired = timer;
+                    mCount--;
+                }
+                timer = next;
+            }
+        }
+    }
+
+    if (now > mNow) {
+        mNow = now;
+    }
+    return expired;
+}
+
+void LocTimerWheel::add(LocTimerDelegate& timer) {
+    // deadline rounded up to the tick
+    uint64_t futureMs = (uint64_t)timer.mFutureTime.tv_sec * 1000 +
+        (timer.mFutureTime.tv_nsec + 999999) / 1000000;
+
+    pthread_mutex_lock(&mWheelMutex);
+    // an empty wheel is not kept turning, bring it to now
+    if (0 == mCount) {
+        mNow = getNowTick();
+    }
+    timer.mTick = (futureMs + mTickMs - 1) / mTickMs;
+    if (timer.mTick <= mNow) {
+        timer.mTick = mNow + 1;
+    }
+    insertLocked(timer);
+    mCount++;
+    if (timer.mTick < mArmedTick) {
+        armLocked(timer.mTick);
+    }
+    pthread_mutex_unlock(&mWheelMutex);
+}
+
+void LocTimerWheel::remove(LocTimerDelegate& timer) {
+    bool toDelete = true;
+
+    pthread_mutex_lock(&mWheelMutex);
+    switch (timer.mWheelState) {
+    case LocTimerDelegate::WHEEL_LINKED:
+        unlinkLocked(timer);
+        mCount--;
+        // the soonest tick only changes if it was this timer's
+        if (timer.mTick == mArmedTick) {
+            armLocked(getSoonestTickLocked());
+        }
+        break;
+    case LocTimerDelegate::WHEEL_FIRING:
+        // run() is about to call or calling expire() on it,
+        // and will do the delete after that.
+        timer.mWheelState = LocTimerDelegate::WHEEL_STOPPED;
+        toDelete = false;
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&mWheelMutex);
+
+    if (toDelete) {
+        delete &timer;
+    }
+}
+
+// The wheel thread context will call this method. If run() method needs to
+// be repetitvely called, it must return true from the previous call.
+bool LocTimerWheel::run() {
+    struct epoll_event ev;
+    int fds = epoll_wait(mPollFd, &ev, 1, -1);
+
+    // we pretty much want to continually poll until the fd is closed
+    bool rerun = (fds > 0) || (errno == EINTR);
+
+    if (fds > 0) {
+        uint64_t expirations;
+        // clear the readiness of the fd, it may be rearmed already
+        read(mDevFd, &expirations, sizeof(expirations));
+
+        pthread_mutex_lock(&mWheelMutex);
+        mArmedTick = WHEEL_DISARMED;
+        LocTimerDelegate* expired = turnLocked(getNowTick());
+        armLocked(getSoonestTickLocked());
+        pthread_mutex_unlock(&mWheelMutex);
+
+        // all the timers of the pass are called back outside of the mutex,
+        // so that they can start / stop timers.
+        while (expired) {
+            LocTimerDelegate* timer = expired;
+            expired = timer->mNext;
+            timer->mNext = NULL;
+
+            // the timer delegate obj gets stopped, but not deleted, in this call
+            timer->expire();
+
+            pthread_mutex_lock(&mWheelMutex);
+            bool toDelete = (LocTimerDelegate::WHEEL_STOPPED == timer->mWheelState);
+            if (!toDelete) {
+                // not stopped yet, leave the delete to remove()
+                timer->mWheelState = LocTimerDelegate::WHEEL_FIRED;
+            }
+            pthread_mutex_unlock(&mWheelMutex);
+
+            if (toDelete) {
+                delete timer;
+            }
+        }
+    }
+
+    // if rerun is true, we are requesting to be scheduled again
+    return rerun;
+}
+
 /***************************LocTimerDelegate methods***************************/
 
 inline
@@ -476,9 +925,16 @@ LocTimerDelegate::LocTimerDelegate(LocTimer& client, struct timespec& futureTime
     : mClient(&client),
       mLock(mClient->mLock->share()),
       mFutureTime(futureTime),
-      mContainer(LocTimerContainer::get(wakeOnExpire)) {
-    // adding the timer into the container
-    mContainer->add(*this);
+      mContainer(NULL),
+      mWheel(LocTimerWheel::get(wakeOnExpire)),
+      mWheelState(WHEEL_FIRED), mTick(0), mSlot(NULL), mPrev(NULL), mNext(NULL) {
+    // adding the timer into the wheel if there is one, or else the container
+    if (mWheel) {
+        mWheel->add(*this);
+    } else {
+        mContainer = LocTimerContainer::get(wakeOnExpire);
+        mContainer->add(*this);
+    }
 }
 
 inline
@@ -494,9 +950,13 @@ void LocTimerDelegate::destroyLocked() {
         if (container) {
             container->remove(*this);
         }
+    } else if (mWheel) {
+        LocTimerWheel* wheel = mWheel;
+        mWheel = NULL;
+        wheel->remove(*this);
     } // else we do not do anything. No such *this* can be
-      // created and reached here with mContainer ever been
-      // a non NULL. So *this* must have reached the if clause
+      // created and reached here with mContainer or mWheel ever
+      // been a non NULL. So *this* must have reached the if clause
       // once, and we want it reach there only once.
 }
 
@@ -579,6 +1039,10 @@ bool LocTimer::stop() {
     return success;
 }
 
+void LocTimer::setSlack(uint32_t slackMs) {
+    LocTimerWheel::setSlack(slackMs);
+}
+
 /***************************LocTimerWrapper methods***************************/
 //////////////////////////////////////////////////////////////////////////
 // This section below wraps for the C style APIs
@@ -692,6 +1156,10 @@ int main(int argc, char** argv) {
     srand(time(NULL));
     int tries = atoi(argv[1]);
     int checks = tries >> 3;
+    // optional slack in ms, to run the test against LocTimerWheel
+    if (argc > 2) {
+        LocTimer::setSlack(atoi(argv[2]));
+    }
     LocTimerTest** timerArray = new LocTimerTest*[tries];
     memset(timerArray, NULL, tries);
 
@@ -65,6 +65,14 @@ public:
     //               false on failure, e.g. timer is not running.
     bool stop();
 
+    // slackMs:      how late timers started from now on may expire, so
+    //               that timers due close to each other get batched.
+    //               0 (the default) to expire every timer precisely.
+    //               A slack applies to all LocTimer's in the process, and
+    //               the first non 0 value sticks; setting it back to 0
+    //               restores precise timers for new starts.
+    static void setSlack(uint32_t slackMs);
+
     //  LocTimer client Should implement this method.
     //  This method is used for timeout calling back to client. This method
     //  should be short enough (eg: send a message to your own thread).
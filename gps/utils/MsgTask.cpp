@@ -31,17 +31,12 @@
 
 #include <unistd.h>
 #include <MsgTask.h>
-#include <msg_q.h>
 #include <loc_log.h>
 #include <platform_lib_includes.h>
 
-static void LocMsgDestroy(void* msg) {
-    delete (LocMsg*)msg;
-}
-
 MsgTask::MsgTask(LocThread::tCreate tCreator,
                  const char* threadName, bool joinable) :
-    mQ(msg_q_init2()), mThread(new LocThread()) {
+    mQ(), mThread(new LocThread()) {
     if (!mThread->start(tCreator, threadName, this, joinable)) {
         delete mThread;
         mThread = NULL;
@@ -49,7 +44,7 @@ MsgTask::MsgTask(LocThread::tCreate tCreator,
 }
 
 MsgTask::MsgTask(const char* threadName, bool joinable) :
-    mQ(msg_q_init2()), mThread(new LocThread()) {
+    mQ(), mThread(new LocThread()) {
     if (!mThread->start(threadName, this, joinable)) {
         delete mThread;
         mThread = NULL;
@@ -57,13 +52,16 @@ MsgTask::MsgTask(const char* threadName, bool joinable) :
 }
 
 MsgTask::~MsgTask() {
-    msg_q_flush((void*)mQ);
-    msg_q_destroy((void**)&mQ);
+    // the thread is gone by now, drop what it did not get to
+    const LocMpscNode* node;
+    while (NULL != (node = mQ.tryPop())) {
+        delete static_cast<const LocMsg*>(node);
+    }
 }
 
 void MsgTask::destroy() {
     LocThread* thread = mThread;
-    msg_q_unblock((void*)mQ);
+    mQ.unblock();
     if (thread) {
         mThread = NULL;
         delete thread;
@@ -73,7 +71,12 @@ void MsgTask::destroy() {
 }
 
 void MsgTask::sendMsg(const LocMsg* msg) const {
-    msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+    if (NULL == msg) {
+        LOC_LOGE("%s:%d] NULL msg\n", __func__, __LINE__);
+    } else if (!mQ.push(msg)) {
+        LOC_LOGE("%s:%d] queue unblocked, msg dropped\n", __func__, __LINE__);
+        delete msg;
+    }
 }
 
 void MsgTask::prerun() {
@@ -83,11 +86,9 @@ void MsgTask::prerun() {
 
 bool MsgTask::run() {
     LOC_LOGV("MsgTask::loop() listening ...\n");
-    LocMsg* msg;
-    msq_q_err_type result = msg_q_rcv((void*)mQ, (void **)&msg);
-    if (eMSG_Q_SUCCESS != result) {
-        LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
-                 loc_get_msg_q_status(result));
+    const LocMsg* msg = static_cast<const LocMsg*>(mQ.pop());
+    if (NULL == msg) {
+        LOC_LOGE("%s:%d] fail receiving msg: queue unblocked\n", __func__, __LINE__);
         return false;
     }
 
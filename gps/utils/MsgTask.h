@@ -30,8 +30,9 @@
 #define __MSG_TASK__
 
 #include <LocThread.h>
+#include <LocMpscQueue.h>
 
-struct LocMsg {
+struct LocMsg : public LocMpscNode {
     inline LocMsg() {}
     inline virtual ~LocMsg() {}
     virtual void proc() const = 0;
@@ -39,7 +40,7 @@ struct LocMsg {
 };
 
 class MsgTask : public LocRunnable {
-    const void* mQ;
+    mutable LocMpscQueue mQ;
     LocThread* mThread;
     friend class LocThreadDelegate;
 protected: